@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2013, 2018, 2023, 2024 University College London
+    Copyright (C) 2013, 2018, 2023, 2024, 2026 University College London
     Copyright 2017 ETH Zurich, Institute of Particle Physics and Astrophysics
     This file is part of STIR.
 
@@ -37,6 +37,7 @@
 #include "stir/CartesianCoordinate3D.h"
 #include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/ProjDataFromStream.h"
+#include "stir/ProjDataSparse.h"
 #include "stir/ProjDataInfoCylindricalArcCorr.h"
 #include "stir/Scanner.h"
 #include "stir/Succeeded.h"
@@ -1032,6 +1033,12 @@ read_interfile_PDFS(istream& input, const string& directory_for_data, const ios:
   strcpy(full_data_file_name, hdr.data_file_name.c_str());
   prepend_directory_name(full_data_file_name, directory_for_data.c_str());
 
+  // a sparse data file would otherwise be interpreted as a (corrupt) dense one
+  if (ProjDataSparse::is_sparse_data_file(full_data_file_name))
+    error(boost::format("read_interfile_PDFS: %1% contains sparse projection data, which cannot be read as ProjDataFromStream. "
+                        "Use ProjData::read_from_file() instead.")
+          % full_data_file_name);
+
   for (unsigned int i = 1; i < hdr.image_scaling_factors[0].size(); i++)
     if (hdr.image_scaling_factors[0][0] != hdr.image_scaling_factors[0][i])
       {
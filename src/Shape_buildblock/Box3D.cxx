@@ -21,6 +21,9 @@
 #include "stir/Succeeded.h"
 #include "stir/warning.h"
 #include "stir/error.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 START_NAMESPACE_STIR
 
@@ -121,6 +124,43 @@ Box3D::is_inside_shape(const CartesianCoordinate3D<float>& coord) const
          && fabs(distance_along_z_axis) < length_z / 2;
 }
 
+Succeeded
+Box3D::get_bounding_box(CartesianCoordinate3D<float>& min_coord, CartesianCoordinate3D<float>& max_coord) const
+{
+  return this->get_bounding_box_for_box_in_shape_coords(
+      min_coord, max_coord, CartesianCoordinate3D<float>(length_z / 2, length_y / 2, length_x / 2));
+}
+
+Succeeded
+Box3D::get_line_interval_in_shape_coords(float& t_min,
+                                         float& t_max,
+                                         const CartesianCoordinate3D<float>& start,
+                                         const CartesianCoordinate3D<float>& direction) const
+{
+  const CartesianCoordinate3D<float> half_lengths(length_z / 2, length_y / 2, length_x / 2);
+  t_min = -std::numeric_limits<float>::max();
+  t_max = std::numeric_limits<float>::max();
+  // intersect the intervals for the 3 slabs
+  for (int d = 1; d <= 3; ++d)
+    {
+      if (direction[d] == 0)
+        {
+          if (std::fabs(start[d]) >= half_lengths[d])
+            {
+              t_min = 1.F;
+              t_max = 0.F;
+              return Succeeded::yes;
+            }
+          continue;
+        }
+      const float t1 = (-half_lengths[d] - start[d]) / direction[d];
+      const float t2 = (half_lengths[d] - start[d]) / direction[d];
+      t_min = std::max(t_min, std::min(t1, t2));
+      t_max = std::min(t_max, std::max(t1, t2));
+    }
+  return Succeeded::yes;
+}
+
 float
 Box3D::get_geometric_volume() const
 {
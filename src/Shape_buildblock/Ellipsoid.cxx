@@ -22,6 +22,7 @@
 #include "stir/warning.h"
 #include "stir/error.h"
 #include <cmath>
+#include <limits>
 
 START_NAMESPACE_STIR
 
@@ -125,6 +126,44 @@ Ellipsoid::is_inside_shape(const CartesianCoordinate3D<float>& coord) const
     return false;
 }
 
+Succeeded
+Ellipsoid::get_bounding_box(CartesianCoordinate3D<float>& min_coord, CartesianCoordinate3D<float>& max_coord) const
+{
+  return this->get_bounding_box_for_box_in_shape_coords(min_coord, max_coord, this->radii);
+}
+
+Succeeded
+Ellipsoid::get_line_interval_in_shape_coords(float& t_min,
+                                             float& t_max,
+                                             const CartesianCoordinate3D<float>& start,
+                                             const CartesianCoordinate3D<float>& direction) const
+{
+  // solve |(start + t*direction)/radii|^2 = 1, i.e. a*t^2 + 2*b*t + c = 0
+  const CartesianCoordinate3D<float> s = start / this->radii;
+  const CartesianCoordinate3D<float> d = direction / this->radii;
+  const float a = inner_product(d, d);
+  const float b = inner_product(s, d);
+  const float c = inner_product(s, s) - 1;
+  if (a == 0)
+    {
+      // zero direction, so the "line" is a single point
+      t_min = c <= 0 ? -std::numeric_limits<float>::max() : 1.F;
+      t_max = c <= 0 ? std::numeric_limits<float>::max() : 0.F;
+      return Succeeded::yes;
+    }
+  const float discriminant = b * b - a * c;
+  if (discriminant < 0)
+    {
+      t_min = 1.F;
+      t_max = 0.F;
+      return Succeeded::yes;
+    }
+  const float root = std::sqrt(discriminant);
+  t_min = (-b - root) / a;
+  t_max = (-b + root) / a;
+  return Succeeded::yes;
+}
+
 Shape3D*
 Ellipsoid::clone() const
 {
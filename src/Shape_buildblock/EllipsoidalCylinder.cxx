@@ -28,6 +28,7 @@
 #include "stir/error.h"
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
 START_NAMESPACE_STIR
 
@@ -189,6 +190,72 @@ EllipsoidalCylinder::is_inside_shape(const CartesianCoordinate3D<float>& coord)
     return false;
 }
 
+Succeeded
+EllipsoidalCylinder::get_bounding_box(CartesianCoordinate3D<float>& min_coord, CartesianCoordinate3D<float>& max_coord) const
+{
+  return this->get_bounding_box_for_box_in_shape_coords(
+      min_coord, max_coord, CartesianCoordinate3D<float>(length / 2, radius_y, radius_x));
+}
+
+Succeeded
+EllipsoidalCylinder::get_line_interval_in_shape_coords(float& t_min,
+                                                       float& t_max,
+                                                       const CartesianCoordinate3D<float>& start,
+                                                       const CartesianCoordinate3D<float>& direction) const
+{
+  // partial cylinders are not convex, so let the caller use is_inside_shape()
+  if (theta_1 > 0 || theta_2 < 360)
+    return Succeeded::no;
+
+  t_min = -std::numeric_limits<float>::max();
+  t_max = std::numeric_limits<float>::max();
+  // axial extent
+  if (direction.z() == 0)
+    {
+      if (std::fabs(start.z()) >= length / 2)
+        {
+          t_min = 1.F;
+          t_max = 0.F;
+          return Succeeded::yes;
+        }
+    }
+  else
+    {
+      const float t1 = (-length / 2 - start.z()) / direction.z();
+      const float t2 = (length / 2 - start.z()) / direction.z();
+      t_min = std::min(t1, t2);
+      t_max = std::max(t1, t2);
+    }
+  // ellipse in x,y: solve a*t^2 + 2*b*t + c = 0
+  const float sx = start.x() / radius_x;
+  const float sy = start.y() / radius_y;
+  const float dx = direction.x() / radius_x;
+  const float dy = direction.y() / radius_y;
+  const float a = dx * dx + dy * dy;
+  const float b = sx * dx + sy * dy;
+  const float c = sx * sx + sy * sy - 1;
+  if (a == 0)
+    {
+      if (c > 0)
+        {
+          t_min = 1.F;
+          t_max = 0.F;
+        }
+      return Succeeded::yes;
+    }
+  const float discriminant = b * b - a * c;
+  if (discriminant < 0)
+    {
+      t_min = 1.F;
+      t_max = 0.F;
+      return Succeeded::yes;
+    }
+  const float root = std::sqrt(discriminant);
+  t_min = std::max(t_min, (-b - root) / a);
+  t_max = std::min(t_max, (-b + root) / a);
+  return Succeeded::yes;
+}
+
 float
 EllipsoidalCylinder::get_geometric_volume() const
 {
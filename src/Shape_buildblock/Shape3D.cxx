@@ -21,7 +21,12 @@
 #include "stir/Shape/DiscretisedShape3D.h"
 #include "stir/DiscretisedDensity.h"
 #include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/Succeeded.h"
 #include "stir/info.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
 
 using std::cerr;
 using std::endl;
@@ -90,6 +95,12 @@ Shape3D::get_voxel_weight(const CartesianCoordinate3D<float>& voxel_centre,
   return float(value) / (num_samples.z() * num_samples.y() * num_samples.x());
 }
 
+Succeeded
+Shape3D::get_bounding_box(CartesianCoordinate3D<float>&, CartesianCoordinate3D<float>&) const
+{
+  return Succeeded::no;
+}
+
 /* Construct the volume- use the convexity, e.g
    the inner voxels sampled with num_samples=1, only the outer
    voxels checked with the user defined num_samples
@@ -110,18 +121,40 @@ Shape3D::construct_volume(VoxelsOnCartesianGrid<float>& image, const CartesianCo
   const int max_y = image.get_max_y();
   const int max_x = image.get_max_x();
 
-  CartesianCoordinate3D<int> crude_num_samples(1, 1, 1);
+  // find range of voxels that can intersect the shape.
+  // All sample points are within half a voxel of the voxel centre, so we can ignore
+  // all voxels whose centre is further away from the bounding box.
+  CartesianCoordinate3D<int> min_indices(min_z, min_y, min_x);
+  CartesianCoordinate3D<int> max_indices(max_z, max_y, max_x);
+  {
+    CartesianCoordinate3D<float> min_coord, max_coord;
+    if (this->get_bounding_box(min_coord, max_coord) == Succeeded::yes)
+      {
+        const CartesianCoordinate3D<float> min_box_index = (min_coord - origin) / voxel_size;
+        const CartesianCoordinate3D<float> max_box_index = (max_coord - origin) / voxel_size;
+        for (int d = 1; d <= 3; ++d)
+          {
+            min_indices[d] = std::max(min_indices[d], static_cast<int>(std::floor(min_box_index[d] - .5F)));
+            max_indices[d] = std::min(max_indices[d], static_cast<int>(std::ceil(max_box_index[d] + .5F)));
+          }
+      }
+  }
+
+  image.fill(0.F);
+  if (min_indices.z() > max_indices.z() || min_indices.y() > max_indices.y() || min_indices.x() > max_indices.x())
+    return;
 
-  for (int z = min_z; z <= max_z; z++)
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z = min_indices.z(); z <= max_indices.z(); z++)
     {
-      for (int y = min_y; y <= max_y; y++)
-        for (int x = min_x; x <= max_x; x++)
+      for (int y = min_indices.y(); y <= max_indices.y(); y++)
+        for (int x = min_indices.x(); x <= max_indices.x(); x++)
 
           {
             const CartesianCoordinate3D<float> current_index(static_cast<float>(z), static_cast<float>(y), static_cast<float>(x));
 
-            // image[z][y][x] = get_voxel_weight(current_point,voxel_size,crude_num_samples);
-
             image[z][y][x] = (is_inside_shape(current_index * voxel_size + origin)) ? 1.F : 0.F;
           }
     }
@@ -129,10 +162,14 @@ Shape3D::construct_volume(VoxelsOnCartesianGrid<float>& image, const CartesianCo
   if (num_samples.x() == 1 && num_samples.y() == 1 && num_samples.z() == 1)
     return;
 
-  int num_recomputed = 0;
-  for (int z = min_z; z <= max_z; z++)
-    for (int y = min_y; y <= max_y; y++)
-      for (int x = min_x; x <= max_x; x++)
+  // find edge voxels using the crude image only, such that planes can be handled independently
+  VectorWithOffset<std::vector<std::pair<int, int>>> voxels_to_recompute(min_indices.z(), max_indices.z());
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z = min_indices.z(); z <= max_indices.z(); z++)
+    for (int y = min_indices.y(); y <= max_indices.y(); y++)
+      for (int x = min_indices.x(); x <= max_indices.x(); x++)
         {
           const float current_value = image[z][y][x];
 
@@ -154,13 +191,21 @@ Shape3D::construct_volume(VoxelsOnCartesianGrid<float>& image, const CartesianCo
                     }
             }
           if (recompute)
-            {
-              num_recomputed++;
-              const CartesianCoordinate3D<float> current_index(
-                  static_cast<float>(z), static_cast<float>(y), static_cast<float>(x));
-              image[z][y][x] = get_voxel_weight(current_index * voxel_size + origin, voxel_size, num_samples);
-            }
+            voxels_to_recompute[z].push_back(std::make_pair(y, x));
         }
+
+  int num_recomputed = 0;
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) reduction(+ : num_recomputed)
+#endif
+  for (int z = min_indices.z(); z <= max_indices.z(); z++)
+    for (const auto& y_x : voxels_to_recompute[z])
+      {
+        num_recomputed++;
+        const CartesianCoordinate3D<float> current_index(
+            static_cast<float>(z), static_cast<float>(y_x.first), static_cast<float>(y_x.second));
+        image[z][y_x.first][y_x.second] = get_voxel_weight(current_index * voxel_size + origin, voxel_size, num_samples);
+      }
   info(boost::format("Number of voxels recomputed with finer sampling : %1%") % num_recomputed);
 }
 
@@ -23,6 +23,7 @@
 #include "stir/Succeeded.h"
 #include "stir/warning.h"
 #include "stir/error.h"
+#include <algorithm>
 #include <cmath>
 
 START_NAMESPACE_STIR
@@ -112,6 +113,88 @@ Shape3DWithOrientation::transform_to_shape_coords(const CartesianCoordinate3D<fl
   return matrix_multiply(this->get_direction_vectors(), coord - this->get_origin());
 }
 
+Succeeded
+Shape3DWithOrientation::get_bounding_box_for_box_in_shape_coords(CartesianCoordinate3D<float>& min_coord,
+                                                                 CartesianCoordinate3D<float>& max_coord,
+                                                                 const CartesianCoordinate3D<float>& half_sizes) const
+{
+  // shape coordinates are r = D*(coord - origin), so coord = origin + inverse(D)*r
+  const Array<2, float>& d = this->get_direction_vectors();
+  const float det = determinant(d);
+  if (det == 0)
+    return Succeeded::no;
+  // inverse via the adjugate (indices run from 1 to 3)
+  float inv[4][4];
+  for (int i = 1; i <= 3; ++i)
+    for (int j = 1; j <= 3; ++j)
+      {
+        const int j1 = j % 3 + 1;
+        const int j2 = (j + 1) % 3 + 1;
+        const int i1 = i % 3 + 1;
+        const int i2 = (i + 1) % 3 + 1;
+        inv[i][j] = (d[j1][i1] * d[j2][i2] - d[j1][i2] * d[j2][i1]) / det;
+      }
+  for (int i = 1; i <= 3; ++i)
+    {
+      float half_size = 0.F;
+      for (int j = 1; j <= 3; ++j)
+        half_size += std::fabs(inv[i][j]) * half_sizes[j];
+      min_coord[i] = this->get_origin()[i] - half_size;
+      max_coord[i] = this->get_origin()[i] + half_size;
+    }
+  return Succeeded::yes;
+}
+
+Succeeded
+Shape3DWithOrientation::get_line_interval_in_shape_coords(float&,
+                                                          float&,
+                                                          const CartesianCoordinate3D<float>&,
+                                                          const CartesianCoordinate3D<float>&) const
+{
+  return Succeeded::no;
+}
+
+float
+Shape3DWithOrientation::get_voxel_weight(const CartesianCoordinate3D<float>& voxel_centre,
+                                         const CartesianCoordinate3D<float>& voxel_size,
+                                         const CartesianCoordinate3D<int>& num_samples) const
+{
+  // direction of a line along x (in shape coordinates), with t in units of the voxel size
+  const CartesianCoordinate3D<float> direction
+      = matrix_multiply(this->get_direction_vectors(), CartesianCoordinate3D<float>(0.F, 0.F, voxel_size.x()));
+  {
+    // check if the current shape supports line intervals
+    float t_min, t_max;
+    if (this->get_line_interval_in_shape_coords(t_min, t_max, this->transform_to_shape_coords(voxel_centre), direction)
+        == Succeeded::no)
+      return base_type::get_voxel_weight(voxel_centre, voxel_size, num_samples);
+  }
+
+  const int num_samples_x = num_samples.x();
+  // x-samples are at (k - (num_samples_x-1)/2)/num_samples_x for k=0..num_samples_x-1
+  const float x_offset = (num_samples_x - 1) / 2.F;
+  int value = 0;
+  for (int kz = 0; kz < num_samples.z(); ++kz)
+    {
+      const float zsmall = (kz - (num_samples.z() - 1) / 2.F) / num_samples.z();
+      for (int ky = 0; ky < num_samples.y(); ++ky)
+        {
+          const float ysmall = (ky - (num_samples.y() - 1) / 2.F) / num_samples.y();
+          const CartesianCoordinate3D<float> start = this->transform_to_shape_coords(
+              voxel_centre + CartesianCoordinate3D<float>(zsmall * voxel_size.z(), ysmall * voxel_size.y(), 0.F));
+          float t_min = 1.F, t_max = 0.F;
+          this->get_line_interval_in_shape_coords(t_min, t_max, start, direction);
+          if (t_min > t_max)
+            continue;
+          const int k_min = std::max(0, static_cast<int>(std::ceil(t_min * num_samples_x + x_offset)));
+          const int k_max = std::min(num_samples_x - 1, static_cast<int>(std::floor(t_max * num_samples_x + x_offset)));
+          if (k_max >= k_min)
+            value += k_max - k_min + 1;
+        }
+    }
+  return float(value) / (num_samples.z() * num_samples.y() * num_samples.x());
+}
+
 void
 Shape3DWithOrientation::scale(const CartesianCoordinate3D<float>& scale3D)
 {
@@ -9,7 +9,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2012, Hammersmith Imanet Ltd
-    Copyright (C) 2020, University College London
+    Copyright (C) 2020, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -93,10 +93,14 @@
 #include "stir/recon_buildblock/ForwardProjectorByBinUsingRayTracing.h"
 #include "stir/IO/read_from_file.h"
 //#include "stir/mash_views.h"
+#ifdef STIR_OPENMP
+#  include <omp.h>
+#endif
 
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <numeric>
 #include <string>
 // for asctime()
@@ -113,7 +117,19 @@ using std::ios;
 START_NAMESPACE_STIR
 
 // should be private member, TODO
-static ofstream full_log;
+static ofstream full_log_file;
+// When processing views in parallel, every thread writes to its own buffer, which is appended to the file after every view
+static thread_local std::ostringstream full_log_thread_buffer;
+
+static std::ostream&
+full_log()
+{
+#ifdef STIR_OPENMP
+  if (omp_in_parallel())
+    return full_log_thread_buffer;
+#endif
+  return full_log_file;
+}
 
 // terribly ugly. can be replaced using LORCoordinates stuff (TODO)
 static void
@@ -373,13 +389,13 @@ FBP3DRPReconstruction::actual_reconstruct(shared_ptr<DiscretisedDensity<3, float
     // sprintf(file,"%s.full_log",output_filename_prefix.c_str());
     std::string file = output_filename_prefix;
     file += ".full_log";
-    full_log.open(file.c_str(), ios::out);
-    if (!full_log)
+    full_log_file.open(file.c_str(), ios::out);
+    if (!full_log_file)
       error("Couldn't open full_log file %s", file.c_str());
   }
 
-  full_log << parameter_info();
-  full_log << "\n\n********** PROCESSING FBP3DRP RECONSTRUCTION *************" << endl;
+  full_log() << parameter_info();
+  full_log() << "\n\n********** PROCESSING FBP3DRP RECONSTRUCTION *************" << endl;
 
   const int old_max_segment_num_to_process = max_segment_num_to_process;
 
@@ -414,7 +430,7 @@ FBP3DRPReconstruction::actual_reconstruct(shared_ptr<DiscretisedDensity<3, float
 
 #if 0      
     if (fit_projections==1){//Fitting between measured and estimaed sinograms
-      full_log << "  - Fitting projections" << endl;  //CL 010699 Forward project measured sinograms and fitting with alpha and beta
+      full_log() << "  - Fitting projections" << endl;  //CL 010699 Forward project measured sinograms and fitting with alpha and beta
       
       // From the paper of  M. Defrise et al., Phys. Med. Biol. 1990 Vol. 35, No 10, pp1361-1372
       // As the forwrad projected sinograms have, in general, a different scaling factor
@@ -436,13 +452,13 @@ FBP3DRPReconstruction::actual_reconstruct(shared_ptr<DiscretisedDensity<3, float
         }
       }
       {
-        full_log << "  - Maximum activity = " << max_activity << " in plane= " << plane_with_max_activity << endl;
+        full_log() << "  - Maximum activity = " << max_activity << " in plane= " << plane_with_max_activity << endl;
         
         //Now forward only on this plane
         Sinogram<float> sino_fwd_pos = 
           direct_sinos_ptr->get_proj_data_info_sptr()->get_empty_sinogram(plane_with_max_activity, 0);
         
-        full_log << "    Forward projection on one ring which contains maximum activity from seg0" << endl;
+        full_log() << "    Forward projection on one ring which contains maximum activity from seg0" << endl;
         //KTTODO forward_project_2D(estimated_image(),sino_fwd_pos, plane_with_max_activity);
         error("Fitting not yet implemented\n");
         // Calculate the fitting the coefficients alpha_fit and beta_fit
@@ -477,7 +493,7 @@ FBP3DRPReconstruction::actual_reconstruct(shared_ptr<DiscretisedDensity<3, float
         if (arc_correction_sptr->set_up(proj_data_ptr->get_proj_data_info_sptr()->create_shared_clone()) == Succeeded::no)
           return Succeeded::no;
 
-        full_log << "FBP3DRP will arc-correct data first\n";
+        full_log() << "FBP3DRP will arc-correct data first\n";
         // warning: need to use clone() as we're modifying it later on
         proj_data_info_with_missing_data_sptr
             = arc_correction_sptr->get_arc_corrected_proj_data_info_sptr()->create_shared_clone();
@@ -526,7 +542,7 @@ FBP3DRPReconstruction::actual_reconstruct(shared_ptr<DiscretisedDensity<3, float
 
   do_log_file(image);
 
-  full_log.close();
+  full_log_file.close();
 
   // restore max_segment_num_to_process to its original value,
   // just in case someone wants to use the reconstruction object twice
@@ -539,26 +555,26 @@ void
 FBP3DRPReconstruction::do_2D_reconstruction()
 { // SSRB+2D FBP with ramp filter
 
-  full_log << "\n---------------------------------------------------------\n";
-  full_log << "2D FBP OF  DIRECT SINOGRAMS (=> IMAGE_ESTIMATE)\n" << endl;
+  full_log() << "\n---------------------------------------------------------\n";
+  full_log() << "2D FBP OF  DIRECT SINOGRAMS (=> IMAGE_ESTIMATE)\n" << endl;
 
   // image_estimate should have 'default' dimensions, origin and voxel_size
   image_estimate_density_ptr.reset(new VoxelsOnCartesianGrid<float>(*proj_data_ptr->get_proj_data_info_sptr()));
 
   {
     FBP2DReconstruction recon2d(proj_data_ptr, alpha_ramp, fc_ramp, PadS, num_segments_to_combine);
-    full_log << "Parameters of the 2D FBP reconstruction" << endl;
-    full_log << recon2d.parameter_info() << endl;
+    full_log() << "Parameters of the 2D FBP reconstruction" << endl;
+    full_log() << recon2d.parameter_info() << endl;
     recon2d.set_up(image_estimate_density_ptr);
     recon2d.reconstruct(image_estimate_density_ptr);
   }
 
-  full_log << "  - min and max in SSRB+FBP image " << estimated_image().find_min() << " " << estimated_image().find_max()
-           << " SUM= " << estimated_image().sum() << endl;
+  full_log() << "  - min and max in SSRB+FBP image " << estimated_image().find_min() << " " << estimated_image().find_max()
+             << " SUM= " << estimated_image().sum() << endl;
 
   if (display_level > 1)
     {
-      full_log << "  - Displaying estimated image" << endl;
+      full_log() << "  - Displaying estimated image" << endl;
       display(estimated_image(), estimated_image().find_max(), "Image estimate");
     }
 
@@ -573,15 +589,15 @@ FBP3DRPReconstruction::do_2D_reconstruction()
 void
 FBP3DRPReconstruction::do_save_img(const char* file, const VoxelsOnCartesianGrid<float>& data) const
 {
-  full_log << "  - Saving " << file << endl;
+  full_log() << "  - Saving " << file << endl;
   output_file_format_ptr->write_to_file(file, data);
-  full_log << "    Min= " << data.find_min() << " Max = " << data.find_max() << " Sum = " << data.sum() << endl;
+  full_log() << "    Min= " << data.find_min() << " Max = " << data.find_max() << " Sum = " << data.sum() << endl;
 }
 
 void
 FBP3DRPReconstruction::do_read_image2D()
 {
-  full_log << "  - Reading  estimated image : " << image_for_reprojection_filename << endl;
+  full_log() << "  - Reading  estimated image : " << image_for_reprojection_filename << endl;
 
   image_estimate_density_ptr = read_from_file<DiscretisedDensity<3, float>>(image_for_reprojection_filename.c_str());
 
@@ -592,8 +608,8 @@ void
 FBP3DRPReconstruction::do_3D_Reconstruction(VoxelsOnCartesianGrid<float>& image)
 {
 
-  full_log << "\n---------------------------------------------------------\n";
-  full_log << "3D PROCESSING\n" << endl;
+  full_log() << "\n---------------------------------------------------------\n";
+  full_log() << "3D PROCESSING\n" << endl;
 
   do_byview_initialise(image);
 
@@ -602,56 +618,79 @@ FBP3DRPReconstruction::do_3D_Reconstruction(VoxelsOnCartesianGrid<float>& image)
 
   forward_projector_sptr->set_input(estimated_image());
   back_projector_sptr->start_accumulating_in_new_target();
+  // make sure that the Colsher filter will be set-up for the first segment
+  colsher_filter_segment_num = proj_data_ptr->get_min_segment_num() - 1;
 
   for (int seg_num = -max_segment_num_to_process; seg_num <= max_segment_num_to_process; seg_num++)
     {
-
-      // a bool value that will be used to determine if we are starting processing for this segment
-      bool first_view_in_segment = true;
-
-      const int orig_min_axial_pos_num = proj_data_ptr->get_min_axial_pos_num(seg_num);
-      const int orig_max_axial_pos_num = proj_data_ptr->get_max_axial_pos_num(seg_num);
-
+      std::vector<ViewSegmentNumbers> vs_nums_to_process;
       for (int view_num = proj_data_ptr->get_min_view_num(); view_num <= proj_data_ptr->get_max_view_num(); ++view_num)
         {
           const ViewSegmentNumbers vs_num(view_num, seg_num);
-          if (!symmetries_sptr->is_basic(vs_num))
-            continue;
-
-          const int new_min_axial_pos_num = proj_data_info_with_missing_data_sptr->get_min_axial_pos_num(seg_num);
-          const int new_max_axial_pos_num = proj_data_info_with_missing_data_sptr->get_max_axial_pos_num(seg_num);
+          if (symmetries_sptr->is_basic(vs_num))
+            vs_nums_to_process.push_back(vs_num);
+        }
+      // some segment_nums might not have any views to process because of the symmetries
+      const bool segment_has_views = !vs_nums_to_process.empty();
 
-          if (first_view_in_segment)
-            {
-              full_log << "\n--------------------------------\n";
-              full_log << "PROCESSING SEGMENT  No " << seg_num << endl;
+      const int orig_min_axial_pos_num = proj_data_ptr->get_min_axial_pos_num(seg_num);
+      const int orig_max_axial_pos_num = proj_data_ptr->get_max_axial_pos_num(seg_num);
+      const int new_min_axial_pos_num = proj_data_info_with_missing_data_sptr->get_min_axial_pos_num(seg_num);
+      const int new_max_axial_pos_num = proj_data_info_with_missing_data_sptr->get_max_axial_pos_num(seg_num);
 
-              full_log << "Average delta= " << input_proj_data_info_cyl().get_average_ring_difference(seg_num) << " with span= "
-                       << input_proj_data_info_cyl().get_max_ring_difference(seg_num)
-                              - input_proj_data_info_cyl().get_min_ring_difference(seg_num) + 1
-                       << " and extended axial position numbers: min= " << new_min_axial_pos_num
-                       << " and max= " << new_max_axial_pos_num << endl;
+      if (segment_has_views)
+        {
+          full_log() << "\n--------------------------------\n";
+          full_log() << "PROCESSING SEGMENT  No " << seg_num << endl;
+
+          full_log() << "Average delta= " << input_proj_data_info_cyl().get_average_ring_difference(seg_num) << " with span= "
+                     << input_proj_data_info_cyl().get_max_ring_difference(seg_num)
+                            - input_proj_data_info_cyl().get_min_ring_difference(seg_num) + 1
+                     << " and extended axial position numbers: min= " << new_min_axial_pos_num
+                     << " and max= " << new_max_axial_pos_num << endl;
+        }
 
-              first_view_in_segment = false;
-            }
+      // Process all views of this segment in parallel. The back projector accumulates in thread-local images,
+      // while forward projection (for the missing data) and filtering of different views overlap.
+#if defined(STIR_OPENMP) && !defined(NRFFT)
+#  pragma omp parallel for schedule(dynamic)
+#endif
+      for (int i = 0; i < static_cast<int>(vs_nums_to_process.size()); ++i)
+        {
+          const ViewSegmentNumbers vs_num = vs_nums_to_process[i];
 
-          full_log << "\n*************************************************************";
-          full_log << "\n        Processing view " << vs_num.view_num() << " of segment " << vs_num.segment_num() << endl;
+          full_log() << "\n*************************************************************";
+          full_log() << "\n        Processing view " << vs_num.view_num() << " of segment " << vs_num.segment_num() << endl;
 
-          full_log << "\n  - Getting related viewgrams" << endl;
+          full_log() << "\n  - Getting related viewgrams" << endl;
 
+#ifdef STIR_OPENMP
+          RelatedViewgrams<float> viewgrams;
+#  pragma omp critical(FBP3DRP_get_viewgrams)
+          viewgrams = proj_data_ptr->get_related_viewgrams(vs_num, symmetries_sptr);
+#else
           RelatedViewgrams<float> viewgrams = proj_data_ptr->get_related_viewgrams(vs_num, symmetries_sptr);
+#endif
 
           do_process_viewgrams(
               viewgrams, new_min_axial_pos_num, new_max_axial_pos_num, orig_min_axial_pos_num, orig_max_axial_pos_num);
+
+#ifdef STIR_OPENMP
+          if (omp_in_parallel())
+            {
+#  pragma omp critical(FBP3DRP_full_log)
+              full_log_file << full_log_thread_buffer.str();
+              full_log_thread_buffer.str("");
+            }
+#endif
         }
       // do some logging etc, but only when this segment had any processing
       // (some segment_nums might not because of the symmetries)
-      if (!first_view_in_segment)
+      if (segment_has_views)
         {
-          full_log << "\n*************************************************************";
-          full_log << "\nEnd of this segment. Current image values:\n"
-                   << "Min= " << image.find_min() << " Max = " << image.find_max() << " Sum = " << image.sum() << endl;
+          full_log() << "\n*************************************************************";
+          full_log() << "\nEnd of this segment. Current image values:\n"
+                     << "Min= " << image.find_min() << " Max = " << image.find_max() << " Sum = " << image.sum() << endl;
 #ifndef PARALLEL
           if (save_intermediate_files && !_disable_output)
             {
@@ -687,8 +726,8 @@ FBP3DRPReconstruction::do_best_fit(const Sinogram<float>& sino_measured, const S
   float meas_square = 0.F;
   float calc_square = 0.F;
   float sigma_square = 0.F;
-  full_log << "  - Fitting estimated sinograms with the measured ones (Max in measured sino = " << sino_measured.find_max()
-           << " Max in fwd sino = " << sino_calculated.find_max() << ")" << endl;
+  full_log() << "  - Fitting estimated sinograms with the measured ones (Max in measured sino = " << sino_measured.find_max()
+             << " Max in fwd sino = " << sino_calculated.find_max() << ")" << endl;
 
   for (int view = sino_measured.get_min_view_num(); view <= sino_measured.get_max_view_num(); view++)
     {
@@ -715,9 +754,9 @@ FBP3DRPReconstruction::do_best_fit(const Sinogram<float>& sino_measured, const S
   alpha_fit = (meas_calc * num_voxels - meas_sum * calc_sum) / determinant;
   beta_fit = (calc_square * meas_sum - calc_sum * meas_calc) / determinant;
 
-  full_log << "  - Calculated fitted coefficients : alpha= " << alpha_fit << " beta= " << beta_fit
-           << " with quality factor= " << ((meas_square - alpha_fit * meas_calc - beta_fit * sino_measured.sum()) / meas_square)
-           << endl;
+  full_log() << "  - Calculated fitted coefficients : alpha= " << alpha_fit << " beta= " << beta_fit
+             << " with quality factor= " << ((meas_square - alpha_fit * meas_calc - beta_fit * sino_measured.sum()) / meas_square)
+             << endl;
 }
 
 void
@@ -757,15 +796,15 @@ FBP3DRPReconstruction::do_forward_project_view(RelatedViewgrams<float>& viewgram
   // do not forward project if we don't need to...
   if (new_min_axial_pos_num <= orig_min_axial_pos_num - 1)
     {
-      full_log << "  - Forward projection of missing data first from ring No " << new_min_axial_pos_num << " to "
-               << orig_min_axial_pos_num - 1 << endl;
+      full_log() << "  - Forward projection of missing data first from ring No " << new_min_axial_pos_num << " to "
+                 << orig_min_axial_pos_num - 1 << endl;
 
       forward_projector_sptr->forward_project(viewgrams, new_min_axial_pos_num, orig_min_axial_pos_num - 1);
     }
 
   if (orig_max_axial_pos_num + 1 <= new_max_axial_pos_num)
     {
-      full_log << "  - Forward projection from ring No " << orig_max_axial_pos_num + 1 << " to " << new_max_axial_pos_num << endl;
+      full_log() << "  - Forward projection from ring No " << orig_max_axial_pos_num + 1 << " to " << new_max_axial_pos_num << endl;
 
       forward_projector_sptr->forward_project(viewgrams, orig_max_axial_pos_num + 1, new_max_axial_pos_num);
     }
@@ -776,7 +815,7 @@ FBP3DRPReconstruction::do_forward_project_view(RelatedViewgrams<float>& viewgram
       // Adjusting estimated sinograms by using the fitting coefficients :
       // sino = sino * alpha_fit + beta_fit;
       
-      full_log << "  - Adjusting all sinograms with alpha = " << alpha_fit << " and beta = " << beta_fit << endl;
+      full_log() << "  - Adjusting all sinograms with alpha = " << alpha_fit << " and beta = " << beta_fit << endl;
       // TODO This is wrong: it adjusts the measured projections as well !!!
       // It needs a loop over axial_poss from new_min_axial_pos_num to orig_min_axial_pos_num, etc.
       error("This is not correctly implemented at the moment. disable fitting (recommended)\n");
@@ -797,17 +836,19 @@ FBP3DRPReconstruction::do_colsher_filter_view(RelatedViewgrams<float>& viewgrams
 
   assert(!is_null_ptr(dynamic_pointer_cast<const ProjDataInfoCylindricalArcCorr>(viewgrams.get_proj_data_info_sptr())));
 
-  // TODO make into object member instead of static
-  static int prev_seg_num = viewgrams.get_proj_data_info_sptr()->get_min_segment_num() - 1;
 #ifdef NRFFT
   static ColsherFilter colsher_filter(0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
 #endif
   const int seg_num = viewgrams.get_basic_segment_num();
 
-  if (prev_seg_num != seg_num)
+  // The filter is set-up by the first thread that processes a view of a new segment.
+  // This is safe as all views of one segment are processed before starting the next segment.
+#ifdef STIR_OPENMP
+#  pragma omp critical(FBP3DRP_colsher_set_up)
+#endif
+  if (colsher_filter_segment_num != seg_num)
     {
-      prev_seg_num = seg_num;
-      full_log << "  - Constructing Colsher filter for this segment\n";
+      full_log() << "  - Constructing Colsher filter for this segment\n";
       const int nrings = viewgrams.get_num_axial_poss();
       const int nprojs = viewgrams.get_num_tangential_poss();
 
@@ -820,8 +861,8 @@ FBP3DRPReconstruction::do_colsher_filter_view(RelatedViewgrams<float>& viewgrams
 
       const float sampling_in_s = viewgrams.get_proj_data_info_sptr()->get_sampling_in_s(Bin(seg_num, 0, 0, 0));
       const float sampling_in_t = viewgrams.get_proj_data_info_sptr()->get_sampling_in_t(Bin(seg_num, 0, 0, 0));
-      full_log << "Colsher filter theta_max = " << theta_max << " theta = " << theta << " d_a = " << sampling_in_s
-               << " d_b = " << sampling_in_t << endl;
+      full_log() << "Colsher filter theta_max = " << theta_max << " theta = " << theta << " d_a = " << sampling_in_s
+                 << " d_b = " << sampling_in_t << endl;
 
 #ifdef NRFFT
       colsher_filter = ColsherFilter(height,
@@ -838,9 +879,10 @@ FBP3DRPReconstruction::do_colsher_filter_view(RelatedViewgrams<float>& viewgrams
         if (colsher_filter.set_up(height, width, theta, sampling_in_s, sampling_in_t) != Succeeded::yes)
           error("Exiting");
 #endif
+      colsher_filter_segment_num = seg_num;
     }
 
-  full_log << "  - Apply Colsher filter to complete oblique sinograms" << endl;
+  full_log() << "  - Apply Colsher filter to complete oblique sinograms" << endl;
 #ifdef NRFFT
 
   assert(viewgrams.get_num_viewgrams() % 2 == 0);
@@ -871,7 +913,7 @@ FBP3DRPReconstruction::do_colsher_filter_view(RelatedViewgrams<float>& viewgrams
   {
     const int num_ring_differences = input_proj_data_info_cyl().get_max_ring_difference(seg_num)
                                      - input_proj_data_info_cyl().get_min_ring_difference(seg_num) + 1;
-    full_log << "  - Multiplying filtered projections by " << num_ring_differences << endl;
+    full_log() << "  - Multiplying filtered projections by " << num_ring_differences << endl;
     if (num_ring_differences != 1)
       {
         viewgrams *= static_cast<float>(num_ring_differences);
@@ -888,7 +930,7 @@ FBP3DRPReconstruction::do_3D_backprojection_view(const RelatedViewgrams<float>&
                                                  int new_min_axial_pos_num,
                                                  int new_max_axial_pos_num)
 {
-  full_log << "  - Backproject the filtered Colsher complete sinograms" << endl;
+  full_log() << "  - Backproject the filtered Colsher complete sinograms" << endl;
 
   back_projector_sptr->back_project(viewgrams, new_min_axial_pos_num, new_max_axial_pos_num);
 }
@@ -899,7 +941,7 @@ FBP3DRPReconstruction::do_log_file(const VoxelsOnCartesianGrid<float>& image)
   char file[max_filename_length];
   sprintf(file, "%s.log", output_filename_prefix.c_str());
 
-  full_log << endl << "- WRITE LOGFILE (" << file << ")" << endl;
+  full_log() << endl << "- WRITE LOGFILE (" << file << ")" << endl;
 
   ofstream logfile(file);
 
@@ -908,7 +950,7 @@ FBP3DRPReconstruction::do_log_file(const VoxelsOnCartesianGrid<float>& image)
       warning("Error opening log file\n");
       return;
     }
-  full_log << endl;
+  full_log() << endl;
 
   const time_t now = time(NULL);
 
@@ -0,0 +1,139 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projdata
+
+  \brief Implementation of non-inline functions of class stir::DetPairViewTangPosLookupTable
+
+  \author Kris Thielemans
+*/
+
+#include "stir/DetPairViewTangPosLookupTable.h"
+#include "stir/error.h"
+#include <map>
+#include <mutex>
+
+START_NAMESPACE_STIR
+
+shared_ptr<const DetPairViewTangPosLookupTable>
+DetPairViewTangPosLookupTable::get_shared(const int num_detectors)
+{
+  static std::mutex cache_mutex;
+  static std::map<int, std::weak_ptr<const DetPairViewTangPosLookupTable>> cache;
+
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  auto& cached = cache[num_detectors];
+  shared_ptr<const DetPairViewTangPosLookupTable> table_sptr = cached.lock();
+  if (!table_sptr)
+    {
+      table_sptr = std::make_shared<const DetPairViewTangPosLookupTable>(num_detectors);
+      cached = table_sptr;
+    }
+  return table_sptr;
+}
+
+DetPairViewTangPosLookupTable::DetPairViewTangPosLookupTable(const int num_detectors_v)
+    : num_detectors(num_detectors_v)
+{
+  static_assert(-1 >> 1 == -1, "right-shift of negative numbers needs to be arithmetic");
+  static_assert(-2 >> 1 == -1, "right-shift of negative numbers needs to be arithmetic");
+
+  if (num_detectors % 2 != 0)
+    error("Number of detectors per ring should be even but is %d", num_detectors);
+  if (num_detectors <= 0 || num_detectors > 65534)
+    error("DetPairViewTangPosLookupTable: number of detectors per ring (%d) should be between 2 and 65534", num_detectors);
+
+  const int max_num_views = num_detectors / 2;
+  min_tang_pos_num = -(num_detectors / 2) + 1;
+  num_tang_poss = num_detectors;
+
+  // view/tangpos -> detectors
+  /*
+     adapted from CTI code
+     Note for implementation: avoid using % with negative numbers
+     so add num_detectors before doing modulo num_detectors)
+  */
+  view_tangpos_to_det1det2.resize(static_cast<std::size_t>(max_num_views) * num_tang_poss);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(static)
+#endif
+  for (int v_num = 0; v_num < max_num_views; ++v_num)
+    for (int tp_num = min_tang_pos_num; tp_num < min_tang_pos_num + num_tang_poss; ++tp_num)
+      {
+        Det1Det2& entry = view_tangpos_to_det1det2[static_cast<std::size_t>(v_num) * num_tang_poss + (tp_num - min_tang_pos_num)];
+        entry.det1_num = static_cast<std::uint16_t>((v_num + (tp_num >> 1) + num_detectors) % num_detectors);
+        entry.det2_num = static_cast<std::uint16_t>((v_num - ((tp_num + 1) >> 1) + num_detectors / 2) % num_detectors);
+      }
+
+  // detectors -> view/tangpos (only det1_num < det2_num)
+  det1det2_to_view_tangpos.resize(static_cast<std::size_t>(num_detectors) * (num_detectors - 1) / 2);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int det1_num = 0; det1_num < num_detectors; ++det1_num)
+    for (int det2_num = det1_num + 1; det2_num < num_detectors; ++det2_num)
+      {
+        /*
+         This somewhat obscure formula was obtained by inverting the code for
+         get_det_num_pair_for_view_tangential_pos_num()
+        */
+        int swap_detectors;
+        int tang_pos_num = (det1_num - det2_num + 3 * num_detectors / 2) % num_detectors;
+        int view_num = (det1_num - (tang_pos_num >> 1) + num_detectors) % num_detectors;
+
+        /* Now adjust ranges for view_num, tang_pos_num.
+          We use the combinations of the following 'symmetries' of
+          (tang_pos_num, view_num) == (tang_pos_num+2*num_views, view_num + num_views)
+          == (-tang_pos_num, view_num + num_views)
+          Using the latter interchanges det_num1 and det_num2, and this leaves
+          the LOR the same in the 2D case. However, in 3D this interchanges the rings
+          as well. So, we keep track of this in swap_detectors.
+        */
+        if (view_num < max_num_views)
+          {
+            if (tang_pos_num >= max_num_views)
+              {
+                tang_pos_num = num_detectors - tang_pos_num;
+                swap_detectors = 1;
+              }
+            else
+              {
+                swap_detectors = 0;
+              }
+          }
+        else
+          {
+            view_num -= max_num_views;
+            if (tang_pos_num >= max_num_views)
+              {
+                tang_pos_num -= num_detectors;
+                swap_detectors = 0;
+              }
+            else
+              {
+                tang_pos_num *= -1;
+                swap_detectors = 1;
+              }
+          }
+
+        ViewTangPosSwap& entry = det1det2_to_view_tangpos[det_pair_index(det1_num, det2_num)];
+        entry.view_num = static_cast<std::uint32_t>(view_num);
+        entry.tang_pos_num = tang_pos_num;
+        entry.swap_detectors = swap_detectors == 0 ? 1U : 0U;
+      }
+}
+
+std::size_t
+DetPairViewTangPosLookupTable::get_size_in_bytes() const
+{
+  return det1det2_to_view_tangpos.size() * sizeof(ViewTangPosSwap) + view_tangpos_to_det1det2.size() * sizeof(Det1Det2);
+}
+
+END_NAMESPACE_STIR
@@ -35,6 +35,7 @@
 #endif
 
 #include <algorithm>
+#include <vector>
 using std::min;
 using std::max;
 
@@ -786,7 +787,7 @@ FanProjData::is_in_data(const int ra, const int a, const int rb, const int b) co
 {
   assert(a >= 0);
   assert(b >= 0);
-  if (rb < (*this)[ra][a].get_min_index() || rb > (*this)[ra][a].get_max_index())
+  if (rb < max(ra, get_min_rb(ra)) || rb > get_max_rb(ra))
     return false;
   if (b >= get_min_b(a))
     return b <= get_max_b(a);
@@ -847,22 +848,24 @@ FanProjData::get_min_rb(const int ra) const
   // return (*this)[ra][(*this)[ra].get_min_index()].get_min_index();
 }
 
+// Note: the index ranges below are computed from the sizes, instead of looking them up in the
+// (nested) storage, as they are used for every element access.
 int
 FanProjData::get_max_rb(const int ra) const
 {
-  return (*this)[ra][(*this)[ra].get_min_index()].get_max_index();
+  return min(ra + max_ring_diff, num_rings - 1);
 }
 
 int
 FanProjData::get_min_b(const int a) const
 {
-  return (*this)[get_min_index()][a][(*this)[get_min_index()][a].get_min_index()].get_min_index();
+  return a + num_detectors_per_ring / 2 - half_fan_size;
 }
 
 int
 FanProjData::get_max_b(const int a) const
 {
-  return (*this)[get_min_index()][a][(*this)[get_min_index()][a].get_min_index()].get_max_index();
+  return a + num_detectors_per_ring / 2 + half_fan_size;
 }
 
 float
@@ -1089,12 +1092,18 @@ make_fan_data_remove_gaps_help(FanProjData& fan_data,
   const int num_physical_rings = num_rings - (num_axial_blocks - 1) * num_virtual_axial_crystals_per_block;
   fan_data = FanProjData(num_physical_rings, num_physical_detectors_per_ring, new_max_delta, 2 * new_half_fan_size + 1);
 
-  shared_ptr<SegmentBySinogram<float>> segment_ptr;
-  Bin bin;
-
-  for (bin.segment_num() = proj_data.get_min_segment_num(); bin.segment_num() <= proj_data.get_max_segment_num();
-       ++bin.segment_num())
+  // Every bin corresponds to a different detector pair, so segments can be processed in parallel
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int segment = proj_data.get_min_segment_num(); segment <= proj_data.get_max_segment_num(); ++segment)
     {
+      Bin bin;
+      shared_ptr<SegmentBySinogram<float>> segment_ptr;
+      bin.segment_num() = segment;
+#ifdef STIR_OPENMP
+#  pragma omp critical(ML_NORM_GET_SEGMENT)
+#endif
       segment_ptr.reset(new SegmentBySinogram<float>(proj_data.get_segment_by_sinogram(bin.segment_num())));
 
       for (bin.axial_pos_num() = proj_data.get_min_axial_pos_num(bin.segment_num());
@@ -1282,6 +1291,10 @@ apply_block_norm(FanProjData& fan_data, const BlockData3D& block_data, const boo
   const int num_tangential_crystals_per_block = num_tangential_detectors / num_tangential_blocks;
   assert(num_tangential_blocks * num_tangential_crystals_per_block == num_tangential_detectors);
 
+  // Note: with rb>=ra, all elements for a given ra are stored in the same "row", so we can parallelise over ra
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       // loop rb from ra to avoid double counting
@@ -1394,6 +1407,10 @@ apply_geo_norm(FanProjData& fan_data, const GeoData3D& geo_data, const bool appl
               }
           }
 
+  // Note: the previous loop is not parallelised, as different (ra,a,rb,b) can be rotated/mirrored to the same element.
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       //    for (int rb = fan_data.get_min_ra(); rb <= fan_data.get_max_ra(); ++rb)
@@ -1414,6 +1431,9 @@ void
 apply_efficiencies(FanProjData& fan_data, const DetectorEfficiencies& efficiencies, const bool apply)
 {
   const int num_detectors_per_ring = fan_data.get_num_detectors_per_ring();
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       // loop rb from ra to avoid double counting
@@ -1432,6 +1452,9 @@ apply_efficiencies(FanProjData& fan_data, const DetectorEfficiencies& efficienci
 void
 make_fan_sum_data(Array<2, float>& data_fan_sums, const FanProjData& fan_data)
 {
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       data_fan_sums[ra][a] = fan_data.sum(ra, a);
@@ -1547,6 +1570,10 @@ make_geo_data(GeoData3D& geo_data, const FanProjData& fan_data)
   FanProjData work = fan_data;
   work.fill(0);
 
+  // Note: with rb>=ra, all elements of work for a given ra are stored in the same "row", so we can parallelise over ra
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
     for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
       // 1// for (int rb = fan_data.get_min_ra(); rb <= fan_data.get_max_ra(); ++rb)
@@ -1568,6 +1595,10 @@ make_geo_data(GeoData3D& geo_data, const FanProjData& fan_data)
 
   geo_data.fill(0);
 
+  // geo_data(ra,a,rb,b) is stored in geo_data[ra][a], so we can parallelise over ra and a
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) collapse(2)
+#endif
   for (int ra = 0; ra < num_axial_crystals_per_block; ++ra)
     //  for (int a = 0; a <= num_transaxial_detectors/2; ++a)
     for (int a = 0; a < num_transaxial_crystals_per_block / 2; ++a)
@@ -1612,18 +1643,38 @@ make_block_data(BlockData3D& block_data, const FanProjData& fan_data)
   assert(num_transaxial_blocks * num_transaxial_crystals_per_block == num_transaxial_detectors);
 
   block_data.fill(0);
-  for (int ra = fan_data.get_min_ra(); ra <= fan_data.get_max_ra(); ++ra)
-    for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
-      // loop rb from ra to avoid double counting
-      for (int rb = max(ra, fan_data.get_min_rb(ra)); rb <= fan_data.get_max_rb(ra); ++rb)
-        for (int b = fan_data.get_min_b(a); b <= fan_data.get_max_b(a); ++b)
-          {
-            block_data(ra / num_axial_crystals_per_block,
-                       a / num_transaxial_crystals_per_block,
-                       rb / num_axial_crystals_per_block,
-                       b / num_transaxial_crystals_per_block)
-                += fan_data(ra, a, rb, b);
-          }
+  // With rb>=ra, all sums for rings in one axial block are stored in the same "row" of block_data,
+  // so we can parallelise over axial blocks (without changing the order of the summation)
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int axial_block_num = 0; axial_block_num < num_axial_blocks; ++axial_block_num)
+    for (int ra = fan_data.get_min_ra() + axial_block_num * num_axial_crystals_per_block;
+         ra < fan_data.get_min_ra() + (axial_block_num + 1) * num_axial_crystals_per_block;
+         ++ra)
+      for (int a = fan_data.get_min_a(); a <= fan_data.get_max_a(); ++a)
+        // loop rb from ra to avoid double counting
+        for (int rb = max(ra, fan_data.get_min_rb(ra)); rb <= fan_data.get_max_rb(ra); ++rb)
+          for (int b = fan_data.get_min_b(a); b <= fan_data.get_max_b(a); ++b)
+            {
+              block_data(ra / num_axial_crystals_per_block,
+                         a / num_transaxial_crystals_per_block,
+                         rb / num_axial_crystals_per_block,
+                         b / num_transaxial_crystals_per_block)
+                  += fan_data(ra, a, rb, b);
+            }
+}
+
+/* The efficiency of a detector is updated using the current efficiencies of the detectors in its fan.
+   Detectors (in any ring) that are less than num_detectors_per_ring/2 - half_fan_size apart are not in each other's
+   fan, so the efficiencies of all detectors in such a "sector" can be updated independently (i.e. in parallel).
+   Looping over sectors is therefore a sequential update in a particular order, and the result does not depend
+   on the number of threads.
+*/
+static int
+get_efficiencies_sector_size(const int num_detectors_per_ring, const int half_fan_size)
+{
+  return max(num_detectors_per_ring / 2 - half_fan_size, 1);
 }
 
 void
@@ -1634,20 +1685,29 @@ iterate_efficiencies(DetectorEfficiencies& efficiencies, const Array<2, float>&
   assert(model.get_max_ra() == data_fan_sums.get_max_index());
   assert(model.get_min_a() == data_fan_sums[data_fan_sums.get_min_index()].get_min_index());
   assert(model.get_max_a() == data_fan_sums[data_fan_sums.get_min_index()].get_max_index());
-  for (int ra = model.get_min_ra(); ra <= model.get_max_ra(); ++ra)
-    for (int a = model.get_min_a(); a <= model.get_max_a(); ++a)
-      {
-        if (data_fan_sums[ra][a] == 0)
-          efficiencies[ra][a] = 0;
-        else
+  const int half_fan_size = (model.get_max_b(0) - model.get_min_b(0)) / 2;
+  const int sector_size = get_efficiencies_sector_size(num_detectors_per_ring, half_fan_size);
+  for (int start_a = model.get_min_a(); start_a <= model.get_max_a(); start_a += sector_size)
+    {
+      const int end_a = min(start_a + sector_size - 1, model.get_max_a());
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) collapse(2)
+#endif
+      for (int ra = model.get_min_ra(); ra <= model.get_max_ra(); ++ra)
+        for (int a = start_a; a <= end_a; ++a)
           {
-            float denominator = 0;
-            for (int rb = model.get_min_rb(ra); rb <= model.get_max_rb(ra); ++rb)
-              for (int b = model.get_min_b(a); b <= model.get_max_b(a); ++b)
-                denominator += efficiencies[rb][b % num_detectors_per_ring] * model(ra, a, rb, b);
-            efficiencies[ra][a] = data_fan_sums[ra][a] / denominator;
+            if (data_fan_sums[ra][a] == 0)
+              efficiencies[ra][a] = 0;
+            else
+              {
+                float denominator = 0;
+                for (int rb = model.get_min_rb(ra); rb <= model.get_max_rb(ra); ++rb)
+                  for (int b = model.get_min_b(a); b <= model.get_max_b(a); ++b)
+                    denominator += efficiencies[rb][b % num_detectors_per_ring] * model(ra, a, rb, b);
+                efficiencies[ra][a] = data_fan_sums[ra][a] / denominator;
+              }
           }
-      }
+    }
 }
 
 // version without model
@@ -1662,39 +1722,50 @@ iterate_efficiencies(DetectorEfficiencies& efficiencies,
 #ifdef WRITE_ALL
   static int sub_iter_num = 0;
 #endif
-  for (int ra = data_fan_sums.get_min_index(); ra <= data_fan_sums.get_max_index(); ++ra)
-    for (int a = data_fan_sums[ra].get_min_index(); a <= data_fan_sums[ra].get_max_index(); ++a)
-      {
-        if (data_fan_sums[ra][a] == 0)
-          efficiencies[ra][a] = 0;
-        else
+  const int min_a = data_fan_sums[data_fan_sums.get_min_index()].get_min_index();
+  const int max_a = data_fan_sums[data_fan_sums.get_min_index()].get_max_index();
+  const int sector_size = get_efficiencies_sector_size(num_detectors_per_ring, half_fan_size);
+  for (int start_a = min_a; start_a <= max_a; start_a += sector_size)
+    {
+      const int end_a = min(start_a + sector_size - 1, max_a);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) collapse(2)
+#endif
+      for (int ra = data_fan_sums.get_min_index(); ra <= data_fan_sums.get_max_index(); ++ra)
+        for (int a = start_a; a <= end_a; ++a)
           {
-            float denominator = 0;
-            for (int rb = max(ra - max_ring_diff, 0); rb <= min(ra + max_ring_diff, num_rings - 1); ++rb)
-              for (int b = a + num_detectors_per_ring / 2 - half_fan_size; b <= a + num_detectors_per_ring / 2 + half_fan_size;
-                   ++b)
-                denominator += efficiencies[rb][b % num_detectors_per_ring];
-            efficiencies[ra][a] = data_fan_sums[ra][a] / denominator;
+            if (data_fan_sums[ra][a] == 0)
+              efficiencies[ra][a] = 0;
+            else
+              {
+                float denominator = 0;
+                for (int rb = max(ra - max_ring_diff, 0); rb <= min(ra + max_ring_diff, num_rings - 1); ++rb)
+                  for (int b = a + num_detectors_per_ring / 2 - half_fan_size;
+                       b <= a + num_detectors_per_ring / 2 + half_fan_size;
+                       ++b)
+                    denominator += efficiencies[rb][b % num_detectors_per_ring];
+                efficiencies[ra][a] = data_fan_sums[ra][a] / denominator;
+              }
           }
 #ifdef WRITE_ALL
-        {
-          char out_filename[100];
-          sprintf(out_filename, "MLresult_subiter_eff_1_%d.out", sub_iter_num++);
-          ofstream out(out_filename);
-          if (!out)
-            {
-              warning("Error opening output file %s\n", out_filename);
-              exit(EXIT_FAILURE);
-            }
-          out << efficiencies;
-          if (!out)
-            {
-              warning("Error writing data to output file %s\n", out_filename);
-              exit(EXIT_FAILURE);
-            }
-        }
-#endif
+      {
+        char out_filename[100];
+        sprintf(out_filename, "MLresult_subiter_eff_1_%d.out", sub_iter_num++);
+        ofstream out(out_filename);
+        if (!out)
+          {
+            warning("Error opening output file %s\n", out_filename);
+            exit(EXIT_FAILURE);
+          }
+        out << efficiencies;
+        if (!out)
+          {
+            warning("Error writing data to output file %s\n", out_filename);
+            exit(EXIT_FAILURE);
+          }
       }
+#endif
+    }
 }
 
 void
@@ -1708,6 +1779,9 @@ iterate_geo_norm(GeoData3D& norm_geo_data, const GeoData3D& measured_geo_data, c
 
   const float threshold = measured_geo_data.find_max() / 10000.F;
 
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) collapse(2)
+#endif
   for (int ra = 0; ra < num_axial_crystals_per_block; ++ra)
     for (int a = 0; a < num_transaxial_crystals_per_block / 2; ++a)
       // loop rb from ra to avoid double counting
@@ -1745,7 +1819,12 @@ iterate_block_norm(BlockData3D& norm_block_data, const BlockData3D& measured_blo
 double
 KL(const FanProjData& d1, const FanProjData& d2, const double threshold)
 {
-  double sum = 0;
+  // compute the sum for every ra in parallel, but add them in ring order such that the result does not
+  // depend on the number of threads
+  std::vector<double> ra_sums(d1.get_max_ra() - d1.get_min_ra() + 1, 0.);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int ra = d1.get_min_ra(); ra <= d1.get_max_ra(); ++ra)
     {
       double asum = 0;
@@ -1761,9 +1840,12 @@ KL(const FanProjData& d1, const FanProjData& d2, const double threshold)
             }
           asum += rbsum;
         }
-      sum += asum;
+      ra_sums[ra - d1.get_min_ra()] = asum;
     }
-  return static_cast<double>(sum);
+  double sum = 0;
+  for (const double ra_sum : ra_sums)
+    sum += ra_sum;
+  return sum;
 }
 
 /*double KL(const GeoData3D& d1, const GeoData3D& d2, const double threshold)
@@ -3,7 +3,7 @@
     Copyright (C) 2000 - 2010-10-15, Hammersmith Imanet Ltd
     Copyright (C) 2011-07-01 -2013, Kris Thielemans
     Copyright (C) 2016, University of Hull
-    Copyright (C) 2015, 2020, 2022, 2023 University College London
+    Copyright (C) 2015, 2020, 2022, 2023, 2026 University College London
     Copyright (C) 2021-2022, Commonwealth Scientific and Industrial Research Organisation
     Copyright (C) 2021, Rutherford Appleton Laboratory STFC
     This file is part of STIR.
@@ -36,6 +36,7 @@
 #include "stir/IO/FileSignature.h"
 #include "stir/IO/interfile.h"
 #include "stir/ProjDataInterfile.h"
+#include "stir/ProjDataSparse.h"
 #include "stir/ProjDataFromStream.h" // needed for converting ProjDataFromStream* to ProjData*
 #include "stir/ProjDataInMemory.h"   // needed for subsets
 #include "stir/ProjDataInfoSubsetByView.h"
@@ -77,7 +78,7 @@ START_NAMESPACE_STIR
 
    Currently supported:
    <ul>
-   <li> Interfile (using  read_interfile_PDFS())
+   <li> Interfile (using  read_interfile_PDFS()), or ProjDataSparse::read_from_file() if the data file is sparse
    <li> ECAT 7 3D sinograms and attenuation files
    >li> GE RDF9 (in HDF5)
    </ul>
@@ -131,6 +132,8 @@ ProjData::read_from_file(const string& filename, const std::ios::openmode openmo
 #ifndef NDEBUG
       info("ProjData::read_from_file trying to read " + filename + " as Interfile", 3);
 #endif
+      if (ProjDataSparse::is_sparse_interfile_header(actual_filename))
+        return ProjDataSparse::read_from_file(actual_filename);
       shared_ptr<ProjData> ptr(read_interfile_PDFS(filename, openmode));
       if (!is_null_ptr(ptr))
         return ptr;
@@ -34,8 +34,6 @@
 #include "stir/error.h"
 #include <sstream>
 
-#include <boost/static_assert.hpp>
-
 using std::endl;
 using std::ends;
 using std::string;
@@ -165,9 +163,6 @@ ProjDataInfoCylindricalNoArcCorr::get_psi_offset() const
 void
 ProjDataInfoCylindricalNoArcCorr::initialise_uncompressed_view_tangpos_to_det1det2() const
 {
-  BOOST_STATIC_ASSERT(-1 >> 1 == -1);
-  BOOST_STATIC_ASSERT(-2 >> 1 == -1);
-
   const int num_detectors = get_scanner_ptr()->get_num_detectors_per_ring();
 
   assert(num_detectors % 2 == 0);
@@ -191,23 +186,7 @@ ProjDataInfoCylindricalNoArcCorr::initialise_uncompressed_view_tangpos_to_det1de
             max_tang_pos_num);
     }
 
-  uncompressed_view_tangpos_to_det1det2.grow(0, num_detectors / 2 - 1);
-  for (int v_num = 0; v_num <= num_detectors / 2 - 1; ++v_num)
-    {
-      uncompressed_view_tangpos_to_det1det2[v_num].grow(min_tang_pos_num, max_tang_pos_num);
-
-      for (int tp_num = min_tang_pos_num; tp_num <= max_tang_pos_num; ++tp_num)
-        {
-          /*
-             adapted from CTI code
-             Note for implementation: avoid using % with negative numbers
-             so add num_detectors before doing modulo num_detectors)
-            */
-          uncompressed_view_tangpos_to_det1det2[v_num][tp_num].det1_num = (v_num + (tp_num >> 1) + num_detectors) % num_detectors;
-          uncompressed_view_tangpos_to_det1det2[v_num][tp_num].det2_num
-              = (v_num - ((tp_num + 1) >> 1) + num_detectors / 2) % num_detectors;
-        }
-    }
+  uncompressed_view_tangpos_to_det1det2_sptr = DetPairViewTangPosLookupTable::get_shared(num_detectors);
     // thanks to yohjp:
     // http://stackoverflow.com/questions/27975737/how-to-handle-cached-data-structures-with-multi-threading-e-g-openmp
 #if defined(STIR_OPENMP) && _OPENMP >= 201012
@@ -219,9 +198,6 @@ ProjDataInfoCylindricalNoArcCorr::initialise_uncompressed_view_tangpos_to_det1de
 void
 ProjDataInfoCylindricalNoArcCorr::initialise_det1det2_to_uncompressed_view_tangpos() const
 {
-  BOOST_STATIC_ASSERT(-1 >> 1 == -1);
-  BOOST_STATIC_ASSERT(-2 >> 1 == -1);
-
   const int num_detectors = get_scanner_ptr()->get_num_detectors_per_ring();
 
   if (num_detectors % 2 != 0)
@@ -239,77 +215,8 @@ ProjDataInfoCylindricalNoArcCorr::initialise_det1det2_to_uncompressed_view_tangp
   assert(fabs(get_phi(Bin(0, 0, 0, 0)) - v_offset) < 1.E-4);
   assert(fabs(get_phi(Bin(0, get_max_view_num() + 1, 0, 0)) - v_offset - _PI) < 1.E-4);
 #endif
-  // const int min_tang_pos_num = -(num_detectors/2);
-  // const int max_tang_pos_num = -(num_detectors/2)+num_detectors;
-  const int max_num_views = num_detectors / 2;
-
-  det1det2_to_uncompressed_view_tangpos.grow(0, num_detectors - 1);
-  for (int det1_num = 0; det1_num < num_detectors; ++det1_num)
-    {
-      det1det2_to_uncompressed_view_tangpos[det1_num].grow(0, num_detectors - 1);
-
-      for (int det2_num = 0; det2_num < num_detectors; ++det2_num)
-        {
-          if (det1_num == det2_num)
-            continue;
-          /*
-           This somewhat obscure formula was obtained by inverting the code for
-           get_det_num_pair_for_view_tangential_pos_num()
-           This can be simplified (especially all the branching later on), but
-           as we execute this code only occasionally, it's probably not worth it.
-          */
-          int swap_detectors;
-          /*
-          Note for implementation: avoid using % with negative numbers
-          so add num_detectors before doing modulo num_detectors
-          */
-          int tang_pos_num = (det1_num - det2_num + 3 * num_detectors / 2) % num_detectors;
-          int view_num = (det1_num - (tang_pos_num >> 1) + num_detectors) % num_detectors;
-
-          /* Now adjust ranges for view_num, tang_pos_num.
-          The next lines go only wrong in the singular (and irrelevant) case
-          det_num1 == det_num2 (when tang_pos_num == num_detectors - tang_pos_num)
-
-            We use the combinations of the following 'symmetries' of
-            (tang_pos_num, view_num) == (tang_pos_num+2*num_views, view_num + num_views)
-            == (-tang_pos_num, view_num + num_views)
-            Using the latter interchanges det_num1 and det_num2, and this leaves
-            the LOR the same in the 2D case. However, in 3D this interchanges the rings
-            as well. So, we keep track of this in swap_detectors, and return its final
-            value.
-          */
-          if (view_num < max_num_views)
-            {
-              if (tang_pos_num >= max_num_views)
-                {
-                  tang_pos_num = num_detectors - tang_pos_num;
-                  swap_detectors = 1;
-                }
-              else
-                {
-                  swap_detectors = 0;
-                }
-            }
-          else
-            {
-              view_num -= max_num_views;
-              if (tang_pos_num >= max_num_views)
-                {
-                  tang_pos_num -= num_detectors;
-                  swap_detectors = 0;
-                }
-              else
-                {
-                  tang_pos_num *= -1;
-                  swap_detectors = 1;
-                }
-            }
-
-          det1det2_to_uncompressed_view_tangpos[det1_num][det2_num].view_num = view_num;
-          det1det2_to_uncompressed_view_tangpos[det1_num][det2_num].tang_pos_num = tang_pos_num;
-          det1det2_to_uncompressed_view_tangpos[det1_num][det2_num].swap_detectors = swap_detectors == 0;
-        }
-    }
+  // the table is shared with other objects, see DetPairViewTangPosLookupTable for the actual computation
+  det1det2_to_uncompressed_view_tangpos_sptr = DetPairViewTangPosLookupTable::get_shared(num_detectors);
     // thanks to yohjp:
     // http://stackoverflow.com/questions/27975737/how-to-handle-cached-data-structures-with-multi-threading-e-g-openmp
 #if defined(STIR_OPENMP) && _OPENMP >= 201012
@@ -355,8 +262,9 @@ ProjDataInfoCylindricalNoArcCorr::get_all_det_pos_pairs_for_bin(vector<Detection
        uncompressed_view_num < (bin.view_num() + 1) * get_view_mashing_factor();
        ++uncompressed_view_num)
     {
-      const int det1_num = uncompressed_view_tangpos_to_det1det2[uncompressed_view_num][bin.tangential_pos_num()].det1_num;
-      const int det2_num = uncompressed_view_tangpos_to_det1det2[uncompressed_view_num][bin.tangential_pos_num()].det2_num;
+      int det1_num, det2_num;
+      uncompressed_view_tangpos_to_det1det2_sptr->get_det_num_pair_for_view_tangential_pos_num(
+          det1_num, det2_num, uncompressed_view_num, bin.tangential_pos_num());
       for (auto rings_iter = ring_pairs.begin(); rings_iter != ring_pairs.end(); ++rings_iter)
         {
           for (int uncompressed_timing_pos_num = min_timing_pos_num; uncompressed_timing_pos_num <= max_timing_pos_num;
@@ -475,7 +383,9 @@ ProjDataInfoCylindricalNoArcCorr::find_cartesian_coordinates_given_scanner_coord
 
   this->initialise_det1det2_to_uncompressed_view_tangpos_if_not_done_yet();
 
-  if (!det1det2_to_uncompressed_view_tangpos[det1][det2].swap_detectors)
+  int unused_view_num, unused_tang_pos_num;
+  if (!det1det2_to_uncompressed_view_tangpos_sptr->get_view_tangential_pos_num_for_det_num_pair(
+          unused_view_num, unused_tang_pos_num, det1, det2))
     {
       d1 = det2;
       d2 = det1;
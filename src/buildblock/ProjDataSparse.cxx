@@ -0,0 +1,438 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projdata
+  \brief Implementations for non-inline functions of class stir::ProjDataSparse
+
+  \author Kris Thielemans
+*/
+
+#include "stir/ProjDataSparse.h"
+#include "stir/ProjDataFromStream.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/Viewgram.h"
+#include "stir/Sinogram.h"
+#include "stir/Bin.h"
+#include "stir/IndexRange2D.h"
+#include "stir/ByteOrder.h"
+#include "stir/Succeeded.h"
+#include "stir/utilities.h"
+#include "stir/IO/interfile.h"
+#include "stir/IO/InterfileHeader.h"
+#include "stir/IO/FileSignature.h"
+#include "stir/error.h"
+#include "stir/warning.h"
+#include <boost/format.hpp>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+
+START_NAMESPACE_STIR
+
+static const char* const sparse_signature = "STIR sparse projection data";
+
+//! storage order of the dense array used for the indices (see ProjDataSparse::get_index())
+static ProjDataFromStream::StorageOrder
+get_storage_order(const ProjDataInfo& proj_data_info)
+{
+  return proj_data_info.get_num_tof_poss() > 1 ? ProjDataFromStream::Timing_Segment_View_AxialPos_TangPos
+                                               : ProjDataFromStream::Segment_View_AxialPos_TangPos;
+}
+
+ProjDataSparse::ProjDataSparse(shared_ptr<const ExamInfo> const& exam_info_sptr,
+                               shared_ptr<const ProjDataInfo> const& proj_data_info_sptr)
+    : ProjData(exam_info_sptr, proj_data_info_sptr)
+{
+  segment_offsets.resize(this->get_num_segments());
+  std::uint64_t offset = 0;
+  for (int segment_num = this->get_min_segment_num(); segment_num <= this->get_max_segment_num(); ++segment_num)
+    {
+      segment_offsets[segment_num - this->get_min_segment_num()] = offset;
+      offset += static_cast<std::uint64_t>(this->get_num_views()) * this->get_num_axial_poss(segment_num)
+                * this->get_num_tangential_poss();
+    }
+  num_bins_per_timing_pos = offset;
+}
+
+std::uint64_t
+ProjDataSparse::get_index(const Bin& bin) const
+{
+  if (bin.segment_num() < this->get_min_segment_num() || bin.segment_num() > this->get_max_segment_num()
+      || bin.view_num() < this->get_min_view_num() || bin.view_num() > this->get_max_view_num()
+      || bin.axial_pos_num() < this->get_min_axial_pos_num(bin.segment_num())
+      || bin.axial_pos_num() > this->get_max_axial_pos_num(bin.segment_num())
+      || bin.tangential_pos_num() < this->get_min_tangential_pos_num()
+      || bin.tangential_pos_num() > this->get_max_tangential_pos_num() || bin.timing_pos_num() < this->get_min_tof_pos_num()
+      || bin.timing_pos_num() > this->get_max_tof_pos_num())
+    error(boost::format("ProjDataSparse: bin (TOF %1%, segment %2%, view %3%, axial %4%, tangential %5%) out of range")
+          % bin.timing_pos_num() % bin.segment_num() % bin.view_num() % bin.axial_pos_num() % bin.tangential_pos_num());
+
+  const std::uint64_t num_tangential_poss = static_cast<std::uint64_t>(this->get_num_tangential_poss());
+  return static_cast<std::uint64_t>(bin.timing_pos_num() - this->get_min_tof_pos_num()) * num_bins_per_timing_pos
+         + segment_offsets[bin.segment_num() - this->get_min_segment_num()]
+         + (static_cast<std::uint64_t>(bin.view_num() - this->get_min_view_num()) * this->get_num_axial_poss(bin.segment_num())
+            + (bin.axial_pos_num() - this->get_min_axial_pos_num(bin.segment_num())))
+               * num_tangential_poss
+         + (bin.tangential_pos_num() - this->get_min_tangential_pos_num());
+}
+
+void
+ProjDataSparse::set_value(const std::uint64_t index, const float value)
+{
+  if (value == 0)
+    storage.erase(index);
+  else
+    storage[index] = value;
+}
+
+float
+ProjDataSparse::get_bin_value(const Bin& bin) const
+{
+  const auto iter = storage.find(this->get_index(bin));
+  return iter == storage.end() ? 0.F : iter->second;
+}
+
+void
+ProjDataSparse::set_bin_value(const Bin& bin)
+{
+  this->set_value(this->get_index(bin), bin.get_bin_value());
+}
+
+void
+ProjDataSparse::increment_bin_value(const Bin& bin, const float increment)
+{
+  if (increment != 0)
+    storage[this->get_index(bin)] += increment;
+}
+
+std::size_t
+ProjDataSparse::get_num_stored_bins() const
+{
+  return storage.size();
+}
+
+Viewgram<float>
+ProjDataSparse::get_viewgram(const int view_num,
+                             const int segment_num,
+                             const bool make_num_tangential_poss_odd,
+                             const int timing_pos) const
+{
+  Bin bin(segment_num, view_num, this->get_min_axial_pos_num(segment_num), this->get_min_tangential_pos_num(), timing_pos);
+  Viewgram<float> viewgram(proj_data_info_sptr, bin);
+  if (!storage.empty())
+    {
+      for (bin.axial_pos_num() = this->get_min_axial_pos_num(segment_num);
+           bin.axial_pos_num() <= this->get_max_axial_pos_num(segment_num);
+           ++bin.axial_pos_num())
+        {
+          bin.tangential_pos_num() = this->get_min_tangential_pos_num();
+          std::uint64_t index = this->get_index(bin);
+          for (; bin.tangential_pos_num() <= this->get_max_tangential_pos_num(); ++bin.tangential_pos_num(), ++index)
+            {
+              const auto iter = storage.find(index);
+              if (iter != storage.end())
+                viewgram[bin.axial_pos_num()][bin.tangential_pos_num()] = iter->second;
+            }
+        }
+    }
+
+  if (make_num_tangential_poss_odd && (this->get_num_tangential_poss() % 2 == 0))
+    {
+      const int new_max_tangential_pos = this->get_max_tangential_pos_num() + 1;
+      viewgram.grow(IndexRange2D(this->get_min_axial_pos_num(segment_num),
+                                 this->get_max_axial_pos_num(segment_num),
+                                 this->get_min_tangential_pos_num(),
+                                 new_max_tangential_pos));
+    }
+  return viewgram;
+}
+
+Succeeded
+ProjDataSparse::set_viewgram(const Viewgram<float>& v)
+{
+  if (*this->get_proj_data_info_sptr() != *(v.get_proj_data_info_sptr()))
+    {
+      warning(boost::format("ProjDataSparse::set_viewgram: viewgram has incompatible ProjDataInfo member\n"
+                            "Original ProjDataInfo: %1%\n"
+                            "ProjDataInfo From viewgram: %2%")
+              % this->get_proj_data_info_sptr()->parameter_info() % v.get_proj_data_info_sptr()->parameter_info());
+      return Succeeded::no;
+    }
+  const int segment_num = v.get_segment_num();
+  Bin bin(segment_num, v.get_view_num(), 0, this->get_min_tangential_pos_num(), v.get_timing_pos_num());
+  for (bin.axial_pos_num() = this->get_min_axial_pos_num(segment_num);
+       bin.axial_pos_num() <= this->get_max_axial_pos_num(segment_num);
+       ++bin.axial_pos_num())
+    {
+      bin.tangential_pos_num() = this->get_min_tangential_pos_num();
+      std::uint64_t index = this->get_index(bin);
+      for (; bin.tangential_pos_num() <= this->get_max_tangential_pos_num(); ++bin.tangential_pos_num(), ++index)
+        this->set_value(index, v[bin.axial_pos_num()][bin.tangential_pos_num()]);
+    }
+  return Succeeded::yes;
+}
+
+Sinogram<float>
+ProjDataSparse::get_sinogram(const int ax_pos_num,
+                             const int segment_num,
+                             const bool make_num_tangential_poss_odd,
+                             const int timing_pos) const
+{
+  Sinogram<float> sinogram(proj_data_info_sptr, ax_pos_num, segment_num, timing_pos);
+  if (!storage.empty())
+    {
+      Bin bin(segment_num, 0, ax_pos_num, 0, timing_pos);
+      for (bin.view_num() = this->get_min_view_num(); bin.view_num() <= this->get_max_view_num(); ++bin.view_num())
+        {
+          bin.tangential_pos_num() = this->get_min_tangential_pos_num();
+          std::uint64_t index = this->get_index(bin);
+          for (; bin.tangential_pos_num() <= this->get_max_tangential_pos_num(); ++bin.tangential_pos_num(), ++index)
+            {
+              const auto iter = storage.find(index);
+              if (iter != storage.end())
+                sinogram[bin.view_num()][bin.tangential_pos_num()] = iter->second;
+            }
+        }
+    }
+
+  if (make_num_tangential_poss_odd && (this->get_num_tangential_poss() % 2 == 0))
+    {
+      const int new_max_tangential_pos = this->get_max_tangential_pos_num() + 1;
+      sinogram.grow(IndexRange2D(
+          this->get_min_view_num(), this->get_max_view_num(), this->get_min_tangential_pos_num(), new_max_tangential_pos));
+    }
+  return sinogram;
+}
+
+Succeeded
+ProjDataSparse::set_sinogram(const Sinogram<float>& s)
+{
+  if (*this->get_proj_data_info_sptr() != *(s.get_proj_data_info_sptr()))
+    {
+      warning(boost::format("ProjDataSparse::set_sinogram: Sinogram<float> has incompatible ProjDataInfo member.\n"
+                            "Original ProjDataInfo: %1%\n"
+                            "ProjDataInfo from sinogram: %2%")
+              % this->get_proj_data_info_sptr()->parameter_info() % s.get_proj_data_info_sptr()->parameter_info());
+      return Succeeded::no;
+    }
+  Bin bin(s.get_segment_num(), 0, s.get_axial_pos_num(), 0, s.get_timing_pos_num());
+  for (bin.view_num() = this->get_min_view_num(); bin.view_num() <= this->get_max_view_num(); ++bin.view_num())
+    {
+      bin.tangential_pos_num() = this->get_min_tangential_pos_num();
+      std::uint64_t index = this->get_index(bin);
+      for (; bin.tangential_pos_num() <= this->get_max_tangential_pos_num(); ++bin.tangential_pos_num(), ++index)
+        this->set_value(index, s[bin.view_num()][bin.tangential_pos_num()]);
+    }
+  return Succeeded::yes;
+}
+
+void
+ProjDataSparse::fill(const float value)
+{
+  storage.clear();
+  if (value != 0)
+    base_type::fill(value);
+}
+
+float
+ProjDataSparse::sum() const
+{
+  double sum = 0;
+  for (const auto& elem : storage)
+    sum += elem.second;
+  return static_cast<float>(sum);
+}
+
+float
+ProjDataSparse::find_max() const
+{
+  // bins that are not stored are zero
+  float max_value = storage.size() < this->size_all() ? 0.F : storage.begin()->second;
+  for (const auto& elem : storage)
+    max_value = std::max(max_value, elem.second);
+  return max_value;
+}
+
+float
+ProjDataSparse::find_min() const
+{
+  float min_value = storage.size() < this->size_all() ? 0.F : storage.begin()->second;
+  for (const auto& elem : storage)
+    min_value = std::min(min_value, elem.second);
+  return min_value;
+}
+
+Succeeded
+ProjDataSparse::write_to_sparse_file(const std::string& filename) const
+{
+  std::string header_name = filename;
+  add_extension(header_name, ".hs");
+  std::string data_name = header_name;
+  replace_extension(data_name, ".sparse");
+
+  {
+    // the header describes the geometry. We use a ProjDataFromStream (without stream) to be able to reuse the
+    // Interfile writing code. Its segment sequence and storage order are those of the dense array used
+    // for the indices (see get_index()), such that an index is the offset of the bin in the data described by the header.
+    std::vector<int> segment_sequence;
+    for (int segment_num = this->get_min_segment_num(); segment_num <= this->get_max_segment_num(); ++segment_num)
+      segment_sequence.push_back(segment_num);
+    const ProjDataFromStream pdfs(this->get_exam_info_sptr(),
+                                  this->get_proj_data_info_sptr(),
+                                  shared_ptr<std::iostream>(),
+                                  0,
+                                  segment_sequence,
+                                  get_storage_order(*this->get_proj_data_info_sptr()),
+                                  NumericType::FLOAT,
+                                  ByteOrder::native);
+    if (write_basic_interfile_PDFS_header(header_name, data_name, pdfs) == Succeeded::no)
+      return Succeeded::no;
+  }
+
+  std::vector<std::uint64_t> indices;
+  indices.reserve(storage.size());
+  for (const auto& elem : storage)
+    indices.push_back(elem.first);
+  std::sort(indices.begin(), indices.end());
+  std::vector<float> values(indices.size());
+  std::transform(indices.begin(), indices.end(), values.begin(), [this](const std::uint64_t index) {
+    return this->storage.find(index)->second;
+  });
+
+  std::ofstream output(data_name.c_str(), std::ios::out | std::ios::binary);
+  if (!output.good())
+    {
+      warning("ProjDataSparse: error opening file " + data_name + " for writing");
+      return Succeeded::no;
+    }
+  output << sparse_signature << '\n'
+         << "byte order := " << (ByteOrder::get_native_order() == ByteOrder::little_endian ? "LITTLEENDIAN" : "BIGENDIAN")
+         << '\n'
+         << "number of non-zero bins := " << indices.size() << '\n';
+  output.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(std::uint64_t));
+  output.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+  if (!output.good())
+    {
+      warning("ProjDataSparse: error writing data to file " + data_name);
+      return Succeeded::no;
+    }
+  return Succeeded::yes;
+}
+
+namespace detail
+{
+//! Interfile header parser that only gets the name of the data file
+class InterfileDataFileNameHeader : public MinimalInterfileHeader
+{
+public:
+  InterfileDataFileNameHeader() { this->add_key("name of data file", &data_file_name); }
+  std::string data_file_name;
+};
+
+static std::string
+get_full_data_file_name(const std::string& header_filename)
+{
+  InterfileDataFileNameHeader hdr;
+  if (!hdr.parse(header_filename.c_str(), false) || hdr.data_file_name.empty())
+    return std::string();
+  char full_data_file_name[max_filename_length];
+  strcpy(full_data_file_name, hdr.data_file_name.c_str());
+  prepend_directory_name(full_data_file_name, get_directory_name(header_filename).c_str());
+  return full_data_file_name;
+}
+} // namespace detail
+
+bool
+ProjDataSparse::is_sparse_interfile_header(const std::string& filename)
+{
+  const std::string data_file_name = detail::get_full_data_file_name(filename);
+  if (data_file_name.empty())
+    return false;
+  return is_sparse_data_file(data_file_name);
+}
+
+bool
+ProjDataSparse::is_sparse_data_file(const std::string& data_file_name)
+{
+  std::ifstream input(data_file_name.c_str(), std::ios::in | std::ios::binary);
+  if (!input)
+    return false;
+  const FileSignature signature(input);
+  return signature.size() >= std::strlen(sparse_signature)
+         && std::strncmp(signature.get_signature(), sparse_signature, std::strlen(sparse_signature)) == 0;
+}
+
+shared_ptr<ProjDataSparse>
+ProjDataSparse::read_from_file(const std::string& filename)
+{
+  InterfilePDFSHeader hdr;
+  if (!hdr.parse(filename.c_str()))
+    error("ProjDataSparse::read_from_file: Interfile parsing of " + filename + " failed");
+  const std::string data_file_name = detail::get_full_data_file_name(filename);
+
+  // check that the header describes the order of the indices (see write_to_sparse_file())
+  {
+    const ProjDataInfo& proj_data_info = *hdr.data_info_sptr;
+    bool order_ok = hdr.storage_order == get_storage_order(proj_data_info);
+    for (std::size_t i = 0; i < hdr.segment_sequence.size(); ++i)
+      order_ok = order_ok && hdr.segment_sequence[i] == proj_data_info.get_min_segment_num() + static_cast<int>(i);
+    for (std::size_t i = 0; i < hdr.timing_poss_sequence.size(); ++i)
+      order_ok = order_ok && hdr.timing_poss_sequence[i] == proj_data_info.get_min_tof_pos_num() + static_cast<int>(i);
+    if (!order_ok)
+      error("ProjDataSparse::read_from_file: " + filename
+            + " has a segment sequence, TOF bin order or storage order that is not supported for sparse data");
+  }
+
+  std::ifstream input(data_file_name.c_str(), std::ios::in | std::ios::binary);
+  if (!input)
+    error("ProjDataSparse::read_from_file: error opening " + data_file_name);
+  std::string line;
+  std::getline(input, line);
+  if (line != sparse_signature)
+    error("ProjDataSparse::read_from_file: " + data_file_name + " is not a sparse projection data file");
+  std::getline(input, line);
+  bool swap_bytes;
+  if (line == "byte order := LITTLEENDIAN")
+    swap_bytes = ByteOrder::get_native_order() != ByteOrder::little_endian;
+  else if (line == "byte order := BIGENDIAN")
+    swap_bytes = ByteOrder::get_native_order() != ByteOrder::big_endian;
+  else
+    error("ProjDataSparse::read_from_file: unexpected line in " + data_file_name + ": " + line);
+  std::getline(input, line);
+  const std::string num_bins_key = "number of non-zero bins := ";
+  if (line.compare(0, num_bins_key.size(), num_bins_key) != 0)
+    error("ProjDataSparse::read_from_file: unexpected line in " + data_file_name + ": " + line);
+  const std::size_t num_bins = std::stoull(line.substr(num_bins_key.size()));
+
+  std::vector<std::uint64_t> indices(num_bins);
+  std::vector<float> values(num_bins);
+  input.read(reinterpret_cast<char*>(indices.data()), num_bins * sizeof(std::uint64_t));
+  input.read(reinterpret_cast<char*>(values.data()), num_bins * sizeof(float));
+  if (!input)
+    error("ProjDataSparse::read_from_file: error reading data from " + data_file_name);
+
+  auto proj_data_sptr = std::make_shared<ProjDataSparse>(hdr.get_exam_info_sptr(), hdr.data_info_sptr->create_shared_clone());
+  const std::uint64_t size_all = proj_data_sptr->size_all();
+  proj_data_sptr->storage.reserve(num_bins);
+  for (std::size_t i = 0; i < num_bins; ++i)
+    {
+      if (swap_bytes)
+        {
+          ByteOrder::swap_order(indices[i]);
+          ByteOrder::swap_order(values[i]);
+        }
+      if (indices[i] >= size_all)
+        error("ProjDataSparse::read_from_file: index out of range in " + data_file_name);
+      proj_data_sptr->set_value(indices[i], values[i]);
+    }
+  return proj_data_sptr;
+}
+
+END_NAMESPACE_STIR
@@ -2,7 +2,7 @@
 //
 /*
     Copyright (C) 2002- 2013, Hammersmith Imanet Ltd
-    Copyright (C) 2021, 2024, University College London
+    Copyright (C) 2021, 2024, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -22,11 +22,16 @@
 #include "stir/ProjDataInterfile.h"
 #include "stir/ProjDataInfoCylindrical.h"
 #include "stir/SSRB.h"
-#include "stir/Sinogram.h"
+#include "stir/SegmentByView.h"
+#include "stir/Viewgram.h"
 #include "stir/Bin.h"
+#include "stir/VectorWithOffset.h"
+#include "stir/Succeeded.h"
 #include "stir/round.h"
 #include <fstream>
 #include <algorithm>
+#include <vector>
+#include <future>
 #include "stir/warning.h"
 #include "stir/error.h"
 
@@ -187,6 +192,13 @@ SSRB(ProjData& out_proj_data, const ProjData& in_proj_data, const bool do_norm)
   if (in_proj_data.get_num_views() % out_proj_data.get_num_views())
     error("SSRB can only mash views when out_num_views divides in_num_views\n");
 
+  const int min_tangential_pos_num = max(in_proj_data.get_min_tangential_pos_num(), out_proj_data.get_min_tangential_pos_num());
+  const int max_tangential_pos_num = min(in_proj_data.get_max_tangential_pos_num(), out_proj_data.get_max_tangential_pos_num());
+
+  // Output segments are written by another thread, while the next one is computed.
+  // Note that get() rethrows any exception that occurred while writing.
+  std::future<void> segment_writer;
+
   for (int out_segment_num = out_proj_data.get_min_segment_num(); out_segment_num <= out_proj_data.get_max_segment_num();
        ++out_segment_num)
     {
@@ -228,84 +240,132 @@ SSRB(ProjData& out_proj_data, const ProjData& in_proj_data, const bool do_norm)
                       out_max_ring_diff);
               }
           }
+      }
+
+      const int out_min_ax_pos_num = out_proj_data.get_min_axial_pos_num(out_segment_num);
+      const int out_max_ax_pos_num = out_proj_data.get_max_axial_pos_num(out_segment_num);
+      // Find for every input sinogram the output sinogram where it has to be added (if any),
+      // and count the number of input sinograms contributing to every output sinogram (ignoring TOF).
+      // Axial positions without output sinogram are set to out_min_ax_pos_num - 1.
+      std::vector<VectorWithOffset<int>> out_ax_pos_nums;
+      VectorWithOffset<unsigned int> num_in_ax_poss(out_min_ax_pos_num, out_max_ax_pos_num);
+      num_in_ax_poss.fill(0U);
+      {
+        VectorWithOffset<float> out_m(out_min_ax_pos_num, out_max_ax_pos_num);
+        for (int out_ax_pos_num = out_min_ax_pos_num; out_ax_pos_num <= out_max_ax_pos_num; ++out_ax_pos_num)
+          out_m[out_ax_pos_num] = out_proj_data_info_sptr->get_m(Bin(out_segment_num, 0, out_ax_pos_num, 0));
 
-        // keep sinograms out of the loop to avoid reallocations
-        // initialise to something because there's no default constructor
-        Sinogram<float> out_sino
-            = out_proj_data.get_empty_sinogram(out_proj_data.get_min_axial_pos_num(out_segment_num), out_segment_num);
-        Sinogram<float> in_sino
-            = in_proj_data.get_empty_sinogram(in_proj_data.get_min_axial_pos_num(out_segment_num), out_segment_num);
-        for (int out_timing_pos_num = out_proj_data.get_min_tof_pos_num();
-             out_timing_pos_num <= out_proj_data.get_max_tof_pos_num();
-             ++out_timing_pos_num)
+        for (int in_segment_num = in_min_segment_num; in_segment_num <= in_max_segment_num; ++in_segment_num)
           {
-            for (int out_ax_pos_num = out_proj_data.get_min_axial_pos_num(out_segment_num);
-                 out_ax_pos_num <= out_proj_data.get_max_axial_pos_num(out_segment_num);
-                 ++out_ax_pos_num)
+            VectorWithOffset<int> out_ax_pos_nums_for_segment(in_proj_data.get_min_axial_pos_num(in_segment_num),
+                                                              in_proj_data.get_max_axial_pos_num(in_segment_num));
+            out_ax_pos_nums_for_segment.fill(out_min_ax_pos_num - 1);
+            for (int in_ax_pos_num = in_proj_data.get_min_axial_pos_num(in_segment_num);
+                 in_ax_pos_num <= in_proj_data.get_max_axial_pos_num(in_segment_num);
+                 ++in_ax_pos_num)
               {
-                Bin out_bin(out_segment_num, 0, out_ax_pos_num, 0, out_timing_pos_num);
-                out_sino = out_proj_data.get_empty_sinogram(out_bin);
-                const float out_m = out_proj_data_info_sptr->get_m(out_bin);
-
-                unsigned int num_in_ax_pos = 0;
-
-                // get edges of TOF bin, currently only exposed via sampling
-                // for non-TOF data, the sampling in k is 0, which is incorrect and would lead to the TOF condition below never
-                // being met. Therefore: for non-TOF set out_lower_k to -1E20F and out_higher_k to 1E20F
-                const float out_lower_k
-                    = out_proj_data_info_sptr->is_tof_data()
-                          ? (out_proj_data_info_sptr->get_k(out_bin) - out_proj_data_info_sptr->get_sampling_in_k(out_bin) / 2)
-                          : -1E20F;
-                const float out_higher_k
-                    = out_proj_data_info_sptr->is_tof_data()
-                          ? (out_proj_data_info_sptr->get_k(out_bin) + out_proj_data_info_sptr->get_sampling_in_k(out_bin) / 2)
-                          : 1E20F;
-
-                for (int in_timing_pos_num = in_proj_data.get_min_tof_pos_num();
-                     in_timing_pos_num <= in_proj_data.get_max_tof_pos_num();
-                     ++in_timing_pos_num)
-                  for (int in_segment_num = in_min_segment_num; in_segment_num <= in_max_segment_num; ++in_segment_num)
-                    for (int in_ax_pos_num = in_proj_data.get_min_axial_pos_num(in_segment_num);
-                         in_ax_pos_num <= in_proj_data.get_max_axial_pos_num(in_segment_num);
-                         ++in_ax_pos_num)
+                const float in_m = in_proj_data_info_sptr->get_m(Bin(in_segment_num, 0, in_ax_pos_num, 0));
+                for (int out_ax_pos_num = out_min_ax_pos_num; out_ax_pos_num <= out_max_ax_pos_num; ++out_ax_pos_num)
+                  if (fabs(out_m[out_ax_pos_num] - in_m) < 1E-4)
+                    {
+                      out_ax_pos_nums_for_segment[in_ax_pos_num] = out_ax_pos_num;
+                      ++num_in_ax_poss[out_ax_pos_num];
+                      break; // out of loop over ax_pos as we found where to put it
+                    }
+              }
+            out_ax_pos_nums.push_back(out_ax_pos_nums_for_segment);
+          }
+      }
+
+      for (int out_timing_pos_num = out_proj_data.get_min_tof_pos_num();
+           out_timing_pos_num <= out_proj_data.get_max_tof_pos_num();
+           ++out_timing_pos_num)
+        {
+          // find input TOF bins that contribute to this output TOF bin
+
+          // get edges of TOF bin, currently only exposed via sampling
+          // for non-TOF data, the sampling in k is 0, which is incorrect and would lead to the TOF condition below never
+          // being met. Therefore: for non-TOF set out_lower_k to -1E20F and out_higher_k to 1E20F
+          const Bin out_bin(out_segment_num, 0, out_min_ax_pos_num, 0, out_timing_pos_num);
+          const float out_lower_k
+              = out_proj_data_info_sptr->is_tof_data()
+                    ? (out_proj_data_info_sptr->get_k(out_bin) - out_proj_data_info_sptr->get_sampling_in_k(out_bin) / 2)
+                    : -1E20F;
+          const float out_higher_k
+              = out_proj_data_info_sptr->is_tof_data()
+                    ? (out_proj_data_info_sptr->get_k(out_bin) + out_proj_data_info_sptr->get_sampling_in_k(out_bin) / 2)
+                    : 1E20F;
+          std::vector<int> in_timing_pos_nums;
+          for (int in_timing_pos_num = in_proj_data.get_min_tof_pos_num();
+               in_timing_pos_num <= in_proj_data.get_max_tof_pos_num();
+               ++in_timing_pos_num)
+            {
+              const float in_k = in_proj_data_info_sptr->get_k(Bin(0, 0, 0, 0, in_timing_pos_num));
+              if (in_k >= out_lower_k && in_k < out_higher_k)
+                in_timing_pos_nums.push_back(in_timing_pos_num);
+            }
+
+          for (int out_ax_pos_num = out_min_ax_pos_num; out_ax_pos_num <= out_max_ax_pos_num; ++out_ax_pos_num)
+            if (num_in_ax_poss[out_ax_pos_num] == 0)
+              warning("SSRB: no sinograms contributing to output segment " + std::to_string(out_segment_num) + ", ax_pos "
+                      + std::to_string(out_ax_pos_num) + ", tof_pos_num " + std::to_string(out_timing_pos_num));
+
+          // Every input viewgram is read once, and added to the output viewgram it contributes to.
+          const auto out_segment_sptr = std::make_shared<SegmentByView<float>>(
+              out_proj_data.get_empty_segment_by_view(SegmentIndices(out_segment_num, out_timing_pos_num)));
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+          for (int out_view_num = out_proj_data.get_min_view_num(); out_view_num <= out_proj_data.get_max_view_num();
+               ++out_view_num)
+            {
+              Array<2, float>& out_viewgram = (*out_segment_sptr)[out_view_num];
+              for (const int in_timing_pos_num : in_timing_pos_nums)
+                for (int in_segment_num = in_min_segment_num; in_segment_num <= in_max_segment_num; ++in_segment_num)
+                  {
+                    const VectorWithOffset<int>& out_ax_pos_nums_for_segment
+                        = out_ax_pos_nums[in_segment_num - in_min_segment_num];
+                    for (int in_view_num = out_view_num * num_views_to_combine;
+                         in_view_num < (out_view_num + 1) * num_views_to_combine;
+                         ++in_view_num)
                       {
-                        Bin in_bin(in_segment_num, 0, in_ax_pos_num, 0, in_timing_pos_num);
-                        const float in_m = in_proj_data_info_sptr->get_m(in_bin);
-                        if (fabs(out_m - in_m) < 1E-4)
-                          {
-                            if (in_timing_pos_num == in_proj_data.get_min_tof_pos_num())
-                              ++num_in_ax_pos; // count number of in_sinograms contributing (ignoring TOF)
+                        shared_ptr<Viewgram<float>> in_viewgram_sptr;
+#ifdef STIR_OPENMP
+#  pragma omp critical(SSRB_GET_VIEWGRAM)
+#endif
+                        in_viewgram_sptr.reset(new Viewgram<float>(
+                            in_proj_data.get_viewgram(in_view_num, in_segment_num, false, in_timing_pos_num)));
 
-                            const float in_k = in_proj_data_info_sptr->get_k(in_bin);
-                            // check if in_timing_pos_num is in the range for the out bin or not
-                            if (in_k < out_lower_k || in_k >= out_higher_k)
+                        for (int in_ax_pos_num = out_ax_pos_nums_for_segment.get_min_index();
+                             in_ax_pos_num <= out_ax_pos_nums_for_segment.get_max_index();
+                             ++in_ax_pos_num)
+                          {
+                            const int out_ax_pos_num = out_ax_pos_nums_for_segment[in_ax_pos_num];
+                            if (out_ax_pos_num < out_min_ax_pos_num)
                               continue;
-                            in_sino = in_proj_data.get_sinogram(in_bin);
-
-                            for (int in_view_num = in_proj_data.get_min_view_num();
-                                 in_view_num <= in_proj_data.get_max_view_num();
-                                 ++in_view_num)
-                              for (int tangential_pos_num
-                                   = max(in_proj_data.get_min_tangential_pos_num(), out_proj_data.get_min_tangential_pos_num());
-                                   tangential_pos_num
-                                   <= min(in_proj_data.get_max_tangential_pos_num(), out_proj_data.get_max_tangential_pos_num());
-                                   ++tangential_pos_num)
-                                out_sino[in_view_num / num_views_to_combine][tangential_pos_num]
-                                    += in_sino[in_view_num][tangential_pos_num];
-
-                            break; // out of loop over ax_pos as we found where to put it
+                            for (int tangential_pos_num = min_tangential_pos_num; tangential_pos_num <= max_tangential_pos_num;
+                                 ++tangential_pos_num)
+                              out_viewgram[out_ax_pos_num][tangential_pos_num]
+                                  += (*in_viewgram_sptr)[in_ax_pos_num][tangential_pos_num];
                           }
                       }
-                if (do_norm && num_in_ax_pos != 0)
-                  out_sino /= static_cast<float>(num_in_ax_pos * num_views_to_combine);
-                if (num_in_ax_pos == 0)
-                  warning("SSRB: no sinograms contributing to output segment " + std::to_string(out_segment_num) + ", ax_pos "
-                          + std::to_string(out_ax_pos_num) + ", tof_pos_num " + std::to_string(out_timing_pos_num));
+                  }
+              if (do_norm)
+                for (int out_ax_pos_num = out_min_ax_pos_num; out_ax_pos_num <= out_max_ax_pos_num; ++out_ax_pos_num)
+                  if (num_in_ax_poss[out_ax_pos_num] != 0)
+                    out_viewgram[out_ax_pos_num] /= static_cast<float>(num_in_ax_poss[out_ax_pos_num] * num_views_to_combine);
+            }
 
-                out_proj_data.set_sinogram(out_sino);
-              }
-          }
-      }
+          if (segment_writer.valid())
+            segment_writer.get();
+          segment_writer = std::async(std::launch::async, [&out_proj_data, out_segment_sptr]() {
+            if (out_proj_data.set_segment(*out_segment_sptr) != Succeeded::yes)
+              error("SSRB: error writing output segment " + std::to_string(out_segment_sptr->get_segment_num()) + ", tof_pos_num "
+                    + std::to_string(out_segment_sptr->get_timing_pos_num()));
+          });
+        }
     }
+  if (segment_writer.valid())
+    segment_writer.get();
 }
 END_NAMESPACE_STIR
@@ -4,6 +4,7 @@
   Copyright (C) 2005 - 2009-10-27, Hammersmith Imanet Ltd
   Copyright (C) 2011-07-01 - 2011, Kris Thielemans
   Copyright 2023, Positrigo AG, Zurich
+  Copyright (C) 2026, University College London
   This file is part of STIR.
 
   SPDX-License-Identifier: Apache-2.0
@@ -29,11 +30,11 @@
 #include "stir/Sinogram.h"
 #include "stir/SegmentBySinogram.h"
 #include "stir/Succeeded.h"
+#include "stir/unique_ptr.h"
 #include "stir/numerics/BSplines.h"
 #include "stir/numerics/BSplinesRegularGrid.h"
 #include "stir/interpolate_projdata.h"
 #include "stir/extend_projdata.h"
-#include "stir/numerics/sampling_functions.h"
 #include "stir/error.h"
 #include <typeinfo>
 
@@ -196,19 +197,29 @@ interpolate_projdata(ProjData& proj_data_out,
   if (proj_data_in_info.get_scanner_sptr()->get_scanner_geometry() != "Cylindrical")
     return interpolate_blocks_on_cylindrical_projdata(proj_data_out, proj_data_in, remove_interleaving);
 
-  // initialise interpolator
-  BSpline::BSplinesRegularGrid<3, float, float> proj_data_interpolator(these_types);
+  // TOF bins are independent, so we process them in parallel. Every TOF bin needs its own interpolator, as the
+  // coefficients (i.e. the prefiltered input segment) differ. Reading and writing are done in a critical section, as
+  // not all ProjData types support this in parallel. Without TOF, we do not start a parallel region here, such that
+  // sample_on_regular_grid() can use all threads.
+  const BSpline::BSplinesRegularGrid<3, float, float> interpolator_without_coefs(these_types);
+  bool all_ok = true;
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) if (proj_data_out_info.get_num_tof_poss() > 1)
+#endif
   for (int k = proj_data_out_info.get_min_tof_pos_num(); k <= proj_data_out_info.get_max_tof_pos_num(); ++k)
     {
-      SegmentBySinogram<float> segment
-          = remove_interleaving ? make_non_interleaved_segment(*(make_non_interleaved_proj_data_info(proj_data_in_info)),
-                                                               proj_data_in.get_segment_by_sinogram(0, k))
-                                : proj_data_in.get_segment_by_sinogram(0, k);
+      unique_ptr<SegmentBySinogram<float>> segment_ptr;
+#ifdef STIR_OPENMP
+#  pragma omp critical(INTERPOLATE_PROJDATA_IO)
+#endif
+      segment_ptr.reset(new SegmentBySinogram<float>(proj_data_in.get_segment_by_sinogram(0, k)));
+      if (remove_interleaving)
+        *segment_ptr = make_non_interleaved_segment(*(make_non_interleaved_proj_data_info(proj_data_in_info)), *segment_ptr);
 
       // for Cylindrical, spacing is regular in all directions, which makes mapping trivial
-      std::function<BasicCoordinate<3, double>(const BasicCoordinate<3, int>&)> index_converter;
       // especially in view direction, extending by 5 leads to much smaller artifacts
-      proj_data_interpolator.set_coef(extend_segment(segment, 5, 5, 5));
+      BSpline::BSplinesRegularGrid<3, float, float> proj_data_interpolator(interpolator_without_coefs);
+      proj_data_interpolator.set_coef(extend_segment(*segment_ptr, 5, 5, 5));
 
       BasicCoordinate<3, double> offset, step;
       // out_index * step + offset = in_index
@@ -229,24 +240,17 @@ interpolate_projdata(ProjData& proj_data_out,
       offset[3] = (proj_data_out_info.get_s(Bin(0, 0, 0, 0)) - proj_data_in_info.get_s(Bin(0, 0, 0, 0))) / in_sampling_s;
       step[3] = out_sampling_s / in_sampling_s;
 
-      // define a function to translate indices in the output proj data to indices in input proj data
-      index_converter
-          = [&proj_data_out_info, offset, step](const BasicCoordinate<3, int>& index_out) -> BasicCoordinate<3, double> {
-        // translate to indices in input proj data
-        BasicCoordinate<3, double> index_in;
-        for (auto dim = 1; dim <= 3; dim++)
-          index_in[dim] = index_out[dim] * step[dim] + offset[dim];
-
-        return index_in;
-      };
-
+      // evaluate the interpolator at out_index * step + offset, using separable passes
       SegmentBySinogram<float> sino_3D_out = proj_data_out.get_empty_segment_by_sinogram(0, false, k);
-      sample_function_using_index_converter(sino_3D_out, proj_data_interpolator, index_converter);
+      proj_data_interpolator.sample_on_regular_grid(sino_3D_out, offset, step);
 
+#ifdef STIR_OPENMP
+#  pragma omp critical(INTERPOLATE_PROJDATA_IO)
+#endif
       if (proj_data_out.set_segment(sino_3D_out) == Succeeded::no)
-        return Succeeded::no;
+        all_ok = false;
     }
-  return Succeeded::yes;
+  return all_ok ? Succeeded::yes : Succeeded::no;
 }
 
 //! This function interpolates BlocksOnCylindrical proj data taking bucket intersections and gaps into account.
@@ -3,6 +3,7 @@
 /*
   Copyright (C) 2005- 2007, Hammersmith Imanet Ltd
   Copyright 2023, Positrigo AG, Zurich
+  Copyright (C) 2026, University College London
   This file is part of STIR.
 
   SPDX-License-Identifier: Apache-2.0
@@ -21,10 +22,12 @@
 #include "stir/ProjData.h"
 #include "stir/ProjDataInfo.h"
 #include "stir/inverse_SSRB.h"
-#include "stir/Sinogram.h"
+#include "stir/SegmentBySinogram.h"
 #include "stir/Bin.h"
+#include "stir/VectorWithOffset.h"
 #include "stir/Succeeded.h"
 #include <limits>
+#include <future>
 #include "stir/warning.h"
 #include "stir/error.h"
 
@@ -50,12 +53,6 @@ inverse_SSRB(ProjData& proj_data_4D, const ProjData& proj_data_3D)
       return Succeeded::no;
     }
 
-  // keep sinograms out of the loop to avoid reallocations
-  // initialise to something because there's no default constructor
-  Sinogram<float> sino_4D = proj_data_4D.get_empty_sinogram(proj_data_4D.get_min_axial_pos_num(0), 0);
-  Sinogram<float> sino_3D_1 = proj_data_3D.get_empty_sinogram(proj_data_3D.get_min_axial_pos_num(0), 0);
-  Sinogram<float> sino_3D_2 = proj_data_3D.get_empty_sinogram(proj_data_3D.get_min_axial_pos_num(0), 0);
-
   // prefill a vector with the axial positions of the direct sinograms
   VectorWithOffset<float> in_m(proj_data_3D.get_min_axial_pos_num(0), proj_data_3D.get_max_axial_pos_num(0));
   for (int in_ax_pos_num = proj_data_3D.get_min_axial_pos_num(0); in_ax_pos_num <= proj_data_3D.get_max_axial_pos_num(0);
@@ -64,72 +61,119 @@ inverse_SSRB(ProjData& proj_data_4D, const ProjData& proj_data_3D)
       in_m.at(in_ax_pos_num) = proj_data_3D_info_sptr->get_m(Bin(0, 0, in_ax_pos_num, 0));
     }
 
-  for (int out_segment_num = proj_data_4D.get_min_segment_num(); out_segment_num <= proj_data_4D.get_max_segment_num();
-       ++out_segment_num)
+  // For every output sinogram, find the direct sinogram(s) it is computed from, and their weights.
+  // in_ax_pos_nums_2 is set to in_ax_pos_nums_1 (with weight 0) if only one sinogram is used.
+  const int out_min_segment_num = proj_data_4D.get_min_segment_num();
+  const int out_max_segment_num = proj_data_4D.get_max_segment_num();
+  VectorWithOffset<VectorWithOffset<int>> in_ax_pos_nums_1(out_min_segment_num, out_max_segment_num);
+  VectorWithOffset<VectorWithOffset<int>> in_ax_pos_nums_2(out_min_segment_num, out_max_segment_num);
+  VectorWithOffset<VectorWithOffset<float>> weights_1(out_min_segment_num, out_max_segment_num);
+  VectorWithOffset<VectorWithOffset<float>> weights_2(out_min_segment_num, out_max_segment_num);
+  for (int out_segment_num = out_min_segment_num; out_segment_num <= out_max_segment_num; ++out_segment_num)
     {
-      for (int out_ax_pos_num = proj_data_4D.get_min_axial_pos_num(out_segment_num);
-           out_ax_pos_num <= proj_data_4D.get_max_axial_pos_num(out_segment_num);
-           ++out_ax_pos_num)
+      const int out_min_ax_pos_num = proj_data_4D.get_min_axial_pos_num(out_segment_num);
+      const int out_max_ax_pos_num = proj_data_4D.get_max_axial_pos_num(out_segment_num);
+      in_ax_pos_nums_1[out_segment_num].grow(out_min_ax_pos_num, out_max_ax_pos_num);
+      in_ax_pos_nums_2[out_segment_num].grow(out_min_ax_pos_num, out_max_ax_pos_num);
+      weights_1[out_segment_num].grow(out_min_ax_pos_num, out_max_ax_pos_num);
+      weights_2[out_segment_num].grow(out_min_ax_pos_num, out_max_ax_pos_num);
+      for (int out_ax_pos_num = out_min_ax_pos_num; out_ax_pos_num <= out_max_ax_pos_num; ++out_ax_pos_num)
         {
-          for (int k = proj_data_4D.get_proj_data_info_sptr()->get_min_tof_pos_num();
-               k <= proj_data_4D.get_proj_data_info_sptr()->get_max_tof_pos_num();
-               ++k)
-            {
-              sino_4D = proj_data_4D.get_empty_sinogram(out_ax_pos_num, out_segment_num, false, k);
-              const float out_m = proj_data_4D_info_sptr->get_m(Bin(out_segment_num, 0, out_ax_pos_num, 0));
+          const float out_m = proj_data_4D_info_sptr->get_m(Bin(out_segment_num, 0, out_ax_pos_num, 0));
 
-              // Go through all direct sinograms to check which pair are closest.
-              bool sinogram_set = false;
-              for (int in_ax_pos_num = proj_data_3D.get_min_axial_pos_num(0);
-                   in_ax_pos_num <= proj_data_3D.get_max_axial_pos_num(0);
-                   ++in_ax_pos_num)
-                {
-                  // for the first slice there is no previous
-                  const auto distance_to_previous = in_ax_pos_num == proj_data_3D.get_min_axial_pos_num(0)
-                                                        ? std::numeric_limits<float>::max()
-                                                        : std::abs(out_m - in_m.at(in_ax_pos_num - 1));
-                  const auto distance_to_current = std::abs(out_m - in_m.at(in_ax_pos_num));
-                  // for the last slice there is no next
-                  const auto distance_to_next = in_ax_pos_num == proj_data_3D.get_max_axial_pos_num(0)
+          // Go through all direct sinograms to check which pair are closest.
+          bool sinogram_found = false;
+          for (int in_ax_pos_num = proj_data_3D.get_min_axial_pos_num(0); in_ax_pos_num <= proj_data_3D.get_max_axial_pos_num(0);
+               ++in_ax_pos_num)
+            {
+              // for the first slice there is no previous
+              const auto distance_to_previous = in_ax_pos_num == proj_data_3D.get_min_axial_pos_num(0)
                                                     ? std::numeric_limits<float>::max()
-                                                    : std::abs(out_m - in_m.at(in_ax_pos_num + 1));
-                  if (distance_to_current <= distance_to_previous && distance_to_current <= distance_to_next)
+                                                    : std::abs(out_m - in_m.at(in_ax_pos_num - 1));
+              const auto distance_to_current = std::abs(out_m - in_m.at(in_ax_pos_num));
+              // for the last slice there is no next
+              const auto distance_to_next = in_ax_pos_num == proj_data_3D.get_max_axial_pos_num(0)
+                                                ? std::numeric_limits<float>::max()
+                                                : std::abs(out_m - in_m.at(in_ax_pos_num + 1));
+              if (distance_to_current <= distance_to_previous && distance_to_current <= distance_to_next)
+                {
+                  if (distance_to_current <= 1E-4)
                     {
-                      if (distance_to_current <= 1E-4)
-                        {
-                          sino_3D_1 = proj_data_3D.get_sinogram(in_ax_pos_num, 0, false, k);
-                          sino_4D += sino_3D_1;
-                        }
-                      else if (distance_to_previous < distance_to_next)
-                        { // interpolate between the previous axial slice and this one
-                          const auto distance_sum = distance_to_previous + distance_to_current;
-                          sino_3D_1 = proj_data_3D.get_sinogram(in_ax_pos_num - 1, 0, false, k);
-                          sino_3D_2 = proj_data_3D.get_sinogram(in_ax_pos_num, 0, false, k);
-                          sino_3D_1.sapyb(distance_to_current / distance_sum, sino_3D_2, distance_to_previous / distance_sum);
-                          sino_4D += sino_3D_1;
-                        }
-                      else
-                        { // interpolate between the next axial slice and this one
-                          const auto distance_sum = distance_to_next + distance_to_current;
-                          sino_3D_1 = proj_data_3D.get_sinogram(in_ax_pos_num + 1, 0, false, k);
-                          sino_3D_2 = proj_data_3D.get_sinogram(in_ax_pos_num, 0, false, k);
-                          sino_3D_1.sapyb(distance_to_current / distance_sum, sino_3D_2, distance_to_next / distance_sum);
-                          sino_4D += sino_3D_1;
-                        }
-
-                      if (proj_data_4D.set_sinogram(sino_4D) == Succeeded::no)
-                        return Succeeded::no;
-                      sinogram_set = true;
-                      break;
+                      in_ax_pos_nums_1[out_segment_num][out_ax_pos_num] = in_ax_pos_num;
+                      in_ax_pos_nums_2[out_segment_num][out_ax_pos_num] = in_ax_pos_num;
+                      weights_1[out_segment_num][out_ax_pos_num] = 1.F;
+                      weights_2[out_segment_num][out_ax_pos_num] = 0.F;
+                    }
+                  else if (distance_to_previous < distance_to_next)
+                    { // interpolate between the previous axial slice and this one
+                      const auto distance_sum = distance_to_previous + distance_to_current;
+                      in_ax_pos_nums_1[out_segment_num][out_ax_pos_num] = in_ax_pos_num - 1;
+                      in_ax_pos_nums_2[out_segment_num][out_ax_pos_num] = in_ax_pos_num;
+                      weights_1[out_segment_num][out_ax_pos_num] = distance_to_current / distance_sum;
+                      weights_2[out_segment_num][out_ax_pos_num] = distance_to_previous / distance_sum;
+                    }
+                  else
+                    { // interpolate between the next axial slice and this one
+                      const auto distance_sum = distance_to_next + distance_to_current;
+                      in_ax_pos_nums_1[out_segment_num][out_ax_pos_num] = in_ax_pos_num + 1;
+                      in_ax_pos_nums_2[out_segment_num][out_ax_pos_num] = in_ax_pos_num;
+                      weights_1[out_segment_num][out_ax_pos_num] = distance_to_current / distance_sum;
+                      weights_2[out_segment_num][out_ax_pos_num] = distance_to_next / distance_sum;
                     }
+                  sinogram_found = true;
+                  break;
                 }
-              if (!sinogram_set)
-                { // it is logically not possible to get here
-                  error("no matching sinogram found for segment %d and axial pos %d", out_segment_num, out_ax_pos_num);
+            }
+          if (!sinogram_found)
+            { // it is logically not possible to get here
+              error("no matching sinogram found for segment %d and axial pos %d", out_segment_num, out_ax_pos_num);
+            }
+        }
+    }
+
+  // Output segments are written by another thread, while the next one is computed.
+  std::future<Succeeded> segment_writer;
+
+  for (int k = proj_data_4D.get_proj_data_info_sptr()->get_min_tof_pos_num();
+       k <= proj_data_4D.get_proj_data_info_sptr()->get_max_tof_pos_num();
+       ++k)
+    {
+      // read all direct sinograms for this TOF bin only once
+      const SegmentBySinogram<float> segment_3D = proj_data_3D.get_segment_by_sinogram(0, k);
+
+      for (int out_segment_num = out_min_segment_num; out_segment_num <= out_max_segment_num; ++out_segment_num)
+        {
+          const auto segment_4D_sptr = std::make_shared<SegmentBySinogram<float>>(
+              proj_data_4D.get_empty_segment_by_sinogram(SegmentIndices(out_segment_num, k)));
+#ifdef STIR_OPENMP
+#  pragma omp parallel for
+#endif
+          for (int out_ax_pos_num = proj_data_4D.get_min_axial_pos_num(out_segment_num);
+               out_ax_pos_num <= proj_data_4D.get_max_axial_pos_num(out_segment_num);
+               ++out_ax_pos_num)
+            {
+              const int in_ax_pos_num_1 = in_ax_pos_nums_1[out_segment_num][out_ax_pos_num];
+              const int in_ax_pos_num_2 = in_ax_pos_nums_2[out_segment_num][out_ax_pos_num];
+              if (in_ax_pos_num_1 == in_ax_pos_num_2)
+                (*segment_4D_sptr)[out_ax_pos_num] += segment_3D[in_ax_pos_num_1];
+              else
+                {
+                  Array<2, float> sino_3D = segment_3D[in_ax_pos_num_1];
+                  sino_3D.sapyb(weights_1[out_segment_num][out_ax_pos_num],
+                                segment_3D[in_ax_pos_num_2],
+                                weights_2[out_segment_num][out_ax_pos_num]);
+                  (*segment_4D_sptr)[out_ax_pos_num] += sino_3D;
                 }
             }
+
+          if (segment_writer.valid() && segment_writer.get() == Succeeded::no)
+            return Succeeded::no;
+          segment_writer = std::async(std::launch::async,
+                                      [&proj_data_4D, segment_4D_sptr]() { return proj_data_4D.set_segment(*segment_4D_sptr); });
         }
     }
+  if (segment_writer.valid())
+    return segment_writer.get();
   return Succeeded::yes;
 }
 END_NAMESPACE_STIR
@@ -9,7 +9,7 @@
 
 */
 /*
-  Copyright (C) 2021, 2022, 2024 University Copyright London
+  Copyright (C) 2021, 2022, 2024, 2026 University Copyright London
   This file is part of STIR.
 
   SPDX-License-Identifier: Apache-2.0
@@ -22,13 +22,40 @@
 #include "stir/ProjDataInfoCylindricalNoArcCorr.h"
 #include "stir/ProjDataInfoBlocksOnCylindricalNoArcCorr.h"
 #include "stir/Bin.h"
-#include "stir/Sinogram.h"
+#include "stir/SegmentByView.h"
+#include "stir/DetectionPositionPair.h"
+#include "stir/Succeeded.h"
 #include "stir/error.h"
+#include <boost/format.hpp>
 #include <memory>
+#include <future>
+#include <vector>
 
 START_NAMESPACE_STIR
 
-// declaration of local function that does the work
+// local function that writes a (non-TOF) segment, replicating it for every TOF bin
+static void
+set_segment_for_all_tof_bins(ProjData& proj_data, const SegmentByView<float>& segment)
+{
+  if (proj_data.get_num_tof_poss() == 1)
+    {
+      if (proj_data.set_segment(segment) != Succeeded::yes)
+        error(boost::format("multiply_crystal_factors: error writing segment %1%") % segment.get_segment_num());
+      return;
+    }
+  for (int timing_pos_num = proj_data.get_min_tof_pos_num(); timing_pos_num <= proj_data.get_max_tof_pos_num(); ++timing_pos_num)
+    {
+      // construct TOF segment with same values as the non-TOF segment,
+      // but appropriate meta-data.
+      const SegmentByView<float> tof_segment(
+          segment, proj_data.get_proj_data_info_sptr(), SegmentIndices(segment.get_segment_num(), timing_pos_num));
+      if (proj_data.set_segment(tof_segment) != Succeeded::yes)
+        error(boost::format("multiply_crystal_factors: error writing segment %1%, TOF bin %2%") % segment.get_segment_num()
+              % timing_pos_num);
+    }
+}
+
+// local function that does the work
 template <class TProjDataInfo>
 void
 multiply_crystal_factors_help(ProjData& proj_data,
@@ -41,82 +68,82 @@ multiply_crystal_factors_help(ProjData& proj_data,
   global_factor /= proj_data.get_num_tof_poss();
 
   const auto non_tof_proj_data_info_sptr = std::dynamic_pointer_cast<TProjDataInfo>(proj_data_info.create_non_tof_clone());
-  Bin bin;
+  const int min_tangential_pos_num = proj_data.get_min_tangential_pos_num();
+  const int num_tangential_poss = proj_data.get_num_tangential_poss();
+  const int view_mashing_factor = non_tof_proj_data_info_sptr->get_view_mashing_factor();
 
-  for (bin.segment_num() = proj_data.get_min_segment_num(); bin.segment_num() <= proj_data.get_max_segment_num();
-       ++bin.segment_num())
-    {
+  // Segments are written by another thread, while the next segment is computed.
+  // Note that get() rethrows any exception that occurred while writing.
+  std::future<void> segment_writer;
 
-      for (bin.axial_pos_num() = proj_data.get_min_axial_pos_num(bin.segment_num());
-           bin.axial_pos_num() <= proj_data.get_max_axial_pos_num(bin.segment_num());
-           ++bin.axial_pos_num())
-        {
-          Sinogram<float> sinogram = non_tof_proj_data_info_sptr->get_empty_sinogram(SinogramIndices(bin));
+  for (int segment_num = proj_data.get_min_segment_num(); segment_num <= proj_data.get_max_segment_num(); ++segment_num)
+    {
+      const int min_axial_pos_num = proj_data.get_min_axial_pos_num(segment_num);
+      const int max_axial_pos_num = proj_data.get_max_axial_pos_num(segment_num);
+      const auto segment_sptr = std::make_shared<SegmentByView<float>>(
+          non_tof_proj_data_info_sptr->get_empty_segment_by_view(SegmentIndices(segment_num)));
 
 #ifdef STIR_OPENMP
-#  if _OPENMP >= 200711
-#    pragma omp parallel for collapse(2) // OpenMP 3.1
-#  else
-#    pragma omp parallel for // older versions
-#  endif
+#  pragma omp parallel for schedule(dynamic)
 #endif
-          for (int view_num = proj_data.get_min_view_num(); view_num <= proj_data.get_max_view_num(); ++view_num)
+      for (int view_num = proj_data.get_min_view_num(); view_num <= proj_data.get_max_view_num(); ++view_num)
+        {
+          // Find the crystals for every (uncompressed) view and tangential position.
+          // These are independent of the axial position, and get_all_det_pos_pairs_for_bin()
+          // returns them in the same order, each one repeated for all ring pairs.
+          std::vector<std::vector<int>> det1_nums(view_mashing_factor, std::vector<int>(num_tangential_poss));
+          std::vector<std::vector<int>> det2_nums(view_mashing_factor, std::vector<int>(num_tangential_poss));
+          {
+            const auto num_ring_pairs = static_cast<std::size_t>(
+                non_tof_proj_data_info_sptr->get_num_ring_pairs_for_segment_axial_pos_num(segment_num, min_axial_pos_num));
+            std::vector<DetectionPositionPair<>> det_pos_pairs;
+            Bin bin(segment_num, view_num, min_axial_pos_num, 0);
+            for (int t = 0; t < num_tangential_poss; ++t)
+              {
+                bin.tangential_pos_num() = min_tangential_pos_num + t;
+                non_tof_proj_data_info_sptr->get_all_det_pos_pairs_for_bin(det_pos_pairs, bin);
+                assert(det_pos_pairs.size() == num_ring_pairs * view_mashing_factor);
+                for (int uncompressed_view = 0; uncompressed_view < view_mashing_factor; ++uncompressed_view)
+                  {
+                    const auto& det_pos_pair = det_pos_pairs[uncompressed_view * num_ring_pairs];
+                    det1_nums[uncompressed_view][t] = det_pos_pair.pos1().tangential_coord();
+                    det2_nums[uncompressed_view][t] = det_pos_pair.pos2().tangential_coord();
+                  }
+              }
+          }
+
+          // Now add products of crystal factors, looping over tangential positions in the inner loop.
+          // Contributions are added in the same order as the detection position pairs of a bin.
+          Array<2, float>& viewgram = (*segment_sptr)[view_num];
+          for (int axial_pos_num = min_axial_pos_num; axial_pos_num <= max_axial_pos_num; ++axial_pos_num)
             {
-              for (int tangential_pos_num = proj_data.get_min_tangential_pos_num();
-                   tangential_pos_num <= proj_data.get_max_tangential_pos_num();
-                   ++tangential_pos_num)
+              float* const row = &viewgram[axial_pos_num][min_tangential_pos_num];
+              const auto& ring_pairs
+                  = non_tof_proj_data_info_sptr->get_all_ring_pairs_for_segment_axial_pos_num(segment_num, axial_pos_num);
+              for (int uncompressed_view = 0; uncompressed_view < view_mashing_factor; ++uncompressed_view)
                 {
-                  // Construct bin with appropriate values
-                  // Sadly cannot be done in the loops above for OpenMP 2.0 compatibility
-                  Bin parallel_bin(bin);
-                  parallel_bin.view_num() = view_num;
-                  parallel_bin.tangential_pos_num() = tangential_pos_num;
-
-                  std::vector<DetectionPositionPair<>> det_pos_pairs;
-                  non_tof_proj_data_info_sptr->get_all_det_pos_pairs_for_bin(
-                      det_pos_pairs, parallel_bin); // using the default argument to ignore TOF here
-                  float result = 0.F;
-                  for (unsigned int i = 0; i < det_pos_pairs.size(); ++i)
+                  const int* const det1_num = det1_nums[uncompressed_view].data();
+                  const int* const det2_num = det2_nums[uncompressed_view].data();
+                  for (const auto& ring_pair : ring_pairs)
                     {
-                      const auto& p1 = det_pos_pairs[i].pos1();
-                      const auto& p2 = det_pos_pairs[i].pos2();
-                      result += efficiencies[p1.axial_coord()][p1.tangential_coord()]
-                                * efficiencies[p2.axial_coord()][p2.tangential_coord()];
+                      const Array<1, float>& efficiencies1 = efficiencies[ring_pair.first];
+                      const Array<1, float>& efficiencies2 = efficiencies[ring_pair.second];
+                      for (int t = 0; t < num_tangential_poss; ++t)
+                        row[t] += efficiencies1[det1_num[t]] * efficiencies2[det2_num[t]];
                     }
-#if defined(STIR_OPENMP)
-#  if _OPENMP >= 201012
-#    pragma omp atomic update
-#  else
-#    pragma omp critical(STIRMULTIPLYCRYSTALFACTORS)
-                  {
-#  endif
-#endif
-                  // Use += such that the "atomic update" pragma compiles (OpenMP 3.0).
-                  // Presumably with OpenMP 3.1 we could use "atomic write"
-                  sinogram[parallel_bin.view_num()][parallel_bin.tangential_pos_num()] += result * global_factor;
-#if defined(STIR_OPENMP) && _OPENMP < 201012
                 }
-#endif
-            }
-        }
-      // now set sinogram, a bit complicated for TOF as we replicate
-      if (proj_data.get_num_tof_poss() == 1)
-        {
-          proj_data.set_sinogram(sinogram);
-        }
-      else
-        {
-          for (bin.timing_pos_num() = proj_data.get_min_tof_pos_num(); bin.timing_pos_num() <= proj_data.get_max_tof_pos_num();
-               ++bin.timing_pos_num())
-            {
-              // construct TOF sinogram with same values as the non-TOF sinogram,
-              // but appropriate meta-data.
-              const Sinogram<float> tof_sinogram(sinogram, proj_data.get_proj_data_info_sptr(), SinogramIndices(bin));
-              proj_data.set_sinogram(tof_sinogram);
+              for (int t = 0; t < num_tangential_poss; ++t)
+                row[t] *= global_factor;
             }
         }
+
+      if (segment_writer.valid())
+        segment_writer.get();
+      segment_writer = std::async(std::launch::async,
+                                  [&proj_data, segment_sptr]() { set_segment_for_all_tof_bins(proj_data, *segment_sptr); });
     }
-}
+  if (segment_writer.valid())
+    segment_writer.get();
 }
 
 void
@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2018-2019, University College London
+    Copyright (C) 2018-2019, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -42,9 +42,110 @@
 #include "stir/IndexRange2D.h"
 #include "stir/error.h"
 #include <cmath>
+#include <vector>
+#include <algorithm>
 
 START_NAMESPACE_STIR
 
+namespace
+{
+/*
+  Weights for overlap interpolation along one axis, such that (for 1D arrays)
+    out[out_index] = sum_i weights[i] * in[first_in_index + i]
+  This gives the same result as overlap_interpolate(out, in, zoom, offset) (up to rounding errors),
+  but the weights are computed only once, and can then be used for every row (or plane) of the data.
+*/
+class OverlapInterpolationWeights
+{
+public:
+  OverlapInterpolationWeights(const int min_out_index,
+                              const int max_out_index,
+                              const int min_in_index,
+                              const int max_in_index,
+                              const float zoom,
+                              const float offset)
+      : min_out_index(min_out_index),
+        first_in_index(std::max(max_out_index - min_out_index + 1, 0)),
+        weights_begin(first_in_index.size() + 1, 0)
+  {
+    assert(zoom > 0);
+    for (int out_index = min_out_index; out_index <= max_out_index; ++out_index)
+      {
+        const std::size_t i = static_cast<std::size_t>(out_index - min_out_index);
+        // edges of the 'out' bin in 'in' coordinates (see overlap_interpolate)
+        const double left_edge = (out_index - .5) / zoom + offset;
+        const double right_edge = (out_index + .5) / zoom + offset;
+        const int first = std::max(static_cast<int>(std::floor(left_edge + .5)), min_in_index);
+        const int last = std::min(static_cast<int>(std::ceil(right_edge - .5)), max_in_index);
+        first_in_index[i] = first;
+        for (int in_index = first; in_index <= last; ++in_index)
+          {
+            const double overlap = std::min(right_edge, in_index + .5) - std::max(left_edge, in_index - .5);
+#ifndef STIR_OVERLAP_NORMALISATION
+            weights.push_back(static_cast<float>(std::max(overlap, 0.)));
+#else
+            weights.push_back(static_cast<float>(std::max(overlap, 0.) * zoom));
+#endif
+          }
+        weights_begin[i + 1] = weights.size();
+      }
+  }
+
+  //! multiply all weights with a factor
+  void scale(const float factor)
+  {
+    for (auto& weight : weights)
+      weight *= factor;
+  }
+
+  //! compute a single value for a 1D array
+  float compute(const Array<1, float>& in, const int out_index) const
+  {
+    const std::size_t i = static_cast<std::size_t>(out_index - min_out_index);
+    int in_index = first_in_index[i];
+    float value = 0.F;
+    for (std::size_t w = weights_begin[i]; w < weights_begin[i + 1]; ++w, ++in_index)
+      value += weights[w] * in[in_index];
+    return value;
+  }
+
+  //! compute a row (or plane) of the output, interpolating along the first index of \a in
+  /*! \a out_elem has to have the same index range as every element of \a in. */
+  template <int num_dimensions>
+  void compute(Array<num_dimensions, float>& out_elem, const Array<num_dimensions + 1, float>& in, const int out_index) const
+  {
+    const std::size_t i = static_cast<std::size_t>(out_index - min_out_index);
+    out_elem.fill(0.F);
+    int in_index = first_in_index[i];
+    for (std::size_t w = weights_begin[i]; w < weights_begin[i + 1]; ++w, ++in_index)
+      add_scaled(out_elem, in[in_index], weights[w]);
+  }
+
+private:
+  int min_out_index;
+  std::vector<int> first_in_index;
+  std::vector<std::size_t> weights_begin;
+  std::vector<float> weights;
+
+  // out += weight*in, written such that the innermost loop can be vectorised
+  static void add_scaled(Array<1, float>& out, const Array<1, float>& in, const float weight)
+  {
+    assert(out.get_index_range() == in.get_index_range());
+    Array<1, float>::const_iterator in_iter = in.begin();
+    for (Array<1, float>::iterator out_iter = out.begin(); out_iter != out.end(); ++out_iter, ++in_iter)
+      *out_iter += weight * *in_iter;
+  }
+
+  template <int num_dimensions>
+  static void add_scaled(Array<num_dimensions, float>& out, const Array<num_dimensions, float>& in, const float weight)
+  {
+    for (int index = out.get_min_index(); index <= out.get_max_index(); ++index)
+      add_scaled(out[index], in[index], weight);
+  }
+};
+
+} // namespace
+
 // TODO all these are terribly wasteful with memory allocations
 // main reason: we cannot have segments with viewgrams of different sizes (et al)
 // also they need to be converted to the new design
@@ -203,9 +304,18 @@ zoom_viewgram(Viewgram<float>& out_view, const Viewgram<float>& in_view, const f
   // compute offset in tangential_sampling_in units
   const float offset = (x_offset_in_mm * cos(phi) + y_offset_in_mm * sin(phi)) / in_bin_size;
 
+  // the weights are the same for every axial position
+  const OverlapInterpolationWeights weights(out_view.get_min_tangential_pos_num(),
+                                            out_view.get_max_tangential_pos_num(),
+                                            in_view.get_min_tangential_pos_num(),
+                                            in_view.get_max_tangential_pos_num(),
+                                            zoom,
+                                            offset);
   for (int axial_pos_num = out_view.get_min_axial_pos_num(); axial_pos_num <= out_view.get_max_axial_pos_num(); ++axial_pos_num)
     {
-      overlap_interpolate(out_view[axial_pos_num], in_view[axial_pos_num], zoom, offset);
+      Array<1, float>& out_row = out_view[axial_pos_num];
+      for (int tang_pos_num = out_row.get_min_index(); tang_pos_num <= out_row.get_max_index(); ++tang_pos_num)
+        out_row[tang_pos_num] = weights.compute(in_view[axial_pos_num], tang_pos_num);
     }
 }
 
@@ -289,13 +399,8 @@ zoom_image(const VoxelsOnCartesianGrid<float>& image,
   const BasicCoordinate<3, int> new_sizes = make_coordinate(image.get_length(), new_size, new_size);
 
   VoxelsOnCartesianGrid<float> new_image = construct_new_image_from_zoom_parameters(image, zooms, offsets_in_mm, new_sizes);
-
-  PixelsOnCartesianGrid<float> new_image2D = new_image.get_plane(new_image.get_min_z());
-  for (int plane = image.get_min_z(); plane <= image.get_max_z(); plane++)
-    {
-      zoom_image(new_image2D, image.get_plane(plane), zoom_options);
-      new_image.set_plane(new_image2D, plane);
-    }
+  // planes are not zoomed, but this allows processing planes in parallel
+  zoom_image(new_image, image, zoom_options);
 
   assert(norm(new_image.get_voxel_size() - image.get_voxel_size() / zooms) < 1);
 
@@ -371,32 +476,6 @@ zoom_image(VoxelsOnCartesianGrid<float>& image_out, const VoxelsOnCartesianGrid<
       return;
     }
 
-  // TODO creating a lot of new images here...
-  Array<3, float> temp(IndexRange3D(image_in.get_min_z(),
-                                    image_in.get_max_z(),
-                                    image_in.get_min_y(),
-                                    image_in.get_max_y(),
-                                    image_out.get_min_x(),
-                                    image_out.get_max_x()));
-
-  for (int z = image_in.get_min_z(); z <= image_in.get_max_z(); z++)
-    for (int y = image_in.get_min_y(); y <= image_in.get_max_y(); y++)
-      overlap_interpolate(temp[z][y], image_in[z][y], zoom_x, x_offset);
-
-  Array<3, float> temp2(IndexRange3D(image_in.get_min_z(),
-                                     image_in.get_max_z(),
-                                     image_out.get_min_y(),
-                                     image_out.get_max_y(),
-                                     image_out.get_min_x(),
-                                     image_out.get_max_x()));
-
-  for (int z = image_in.get_min_z(); z <= image_in.get_max_z(); z++)
-    overlap_interpolate(temp2[z], temp[z], zoom_y, y_offset);
-
-  temp.recycle();
-
-  overlap_interpolate(image_out, temp2, zoom_z, z_offset);
-
   float scale_image = 1.F;
 
   switch (zoom_options.get_scaling_option())
@@ -414,12 +493,56 @@ zoom_image(VoxelsOnCartesianGrid<float>& image_out, const VoxelsOnCartesianGrid<
       }
 
       case ZoomOptions::preserve_sum: {
-        return; // no need to scale
+        break; // no need to scale
       }
     }
 
+  /*
+    Interpolation is done separably, using the same weights for every row. First along x and y, plane by plane
+    (for every input plane), then along z. The scale factor is included in the weights for z.
+  */
+  const OverlapInterpolationWeights x_weights(
+      image_out.get_min_x(), image_out.get_max_x(), image_in.get_min_x(), image_in.get_max_x(), zoom_x, x_offset);
+  const OverlapInterpolationWeights y_weights(
+      image_out.get_min_y(), image_out.get_max_y(), image_in.get_min_y(), image_in.get_max_y(), zoom_y, y_offset);
+  OverlapInterpolationWeights z_weights(
+      image_out.get_min_z(), image_out.get_max_z(), image_in.get_min_z(), image_in.get_max_z(), zoom_z, z_offset);
   if (scale_image != 1.F)
-    image_out *= scale_image;
+    z_weights.scale(scale_image);
+
+  // planes of the input image, zoomed in x and y
+  Array<3, float> temp(IndexRange3D(image_in.get_min_z(),
+                                    image_in.get_max_z(),
+                                    image_out.get_min_y(),
+                                    image_out.get_max_y(),
+                                    image_out.get_min_x(),
+                                    image_out.get_max_x()));
+
+#ifdef STIR_OPENMP
+#  pragma omp parallel
+#endif
+  {
+    // one buffer per thread for the plane zoomed in x
+    Array<2, float> plane_zoomed_in_x(
+        IndexRange2D(image_in.get_min_y(), image_in.get_max_y(), image_out.get_min_x(), image_out.get_max_x()));
+#ifdef STIR_OPENMP
+#  pragma omp for schedule(static)
+#endif
+    for (int z = image_in.get_min_z(); z <= image_in.get_max_z(); z++)
+      {
+        for (int y = image_in.get_min_y(); y <= image_in.get_max_y(); y++)
+          for (int x = image_out.get_min_x(); x <= image_out.get_max_x(); x++)
+            plane_zoomed_in_x[y][x] = x_weights.compute(image_in[z][y], x);
+        for (int y = image_out.get_min_y(); y <= image_out.get_max_y(); y++)
+          y_weights.compute(temp[z][y], plane_zoomed_in_x, y);
+      }
+  }
+
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(static)
+#endif
+  for (int z = image_out.get_min_z(); z <= image_out.get_max_z(); z++)
+    z_weights.compute(image_out[z], temp, z);
 }
 
 void
@@ -444,14 +567,6 @@ zoom_image(PixelsOnCartesianGrid<float>& image2D_out,
       return;
     }
 
-  Array<2, float> temp(
-      IndexRange2D(image2D_in.get_min_y(), image2D_in.get_max_y(), image2D_out.get_min_x(), image2D_out.get_max_x()));
-
-  for (int y = image2D_in.get_min_y(); y <= image2D_in.get_max_y(); y++)
-    overlap_interpolate(temp[y], image2D_in[y], zoom_x, x_offset);
-
-  overlap_interpolate(image2D_out, temp, zoom_y, y_offset);
-
   float scale_image = 1.F;
 
   switch (zoom_options.get_scaling_option())
@@ -469,12 +584,27 @@ zoom_image(PixelsOnCartesianGrid<float>& image2D_out,
       }
 
       case ZoomOptions::preserve_sum: {
-        return; // no need to scale
+        break; // no need to scale
       }
     }
 
+  // see the 3D version
+  const OverlapInterpolationWeights x_weights(
+      image2D_out.get_min_x(), image2D_out.get_max_x(), image2D_in.get_min_x(), image2D_in.get_max_x(), zoom_x, x_offset);
+  OverlapInterpolationWeights y_weights(
+      image2D_out.get_min_y(), image2D_out.get_max_y(), image2D_in.get_min_y(), image2D_in.get_max_y(), zoom_y, y_offset);
   if (scale_image != 1.F)
-    image2D_out *= scale_image;
+    y_weights.scale(scale_image);
+
+  Array<2, float> temp(
+      IndexRange2D(image2D_in.get_min_y(), image2D_in.get_max_y(), image2D_out.get_min_x(), image2D_out.get_max_x()));
+
+  for (int y = image2D_in.get_min_y(); y <= image2D_in.get_max_y(); y++)
+    for (int x = image2D_out.get_min_x(); x <= image2D_out.get_max_x(); x++)
+      temp[y][x] = x_weights.compute(image2D_in[y], x);
+
+  for (int y = image2D_out.get_min_y(); y <= image2D_out.get_max_y(); y++)
+    y_weights.compute(image2D_out[y], temp, y);
 }
 
 END_NAMESPACE_STIR
@@ -0,0 +1,94 @@
+/*
+    Copyright (C) 2000 - 2007, Hammersmith Imanet Ltd
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup evaluation
+
+  \brief Implementation of class stir::ROIValuesParameters
+
+  \author Kris Thielemans
+*/
+#include "stir/evaluation/ROIValuesParameters.h"
+#include "stir/is_null_ptr.h"
+#include "stir/warning.h"
+
+START_NAMESPACE_STIR
+
+ROIValuesParameters::ROIValuesParameters()
+{
+  set_defaults();
+  initialise_keymap();
+}
+
+void
+ROIValuesParameters::increment_current_shape_num()
+{
+  if (!is_null_ptr(current_shape_sptr))
+    {
+      shape_ptrs.push_back(current_shape_sptr);
+      shape_names.push_back(current_shape_name);
+      current_shape_sptr.reset();
+      current_shape_name = "";
+    }
+}
+
+void
+ROIValuesParameters::set_defaults()
+{
+  shape_ptrs.resize(0);
+  shape_names.resize(0);
+
+  filter_ptr.reset();
+  current_shape_sptr.reset();
+  current_shape_name = "";
+  num_samples = CartesianCoordinate3D<int>(1, 1, 1);
+}
+
+void
+ROIValuesParameters::initialise_keymap()
+{
+  add_start_key("ROIValues Parameters");
+  add_key("ROI name", &current_shape_name);
+  add_parsing_key("ROI Shape type", &current_shape_sptr);
+  add_key("next shape", KeyArgument::NONE, (KeywordProcessor)&ROIValuesParameters::increment_current_shape_num);
+  add_key("number of samples to take for ROI template-z", &num_samples.z());
+  add_key("number of samples to take for ROI template-y", &num_samples.y());
+  add_key("number of samples to take for ROI template-x", &num_samples.x());
+  add_parsing_key("Image Filter type", &filter_ptr);
+  add_stop_key("END");
+}
+
+bool
+ROIValuesParameters::post_processing()
+{
+  assert(shape_names.size() == shape_ptrs.size());
+
+  if (!is_null_ptr(current_shape_sptr))
+    {
+      increment_current_shape_num();
+    }
+  if (num_samples.z() <= 0)
+    {
+      warning("number of samples to take in z-direction should be strictly positive\n");
+      return true;
+    }
+  if (num_samples.y() <= 0)
+    {
+      warning("number of samples to take in y-direction should be strictly positive\n");
+      return true;
+    }
+  if (num_samples.x() <= 0)
+    {
+      warning("number of samples to take in x-direction should be strictly positive\n");
+      return true;
+    }
+  return false;
+}
+
+END_NAMESPACE_STIR
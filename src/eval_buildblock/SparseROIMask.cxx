@@ -0,0 +1,135 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup evaluation
+
+  \brief Implementation of class stir::SparseROIMask
+
+  \author Kris Thielemans
+*/
+#include "stir/evaluation/SparseROIMask.h"
+#include "stir/Shape/Shape3D.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/shared_ptr.h"
+#include "stir/error.h"
+#include "stir/round.h"
+#include <unordered_map>
+
+START_NAMESPACE_STIR
+
+SparseROIMask::SparseROIMask()
+{}
+
+SparseROIMask::SparseROIMask(const Shape3D& shape,
+                             const VoxelsOnCartesianGrid<float>& image_template,
+                             const CartesianCoordinate3D<int>& num_samples)
+{
+  shared_ptr<VoxelsOnCartesianGrid<float>> discretised_shape_sptr(image_template.get_empty_voxels_on_cartesian_grid());
+  shape.construct_volume(*discretised_shape_sptr, num_samples);
+  this->set_from_image(*discretised_shape_sptr);
+}
+
+SparseROIMask::SparseROIMask(const DiscretisedDensity<3, float>& discretised_shape)
+{
+  const VoxelsOnCartesianGrid<float>* image_ptr = dynamic_cast<const VoxelsOnCartesianGrid<float>*>(&discretised_shape);
+  if (!image_ptr)
+    error("SparseROIMask: can only handle images of type VoxelsOnCartesianGrid");
+  this->set_from_image(*image_ptr);
+}
+
+std::vector<SparseROIMask>
+SparseROIMask::construct_from_label_image(const DiscretisedDensity<3, float>& label_image, const std::vector<int>& labels)
+{
+  const VoxelsOnCartesianGrid<float>* image_ptr = dynamic_cast<const VoxelsOnCartesianGrid<float>*>(&label_image);
+  if (!image_ptr)
+    error("SparseROIMask: can only handle images of type VoxelsOnCartesianGrid");
+  const VoxelsOnCartesianGrid<float>& image = *image_ptr;
+
+  std::unordered_map<int, std::size_t> label_to_mask_num;
+  for (std::size_t i = 0; i < labels.size(); ++i)
+    if (!label_to_mask_num.emplace(labels[i], i).second)
+      error("SparseROIMask::construct_from_label_image: label %d occurs more than once", labels[i]);
+
+  std::vector<SparseROIMask> masks(labels.size());
+  for (SparseROIMask& mask : masks)
+    mask.set_grid_from_image(image);
+
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z = image.get_min_z(); z <= image.get_max_z(); ++z)
+    {
+      for (int y = image[z].get_min_index(); y <= image[z].get_max_index(); ++y)
+        for (int x = image[z][y].get_min_index(); x <= image[z][y].get_max_index(); ++x)
+          {
+            const auto iter = label_to_mask_num.find(round(image[z][y][x]));
+            if (iter != label_to_mask_num.end())
+              masks[iter->second].planes[z].push_back(VoxelWeight{ y, x, 1.F });
+          }
+      for (SparseROIMask& mask : masks)
+        mask.planes[z].shrink_to_fit();
+    }
+  return masks;
+}
+
+void
+SparseROIMask::set_grid_from_image(const VoxelsOnCartesianGrid<float>& image)
+{
+  this->index_range = image.get_index_range();
+  this->origin = image.get_origin();
+  this->voxel_size = image.get_voxel_size();
+  this->planes = VectorWithOffset<std::vector<VoxelWeight>>(image.get_min_z(), image.get_max_z());
+}
+
+void
+SparseROIMask::set_from_image(const VoxelsOnCartesianGrid<float>& discretised_shape)
+{
+  this->set_grid_from_image(discretised_shape);
+
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z = discretised_shape.get_min_z(); z <= discretised_shape.get_max_z(); ++z)
+    {
+      std::vector<VoxelWeight>& plane = this->planes[z];
+      for (int y = discretised_shape[z].get_min_index(); y <= discretised_shape[z].get_max_index(); ++y)
+        for (int x = discretised_shape[z][y].get_min_index(); x <= discretised_shape[z][y].get_max_index(); ++x)
+          {
+            const float weight = discretised_shape[z][y][x];
+            if (weight != 0)
+              plane.push_back(VoxelWeight{ y, x, weight });
+          }
+      plane.shrink_to_fit();
+    }
+}
+
+bool
+SparseROIMask::is_compatible_with(const DiscretisedDensity<3, float>& density) const
+{
+  const VoxelsOnCartesianGrid<float>* image_ptr = dynamic_cast<const VoxelsOnCartesianGrid<float>*>(&density);
+  if (!image_ptr)
+    return false;
+  if (image_ptr->get_index_range() != this->index_range)
+    return false;
+  const float tolerance = 1.E-4F * norm(this->voxel_size);
+  return norm(image_ptr->get_voxel_size() - this->voxel_size) <= tolerance
+         && norm(image_ptr->get_origin() - this->origin) <= tolerance;
+}
+
+std::size_t
+SparseROIMask::get_num_voxels() const
+{
+  std::size_t num_voxels = 0;
+  for (int z = this->planes.get_min_index(); z <= this->planes.get_max_index(); ++z)
+    num_voxels += this->planes[z].size();
+  return num_voxels;
+}
+
+END_NAMESPACE_STIR
@@ -18,7 +18,10 @@
     See STIR/LICENSE.txt for details
 */
 #include "stir/evaluation/compute_ROI_values.h"
+#include "stir/evaluation/SparseROIMask.h"
 #include "stir/Shape/Shape3D.h"
+#include "stir/DynamicDiscretisedDensity.h"
+#include "stir/GatedDiscretisedDensity.h"
 #include "stir/CartesianCoordinate2D.h"
 #include "stir/CartesianCoordinate3D.h"
 #include "stir/VoxelsOnCartesianGrid.h"
@@ -29,6 +32,38 @@
 
 START_NAMESPACE_STIR
 
+static ROIValues
+compute_ROI_values_for_plane(const VoxelsOnCartesianGrid<float>& image,
+                             const SparseROIMask& mask,
+                             const int z,
+                             const float voxel_volume)
+{
+  // same computation as for the discretised_shape version of compute_ROI_values_per_plane, but only loop over voxels in the mask
+  float ROI_min = std::numeric_limits<float>::max();
+  float ROI_max = std::numeric_limits<float>::min();
+  float integral = 0;
+  float integral_square = 0;
+  float volume = 0;
+  for (const SparseROIMask::VoxelWeight& voxel : mask.get_plane(z))
+    {
+      volume += voxel.weight;
+      const float org_value = image[z][voxel.y][voxel.x];
+      if (org_value < ROI_min)
+        ROI_min = org_value;
+      if (org_value > ROI_max)
+        ROI_max = org_value;
+      if (org_value == 0)
+        continue;
+      const float value = voxel.weight * org_value;
+      integral += value;
+      integral_square += value * org_value;
+    }
+  integral *= voxel_volume;
+  integral_square *= voxel_volume;
+  volume *= voxel_volume;
+  return ROIValues(volume, integral, integral_square, ROI_min, ROI_max);
+}
+
 void
 compute_ROI_values_per_plane(VectorWithOffset<ROIValues>& values,
                              const DiscretisedDensity<3, float>& density,
@@ -36,11 +71,9 @@ compute_ROI_values_per_plane(VectorWithOffset<ROIValues>& values,
                              const CartesianCoordinate3D<int>& num_samples)
 {
   const VoxelsOnCartesianGrid<float>& image = dynamic_cast<const VoxelsOnCartesianGrid<float>&>(density);
-  shared_ptr<VoxelsOnCartesianGrid<float>> discretised_shape_ptr(image.get_empty_voxels_on_cartesian_grid());
-
-  shape.construct_volume(*discretised_shape_ptr, num_samples);
+  const SparseROIMask mask(shape, image, num_samples);
 
-  compute_ROI_values_per_plane(values, density, *discretised_shape_ptr);
+  compute_ROI_values_per_plane(values, density, mask);
 }
 
 void
@@ -61,6 +94,9 @@ compute_ROI_values_per_plane(VectorWithOffset<ROIValues>& values,
   // initialise values correct size
   values = VectorWithOffset<ROIValues>(min_z, max_z);
 
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int z = min_z; z <= max_z; z++)
     {
 #if 0
@@ -108,6 +144,83 @@ compute_ROI_values_per_plane(VectorWithOffset<ROIValues>& values,
     }
 }
 
+void
+compute_ROI_values_per_plane(VectorWithOffset<ROIValues>& values,
+                             const DiscretisedDensity<3, float>& density,
+                             const SparseROIMask& mask)
+{
+  if (!mask.is_compatible_with(density))
+    error("compute_ROI_values_per_plane: density and mask do not have the same characteristics.");
+
+  const int min_z = density.get_min_index();
+  const int max_z = density.get_max_index();
+  const VoxelsOnCartesianGrid<float>& image = dynamic_cast<const VoxelsOnCartesianGrid<float>&>(density);
+  const float voxel_volume = mask.get_voxel_volume();
+
+  // initialise values correct size
+  values = VectorWithOffset<ROIValues>(min_z, max_z);
+
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int z = min_z; z <= max_z; z++)
+    values[z] = compute_ROI_values_for_plane(image, mask, z, voxel_volume);
+}
+
+void
+compute_total_ROI_values(std::vector<ROIValues>& values,
+                         const DiscretisedDensity<3, float>& density,
+                         const std::vector<SparseROIMask>& masks)
+{
+  for (const SparseROIMask& mask : masks)
+    if (!mask.is_compatible_with(density))
+      error("compute_total_ROI_values: density and masks do not have the same characteristics.");
+
+  values.assign(masks.size(), ROIValues());
+  if (masks.empty())
+    return;
+
+  const int min_z = density.get_min_index();
+  const int num_planes = density.get_max_index() - min_z + 1;
+  const VoxelsOnCartesianGrid<float>& image = dynamic_cast<const VoxelsOnCartesianGrid<float>&>(density);
+  const float voxel_volume = masks[0].get_voxel_volume();
+
+  // loop over all (mask, plane) combinations in one go, such that threads are kept busy
+  // even when there are only a few masks, or masks only cover a few planes
+  const int num_tasks = static_cast<int>(masks.size()) * num_planes;
+  std::vector<ROIValues> plane_values(num_tasks);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int task_num = 0; task_num < num_tasks; ++task_num)
+    {
+      const int mask_num = task_num / num_planes;
+      const int z = min_z + task_num % num_planes;
+      plane_values[task_num] = compute_ROI_values_for_plane(image, masks[mask_num], z, voxel_volume);
+    }
+
+  for (int task_num = 0; task_num < num_tasks; ++task_num)
+    values[task_num / num_planes] += plane_values[task_num];
+}
+
+std::vector<std::vector<ROIValues>>
+compute_total_ROI_values(const DynamicDiscretisedDensity& images, const std::vector<SparseROIMask>& masks)
+{
+  std::vector<std::vector<ROIValues>> values(images.get_num_time_frames());
+  for (unsigned int frame_num = 1; frame_num <= images.get_num_time_frames(); ++frame_num)
+    compute_total_ROI_values(values[frame_num - 1], images.get_density(frame_num), masks);
+  return values;
+}
+
+std::vector<std::vector<ROIValues>>
+compute_total_ROI_values(const GatedDiscretisedDensity& images, const std::vector<SparseROIMask>& masks)
+{
+  std::vector<std::vector<ROIValues>> values(images.get_num_gates());
+  for (unsigned int gate_num = 1; gate_num <= images.get_num_gates(); ++gate_num)
+    compute_total_ROI_values(values[gate_num - 1], images.get_density(gate_num), masks);
+  return values;
+}
+
 ROIValues
 compute_total_ROI_values(const VectorWithOffset<ROIValues>& values)
 {
@@ -128,6 +241,14 @@ compute_total_ROI_values(const DiscretisedDensity<3, float>& image,
   return compute_total_ROI_values(values);
 }
 
+ROIValues
+compute_total_ROI_values(const DiscretisedDensity<3, float>& image, const SparseROIMask& mask)
+{
+  VectorWithOffset<ROIValues> values;
+  compute_ROI_values_per_plane(values, image, mask);
+  return compute_total_ROI_values(values);
+}
+
 ROIValues
 compute_total_ROI_values(const DiscretisedDensity<3, float>& image, const DiscretisedDensity<3, float>& discretised_shape)
 {
@@ -0,0 +1,97 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projdata
+
+  \brief Declaration of class stir::DetPairViewTangPosLookupTable
+
+  \author Kris Thielemans
+*/
+#ifndef __stir_DetPairViewTangPosLookupTable_H__
+#define __stir_DetPairViewTangPosLookupTable_H__
+
+#include "stir/shared_ptr.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup projdata
+  \brief Immutable look-up tables between (unmashed) view/tangential position and detector pairs for a full ring
+
+  The tables used by ProjDataInfoCylindricalNoArcCorr and ProjDataInfoGenericNoArcCorr only depend on
+  the number of detectors per ring. Objects of this class are therefore shared between all
+  ProjDataInfo objects (and their clones) via get_shared(), and are only constructed once.
+
+  The detector-pair table is packed: an entry is stored in 32 bits, and only pairs with
+  <code>det1_num < det2_num</code> are stored. This uses the symmetry that interchanging the detectors
+  gives the same view and tangential position, but with the \c swap_detectors flag flipped.
+  For a scanner with 1000 detectors per ring, this takes about 2MB.
+
+  \warning The number of detectors per ring has to be even and at most 65534.
+*/
+class DetPairViewTangPosLookupTable
+{
+public:
+  //! Get the (possibly cached) table for a given number of detectors per ring
+  /*! Tables are kept in a process-wide cache as long as there is at least one user. */
+  static shared_ptr<const DetPairViewTangPosLookupTable> get_shared(const int num_detectors);
+
+  //! Constructs the tables (in parallel if OpenMP is enabled)
+  /*! Normally you would use get_shared() instead. */
+  explicit DetPairViewTangPosLookupTable(const int num_detectors);
+
+  int get_num_detectors() const { return num_detectors; }
+
+  //! Find unmashed view and tangential position for a detector pair
+  /*! \return \c false if the detectors had to be swapped (i.e. the bin corresponds to (\a det2_num, \a det1_num))
+      \warning \a det1_num and \a det2_num have to be different.
+  */
+  inline bool
+  get_view_tangential_pos_num_for_det_num_pair(int& view_num, int& tang_pos_num, const int det1_num, const int det2_num) const;
+
+  //! Find detector pair for an unmashed view and tangential position
+  inline void
+  get_det_num_pair_for_view_tangential_pos_num(int& det1_num, int& det2_num, const int view_num, const int tang_pos_num) const;
+
+  //! Memory used by the tables (in bytes)
+  std::size_t get_size_in_bytes() const;
+
+private:
+  struct ViewTangPosSwap
+  {
+    std::uint32_t view_num : 15;
+    std::int32_t tang_pos_num : 16;
+    std::uint32_t swap_detectors : 1;
+  };
+  struct Det1Det2
+  {
+    std::uint16_t det1_num;
+    std::uint16_t det2_num;
+  };
+
+  int num_detectors;
+  int min_tang_pos_num;
+  int num_tang_poss;
+  //! entries for det1_num < det2_num, stored row by row
+  std::vector<ViewTangPosSwap> det1det2_to_view_tangpos;
+  //! entries stored as [view_num*num_tang_poss + tang_pos_num - min_tang_pos_num]
+  std::vector<Det1Det2> view_tangpos_to_det1det2;
+
+  inline std::size_t det_pair_index(const int det1_num, const int det2_num) const;
+};
+
+END_NAMESPACE_STIR
+
+#include "stir/DetPairViewTangPosLookupTable.inl"
+
+#endif
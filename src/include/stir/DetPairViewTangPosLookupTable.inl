@@ -0,0 +1,68 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projdata
+
+  \brief Implementation of inline functions of class stir::DetPairViewTangPosLookupTable
+
+  \author Kris Thielemans
+*/
+#include <cassert>
+
+START_NAMESPACE_STIR
+
+std::size_t
+DetPairViewTangPosLookupTable::det_pair_index(const int det1_num, const int det2_num) const
+{
+  assert(det1_num < det2_num);
+  // row det1_num starts after sum_{d<det1_num} (num_detectors-1-d) entries
+  return static_cast<std::size_t>(det1_num) * (2 * num_detectors - det1_num - 1) / 2 + (det2_num - det1_num - 1);
+}
+
+bool
+DetPairViewTangPosLookupTable::get_view_tangential_pos_num_for_det_num_pair(int& view_num,
+                                                                           int& tang_pos_num,
+                                                                           const int det1_num,
+                                                                           const int det2_num) const
+{
+  assert(det1_num != det2_num);
+  assert(det1_num >= 0 && det1_num < num_detectors);
+  assert(det2_num >= 0 && det2_num < num_detectors);
+  if (det1_num < det2_num)
+    {
+      const ViewTangPosSwap& entry = det1det2_to_view_tangpos[det_pair_index(det1_num, det2_num)];
+      view_num = entry.view_num;
+      tang_pos_num = entry.tang_pos_num;
+      return entry.swap_detectors != 0;
+    }
+  else
+    {
+      const ViewTangPosSwap& entry = det1det2_to_view_tangpos[det_pair_index(det2_num, det1_num)];
+      view_num = entry.view_num;
+      tang_pos_num = entry.tang_pos_num;
+      return entry.swap_detectors == 0;
+    }
+}
+
+void
+DetPairViewTangPosLookupTable::get_det_num_pair_for_view_tangential_pos_num(int& det1_num,
+                                                                           int& det2_num,
+                                                                           const int view_num,
+                                                                           const int tang_pos_num) const
+{
+  assert(view_num >= 0 && view_num < num_detectors / 2);
+  assert(tang_pos_num >= min_tang_pos_num && tang_pos_num < min_tang_pos_num + num_tang_poss);
+  const Det1Det2& entry = view_tangpos_to_det1det2[static_cast<std::size_t>(view_num) * num_tang_poss
+                                                   + (tang_pos_num - min_tang_pos_num)];
+  det1_num = entry.det1_num;
+  det2_num = entry.det2_num;
+}
+
+END_NAMESPACE_STIR
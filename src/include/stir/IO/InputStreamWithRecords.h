@@ -10,6 +10,7 @@
 */
 /*
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -36,9 +37,10 @@ START_NAMESPACE_STIR
     the function to find out what the size of the record is. In that case, all IO
     handling is completely generic and is implemented in this class.
 
-    Current implementation needs a \c max_size_of_record to allocate enough memory
-    (on the stack) before reading. This is efficient in many cases, but impractical
-    in others.
+    Data are read from the stream in large blocks into an internal buffer, and records
+    are decoded directly from this buffer. This avoids a read call (and an allocation)
+    for every record. The stream should therefore not be used by anything else while
+    this object reads from it.
 
     \par Requirements
     \c RecordT needs to have the following member functions
@@ -52,8 +54,6 @@ START_NAMESPACE_STIR
                          const std::size_t size_of_record,
                          const OptionsT options);
     \endcode
-
-    \todo Allow choosing between allocation with \c new or on the stack.
 */
 template <class RecordT, class OptionsT>
 class InputStreamWithRecords
@@ -82,6 +82,23 @@ public:
 
   inline virtual Succeeded get_next_record(RecordT& record) const;
 
+  //! read the next records into an array
+  /*! Reads up to \a max_num_records records into the array starting at \a records.
+      This is equivalent to calling get_next_record() repeatedly, but avoids the locking
+      overhead for every record.
+      \return the number of records read. If this is less than \a max_num_records, the end
+      of the data has been reached (or an error occurred).
+  */
+  inline std::size_t get_next_records(RecordT* const records, const std::size_t max_num_records) const;
+
+  //! read the next records, using a function object to find where to store them
+  /*! \a get_record(i) has to return a reference to the \c RecordT where the i-th record is stored.
+      This is useful when the records are not in a contiguous array, but is otherwise identical to
+      the above function.
+  */
+  template <class GetRecordT>
+  inline std::size_t get_next_records(const GetRecordT& get_record, const std::size_t max_num_records) const;
+
   //! go back to starting position
   inline Succeeded reset();
 
@@ -108,6 +125,10 @@ public:
   */
   inline void set_saved_get_positions(const std::vector<std::streampos>&);
 
+  //! access the stream
+  /*! \warning The "get" position of the stream will generally be past the current record,
+      as data are buffered.
+  */
   inline std::istream& get_stream() { return *this->stream_ptr; }
 
 private:
@@ -121,6 +142,23 @@ private:
   const std::size_t max_size_of_record;
 
   const OptionsT options;
+
+  //! buffer with data read from the stream
+  mutable std::vector<char> buffer;
+  //! position of the next record in the buffer
+  mutable std::size_t buffer_pos;
+  //! end of the valid data in the buffer
+  mutable std::size_t buffer_end;
+  //! stream position corresponding to \c buffer_end, or -1 if unknown (after seeking to the end)
+  mutable std::streampos stream_position_of_buffer_end;
+
+  //! empty the buffer, called after repositioning the stream
+  inline void clear_buffer(const std::streampos stream_position) const;
+  //! make sure that at least \a size bytes are available in the buffer, reading from the stream if necessary
+  /*! \return \c false if this was not possible (e.g. at the end of the stream). */
+  inline bool ensure_data_in_buffer(const std::size_t size) const;
+  //! read a single record (without locking)
+  inline Succeeded read_record_from_buffer(RecordT& record) const;
 };
 
 END_NAMESPACE_STIR
@@ -8,6 +8,7 @@
 /*
     Copyright (C) 2003-2011, Hammersmith Imanet Ltd
     Copyright (C) 2012-2013, Kris Thielemans
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -19,10 +20,10 @@
 #include "stir/Succeeded.h"
 #include "stir/is_null_ptr.h"
 #include "stir/shared_ptr.h"
-#include "boost/shared_array.hpp"
 #include "stir/warning.h"
 #include "stir/error.h"
 #include <fstream>
+#include <algorithm>
 
 START_NAMESPACE_STIR
 template <class RecordT, class OptionsT>
@@ -36,11 +37,14 @@ InputStreamWithRecords<RecordT, OptionsT>::InputStreamWithRecords(const shared_p
       options(options)
 {
   assert(size_of_record_signature <= max_size_of_record);
+  buffer.resize(std::max(std::size_t(1048576), max_size_of_record));
+  clear_buffer(std::streampos(0));
   if (is_null_ptr(stream_ptr))
     return;
   starting_stream_position = stream_ptr->tellg();
   if (!stream_ptr->good())
     error("InputStreamWithRecords: error in tellg()\n");
+  clear_buffer(starting_stream_position);
 }
 
 template <class RecordT, class OptionsT>
@@ -56,6 +60,7 @@ InputStreamWithRecords<RecordT, OptionsT>::InputStreamWithRecords(const std::str
       options(options)
 {
   assert(size_of_record_signature <= max_size_of_record);
+  buffer.resize(std::max(std::size_t(1048576), max_size_of_record));
   std::fstream* s_ptr = new std::fstream;
   open_read_binary(*s_ptr, filename.c_str());
   stream_ptr.reset(s_ptr);
@@ -63,6 +68,61 @@ InputStreamWithRecords<RecordT, OptionsT>::InputStreamWithRecords(const std::str
     error("InputStreamWithRecords: error in reset() for filename %s\n", filename.c_str());
 }
 
+template <class RecordT, class OptionsT>
+void
+InputStreamWithRecords<RecordT, OptionsT>::clear_buffer(const std::streampos stream_position) const
+{
+  this->buffer_pos = 0;
+  this->buffer_end = 0;
+  this->stream_position_of_buffer_end = stream_position;
+}
+
+template <class RecordT, class OptionsT>
+bool
+InputStreamWithRecords<RecordT, OptionsT>::ensure_data_in_buffer(const std::size_t size) const
+{
+  if (this->buffer_end - this->buffer_pos >= size)
+    return true;
+
+  // move remaining data to the start of the buffer
+  const std::size_t num_remaining = this->buffer_end - this->buffer_pos;
+  std::copy(this->buffer.begin() + this->buffer_pos, this->buffer.begin() + this->buffer_end, this->buffer.begin());
+  this->buffer_pos = 0;
+  this->buffer_end = num_remaining;
+  if (stream_ptr->eof())
+    return false;
+
+  // fill the rest of the buffer
+  stream_ptr->read(this->buffer.data() + this->buffer_end, static_cast<std::streamsize>(this->buffer.size() - this->buffer_end));
+  const std::streamsize num_read = stream_ptr->gcount();
+  this->buffer_end += static_cast<std::size_t>(num_read);
+  if (this->stream_position_of_buffer_end != std::streampos(-1))
+    this->stream_position_of_buffer_end += num_read;
+  if (stream_ptr->bad())
+    {
+      warning("Error after reading from list mode stream in get_next_record");
+      return false;
+    }
+  return this->buffer_end >= size;
+}
+
+template <class RecordT, class OptionsT>
+Succeeded
+InputStreamWithRecords<RecordT, OptionsT>::read_record_from_buffer(RecordT& record) const
+{
+  if (!this->ensure_data_in_buffer(this->size_of_record_signature))
+    return Succeeded::no;
+  const std::size_t size_of_record
+      = record.size_of_record_at_ptr(this->buffer.data() + this->buffer_pos, this->size_of_record_signature, options);
+  assert(size_of_record <= this->max_size_of_record);
+  // note: this might move the data in the buffer
+  if (!this->ensure_data_in_buffer(size_of_record))
+    return Succeeded::no;
+  const char* const data_ptr = this->buffer.data() + this->buffer_pos;
+  this->buffer_pos += size_of_record;
+  return record.init_from_data_ptr(data_ptr, size_of_record, options);
+}
+
 template <class RecordT, class OptionsT>
 Succeeded
 InputStreamWithRecords<RecordT, OptionsT>::get_next_record(RecordT& record) const
@@ -72,37 +132,40 @@ InputStreamWithRecords<RecordT, OptionsT>::get_next_record(RecordT& record) cons
 
   Succeeded ret = Succeeded::yes;
 
+#ifdef STIR_OPENMP
+#  pragma omp critical(LISTMODEIO)
+#endif
+  ret = this->read_record_from_buffer(record);
+
+  return ret;
+}
+
+template <class RecordT, class OptionsT>
+std::size_t
+InputStreamWithRecords<RecordT, OptionsT>::get_next_records(RecordT* const records, const std::size_t max_num_records) const
+{
+  return this->get_next_records([records](const std::size_t i) -> RecordT& { return records[i]; }, max_num_records);
+}
+
+template <class RecordT, class OptionsT>
+template <class GetRecordT>
+std::size_t
+InputStreamWithRecords<RecordT, OptionsT>::get_next_records(const GetRecordT& get_record, const std::size_t max_num_records) const
+{
+  if (is_null_ptr(stream_ptr))
+    return 0;
+
+  std::size_t num_records = 0;
+
 #ifdef STIR_OPENMP
 #  pragma omp critical(LISTMODEIO)
 #endif
   {
-    // rely on file caching by the C++ library or the OS
-    assert(this->size_of_record_signature <= this->max_size_of_record);
-    boost::shared_array<char> data_sptr(new char[this->max_size_of_record]);
-
-    stream_ptr->read(data_sptr.get(), this->size_of_record_signature);
-    if (stream_ptr->gcount() < static_cast<std::streamsize>(this->size_of_record_signature))
-      {
-        ret = Succeeded::no;
-      }
-    const std::size_t size_of_record = record.size_of_record_at_ptr(data_sptr.get(), this->size_of_record_signature, options);
-    assert(size_of_record <= this->max_size_of_record);
-    if (size_of_record > this->size_of_record_signature)
-      stream_ptr->read(data_sptr.get() + this->size_of_record_signature, size_of_record - this->size_of_record_signature);
-    if (stream_ptr->eof())
-      {
-        ret = Succeeded::no;
-      }
-    else if (stream_ptr->bad())
-      {
-        warning("Error after reading from list mode stream in get_next_record");
-        ret = Succeeded::no;
-      }
-    if (ret == Succeeded::yes)
-      ret = record.init_from_data_ptr(data_sptr.get(), size_of_record, options);
+    while (num_records < max_num_records && this->read_record_from_buffer(get_record(num_records)) == Succeeded::yes)
+      ++num_records;
   }
 
-  return ret;
+  return num_records;
 }
 
 template <class RecordT, class OptionsT>
@@ -116,6 +179,7 @@ InputStreamWithRecords<RecordT, OptionsT>::reset()
   if (stream_ptr->eof())
     stream_ptr->clear();
   stream_ptr->seekg(starting_stream_position, std::ios::beg);
+  clear_buffer(starting_stream_position);
   if (stream_ptr->bad())
     return Succeeded::no;
   else
@@ -127,20 +191,17 @@ typename InputStreamWithRecords<RecordT, OptionsT>::SavedPosition
 InputStreamWithRecords<RecordT, OptionsT>::save_get_position()
 {
   assert(!is_null_ptr(stream_ptr));
-  // TODO should somehow check if tellg() worked and return an error if it didn't
+  // find position of the next record from the position of the end of the buffer
+  const std::size_t num_buffered = this->buffer_end - this->buffer_pos;
   std::streampos pos;
-  if (!stream_ptr->eof())
+  if (this->stream_position_of_buffer_end == std::streampos(-1) || (num_buffered == 0 && stream_ptr->eof()))
     {
-      pos = stream_ptr->tellg();
-      if (!stream_ptr->good())
-        error("InputStreamWithRecords<RecordT, OptionsT>::save_get_position\n"
-              "Error after getting position in file");
+      // use -1 to signify eof
+      pos = std::streampos(-1);
     }
   else
     {
-      // use -1 to signify eof
-      // (this is probably the behaviour of tellg anyway, but this way we're sure).
-      pos = std::streampos(-1);
+      pos = this->stream_position_of_buffer_end - static_cast<std::streamoff>(num_buffered);
     }
   saved_get_positions.push_back(pos);
   return saved_get_positions.size() - 1;
@@ -160,6 +221,7 @@ InputStreamWithRecords<RecordT, OptionsT>::set_get_position(
     stream_ptr->seekg(0, std::ios::end); // go to eof
   else
     stream_ptr->seekg(saved_get_positions[pos]);
+  clear_buffer(saved_get_positions[pos]);
 
   if (!stream_ptr->good())
     return Succeeded::no;
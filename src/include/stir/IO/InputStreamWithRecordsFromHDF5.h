@@ -13,7 +13,7 @@
 
 */
 /*
-    Copyright (C) 2016-2018, 2020-2021 University College London
+    Copyright (C) 2016-2018, 2020-2021, 2026 University College London
     Copyright (C) 2016-2019, University of Leeds
     Copyright (C) 2016-2018, University of Hull
 
@@ -51,9 +51,8 @@ namespace RDF_HDF5
     the function to find out what the size of the record is. In that case, all IO
     handling is completely generic and is implemented in this class.
 
-    Current implementation needs a \c max_size_of_record to allocate enough memory
-    (on the stack) before reading. This is efficient in many cases, but impractical
-    in others.
+    Data are read from the file in large blocks into an internal buffer, and records
+    are decoded directly from this buffer.
 
     \par Requirements
     \c RecordT needs to have the following member functions
@@ -67,8 +66,6 @@ namespace RDF_HDF5
                          const std::size_t size_of_record,
                          const OptionsT options);
     \endcode
-
-    \todo Allow choosing between allocation with \c new or on the stack.
 */
 template <class RecordT>
 class InputStreamWithRecordsFromHDF5
@@ -91,6 +88,20 @@ public:
 
   inline virtual Succeeded get_next_record(RecordT& record);
 
+  //! read the next records into an array
+  /*! Reads up to \a max_num_records records into the array starting at \a records.
+      \return the number of records read. If this is less than \a max_num_records, the end
+      of the data has been reached (or an error occurred).
+  */
+  inline std::size_t get_next_records(RecordT* const records, const std::size_t max_num_records);
+
+  //! read the next records, using a function object to find where to store them
+  /*! \a get_record(i) has to return a reference to the \c RecordT where the i-th record is stored.
+      Otherwise identical to the above function.
+  */
+  template <class GetRecordT>
+  inline std::size_t get_next_records(const GetRecordT& get_record, const std::size_t max_num_records);
+
   virtual Succeeded set_up();
 
   //! go back to starting position
@@ -122,8 +133,6 @@ public:
 private:
   shared_ptr<GEHDF5Wrapper> input_sptr;
 
-  boost::shared_array<char> data_sptr;
-
   uint64_t m_list_size = 0;
 
   std::streampos starting_stream_position;
@@ -134,8 +143,6 @@ private:
   const std::size_t size_of_record_signature;
   const std::size_t max_size_of_record;
 
-  //! read data from buffer
-  void read_data(char* output, const std::streampos offset, const hsize_t size) const;
   // members for buffering
 
   boost::shared_array<char> buffer;
@@ -144,6 +151,10 @@ private:
   mutable std::size_t buffer_size;
   mutable std::streampos start_of_buffer_offset;
   void fill_buffer(const std::streampos offset) const;
+  //! get a pointer to \a size bytes of data at \a offset, refilling the buffer if necessary
+  inline const char* get_data_ptr(const std::streampos offset, const std::size_t size) const;
+  //! read a single record, without catching exceptions
+  inline Succeeded read_record_from_buffer(RecordT& record);
 };
 
 } // namespace RDF_HDF5
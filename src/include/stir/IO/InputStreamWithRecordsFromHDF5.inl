@@ -14,7 +14,7 @@
     Copyright (C) 2012-2013, Kris Thielemans
     Copyright (C) 2018 University of Hull
     Copyright (C) 2018 University of Leeds
-    Copyright (C) 2020-2021 University College London
+    Copyright (C) 2020-2021, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -28,7 +28,6 @@
 #include "stir/shared_ptr.h"
 
 #include <fstream>
-#include <string.h>
 START_NAMESPACE_STIR
 
 namespace GE
@@ -75,7 +74,6 @@ Succeeded
 InputStreamWithRecordsFromHDF5<RecordT>::set_up()
 {
   input_sptr.reset(new GEHDF5Wrapper(m_filename));
-  data_sptr.reset(new char[this->max_size_of_record]);
   starting_stream_position = 0;
   current_offset = 0;
 
@@ -96,22 +94,42 @@ InputStreamWithRecordsFromHDF5<RecordT>::fill_buffer(const std::streampos offset
 }
 
 template <class RecordT>
-void
-InputStreamWithRecordsFromHDF5<RecordT>::read_data(char* output, const std::streampos offset, const hsize_t size) const
+const char*
+InputStreamWithRecordsFromHDF5<RecordT>::get_data_ptr(const std::streampos offset, const std::size_t size) const
 {
   if (this->buffer_size == 0 || offset < this->start_of_buffer_offset
-      || offset >= (this->start_of_buffer_offset + static_cast<std::streampos>(this->buffer_size)))
-    this->fill_buffer(offset);
-
-  // copy data from buffer to output
-  const std::size_t offset_in_buffer = offset - this->start_of_buffer_offset;
-  const hsize_t size_in_buffer = std::min(size, static_cast<hsize_t>(this->buffer_size - offset_in_buffer));
+      || offset + static_cast<std::streamoff>(size)
+             > this->start_of_buffer_offset + static_cast<std::streamoff>(this->buffer_size))
+    {
+      this->fill_buffer(offset);
+      // check if the record is truncated at the end of the data
+      if (this->buffer_size < size)
+        return 0;
+    }
+  return this->buffer.get() + static_cast<std::streamoff>(offset - this->start_of_buffer_offset);
+}
 
-  memcpy(output, this->buffer.get() + offset_in_buffer, static_cast<std::size_t>(size_in_buffer));
+template <class RecordT>
+Succeeded
+InputStreamWithRecordsFromHDF5<RecordT>::read_record_from_buffer(RecordT& record)
+{
+  if (current_offset >= static_cast<std::streampos>(m_list_size))
+    return Succeeded::no;
+  // records are decoded directly from the buffer, which is refilled when a record is not completely in it
+  const char* data_ptr = this->get_data_ptr(current_offset, this->size_of_record_signature);
+  if (!data_ptr)
+    return Succeeded::no;
+  const std::size_t size_of_record = record.size_of_record_at_ptr(data_ptr, this->size_of_record_signature, false);
 
-  // check if there is anything else to read after the end of the buffer
-  if (size_in_buffer < size)
-    read_data(output + size_in_buffer, offset + static_cast<std::streampos>(size_in_buffer), size - size_in_buffer);
+  assert(size_of_record <= this->max_size_of_record);
+  if (size_of_record > this->size_of_record_signature)
+    {
+      data_ptr = this->get_data_ptr(current_offset, size_of_record);
+      if (!data_ptr)
+        return Succeeded::no;
+    }
+  current_offset += size_of_record;
+  return record.init_from_data_ptr(data_ptr, size_of_record, false);
 }
 
 template <class RecordT>
@@ -120,21 +138,7 @@ InputStreamWithRecordsFromHDF5<RecordT>::get_next_record(RecordT& record)
 {
   try
     {
-      if (current_offset >= static_cast<std::streampos>(m_list_size))
-        return Succeeded::no;
-      char* data_ptr = data_sptr.get();
-      this->read_data(data_ptr, current_offset, hsize_t(this->size_of_record_signature));
-      const std::size_t size_of_record = record.size_of_record_at_ptr(data_ptr, this->size_of_record_signature, false);
-
-      assert(size_of_record <= this->max_size_of_record);
-      // read more bytes if necessary
-      auto remainder = size_of_record - this->size_of_record_signature;
-      if (remainder > 0)
-        this->read_data(data_ptr + this->size_of_record_signature,
-                        current_offset + static_cast<std::streampos>(this->size_of_record_signature),
-                        hsize_t(remainder));
-      current_offset += size_of_record;
-      return record.init_from_data_ptr(data_ptr, size_of_record, false);
+      return this->read_record_from_buffer(record);
     }
   catch (...)
     {
@@ -142,6 +146,29 @@ InputStreamWithRecordsFromHDF5<RecordT>::get_next_record(RecordT& record)
     }
 }
 
+template <class RecordT>
+std::size_t
+InputStreamWithRecordsFromHDF5<RecordT>::get_next_records(RecordT* const records, const std::size_t max_num_records)
+{
+  return this->get_next_records([records](const std::size_t i) -> RecordT& { return records[i]; }, max_num_records);
+}
+
+template <class RecordT>
+template <class GetRecordT>
+std::size_t
+InputStreamWithRecordsFromHDF5<RecordT>::get_next_records(const GetRecordT& get_record, const std::size_t max_num_records)
+{
+  std::size_t num_records = 0;
+  try
+    {
+      while (num_records < max_num_records && this->read_record_from_buffer(get_record(num_records)) == Succeeded::yes)
+        ++num_records;
+    }
+  catch (...)
+    {}
+  return num_records;
+}
+
 template <class RecordT>
 Succeeded
 InputStreamWithRecordsFromHDF5<RecordT>::reset()
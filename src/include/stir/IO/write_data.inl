@@ -42,6 +42,24 @@ write_data_with_fixed_scale_factor_help(is_not_1d,
                                         const ByteOrder byte_order,
                                         const bool can_corrupt_data)
 {
+  // write contiguous data in one go, which is much faster than writing row by row
+  if (data.is_contiguous())
+    {
+      if (typeid(OutputType) != typeid(elemT) || scale_factor != 1)
+        {
+          ScaleT new_scale_factor = scale_factor;
+          auto data_tmp = convert_array(new_scale_factor, data, NumericInfo<OutputType>());
+          if (std::fabs(new_scale_factor - scale_factor) > scale_factor * .001)
+            return Succeeded::no;
+          if (data_tmp.is_contiguous())
+            return write_data_1d(s, data_tmp, byte_order, /*can_corrupt_data*/ true);
+        }
+      else
+        {
+          return write_data_1d(s, data, byte_order, can_corrupt_data);
+        }
+    }
+
   for (auto iter = data.begin(); iter != data.end(); ++iter)
     {
       if (write_data_with_fixed_scale_factor(s, *iter, output_type, scale_factor, byte_order, can_corrupt_data) == Succeeded::no)
@@ -95,8 +95,8 @@ ProjDataInfoCylindricalNoArcCorr::get_det_num_pair_for_view_tangential_pos_num(i
   assert(get_view_mashing_factor() == 1);
   this->initialise_uncompressed_view_tangpos_to_det1det2_if_not_done_yet();
 
-  det1_num = uncompressed_view_tangpos_to_det1det2[view_num][tang_pos_num].det1_num;
-  det2_num = uncompressed_view_tangpos_to_det1det2[view_num][tang_pos_num].det2_num;
+  uncompressed_view_tangpos_to_det1det2_sptr->get_det_num_pair_for_view_tangential_pos_num(
+      det1_num, det2_num, view_num, tang_pos_num);
 }
 
 bool
@@ -108,9 +108,10 @@ ProjDataInfoCylindricalNoArcCorr::get_view_tangential_pos_num_for_det_num_pair(i
   assert(det1_num != det2_num);
   this->initialise_det1det2_to_uncompressed_view_tangpos_if_not_done_yet();
 
-  view_num = det1det2_to_uncompressed_view_tangpos[det1_num][det2_num].view_num / get_view_mashing_factor();
-  tang_pos_num = det1det2_to_uncompressed_view_tangpos[det1_num][det2_num].tang_pos_num;
-  return det1det2_to_uncompressed_view_tangpos[det1_num][det2_num].swap_detectors;
+  const bool swap_detectors = det1det2_to_uncompressed_view_tangpos_sptr->get_view_tangential_pos_num_for_det_num_pair(
+      view_num, tang_pos_num, det1_num, det2_num);
+  view_num /= get_view_mashing_factor();
+  return swap_detectors;
 }
 
 Succeeded
@@ -97,8 +97,8 @@ ProjDataInfoGenericNoArcCorr::get_det_num_pair_for_view_tangential_pos_num(int&
   assert(get_view_mashing_factor() == 1);
   this->initialise_uncompressed_view_tangpos_to_det1det2_if_not_done_yet();
 
-  det1_num = uncompressed_view_tangpos_to_det1det2[view_num][tang_pos_num].det1_num;
-  det2_num = uncompressed_view_tangpos_to_det1det2[view_num][tang_pos_num].det2_num;
+  uncompressed_view_tangpos_to_det1det2_sptr->get_det_num_pair_for_view_tangential_pos_num(
+      det1_num, det2_num, view_num, tang_pos_num);
 }
 
 bool
@@ -110,9 +110,10 @@ ProjDataInfoGenericNoArcCorr::get_view_tangential_pos_num_for_det_num_pair(int&
   assert(det1_num != det2_num);
   this->initialise_det1det2_to_uncompressed_view_tangpos_if_not_done_yet();
 
-  view_num = det1det2_to_uncompressed_view_tangpos[det1_num][det2_num].view_num / get_view_mashing_factor();
-  tang_pos_num = det1det2_to_uncompressed_view_tangpos[det1_num][det2_num].tang_pos_num;
-  return det1det2_to_uncompressed_view_tangpos[det1_num][det2_num].swap_detectors;
+  const bool swap_detectors = det1det2_to_uncompressed_view_tangpos_sptr->get_view_tangential_pos_num_for_det_num_pair(
+      view_num, tang_pos_num, det1_num, det2_num);
+  view_num /= get_view_mashing_factor();
+  return swap_detectors;
 }
 
 Succeeded
@@ -0,0 +1,144 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projdata
+  \brief Declaration of class stir::ProjDataSparse
+
+  \author Kris Thielemans
+*/
+
+#ifndef __stir_ProjDataSparse_H__
+#define __stir_ProjDataSparse_H__
+
+#include "stir/ProjData.h"
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+START_NAMESPACE_STIR
+
+class Succeeded;
+
+/*!
+  \ingroup projdata
+  \brief A class which stores projection data in memory, keeping only the non-zero bins.
+
+  This is useful for short time frames or high-resolution (e.g. TOF) data, where most bins of a
+  histogrammed list-mode acquisition are zero, such that the data fits in memory while a
+  ProjDataInMemory would not.
+
+  Bins are stored in a hash-map, indexed by their position in a dense array in
+  Timing_Segment_View_AxialPos_TangPos order. Retrieving a viewgram or sinogram therefore costs a
+  look-up per bin, and accumulating counts (see increment_bin_value()) is fast.
+
+  \par File format
+
+  write_to_sparse_file() writes an Interfile header (with extension \c .hs) describing the
+  geometry and the layout of the dense array used for the indices (i.e. segments in increasing
+  order, and Segment_View_AxialPos_TangPos or Timing_Segment_View_AxialPos_TangPos storage order),
+  but its "name of data file" keyword refers to a file
+  (with extension \c .sparse) with the following format
+  \verbatim
+  STIR sparse projection data
+  byte order := LITTLEENDIAN
+  number of non-zero bins := N
+  <binary data>
+  \endverbatim
+  where the binary data consists of N \c std::uint64_t indices (in increasing order),
+  followed by N \c float values, both in the byte order given in the text.
+
+  The index of a bin is therefore its offset (in number of elements) in the dense data described
+  by the header. ProjData::read_from_file() recognises these files and returns a ProjDataSparse object.
+  Other Interfile readers (see read_interfile_PDFS()) reject them, and read_from_file() rejects
+  headers with another segment sequence or storage order.
+*/
+class ProjDataSparse : public ProjData
+{
+#ifdef SWIG
+  // SWIG needs this typedef to be public
+public:
+#endif
+  typedef ProjDataSparse self_type;
+  typedef ProjData base_type;
+
+public:
+  //! constructor with only info, all bins will be zero
+  ProjDataSparse(shared_ptr<const ExamInfo> const& exam_info_sptr, shared_ptr<const ProjDataInfo> const& proj_data_info_sptr);
+
+  //! A static member to get sparse projection data from a file
+  /*! \a filename has to be the name of an Interfile header written by write_to_sparse_file(). */
+  static shared_ptr<ProjDataSparse> read_from_file(const std::string& filename);
+
+  //! Check if \a filename is an Interfile header that refers to a sparse data file
+  static bool is_sparse_interfile_header(const std::string& filename);
+
+  //! Check if \a data_file_name is a sparse data file (as written by write_to_sparse_file())
+  static bool is_sparse_data_file(const std::string& data_file_name);
+
+  //! Write the data to file
+  /*! \a filename is used for the header, with \c .hs appended if it doesn't have an extension.
+      The data file name is found by replacing the extension with \c .sparse.
+  */
+  Succeeded write_to_sparse_file(const std::string& filename) const;
+
+  Viewgram<float> get_viewgram(const int view_num,
+                               const int segment_num,
+                               const bool make_num_tangential_poss_odd = false,
+                               const int timing_pos = 0) const override;
+  Succeeded set_viewgram(const Viewgram<float>& v) override;
+
+  Sinogram<float> get_sinogram(const int ax_pos_num,
+                               const int segment_num,
+                               const bool make_num_tangential_poss_odd = false,
+                               const int timing_pos = 0) const override;
+  Succeeded set_sinogram(const Sinogram<float>& s) override;
+
+  //! set all bins to the same value
+  /*! Filling with 0 just clears the storage. Any other value makes the data dense. */
+  void fill(const float value) override;
+  using base_type::fill;
+
+  //! Returns the value of a bin
+  float get_bin_value(const Bin& bin) const;
+  //! Set the value of a bin to the value stored in \a bin
+  void set_bin_value(const Bin& bin);
+  //! Add \a increment to the value of a bin
+  void increment_bin_value(const Bin& bin, const float increment);
+
+  //! Returns the number of bins that are currently stored
+  /*! Bins that have been set to zero are removed from the storage, but bins that
+      sum to zero after calling increment_bin_value() are not. */
+  std::size_t get_num_stored_bins() const;
+
+  //! return sum of all elements
+  float sum() const override;
+  //! return maximum value of all elements
+  float find_max() const override;
+  //! return minimum value of all elements
+  float find_min() const override;
+
+private:
+  typedef std::unordered_map<std::uint64_t, float> storage_type;
+  storage_type storage;
+  //! offset of the first bin of each segment, indexed by segment_num - min_segment_num
+  std::vector<std::uint64_t> segment_offsets;
+  std::uint64_t num_bins_per_timing_pos;
+
+  //! index of the bin in Timing_Segment_View_AxialPos_TangPos order
+  /*! Calls error() if the bin is out of range. */
+  std::uint64_t get_index(const Bin& bin) const;
+  //! Set the value of the element with index \a index, removing it from the storage if the value is 0
+  void set_value(const std::uint64_t index, const float value);
+};
+
+END_NAMESPACE_STIR
+
+#endif
@@ -11,7 +11,7 @@
 */
 /*
     Copyright (C) 2002- 2009, Hammersmith Imanet Ltd
-    Copyright (C) 2021, 2024 University College London
+    Copyright (C) 2021, 2024, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -111,7 +111,7 @@ void SSRB(const std::string& output_filename,
   \ingroup projdata
   \param out_projdata Output projection data. Its projection_data_info is used to
   determine output characteristics. Data will be 'put' in here using
-  ProjData::set_sinogram().
+  ProjData::set_segment().
   \param in_projdata input data
   \param do_normalisation (default true) wether to normalise the output sinograms
   corresponding to how many (ignoring TOF) input sinograms contribute to them.
@@ -121,6 +121,8 @@ void SSRB(const std::string& output_filename,
   direction, projectors are outputting "normalised" data, i.e. corresponding to the
   line integral).
 
+  Every input viewgram is read only once. Output segments are computed in parallel over views
+  (when OpenMP is enabled), and written by a separate thread while the next one is computed.
 
   \warning \a in_projdata has to be (at least) of type ProjDataInfoCylindrical
 
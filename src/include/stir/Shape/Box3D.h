@@ -74,6 +74,8 @@ public:
 
   bool is_inside_shape(const CartesianCoordinate3D<float>& coord) const override;
 
+  Succeeded get_bounding_box(CartesianCoordinate3D<float>& min_coord, CartesianCoordinate3D<float>& max_coord) const override;
+
   Shape3D* clone() const override;
 
   //! Compare boxes
@@ -90,6 +92,11 @@ protected:
   //! Length in z-direction if the shape is not rotated
   float length_z;
 
+  Succeeded get_line_interval_in_shape_coords(float& t_min,
+                                              float& t_max,
+                                              const CartesianCoordinate3D<float>& start,
+                                              const CartesianCoordinate3D<float>& direction) const override;
+
 private:
   void set_defaults() override;
   void initialise_keymap() override;
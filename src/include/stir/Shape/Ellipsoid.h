@@ -67,6 +67,8 @@ public:
 
   bool is_inside_shape(const CartesianCoordinate3D<float>& coord) const override;
 
+  Succeeded get_bounding_box(CartesianCoordinate3D<float>& min_coord, CartesianCoordinate3D<float>& max_coord) const override;
+
   Shape3D* clone() const override;
 
   //! Compare cylinders
@@ -97,6 +99,11 @@ protected:
   //! Radii in 3 directions (before using the direction vectors)
   CartesianCoordinate3D<float> radii;
 
+  Succeeded get_line_interval_in_shape_coords(float& t_min,
+                                              float& t_max,
+                                              const CartesianCoordinate3D<float>& start,
+                                              const CartesianCoordinate3D<float>& direction) const override;
+
   //! set defaults before parsing
   /*! sets radii to 0 and calls Shape3DWithOrientation::set_defaults() */
   void set_defaults() override;
@@ -111,6 +111,8 @@ public:
 
   bool is_inside_shape(const CartesianCoordinate3D<float>& coord) const override;
 
+  Succeeded get_bounding_box(CartesianCoordinate3D<float>& min_coord, CartesianCoordinate3D<float>& max_coord) const override;
+
   inline float get_length() const
   {
     return length;
@@ -140,6 +142,11 @@ protected:
   //! final theta if the shape is not rotated (in degrees)
   float theta_2;
 
+  Succeeded get_line_interval_in_shape_coords(float& t_min,
+                                              float& t_max,
+                                              const CartesianCoordinate3D<float>& start,
+                                              const CartesianCoordinate3D<float>& direction) const override;
+
   //! set defaults before parsing
   /*! sets radii and length to 0, theta_1=0, theta_2=360 and calls Shape3DWithOrientation::set_defaults() */
   void set_defaults() override;
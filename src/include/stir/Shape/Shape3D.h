@@ -29,6 +29,7 @@ START_NAMESPACE_STIR
 
 template <typename elemT>
 class VoxelsOnCartesianGrid;
+class Succeeded;
 
 /*!
   \ingroup Shape
@@ -146,7 +147,15 @@ public:
     does a first pass through the image where is_inside_shape() is called
     only for the centre of the voxels. After this, only edge voxels are
     resampled. So, if a shape lies between the centre of all voxels,
-    it will not be sampled at all.
+    it will not be sampled at all. Edge voxels are determined from the
+    result of the first pass only (i.e. a voxel is an edge voxel if one of its
+    neighbours has a different value after the first pass).
+
+    If get_bounding_box() is implemented, only voxels that intersect the bounding box
+    are considered, and all others are set to 0.
+
+    When compiled with OpenMP, both passes are parallelised over planes. This means
+    that is_inside_shape() and get_voxel_weight() need to be thread-safe.
   \todo Get rid of restriction to allow only VoxelsOnCartesianGrid<float>
   (but that's rather hard)
   \todo Potentially this should fill a DiscretisedShape3D.
@@ -169,7 +178,14 @@ public:
   virtual float get_geometric_area() const;
 #endif
 
-  // TODO get_bounding_box() const;
+  //! Get a box (in 'absolute' coordinates) that contains the whole shape
+  /*!
+    The box is not necessarily the smallest possible one.
+
+    As this is not possible/easy for all shapes, the default implementation
+    returns Succeeded::no, in which case \a min_coord and \a max_coord are not modified.
+  */
+  virtual Succeeded get_bounding_box(CartesianCoordinate3D<float>& min_coord, CartesianCoordinate3D<float>& max_coord) const;
 
   //! get the origin of the shape-coordinate system
   inline CartesianCoordinate3D<float> get_origin() const;
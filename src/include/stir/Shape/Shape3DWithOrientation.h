@@ -75,6 +75,17 @@ public:
   */
   Succeeded set_direction_vectors(const Array<2, float>&);
 
+  //! Determine (approximately) the intersection volume of a voxel with the shape.
+  /*!
+    This uses the same regular sampling as Shape3D::get_voxel_weight(). However, if the derived
+    class implements get_line_interval_in_shape_coords(), the samples along each
+    line in x-direction are counted analytically, avoiding calls to is_inside_shape()
+    for every sample. The result is then identical up to floating point rounding.
+  */
+  float get_voxel_weight(const CartesianCoordinate3D<float>& voxel_centre,
+                         const CartesianCoordinate3D<float>& voxel_size,
+                         const CartesianCoordinate3D<int>& num_samples) const override;
+
 #if 0
   // TODO non-sensical after non-uniform scale
   float get_angle_alpha() const;
@@ -110,6 +121,33 @@ protected:
   //! Transform a 'real-world' coordinate to the coordinate system used by the shape
   CartesianCoordinate3D<float> transform_to_shape_coords(const CartesianCoordinate3D<float>&) const;
 
+  //! Find the bounding box of a shape that fits in a box in shape coordinates
+  /*!
+    \param half_sizes the shape is assumed to be inside the box <code>[-half_sizes, half_sizes]</code>
+    in the coordinate system returned by transform_to_shape_coords().
+
+    This is a helper function for implementing get_bounding_box() in derived classes.
+  */
+  Succeeded get_bounding_box_for_box_in_shape_coords(CartesianCoordinate3D<float>& min_coord,
+                                                     CartesianCoordinate3D<float>& max_coord,
+                                                     const CartesianCoordinate3D<float>& half_sizes) const;
+
+  //! Find the interval of the line <code>start + t*direction</code> (in shape coordinates) that is inside the shape
+  /*!
+    This function is used by get_voxel_weight(). On return, \a t_min and \a t_max are the end-points of
+    the interval. If the line does not intersect the shape, \a t_min should be larger than \a t_max.
+
+    The default implementation returns Succeeded::no, which means that this functionality is not
+    available for this shape (or for the current parameters of the shape), in which case
+    get_voxel_weight() will use is_inside_shape() instead.
+
+    \warning The shape has to be convex along lines for this to work.
+  */
+  virtual Succeeded get_line_interval_in_shape_coords(float& t_min,
+                                                      float& t_max,
+                                                      const CartesianCoordinate3D<float>& start,
+                                                      const CartesianCoordinate3D<float>& direction) const;
+
   //! sets defaults for parsing
   /*! sets direction vectors to the normal unit vectors. */
   void set_defaults() override;
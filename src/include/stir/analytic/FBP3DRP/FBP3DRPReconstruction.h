@@ -3,6 +3,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2007, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
 
     This file is part of STIR.
 
@@ -238,6 +239,8 @@ private:
 #ifndef NRFFT
   ColsherFilter colsher_filter;
 #endif
+  //! segment number for which the Colsher filter was last set-up
+  int colsher_filter_segment_num;
   float alpha_fit;
   float beta_fit;
 
@@ -0,0 +1,49 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+#ifndef __stir_compute_hash_H__
+#define __stir_compute_hash_H__
+/*!
+  \file
+  \ingroup buildblock
+
+  \brief Declaration and implementation of stir::compute_hash
+
+  \author Kris Thielemans
+*/
+#include "stir/common.h"
+#include <cstddef>
+#include <cstdint>
+
+START_NAMESPACE_STIR
+
+//! Compute a (non-cryptographic) 64-bit hash of some data
+/*!
+  \ingroup buildblock
+  This is the FNV-1a hash, which gives the same result on all platforms (for the same bytes).
+  \a hash can be used to continue hashing previous data, i.e.
+  \code
+  compute_hash(b, size_b, compute_hash(a, size_a))
+  \endcode
+  gives the same result as hashing the concatenation of \c a and \c b.
+*/
+inline std::uint64_t
+compute_hash(const void* data, const std::size_t num_bytes, std::uint64_t hash = 14695981039346656037ULL)
+{
+  const unsigned char* ptr = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < num_bytes; ++i)
+    {
+      hash ^= ptr[i];
+      hash *= 1099511628211ULL;
+    }
+  return hash;
+}
+
+END_NAMESPACE_STIR
+
+#endif
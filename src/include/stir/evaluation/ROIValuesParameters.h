@@ -0,0 +1,82 @@
+/*
+    Copyright (C) 2000 - 2007, Hammersmith Imanet Ltd
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup evaluation
+
+  \brief Declaration of class stir::ROIValuesParameters
+
+  \author Kris Thielemans
+*/
+#ifndef __stir_evaluation_ROIValuesParameters__H__
+#define __stir_evaluation_ROIValuesParameters__H__
+
+#include "stir/KeyParser.h"
+#include "stir/Shape/Shape3D.h"
+#include "stir/DataProcessor.h"
+#include "stir/DiscretisedDensity.h"
+#include "stir/CartesianCoordinate3D.h"
+#include "stir/shared_ptr.h"
+#include <vector>
+#include <string>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup evaluation
+  \brief Parser for a list of ROIs (and an optional image filter) as used by the ROI utilities
+
+  The .par file has the following format
+  \verbatim
+  ROIValues Parameters :=
+
+  ; give the ROI an (optional) name. Defaults to the empty string.
+  ROI name := some name
+  ; see Shape3D hierarchy for possible values
+  ROI Shape type:=ellipsoid
+  ;; ellipsoid parameters here
+
+  ; if more than 1 ROI is desired, you can do this
+  next shape :=
+  ROI name := some other name
+  ROI Shape type:=ellipsoidal cylinder
+  ;; parameters here
+
+  number of samples to take for ROI template-z:=1
+  number of samples to take for ROI template-y:=1
+  number of samples to take for ROI template-x:=1
+
+  ; specify (optional) filter to apply before computing ROI values
+  ; see ImageProcessor hierarchy for possible values
+  Image Filter type:=None
+  End:=
+  \endverbatim
+*/
+// TODO repetition of postfilter.cxx to be able to use its .par file
+class ROIValuesParameters : public KeyParser
+{
+public:
+  ROIValuesParameters();
+  virtual void set_defaults();
+  virtual void initialise_keymap();
+  bool post_processing() override;
+  std::vector<shared_ptr<Shape3D>> shape_ptrs;
+  std::vector<std::string> shape_names;
+  CartesianCoordinate3D<int> num_samples;
+  shared_ptr<DataProcessor<DiscretisedDensity<3, float>>> filter_ptr;
+
+private:
+  shared_ptr<Shape3D> current_shape_sptr;
+  std::string current_shape_name;
+  void increment_current_shape_num();
+};
+
+END_NAMESPACE_STIR
+
+#endif
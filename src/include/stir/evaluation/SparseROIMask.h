@@ -0,0 +1,103 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup evaluation
+
+  \brief Declaration of class stir::SparseROIMask
+
+  \author Kris Thielemans
+*/
+#ifndef __stir_evaluation_SparseROIMask__H__
+#define __stir_evaluation_SparseROIMask__H__
+
+#include "stir/VectorWithOffset.h"
+#include "stir/IndexRange.h"
+#include "stir/CartesianCoordinate3D.h"
+#include <vector>
+#include <cstddef>
+
+START_NAMESPACE_STIR
+
+template <int num_dimensions, typename elemT>
+class DiscretisedDensity;
+template <typename elemT>
+class VoxelsOnCartesianGrid;
+class Shape3D;
+
+/*!
+  \ingroup evaluation
+  \brief A discretised ROI, stored as a list of (voxel index, weight) pairs per plane
+
+  Discretising a Shape3D (via Shape3D::construct_volume()) can be expensive, especially with
+  sub-sampling. This class stores the result in a compact form such that it can be reused
+  to compute ROI values for many images on the same grid (e.g. all frames of a dynamic image)
+  via compute_ROI_values_per_plane() and compute_total_ROI_values().
+
+  Only voxels with non-zero weight are stored.
+*/
+class SparseROIMask
+{
+public:
+  //! Index and weight of a voxel in a plane
+  struct VoxelWeight
+  {
+    int y;
+    int x;
+    float weight;
+  };
+
+  //! Construct an empty mask
+  SparseROIMask();
+
+  //! Discretise \a shape on the grid of \a image_template
+  /*! \see Shape3D::construct_volume() for the meaning of \a num_samples */
+  SparseROIMask(const Shape3D& shape,
+                const VoxelsOnCartesianGrid<float>& image_template,
+                const CartesianCoordinate3D<int>& num_samples);
+
+  //! Use all non-zero voxels of \a discretised_shape (which has to be a VoxelsOnCartesianGrid)
+  explicit SparseROIMask(const DiscretisedDensity<3, float>& discretised_shape);
+
+  //! Construct masks for a number of labels in a label image in a single pass
+  /*! Voxels are assigned to the mask of a label if their value (rounded to the nearest integer)
+      is equal to that label. All weights are 1.
+      \return a vector with one mask per element of \a labels (in the same order)
+  */
+  static std::vector<SparseROIMask> construct_from_label_image(const DiscretisedDensity<3, float>& label_image,
+                                                               const std::vector<int>& labels);
+
+  //! Check if the mask was constructed on the same grid as \a image
+  bool is_compatible_with(const DiscretisedDensity<3, float>& image) const;
+
+  int get_min_z() const { return planes.get_min_index(); }
+  int get_max_z() const { return planes.get_max_index(); }
+
+  //! Get all voxels in plane \a z
+  const std::vector<VoxelWeight>& get_plane(const int z) const { return planes[z]; }
+
+  //! Total number of voxels in the mask
+  std::size_t get_num_voxels() const;
+
+  //! Volume of a single voxel (in mm^3)
+  float get_voxel_volume() const { return voxel_size.z() * voxel_size.y() * voxel_size.x(); }
+
+private:
+  IndexRange<3> index_range;
+  CartesianCoordinate3D<float> origin;
+  CartesianCoordinate3D<float> voxel_size;
+  VectorWithOffset<std::vector<VoxelWeight>> planes;
+
+  void set_from_image(const VoxelsOnCartesianGrid<float>& discretised_shape);
+  void set_grid_from_image(const VoxelsOnCartesianGrid<float>& image);
+};
+
+END_NAMESPACE_STIR
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "stir/evaluation/ROIValues.h"
 #include "stir/VoxelsOnCartesianGrid.h"
+#include <vector>
 
 START_NAMESPACE_STIR
 
@@ -33,6 +34,9 @@ class VectorWithOffset;
 template <int num_dimensions, typename elemT>
 class DiscretisedDensity;
 class Shape3D;
+class SparseROIMask;
+class DynamicDiscretisedDensity;
+class GatedDiscretisedDensity;
 
 /*! \ingroup evaluation
     \name Functions to compute ROI values
@@ -41,6 +45,10 @@ class Shape3D;
     This can make fuzzy boundaries (when the \a num_samples argument is not (1,1,1), or when DiscretisedShape3D
     needs zooming). Mean and stddev are computed using weighted versions, taking this smoothness
     into account, while ROI_min and max are ignore those weights.
+
+    When computing values for many images on the same grid, it is more efficient to
+    discretise the shape once into a SparseROIMask, and use the corresponding overloads.
+    All functions are parallelised over planes when OpenMP is enabled.
 */
 //@{
 
@@ -55,8 +63,34 @@ void compute_ROI_values_per_plane(VectorWithOffset<ROIValues>& values,
                                   const DiscretisedDensity<3, float>& image,
                                   const DiscretisedDensity<3, float>& discretised_shape);
 
+//! Compute ROI values per plane using a precomputed mask
+/*! \a mask has to be constructed on the same grid as \a image (checked with SparseROIMask::is_compatible_with()). */
+void compute_ROI_values_per_plane(VectorWithOffset<ROIValues>& values,
+                                  const DiscretisedDensity<3, float>& image,
+                                  const SparseROIMask& mask);
+
 ROIValues compute_total_ROI_values(const VectorWithOffset<ROIValues>& values);
 
+ROIValues compute_total_ROI_values(const DiscretisedDensity<3, float>& image, const SparseROIMask& mask);
+
+//! Compute ROI values for a number of masks in a single pass over the image
+/*! \a values will be resized to the number of masks. All masks have to be compatible with \a image.
+    Parallelisation is over all (mask, plane) combinations.
+*/
+void compute_total_ROI_values(std::vector<ROIValues>& values,
+                              const DiscretisedDensity<3, float>& image,
+                              const std::vector<SparseROIMask>& masks);
+
+//! Compute ROI values for a number of masks for every frame of a dynamic image
+/*! \return values indexed as <code>[frame_num-1][mask_num]</code> */
+std::vector<std::vector<ROIValues>> compute_total_ROI_values(const DynamicDiscretisedDensity& images,
+                                                             const std::vector<SparseROIMask>& masks);
+
+//! Compute ROI values for a number of masks for every gate of a gated image
+/*! \return values indexed as <code>[gate_num-1][mask_num]</code> */
+std::vector<std::vector<ROIValues>> compute_total_ROI_values(const GatedDiscretisedDensity& images,
+                                                             const std::vector<SparseROIMask>& masks);
+
 ROIValues compute_total_ROI_values(const DiscretisedDensity<3, float>& image,
                                    const Shape3D& shape,
                                    const CartesianCoordinate3D<int>& num_samples);
@@ -2,6 +2,7 @@
 //
 /*
     Copyright (C) 2005- 2005, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -28,7 +29,7 @@ class Succeeded;
   \ingroup projdata
   \param[out] proj_data_4D Its projection_data_info is used to
   determine output characteristics (e.g. number of segments). Data will be 'put' in here using
-  ProjData::set_sinogram().
+  ProjData::set_segment().
   \param[in] proj_data_3D input data
 
   The STIR implementation of Inverse SSRB applies the
@@ -42,6 +43,9 @@ class Succeeded;
 
   Input and output projectino data should have the same number of views and tangential positions.
 
+  The direct sinograms are read only once (per TOF bin). Output segments are computed in parallel
+  over axial positions (when OpenMP is enabled), and written by a separate thread while the next one is computed.
+
 */
 Succeeded inverse_SSRB(ProjData& proj_data_4D, const ProjData& proj_data_3D);
 
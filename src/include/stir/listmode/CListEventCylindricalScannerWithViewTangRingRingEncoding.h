@@ -2,6 +2,7 @@
 //
 /*
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -74,6 +75,9 @@ public:
   //! warning only ProjDataInfoCylindricalNoArcCorr
   inline virtual void get_bin(Bin&, const ProjDataInfo&) const;
 
+  //! Returns \c false, as get_bin() uses the sinogram coordinates, not get_detection_position()
+  bool get_bin_uses_detection_position() const override { return false; }
+
   //! This method checks if the template is valid for LmToProjData
   /*! Used before the actual processing of the data (see issue #61), before calling get_bin()
    *  Most scanners have listmode data that correspond to non arc-corrected data and
@@ -10,6 +10,7 @@
 */
 /*
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -62,6 +63,12 @@ public:
   */
   inline void get_bin(Bin& bin, const ProjDataInfo& proj_data_info) const override;
 
+  //! Whether get_bin() finds the bin from get_detection_position() as in this class
+  /*! If so, convert_events_to_bins() bypasses the virtual get_bin() and uses get_detection_position() instead.
+      Derived classes that override get_bin() therefore have to override this function to return \c false.
+  */
+  virtual bool get_bin_uses_detection_position() const { return true; }
+
   //! This method checks if the template is valid for LmToProjData
   /*! Used before the actual processing of the data (see issue #61), before calling get_bin()
    *  Most scanners have listmode data that correspond to non arc-corrected data and
@@ -13,7 +13,7 @@
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
     Copyright (C) 2017, 2022, University College London
     Copyright (C) 2017, University of Leeds
-    Copyright (C) 2023, University College London
+    Copyright (C) 2023, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -24,6 +24,8 @@
 
 #include "stir/LORCoordinates.h"
 #include "stir/error.h"
+#include <mutex>
+#include <memory>
 
 START_NAMESPACE_STIR
 
@@ -35,6 +37,18 @@ CListEventScannerWithDiscreteDetectors<ProjDataInfoT>::CListEventScannerWithDisc
     error("CListEventScannerWithDiscreteDetectors constructor called with zero pointer");
 
   auto scanner_sptr = proj_data_info_sptr->get_scanner_sptr();
+
+  // Every list-mode record contains an event, so we share the uncompressed ProjDataInfo between all events
+  // for the same scanner. This keeps memory use small when many records are kept in memory (see ListRecordBatch).
+  static std::mutex cache_mutex;
+  static std::weak_ptr<const ProjDataInfoT> cached_proj_data_info_wptr;
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  this->uncompressed_proj_data_info_sptr = cached_proj_data_info_wptr.lock();
+  if (this->uncompressed_proj_data_info_sptr
+      && (this->uncompressed_proj_data_info_sptr->get_scanner_sptr() == scanner_sptr
+          || *this->uncompressed_proj_data_info_sptr->get_scanner_ptr() == *scanner_sptr))
+    return;
+
   // get bare pointer of uncompressed ProjDataInfo
   auto pdi_ptr = ProjDataInfo::construct_proj_data_info(scanner_sptr,
                                                         1,
@@ -53,6 +67,7 @@ CListEventScannerWithDiscreteDetectors<ProjDataInfoT>::CListEventScannerWithDisc
     }
   // set shared_ptr from bare pointer (will take ownership)
   this->uncompressed_proj_data_info_sptr.reset(pdi_ptr_cast);
+  cached_proj_data_info_wptr = this->uncompressed_proj_data_info_sptr;
 }
 
 template <class ProjDataInfoT>
@@ -1,5 +1,5 @@
 /*
-    Copyright (C) 2013-2020 University College London
+    Copyright (C) 2013-2020, 2026 University College London
     Copyright (C) 2017-2019 University of Leeds
 */
 /*!
@@ -50,6 +50,9 @@ public:
 
   Succeeded get_next_record(CListRecord& record) const override;
 
+  //! Reads all records with a single call to the input stream
+  std::size_t get_next_records(const shared_ptr<ListRecord>* const records, const std::size_t max_num_records) const override;
+
   Succeeded reset() override;
 
   SavedPosition save_get_position() override;
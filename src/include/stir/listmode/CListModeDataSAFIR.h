@@ -74,6 +74,8 @@ public:
   std::string get_name() const override;
   shared_ptr<CListRecord> get_empty_record_sptr() const override;
   Succeeded get_next_record(CListRecord& record_of_general_type) const override;
+  //! Reads all records with a single call to the input stream
+  std::size_t get_next_records(const shared_ptr<ListRecord>* const records, const std::size_t max_num_records) const override;
   Succeeded reset() override;
 
   /*!
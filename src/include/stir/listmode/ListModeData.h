@@ -2,7 +2,7 @@
     Copyright (C) 2003 - 2011-06-24, Hammersmith Imanet Ltd
     Copyright (C) 2011-07-01 - 2014, Kris Thielemans
     Copyright (C) 2019, National Physical Laboratory
-    Copyright (C) 2019, University College of London
+    Copyright (C) 2019, 2026, University College of London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -23,6 +23,7 @@
 
 #include <string>
 #include <ctime>
+#include <cstddef>
 #include "stir/ProjDataInfo.h"
 #include "stir/ExamData.h"
 #include "stir/RegisteredParsingObject.h"
@@ -183,6 +184,23 @@ public:
     return get_next(event);
   }
 
+  //! Gets the next records in the listmode sequence
+  /*! Reads up to \a max_num_records records into <code>*records[0]</code>, <code>*records[1]</code> etc.
+      These have to be of the type returned by get_empty_record_sptr().
+
+      This is equivalent to calling get_next_record() repeatedly, which is what the default implementation does.
+      Derived classes can override it to read all records at once (e.g. with only a single lock when using OpenMP).
+      \return the number of records read. If this is less than \a max_num_records, the end of the data has been
+      reached (or an error occurred).
+  */
+  virtual std::size_t get_next_records(const shared_ptr<ListRecord>* const records, const std::size_t max_num_records) const
+  {
+    std::size_t num_records = 0;
+    while (num_records < max_num_records && this->get_next_record(*records[num_records]) == Succeeded::yes)
+      ++num_records;
+    return num_records;
+  }
+
   //! Call this function if you want to re-start reading at the beginning.
   virtual Succeeded reset() = 0;
 
@@ -0,0 +1,110 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup listmode
+  \brief Declaration of class stir::ListRecordBatch
+
+  \author Kris Thielemans
+*/
+
+#ifndef __stir_listmode_ListRecordBatch_H__
+#define __stir_listmode_ListRecordBatch_H__
+
+#include "stir/shared_ptr.h"
+#include <vector>
+#include <limits>
+#include <cstddef>
+
+START_NAMESPACE_STIR
+
+class ListModeData;
+class ListRecord;
+class Succeeded;
+
+/*!
+  \brief A class to read a batch of list-mode events, such that they can be processed in parallel.
+  \ingroup listmode
+
+  Reading list-mode data is inherently sequential, as the time of an event is only known from the
+  time records preceding it. This class reads a batch of events sequentially, and stores every event
+  together with its time. Decoding the events (e.g. finding the detection positions or bins) can then
+  be done in parallel, for instance with OpenMP:
+  \code
+  ListRecordBatch batch(lm_data, 1000000);
+  double current_time = 0;
+  bool more_data = true;
+  while (more_data)
+    {
+      more_data = batch.read(lm_data, current_time) == Succeeded::yes;
+  #pragma omp parallel for
+      for (long i = 0; i < static_cast<long>(batch.size()); ++i)
+        {
+          const ListRecord& record = batch.get_record(i);
+          // process record.event(), using batch.get_time(i)
+        }
+    }
+  \endcode
+
+  The records are constructed via ListModeData::get_empty_record_sptr() and reused for every batch.
+*/
+class ListRecordBatch
+{
+public:
+  //! Construct a batch with records suitable for \a lm_data
+  ListRecordBatch(const ListModeData& lm_data, const std::size_t max_num_events);
+
+  //! Read the next events, overwriting the previous ones
+  /*! Records are read until \a max_num_events events are stored (or the maximum number of events given to the
+      constructor, if smaller), a time record with time at or after \a end_time is found, or there are no more records.
+      Time records are not stored, but \a current_time is updated, and every event gets the time of the last time
+      record read before it. If a record is both a time and an event (as for some formats), and its time is at or
+      after \a end_time, it will be the first event of the next batch.
+
+      Records are read with ListModeData::get_next_records(), asking for as many records as there are events
+      still to be stored. Therefore, the position in \a lm_data is never beyond the last stored event, unless
+      reading stopped at \a end_time. In that case, records after the time record could have been read already.
+      They are kept, and will be used in the next call to read().
+
+      \return Succeeded::no if the end of the list-mode data has been reached.
+  */
+  Succeeded read(ListModeData& lm_data,
+                 double& current_time,
+                 const double end_time = std::numeric_limits<double>::max(),
+                 const std::size_t max_num_events = std::numeric_limits<std::size_t>::max());
+
+  //! Number of events currently stored
+  std::size_t size() const { return num_events; }
+
+  //! Get a stored event
+  const ListRecord& get_record(const std::size_t i) const { return *records[i]; }
+
+  //! Get the time (in secs) of a stored event
+  double get_time(const std::size_t i) const { return times[i]; }
+
+  //! Maximum number of events that can be stored
+  std::size_t get_max_num_events() const { return records.size(); }
+
+private:
+  std::vector<shared_ptr<ListRecord>> records;
+  std::vector<double> times;
+  std::size_t num_events;
+  //! records that were read from the list-mode data, but not yet processed
+  /*! These are stored in \c records[first_pending_record] ... \c records[first_pending_record+num_pending_records-1] */
+  std::size_t first_pending_record;
+  std::size_t num_pending_records;
+  //! set if the last call to read() stopped at an event with a time at or after \c end_time
+  /*! This will then be the first pending record, and its time has already been used to set \c current_time. */
+  bool pending_record_has_time;
+  double pending_record_time;
+};
+
+END_NAMESPACE_STIR
+
+#endif
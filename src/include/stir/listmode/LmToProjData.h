@@ -18,7 +18,7 @@
     Copyright (C) 2000- 2009, Hammersmith Imanet Ltd
     Copyright (C) 2017, University of Hull
     Copyright (C) 2019, National Physical Laboratory
-    Copyright (C) 2019, 2021, University College of London
+    Copyright (C) 2019, 2021, 2026, University College of London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -107,6 +107,10 @@ class ListTime;
     num_segments_in_memory := -1
     ; same for TOF bins
     num_TOF_bins_in_memory := 1
+    ; alternatively, keep only the non-zero bins in memory, and write the output as
+    ; sparse projection data (see ProjDataSparse). All data is then processed in a
+    ; single pass, such that the 2 keywords above are ignored.
+    store sparse histogram := 0
   End :=
   \endverbatim
 
@@ -204,6 +208,10 @@ public:
   bool get_store_delayeds() const;
   void set_num_segments_in_memory(int);
   int get_num_segments_in_memory() const;
+  //! Use ProjDataSparse to store the histogram
+  /*! If set, set_output_projdata_sptr() has to be called with a ProjDataSparse object (or not at all). */
+  void set_store_sparse_histogram(bool);
+  bool get_store_sparse_histogram() const;
   void set_num_events_to_store(long int);
   long int get_num_events_to_store() const;
   void set_time_frame_definitions(const TimeFrameDefinitions&);
@@ -276,6 +284,8 @@ protected:
 
   int num_segments_in_memory;
   int num_timing_poss_in_memory;
+  //! corresponds to key "store sparse histogram"
+  bool store_sparse_histogram;
   long int num_events_to_store;
   int max_segment_num_to_process;
 
@@ -0,0 +1,45 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup listmode
+  \brief Declaration of stir::convert_events_to_bins
+
+  \author Kris Thielemans
+*/
+
+#ifndef __stir_listmode_convert_events_to_bins_H__
+#define __stir_listmode_convert_events_to_bins_H__
+
+#include "stir/Bin.h"
+#include <vector>
+
+START_NAMESPACE_STIR
+
+class ListRecordBatch;
+class ProjDataInfo;
+
+//! Find the bins for all events in a batch
+/*! \ingroup listmode
+  On return, \a bins has the same size as \a batch, and <tt>bins[i]</tt> is the bin corresponding to
+  the event of <tt>batch.get_record(i)</tt>, with bin value 1 if the event could be converted, and 0
+  otherwise (as for CListEvent::get_bin()).
+
+  When the events are of type CListEventScannerWithDiscreteDetectors<ProjDataInfoCylindricalNoArcCorr>
+  (and do not override its get_bin(), see
+  CListEventScannerWithDiscreteDetectors::get_bin_uses_detection_position())
+  and \a proj_data_info is a ProjDataInfoCylindricalNoArcCorr, types are checked only once for the
+  whole batch, and the detection positions are converted to bins using non-virtual functions, in parallel
+  when OpenMP is enabled. Otherwise, CListEvent::get_bin() is called for every event.
+*/
+void convert_events_to_bins(std::vector<Bin>& bins, const ListRecordBatch& batch, const ProjDataInfo& proj_data_info);
+
+END_NAMESPACE_STIR
+
+#endif
@@ -9,7 +9,7 @@
 
 */
 /*
-  Copyright (C) 2021, University Copyright London
+  Copyright (C) 2021, 2026 University Copyright London
   This file is part of STIR.
 
   SPDX-License-Identifier: Apache-2.0
@@ -40,6 +40,9 @@ class Array;
 
   This is useful for normalisation, but also for randoms from singles.
 
+  The computation is done per segment, in parallel over views (when OpenMP is enabled).
+  A segment is written to \c proj_data by a separate thread while the next one is computed.
+
   \warning If TOF data is used, each TOF bin will be set to 1/num_tof_bins the non-TOF value.
   This is appropriate for RFS, but would be confusing when using for normalisation.
 
@@ -1,6 +1,6 @@
 /*
   Copyright (C) 2005 - 2009-10-27, Hammersmith Imanet Ltd
-  Copyright (C) 2013, University College London
+  Copyright (C) 2013, 2026, University College London
   This file is part of STIR.
 
   SPDX-License-Identifier: Apache-2.0
@@ -118,6 +118,23 @@ public:
   inline const BasicCoordinate<num_dimensions, out_elemT>
   gradient(const BasicCoordinate<num_dimensions, pos_type>& relative_positions) const;
 
+  //! Compute values of the interpolator on a regular grid
+  /*! Sets every element of \a out such that
+      \code
+      out[index] == (*this)(index * step + offset)
+      \endcode
+      (where the multiplication is element-wise). The computation is done separably, i.e. as 1D passes
+      along every dimension, with the B-spline weights precomputed once per output index in every dimension.
+      This gives the same values as evaluating the interpolator at every point (up to rounding errors),
+      but is much faster.
+      The passes are parallelised when OpenMP is enabled.
+
+      \warning Currently only implemented for 3 dimensions.
+  */
+  inline void sample_on_regular_grid(Array<num_dimensions, out_elemT>& out,
+                                     const BasicCoordinate<num_dimensions, pos_type>& offset,
+                                     const BasicCoordinate<num_dimensions, pos_type>& step) const;
+
 private:
   // variables that store numbers for the spline type
   // TODO these coefficients and the spline type could/should be integrated into 1 class
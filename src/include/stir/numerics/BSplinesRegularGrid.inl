@@ -1,6 +1,6 @@
 /*
   Copyright (C) 2005 - 2009-10-08, Hammersmith Imanet Ltd
-  Copyright (C) 2013, University College London
+  Copyright (C) 2013, 2026, University College London
   This file is part of STIR.
 
   SPDX-License-Identifier: Apache-2.0
@@ -17,6 +17,11 @@
 */
 
 #include "stir/numerics/BSplinesDetail.inl"
+#include "stir/IndexRange3D.h"
+#include "stir/error.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
 START_NAMESPACE_STIR
 
 namespace BSpline
@@ -73,6 +78,143 @@ BSplinesRegularGrid<num_dimensions, out_elemT, in_elemT, constantsT>::gradient(
       this->_coeffs, relative_positions, this->_spline_types);
 }
 
+namespace detail
+{
+/* Find the (mirrored) indices and weights of the input samples used for every output sample when sampling
+   a 1D B-spline on the regular grid out_index * step + offset. This does the same computation as
+   spline_convolution() (for one dimension). Results are stored for every output index as kernel_length
+   consecutive elements.
+*/
+inline void
+set_BSplines_sampling_table(std::vector<int>& indices,
+                            std::vector<pos_type>& weights,
+                            int& kernel_length,
+                            const BSplineType spline_type,
+                            const int min_in_index,
+                            const int max_in_index,
+                            const int min_out_index,
+                            const int max_out_index,
+                            const pos_type offset,
+                            const pos_type step)
+{
+  const PieceWiseFunction<pos_type>& bspline = bspline_function(spline_type);
+  kernel_length = bspline.kernel_total_length();
+  indices.resize(static_cast<std::size_t>(max_out_index - min_out_index + 1) * kernel_length);
+  weights.resize(indices.size());
+  std::size_t i = 0;
+  for (int out_index = min_out_index; out_index <= max_out_index; ++out_index)
+    {
+      const pos_type relative_position = out_index * step + offset;
+      const int kmin = static_cast<int>(std::ceil(relative_position - bspline.kernel_length_right()));
+      const int kmax = kmin + kernel_length - 1;
+      pos_type current_pos = relative_position - kmin;
+      int p = bspline.find_piece(current_pos);
+      for (int k = kmin; k <= kmax; ++k, --current_pos, --p, ++i)
+        {
+          if (k < min_in_index)
+            indices[i] = 2 * min_in_index - k;
+          else if (k > max_in_index)
+            indices[i] = 2 * max_in_index - k;
+          else
+            indices[i] = k;
+          assert(min_in_index <= indices[i] && indices[i] <= max_in_index);
+          weights[i] = bspline.function_piece(current_pos, p);
+        }
+    }
+}
+} // namespace detail
+
+template <int num_dimensions, typename out_elemT, typename in_elemT, typename constantsT>
+void
+BSplinesRegularGrid<num_dimensions, out_elemT, in_elemT, constantsT>::sample_on_regular_grid(
+    Array<num_dimensions, out_elemT>& out,
+    const BasicCoordinate<num_dimensions, pos_type>& offset,
+    const BasicCoordinate<num_dimensions, pos_type>& step) const
+{
+  static_assert(num_dimensions == 3, "BSplinesRegularGrid::sample_on_regular_grid is only implemented for 3 dimensions");
+  BasicCoordinate<3, int> min_in, max_in, min_out, max_out;
+  if (!this->_coeffs.get_regular_range(min_in, max_in) || !out.get_regular_range(min_out, max_out))
+    error("BSplinesRegularGrid::sample_on_regular_grid needs arrays with a regular range");
+
+  BasicCoordinate<3, std::vector<int>> indices;
+  BasicCoordinate<3, std::vector<pos_type>> weights;
+  BasicCoordinate<3, int> kernel_lengths;
+  for (int d = 1; d <= 3; ++d)
+    detail::set_BSplines_sampling_table(indices[d],
+                                        weights[d],
+                                        kernel_lengths[d],
+                                        this->_spline_types[d],
+                                        min_in[d],
+                                        max_in[d],
+                                        min_out[d],
+                                        max_out[d],
+                                        offset[d],
+                                        step[d]);
+  const int num_out_3 = max_out[3] - min_out[3] + 1;
+
+  // Values are accumulated in the same order as in operator(), i.e. first along the last dimension.
+  // Pass 1: interpolate along the last dimension
+  Array<3, out_elemT> values_1(
+      IndexRange3D(min_in[1], max_in[1], min_in[2], max_in[2], min_out[3], max_out[3]));
+#ifdef STIR_OPENMP
+#  pragma omp parallel for collapse(2)
+#endif
+  for (int i1 = min_in[1]; i1 <= max_in[1]; ++i1)
+    for (int i2 = min_in[2]; i2 <= max_in[2]; ++i2)
+      {
+        const Array<1, out_elemT>& coeffs_row = this->_coeffs[i1][i2];
+        Array<1, out_elemT>& row = values_1[i1][i2];
+        const int* index = indices[3].data();
+        const pos_type* weight = weights[3].data();
+        for (int o3 = min_out[3]; o3 <= max_out[3]; ++o3)
+          {
+            out_elemT value = 0;
+            for (int k = 0; k < kernel_lengths[3]; ++k, ++index, ++weight)
+              value += static_cast<out_elemT>(coeffs_row[*index] * *weight);
+            row[o3] = value;
+          }
+      }
+
+  // Pass 2: interpolate along the middle dimension (inner loop along the last dimension)
+  Array<3, out_elemT> values_2(
+      IndexRange3D(min_in[1], max_in[1], min_out[2], max_out[2], min_out[3], max_out[3]));
+#ifdef STIR_OPENMP
+#  pragma omp parallel for collapse(2)
+#endif
+  for (int i1 = min_in[1]; i1 <= max_in[1]; ++i1)
+    for (int o2 = min_out[2]; o2 <= max_out[2]; ++o2)
+      {
+        out_elemT* const row = &values_2[i1][o2][min_out[3]];
+        const std::size_t first = static_cast<std::size_t>(o2 - min_out[2]) * kernel_lengths[2];
+        for (int k = 0; k < kernel_lengths[2]; ++k)
+          {
+            const out_elemT* const in_row = &values_1[i1][indices[2][first + k]][min_out[3]];
+            const pos_type weight = weights[2][first + k];
+            for (int o3 = 0; o3 < num_out_3; ++o3)
+              row[o3] += static_cast<out_elemT>(in_row[o3] * weight);
+          }
+      }
+
+  // Pass 3: interpolate along the first dimension
+#ifdef STIR_OPENMP
+#  pragma omp parallel for collapse(2)
+#endif
+  for (int o1 = min_out[1]; o1 <= max_out[1]; ++o1)
+    for (int o2 = min_out[2]; o2 <= max_out[2]; ++o2)
+      {
+        out_elemT* const row = &out[o1][o2][min_out[3]];
+        std::fill(row, row + num_out_3, out_elemT(0));
+        const std::size_t first = static_cast<std::size_t>(o1 - min_out[1]) * kernel_lengths[1];
+        for (int k = 0; k < kernel_lengths[1]; ++k)
+          {
+            const out_elemT* const in_row = &values_2[indices[1][first + k]][o2][min_out[3]];
+            const pos_type weight = weights[1][first + k];
+            for (int o3 = 0; o3 < num_out_3; ++o3)
+              row[o3] += static_cast<out_elemT>(in_row[o3] * weight);
+          }
+      }
+}
+
 } // end of namespace BSpline
 
 END_NAMESPACE_STIR
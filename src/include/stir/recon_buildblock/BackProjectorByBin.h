@@ -15,7 +15,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2018-2019, University College London
+    Copyright (C) 2018-2019, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -30,6 +30,10 @@
 #include "stir/shared_ptr.h"
 #include "stir/Bin.h"
 #include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include <vector>
+#ifdef STIR_OPENMP
+#  include <omp.h>
+#endif
 
 START_NAMESPACE_STIR
 
@@ -53,6 +57,18 @@ public:
   //! Default constructor calls reset_timers()
   BackProjectorByBin();
 
+  //! Copy constructor
+  /*! The copy gets its own images to accumulate the back projection in (and its own locks for them),
+      such that it can be used independently of the original.
+  */
+  BackProjectorByBin(const BackProjectorByBin&);
+
+  //! Assignment operator
+  /*! As for the copy constructor, the images to accumulate the back projection in (and their locks)
+      are not shared with \a other.
+  */
+  BackProjectorByBin& operator=(const BackProjectorByBin&);
+
   ~BackProjectorByBin() override;
 
   //! Stores all necessary geometric info
@@ -140,6 +156,20 @@ public:
   /// Set data processor to use after back projection
   void set_post_data_processor(shared_ptr<DataProcessor<DiscretisedDensity<3, float>>> post_data_processor_sptr);
 
+  //! Set the maximum number of images in which the back projections of different OpenMP threads are accumulated
+  /*!
+    When using OpenMP, every thread normally accumulates its back projections in its own image, such that memory
+    usage grows with the number of threads. Setting this to a positive number limits the number of these images.
+    Threads then share images, which are locked while a thread is back projecting into them.
+    The default value 0 uses one image per thread, as in previous versions of STIR. Memory usage
+    is then unbounded in the number of threads, but threads never wait for each other. It is therefore
+    recommended to set this (e.g. to 4 or 8) when using many threads for large images.
+
+    Has to be called before set_up(). This setting is ignored when STIR is compiled without OpenMP.
+  */
+  void set_max_num_thread_local_images(const int);
+  int get_max_num_thread_local_images() const;
+
   virtual BackProjectorByBin* clone() const = 0;
 
 protected:
@@ -191,6 +221,9 @@ protected:
 
   bool _already_set_up;
 
+  //! \see set_max_num_thread_local_images()
+  int _max_num_thread_local_images;
+
   //! Clone of the density sptr set with set_up()
   shared_ptr<DiscretisedDensity<3, float>> _density_sptr;
   shared_ptr<DataProcessor<DiscretisedDensity<3, float>>> _post_data_processor_sptr;
@@ -204,8 +237,28 @@ protected:
 
 private:
 #ifdef STIR_OPENMP
-  //! A vector of back projected images that will be used with openMP. There will be as many images as openMP threads
+  //! A vector of back projected images that will be used with openMP.
+  /*! There will be as many images as openMP threads, unless limited by set_max_num_thread_local_images(),
+      in which case threads share images. */
   std::vector<shared_ptr<DiscretisedDensity<3, float>>> _local_output_image_sptrs;
+  //! A wrapper around an OpenMP lock, initialising and destroying it
+  /*! Copying creates a new (unset) lock, such that copies of the back projector (e.g. via clone())
+      do not share locks. */
+  class ImageLock
+  {
+  public:
+    ImageLock() { omp_init_lock(&lock); }
+    ImageLock(const ImageLock&) { omp_init_lock(&lock); }
+    ImageLock& operator=(const ImageLock&) { return *this; }
+    ~ImageLock() { omp_destroy_lock(&lock); }
+    omp_lock_t lock;
+  };
+  //! Locks for \c _local_output_image_sptrs
+  std::vector<ImageLock> _local_output_image_locks;
+  //! Index in \c _local_output_image_sptrs currently used by every thread (see back_project())
+  std::vector<int> _local_output_image_num_of_thread;
+  //! Index in \c _local_output_image_sptrs used by the current thread
+  int get_local_output_image_num() const;
 #endif
 };
 
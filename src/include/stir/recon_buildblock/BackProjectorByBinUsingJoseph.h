@@ -0,0 +1,86 @@
+//
+//
+/*!
+  \file
+  \ingroup projection
+
+  \brief Declaration of class stir::BackProjectorByBinUsingJoseph
+
+  \author Kris Thielemans
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+#ifndef __stir_recon_buildblock_BackProjectorByBinUsingJoseph__H__
+#define __stir_recon_buildblock_BackProjectorByBinUsingJoseph__H__
+
+#include "stir/recon_buildblock/BackProjectorByBin.h"
+#include "stir/RegisteredParsingObject.h"
+#include "stir/shared_ptr.h"
+
+START_NAMESPACE_STIR
+
+class DataSymmetriesForBins_PET_CartesianGrid;
+namespace detail
+{
+class JosephProjectionHelper;
+}
+
+/*!
+  \ingroup projection
+  \brief Matrix-free back projector using Joseph's interpolation method, including TOF
+
+  This is the exact adjoint of ForwardProjectorByBinUsingJoseph. See there for more information.
+
+  Multi-threading is done via BackProjectorByBin::back_project(), i.e. over views, with every
+  thread accumulating into its own image.
+
+  \par Parsing details
+  \verbatim
+  Back Projector Using Joseph Parameters:=
+  End Back Projector Using Joseph Parameters:=
+  \endverbatim
+*/
+class BackProjectorByBinUsingJoseph : public RegisteredParsingObject<BackProjectorByBinUsingJoseph, BackProjectorByBin>
+{
+public:
+  //! Name which will be used when parsing a BackProjectorByBin object
+  static const char* const registered_name;
+
+  BackProjectorByBinUsingJoseph();
+
+  ~BackProjectorByBinUsingJoseph() override;
+
+  //! Stores all necessary geometric info
+  void set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_ptr,
+              const shared_ptr<const DiscretisedDensity<3, float>>& density_info_sptr // TODO should be Info only
+              ) override;
+
+  const DataSymmetriesForViewSegmentNumbers* get_symmetries_used() const override;
+
+  BackProjectorByBinUsingJoseph* clone() const override;
+
+protected:
+  void actual_back_project(DiscretisedDensity<3, float>& density,
+                           const RelatedViewgrams<float>& viewgrams,
+                           const int min_axial_pos_num,
+                           const int max_axial_pos_num,
+                           const int min_tangential_pos_num,
+                           const int max_tangential_pos_num) override;
+
+private:
+  shared_ptr<DataSymmetriesForBins_PET_CartesianGrid> symmetries_sptr;
+  shared_ptr<detail::JosephProjectionHelper> helper_sptr;
+
+  void set_defaults() override;
+  void initialise_keymap() override;
+};
+
+END_NAMESPACE_STIR
+
+#endif
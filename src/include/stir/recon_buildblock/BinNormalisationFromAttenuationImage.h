@@ -41,15 +41,24 @@ START_NAMESPACE_STIR
 
   \warning Attenuation image data are supposed to be in units cm^-1.
     (Reference: water has mu .096 cm^-1.)
-  \todo Add mechanism for caching the attenuation correction factors, such that they will
-  be calculated only once. However, caching should by default be disabled, as most
-  applications need them only once anyway.
+
+  \par Caching
+  Iterative reconstructions call apply() or undo() for every subset in every subiteration,
+  which means that the attenuation image would be forward projected many times.
+  When caching is enabled, the attenuation correction factors of every viewgram are computed
+  only once (when first needed) and stored. Cached factors are kept in memory up to a
+  configurable budget. Once that budget is exhausted, newly computed factors are written to a
+  temporary file (as floats) and read back when needed. The cache can be used by multiple threads.
+  Caching is disabled by default, as most applications need the factors only once anyway.
 
   \par Parsing details
   \verbatim
   Bin Normalisation From Attenuation Image:=
   attenuation_image_filename := <ASCII>
   forward projector type := <ASCII>
+  ; optional keys for caching
+  cache attenuation correction factors := 0
+  cache memory budget (in MB) := 1024
   End Bin Normalisation From Attenuation Image :=
   \endverbatim
 */
@@ -110,10 +119,30 @@ public:
 
   float get_bin_efficiency(const Bin& bin) const override;
 
+  //! Enable/disable caching of the attenuation correction factors
+  /*! Has to be called before set_up(). */
+  void set_use_cache(const bool use_cache);
+  bool get_use_cache() const;
+
+  //! Set the maximum amount of memory used for caching (in MB)
+  /*! Factors that do not fit in memory are cached on disk. Has to be called before set_up(). */
+  void set_cache_memory_budget_in_MB(const float budget);
+  float get_cache_memory_budget_in_MB() const;
+
 private:
+  class ACFCache;
+
   shared_ptr<const DiscretisedDensity<3, float>> attenuation_image_ptr;
   shared_ptr<ForwardProjectorByBin> forward_projector_ptr;
 
+  bool use_cache;
+  float cache_memory_budget_in_MB;
+  //! only allocated by set_up() when caching is enabled
+  shared_ptr<ACFCache> acf_cache_sptr;
+
+  //! fill \a acf_viewgrams with the attenuation correction factors, using the cache if enabled
+  void get_attenuation_correction_factors(RelatedViewgrams<float>& acf_viewgrams) const;
+
   // parsing stuff
   void set_defaults() override;
   void initialise_keymap() override;
@@ -0,0 +1,106 @@
+//
+//
+/*!
+  \file
+  \ingroup projection
+
+  \brief Declaration of class stir::ForwardProjectorByBinUsingJoseph
+
+  \author Kris Thielemans
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+#ifndef __stir_recon_buildblock_ForwardProjectorByBinUsingJoseph__H__
+#define __stir_recon_buildblock_ForwardProjectorByBinUsingJoseph__H__
+
+#include "stir/recon_buildblock/ForwardProjectorByBin.h"
+#include "stir/RegisteredParsingObject.h"
+#include "stir/shared_ptr.h"
+#include <vector>
+
+START_NAMESPACE_STIR
+
+class DataSymmetriesForBins_PET_CartesianGrid;
+namespace detail
+{
+class JosephProjectionHelper;
+}
+
+/*!
+  \ingroup projection
+  \brief Matrix-free forward projector using Joseph's interpolation method, including TOF
+
+  Every bin is computed by sampling its LOR once per image plane (along the axis in which the
+  LOR moves fastest), and interpolating bi-linearly in that plane. For TOF data, the samples are
+  weighted with a Gaussian TOF kernel, and only the relevant part of the LOR is visited.
+  See detail::JosephProjectionHelper for more information.
+
+  LORs are computed via ProjDataInfo::get_LOR(), such that all PET geometries are supported,
+  including ProjDataInfoBlocksOnCylindricalNoArcCorr. As nothing is cached, no extra memory is
+  needed (aside from a copy of the image).
+
+  Related viewgrams (as determined by DataSymmetriesForBins_PET_CartesianGrid) are all computed
+  directly. Multi-threading is done via ForwardProjectorByBin::forward_project(), i.e. over views.
+
+  This projector is the adjoint of BackProjectorByBinUsingJoseph.
+
+  \warning The image HAS to be of type VoxelsOnCartesianGrid.
+
+  \par Parsing details
+  \verbatim
+  Forward Projector Using Joseph Parameters:=
+  End Forward Projector Using Joseph Parameters:=
+  \endverbatim
+*/
+class ForwardProjectorByBinUsingJoseph : public RegisteredParsingObject<ForwardProjectorByBinUsingJoseph, ForwardProjectorByBin>
+{
+public:
+  //! Name which will be used when parsing a ForwardProjectorByBin object
+  static const char* const registered_name;
+
+  ForwardProjectorByBinUsingJoseph();
+
+  ~ForwardProjectorByBinUsingJoseph() override;
+
+  //! Stores all necessary geometric info
+  void set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_ptr,
+              const shared_ptr<const DiscretisedDensity<3, float>>& density_info_sptr // TODO should be Info only
+              ) override;
+
+  const DataSymmetriesForViewSegmentNumbers* get_symmetries_used() const override;
+
+  //! Stores the image
+  /*! The projector accesses the image stored by ForwardProjectorByBin::set_input() directly. Only if that is not
+      contiguous, a contiguous copy is made.
+  */
+  void set_input(const DiscretisedDensity<3, float>&) override;
+
+protected:
+  void actual_forward_project(RelatedViewgrams<float>& viewgrams,
+                              const int min_axial_pos_num,
+                              const int max_axial_pos_num,
+                              const int min_tangential_pos_num,
+                              const int max_tangential_pos_num) override;
+
+private:
+  shared_ptr<DataSymmetriesForBins_PET_CartesianGrid> symmetries_sptr;
+  shared_ptr<detail::JosephProjectionHelper> helper_sptr;
+  //! pointer to the data of the image stored by ForwardProjectorByBin::set_input(), if it is contiguous
+  /*! This is safe to access from multiple threads, as that image is not modified until the next call to set_input(). */
+  const float* density_data_ptr = nullptr;
+  //! contiguous copy of the image, only used if the stored image is not contiguous
+  std::vector<float> image_data;
+
+  void set_defaults() override;
+  void initialise_keymap() override;
+};
+
+END_NAMESPACE_STIR
+
+#endif
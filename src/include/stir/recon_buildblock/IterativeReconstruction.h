@@ -35,6 +35,7 @@
 #  include "stir/shared_ptr.h"
 #  include "stir/DataProcessor.h"
 #  include "stir/recon_buildblock/GeneralisedObjectiveFunction.h"
+#  include <future>
 
 START_NAMESPACE_STIR
 
@@ -59,6 +60,8 @@ START_NAMESPACE_STIR
   start at subset:= 0
   number of subiterations:= 1
   save images at subiteration intervals:= 1
+  ; if set, intermediate images are written in a background thread (see end_of_iteration_processing())
+  write intermediate images in background:= 0
   start at subiteration number:=2
 
   initial image :=
@@ -167,6 +170,9 @@ public:
   //! subiteration interval at which data will be saved
   const int get_save_interval() const;
 
+  //! signals whether intermediate images are written in a background thread
+  bool get_write_intermediate_images_in_background() const;
+
   //! signals whether to randomise the subset order in each iteration
   const bool get_randomise_subset_order() const;
 
@@ -210,6 +216,9 @@ public:
   //! subiteration interval at which data will be saved
   void set_save_interval(const int);
 
+  //! signals whether intermediate images are written in a background thread
+  void set_write_intermediate_images_in_background(const bool);
+
   //! signals whether to randomise the subset order in each iteration
   void set_randomise_subset_order(const bool);
 
@@ -234,6 +243,13 @@ public:
   //! the principal operations for updating the data iterates at each iteration
   virtual void update_estimate(TargetT& current_estimate) = 0;
 
+  //! wait until all images that are being written in the background are on disk
+  /*! Calls error() if writing failed. This is called by reconstruct() and end_of_iteration_processing()
+      when writing the final image, but you need to call it yourself if you call
+      end_of_iteration_processing() from your own loop and need the intermediate files.
+  */
+  void wait_for_background_output();
+
 protected:
   IterativeReconstruction();
 
@@ -243,7 +259,10 @@ protected:
       <li>applies the inter-filtering and/or post-filtering data processor,</li>
       <li>writes the current data to file at the designated subiteration numbers
       (including the final one). Filenames used are determined by
-      Reconstruction::output_filename_prefix,</li>
+      Reconstruction::output_filename_prefix. If get_write_intermediate_images_in_background()
+      is \c true, intermediate images are copied and written in a background thread,
+      such that the iterations can continue. At most one image is written in the background
+      at any time. The final image is always written before returning,</li>
       <li>writes the objective function values (using
       GeneralisedObjectiveFunction::report_objective_function_values) to stderr.</li>
       </ul>
@@ -287,6 +306,9 @@ protected:
   //! subiteration interval at which data will be saved
   int save_interval;
 
+  //! signals whether intermediate images are written in a background thread
+  bool write_intermediate_images_in_background;
+
   //! signals whether to randomise the subset order in each iteration
   bool randomise_subset_order;
 
@@ -315,6 +337,8 @@ private:
   VectorWithOffset<int> _current_subset_array;
   //! used to randomly generate a subset sequence order for the current iteration
   VectorWithOffset<int> randomly_permute_subset_order() const;
+  //! result of the image that is currently being written in the background (if any)
+  std::shared_future<Succeeded> _background_output;
 };
 
 END_NAMESPACE_STIR
@@ -0,0 +1,92 @@
+//
+//
+/*!
+  \file
+  \ingroup projection
+
+  \brief Defines stir::detail::JosephProjectionHelper
+
+  \author Kris Thielemans
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+#ifndef __stir_recon_buildblock_JosephProjectionHelper_h__
+#define __stir_recon_buildblock_JosephProjectionHelper_h__
+
+#include "stir/CartesianCoordinate3D.h"
+#include "stir/shared_ptr.h"
+
+START_NAMESPACE_STIR
+
+template <int num_dimensions, class elemT>
+class DiscretisedDensity;
+class ProjDataInfo;
+class Bin;
+
+namespace detail
+{
+/*!
+  \ingroup projection
+  \brief Helper class implementing Joseph's interpolating projection for a single bin
+
+  The LOR of a bin (as given by ProjDataInfo::get_LOR()) is sampled once per image plane
+  perpendicular to the axis along which the LOR moves fastest (in voxel units). In each of these
+  planes, the image is interpolated bi-linearly. Each sample is weighted with the length of the LOR
+  between 2 planes (divided by the x voxel size, as other STIR projectors, unless \c NEWSCALE is
+  \c \#defined).
+
+  For TOF data, every sample is multiplied with the integral of a Gaussian (with FWHM given by the
+  scanner timing resolution) over the TOF bin. Only the part of the LOR within 4 sigma of the
+  TOF bin is visited. TOF conventions are the same as in ProjMatrixByBin.
+
+  Images are passed as pointers to contiguous data, with the same ordering as VoxelsOnCartesianGrid.
+
+  Image coordinates are computed in the "gantry" coordinate system used by ProjDataInfo::get_LOR(),
+  i.e. with the middle of the image in the centre of the scanner.
+*/
+class JosephProjectionHelper
+{
+public:
+  JosephProjectionHelper(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                         const DiscretisedDensity<3, float>& density_info);
+
+  //! Number of voxels in the image
+  std::size_t get_num_voxels() const;
+
+  //! Compute the (TOF-weighted) line integral for \a bin
+  float forward_project_bin(const float* image_ptr, const Bin& bin) const;
+
+  //! Add \a value times the LOR weights of \a bin to the image
+  void back_project_bin(float* image_ptr, const Bin& bin, const float value) const;
+
+private:
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr;
+  //! number of voxels in z,y,x
+  CartesianCoordinate3D<int> dimensions;
+  //! offset between successive voxels in z,y,x in the contiguous array
+  CartesianCoordinate3D<int> strides;
+  //! gantry coordinates of the first voxel
+  CartesianCoordinate3D<float> first_voxel;
+  CartesianCoordinate3D<float> voxel_size;
+  //! scale factor for the LOR length
+  float rescale;
+  //! 1/(sqrt(2)*sigma) of the TOF kernel in mm, or 0 for non-TOF data
+  float r_sqrt2_gauss_sigma;
+
+  //! Loop over all samples and interpolation weights of \a bin
+  /*! For each voxel, \c func(index, weight) is called, with index the offset in the contiguous array. */
+  template <class FunctionT>
+  void for_all_voxels_on_LOR(const Bin& bin, FunctionT& func) const;
+};
+
+} // namespace detail
+
+END_NAMESPACE_STIR
+
+#endif // __stir_recon_buildblock_JosephProjectionHelper_h__
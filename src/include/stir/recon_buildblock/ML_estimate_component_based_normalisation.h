@@ -1,5 +1,5 @@
 /*
-    Copyright (C) 2022, University College London
+    Copyright (C) 2022, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -23,6 +23,12 @@ class ProjData;
  \brief Find normalisation factors using a maximum likelihood approach
 
   \ingroup recon_buildblock
+
+  If \a do_KL is \c true, the Kullback-Leibler divergence between the measured data and the current
+  estimate is written to the log. As this is relatively expensive, it is only computed every
+  \a KL_interval (sub)iterations, and after the last one.
+
+  When STIR is compiled with OpenMP, most computations are performed in parallel.
 */
 void ML_estimate_component_based_normalisation(const std::string& out_filename_prefix,
                                                const ProjData& measured_data,
@@ -33,6 +39,7 @@ void ML_estimate_component_based_normalisation(const std::string& out_filename_p
                                                bool do_block,
                                                bool do_symmetry_per_block,
                                                bool do_KL,
-                                               bool do_display);
+                                               bool do_display,
+                                               const int KL_interval = 1);
 
 END_NAMESPACE_STIR
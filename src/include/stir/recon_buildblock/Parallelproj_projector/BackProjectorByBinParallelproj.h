@@ -11,7 +11,7 @@
 
 */
 /*
-    Copyright (C) 2019, 2021 University College London
+    Copyright (C) 2019, 2021, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -23,12 +23,14 @@
 
 #include "stir/RegisteredParsingObject.h"
 #include "stir/recon_buildblock/BackProjectorByBin.h"
+#include <vector>
 //#include "stir/recon_buildblock/Parallelproj_projector/ParallelprojHelper.h"
 
 START_NAMESPACE_STIR
 
 class DataSymmetriesForViewSegmentNumbers;
 class ProjDataInMemory;
+class ViewSegmentNumbers;
 namespace detail
 {
 class ParallelprojHelper;
@@ -37,6 +39,14 @@ class ParallelprojHelper;
 /*!
   \ingroup Parallelproj
   \brief Class for Parallelproj's back projector
+
+  When using the CPU version of Parallelproj, viewgrams are back projected as they are passed,
+  computing LOR end-points for those viewgrams only, such that back projecting a subset only
+  costs the size of that subset. For TOF data, back_project(const ProjData&, int, int) handles
+  all TOF bins of a view in a single call to Parallelproj.
+
+  When using the CUDA version of Parallelproj, viewgrams are accumulated in a full-size sinogram,
+  which is back projected in get_output().
 */
 class BackProjectorByBinParallelproj : public RegisteredParsingObject<BackProjectorByBinParallelproj, BackProjectorByBin>
 {
@@ -63,10 +73,11 @@ public:
   //! Symmetries not used, so returns TrivialDataSymmetriesForBins.
   const DataSymmetriesForViewSegmentNumbers* get_symmetries_used() const override;
 
-#if 0
- /// Back project
-  void back_project(const ProjData&, int subset_num = 0, int num_subsets = 1);
-#endif
+  using BackProjectorByBin::back_project;
+  //! Back project (a subset of) the data
+  /*! For the CPU version of Parallelproj, this back projects all TOF bins of a view at once. */
+  void back_project(const ProjData&, int subset_num = 0, int num_subsets = 1) override;
+
   /// Get output
   void get_output(DiscretisedDensity<3, float>&) const override;
 
@@ -104,11 +115,26 @@ protected:
 
 private:
   shared_ptr<DataSymmetriesForViewSegmentNumbers> _symmetries_sptr;
+  //! data to back project (only used by the CUDA version)
   shared_ptr<ProjDataInMemory> _proj_data_to_backproject_sptr;
+  //! contiguous image to accumulate into (only used by the CPU version)
+  std::vector<float> _image_vec;
   shared_ptr<detail::ParallelprojHelper> _helper;
   bool _do_not_setup_helper;
   friend class ProjectorByBinPairUsingParallelproj;
   void set_helper(shared_ptr<detail::ParallelprojHelper>);
+  //! Back project the LORs of (part of) a viewgram for all TOF bins or only for one, accumulating into _image_vec
+  /*! \a mem_for_PP has to be in Parallelproj order, i.e. with the TOF bin running fastest.
+      If \a tof_idx is non-negative (and the data is TOF), only that TOF bin (counting from 0) is back projected,
+      and \a mem_for_PP contains one value per LOR.
+  */
+  void back_project_LORs(const std::vector<float>& mem_for_PP,
+                         const ViewSegmentNumbers& vs,
+                         const int min_axial_pos_num,
+                         const int max_axial_pos_num,
+                         const int min_tangential_pos_num,
+                         const int max_tangential_pos_num,
+                         const int tof_idx = -1);
   bool _cuda_verbosity;
   int _num_gpu_chunks;
 };
@@ -14,7 +14,7 @@
 
 */
 /*
-    Copyright (C) 2019, 2021 University College London
+    Copyright (C) 2019, 2021, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -24,11 +24,13 @@
 
 #include "stir/RegisteredParsingObject.h"
 #include "stir/recon_buildblock/ForwardProjectorByBin.h"
+#include <vector>
 
 START_NAMESPACE_STIR
 
 class ProjDataInMemory;
 class DataSymmetriesForViewSegmentNumbers;
+class ViewSegmentNumbers;
 namespace detail
 {
 class ParallelprojHelper;
@@ -37,6 +39,14 @@ class ParallelprojHelper;
 /*!
   \ingroup Parallelproj
   \brief Class for Parallelproj's forward projector.
+
+  When using the CPU version of Parallelproj, only the requested viewgrams are projected,
+  and LOR end-points are computed for those viewgrams only. Forward projecting a subset
+  of the data therefore only costs (in memory and time) the size of that subset.
+  For TOF data, all TOF bins of a view are computed in a single call to Parallelproj.
+
+  When using the CUDA version of Parallelproj, all data is projected in set_input(),
+  in \c num_gpu_chunks chunks. LOR end-points are computed per chunk.
 */
 class ForwardProjectorByBinParallelproj : public RegisteredParsingObject<ForwardProjectorByBinParallelproj, ForwardProjectorByBin>
 {
@@ -74,6 +84,11 @@ public:
   /// Set input
   void set_input(const DiscretisedDensity<3, float>&) override;
 
+  using ForwardProjectorByBin::forward_project;
+  //! Forward project (a subset of) the data
+  /*! For the CPU version of Parallelproj, this projects all TOF bins of a view at once. */
+  void forward_project(ProjData&, int subset_num = 0, int num_subsets = 1, bool zero = true) override;
+
   /// set defaults
   void set_defaults() override;
 
@@ -97,11 +112,26 @@ protected:
 
 private:
   shared_ptr<DataSymmetriesForViewSegmentNumbers> _symmetries_sptr;
+  //! projected data (only used by the CUDA version)
   shared_ptr<ProjDataInMemory> _projected_data_sptr;
+  //! contiguous copy of the input image (only used by the CPU version)
+  std::vector<float> _image_vec;
   shared_ptr<detail::ParallelprojHelper> _helper;
   bool _do_not_setup_helper;
   friend class ProjectorByBinPairUsingParallelproj;
   void set_helper(shared_ptr<detail::ParallelprojHelper>);
+  //! Project the LORs of (part of) a viewgram for all TOF bins, or only for one
+  /*! \a output is resized to contain the result in Parallelproj order, i.e. with the TOF bin running fastest.
+      If \a tof_idx is non-negative (and the data is TOF), only that TOF bin (counting from 0) is computed,
+      and \a output contains one value per LOR.
+  */
+  void project_LORs(std::vector<float>& output,
+                    const ViewSegmentNumbers& vs,
+                    const int min_axial_pos_num,
+                    const int max_axial_pos_num,
+                    const int min_tangential_pos_num,
+                    const int max_tangential_pos_num,
+                    const int tof_idx = -1) const;
   bool _cuda_verbosity;
   bool _use_truncation;
   int _num_gpu_chunks;
@@ -10,7 +10,7 @@
 
 */
 /*
-    Copyright (C) 2021 University College London
+    Copyright (C) 2021, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -21,6 +21,7 @@
 #define __stir_recon_buildblock_ParallelprojHelper_h__
 
 #include "stir/common.h"
+#include "stir/shared_ptr.h"
 #include <vector>
 #include <array>
 
@@ -29,6 +30,8 @@ START_NAMESPACE_STIR
 template <int num_dimensions, class elemT>
 class DiscretisedDensity;
 class ProjDataInfo;
+class ViewSegmentNumbers;
+class Bin;
 
 namespace detail
 {
@@ -36,6 +39,10 @@ namespace detail
   \ingroup projection
   \ingroup Parallelproj
   \brief Helper class for Parallelproj's projectors
+
+  LOR end-points (in the units used by parallelproj) are computed on demand, either for
+  a range of LORs (in the order used by ProjDataInMemory, ignoring TOF), or for (part of) a
+  viewgram. This avoids having to store 6 floats for every bin of the full projection data.
 */
 class ParallelprojHelper
 {
@@ -43,12 +50,25 @@ public:
   ~ParallelprojHelper();
   ParallelprojHelper(const ProjDataInfo& p_info, const DiscretisedDensity<3, float>& density);
 
+  //! Compute end-points for \a num_lors LORs starting from \a first_lor_num
+  /*! LORs are numbered as in ProjDataInMemory (for a single TOF bin). \a xstart and \a xend are resized
+      to 3 floats per LOR. */
+  void
+  get_LOR_endpoints(std::vector<float>& xstart, std::vector<float>& xend, long long first_lor_num, long long num_lors) const;
+
+  //! Compute end-points for the LORs in a viewgram, ordered as in Viewgram (axial position runs slowest)
+  void get_LOR_endpoints(std::vector<float>& xstart,
+                         std::vector<float>& xend,
+                         const ViewSegmentNumbers& vs,
+                         const int min_axial_pos_num,
+                         const int max_axial_pos_num,
+                         const int min_tangential_pos_num,
+                         const int max_tangential_pos_num) const;
+
   // parallelproj arrays
   std::array<float, 3> voxsize;
   std::array<int, 3> imgdim;
   std::array<float, 3> origin;
-  std::vector<float> xstart;
-  std::vector<float> xend;
 
   long long num_image_voxel;
   long long num_lors;
@@ -57,6 +77,24 @@ public:
   float tofcenter_offset;
   float tofbin_width;
   short num_tof_bins;
+
+  //! The \c tofcenter_offset to pass to Parallelproj to compute only TOF bin \a tof_idx
+  /*! Parallelproj numbers TOF bins \c it from <tt>-(num_tof_bins/2)</tt> to <tt>num_tof_bins/2</tt>, centred at
+      <tt>it*tofbin_width + tofcenter_offset</tt>. When calling it with a single TOF bin, its centre is therefore
+      the returned offset. \a tof_idx runs from 0 to <tt>num_tof_bins-1</tt>.
+  */
+  float get_tofcenter_offset_for_TOF_bin(const int tof_idx) const;
+
+private:
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr;
+  std::vector<int> segment_sequence;
+  //! scale factor from mm to parallelproj units
+  float rescale;
+  //! radius of the cylinder used to find the end-points
+  float radius;
+
+  //! set 3 floats in \a xstart_ptr and \a xend_ptr
+  void set_LOR_endpoints(float* xstart_ptr, float* xend_ptr, const Bin& bin) const;
 };
 
 } // namespace detail
@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2022, Matthew Strugari
     Copyright (C) 2014, Biomedical Image Group (GIB), Universitat de Barcelona, Barcelona, Spain. All rights reserved.
-    Copyright (C) 2014, 2021, University College London
+    Copyright (C) 2014, 2021, 2026, University College London
     This file is part of STIR.
 
     This software is distributed WITHOUT ANY WARRANTY;
@@ -19,6 +19,13 @@
 namespace SPECTUB_mph
 {
 
+//! compute the weights for subset \a kOS (\a do_estim is true) or estimate their number (\a do_estim is false)
+/*! When computing the weights, image slices are distributed over OpenMP threads (if enabled). The weights are
+    stored in \a wm in the same order as for a sequential calculation. Every thread uses its own copy of
+    \a psf2d_bin, \a psf_subs and \a psf2d_aux, so only their sizes are used.
+
+    The image indices for STIR (\a wm.nx etc) are not filled in by this function.
+*/
 void wm_calculation_mph(bool do_estim,
                         const int kOS,
                         psf2d_type* psf2d_bin,
@@ -19,6 +19,8 @@
 #define __stir_recon_buildblock_PoissonLogLikelihoodWithLinearModelForMean_H__
 
 #include "stir/recon_buildblock/GeneralisedObjectiveFunction.h"
+#include <vector>
+#include <string>
 
 START_NAMESPACE_STIR
 
@@ -101,8 +103,29 @@ START_NAMESPACE_STIR
   ; e.g. subsens_%d.hv
   ; boost::format is used with the pattern (which means you can use it like sprintf)
   subset sensitivity filenames:=
+  ; directory for the sensitivity cache (see below). Defaults to empty (no cache)
+  sensitivity cache directory:=
   \endverbatim
 
+  \par Sensitivity cache
+  If a <tt>sensitivity cache directory</tt> is set, and the sensitivity would otherwise be
+  recomputed because no filenames were given, set_up() will look in that directory for sensitivities
+  that were computed earlier with the same settings. These settings are described by
+  get_sensitivity_cache_description() (e.g. scanner and projection data info, image geometry,
+  projectors, normalisation, subsets) and a hash of this description is used to construct the filenames.
+  If no such files are found (or \c recompute_sensitivity is set), the sensitivities are computed
+  and written to the cache. This way, reconstructions of many data sets with the same
+  protocol can reuse the sensitivities automatically.
+
+  When reading from the cache, only the total sensitivity is read during set_up(). Subset sensitivities
+  are only read when they are first used.
+
+  \warning Files referred to in the settings are in general identified by their name, not their content.
+  If such files are overwritten, you need to clear the cache. PoissonLogLikelihoodWithLinearModelForMeanAndProjData
+  does use the content of the files referred to by the normalisation (e.g. the attenuation image). However,
+  normalisations that were constructed from data in memory are only identified by their parameters.
+  \warning The directory has to exist.
+
   \par Terminology
   We currently use \c sub_gradient for the gradient of the likelihood of the subset (not
   the mathematical subgradient).
@@ -189,6 +212,10 @@ public:
  */
   std::string get_subsensitivity_filenames() const;
 
+  //! get the directory used for the sensitivity cache
+  /*! will be a zero string if the cache is not used */
+  std::string get_sensitivity_cache_directory() const;
+
   /*! \name Functions to set parameters
     This can be used as alternative to the parsing mechanism.
    \warning After using any of these, you have to call set_up().
@@ -213,6 +240,9 @@ public:
   Calls error() if the pattern is invalid.
  */
   void set_subsensitivity_filenames(const std::string&);
+  //! set the directory used for the sensitivity cache
+  /*! set to a zero-length string to disable the cache */
+  void set_sensitivity_cache_directory(const std::string&);
   //@}
 
   /*! The implementation checks if the sensitivity of a voxel is zero. If so,
@@ -225,9 +255,23 @@ private:
   std::string subsensitivity_filenames;
   bool recompute_sensitivity;
   bool use_subset_sensitivities;
+  std::string sensitivity_cache_directory;
 
-  VectorWithOffset<shared_ptr<TargetT>> subsensitivity_sptrs;
+  //! subset sensitivities (can be read lazily from the cache, see get_subset_sensitivity_sptr())
+  mutable VectorWithOffset<shared_ptr<TargetT>> subsensitivity_sptrs;
   shared_ptr<TargetT> sensitivity_sptr;
+  //! filenames of subset sensitivities in the cache (empty if not read from the cache)
+  std::vector<std::string> subsensitivity_cache_filenames;
+
+  //! find the prefix for all filenames in the cache for the given description
+  std::string get_sensitivity_cache_filename_prefix(const std::string& description) const;
+  //! get full description of the settings for the cache (or an empty string if the cache cannot be used)
+  std::string get_full_sensitivity_cache_description(const TargetT& target) const;
+  //! read sensitivities from the cache if present
+  /*! Only the total sensitivity is read (if get_use_subset_sensitivities() is true). */
+  bool read_sensitivities_from_cache(const TargetT& target, const std::string& description);
+  //! write all sensitivities to the cache
+  void write_sensitivities_to_cache(const std::string& description) const;
 
   //! Get the subset sensitivity sptr
   shared_ptr<TargetT> get_subset_sensitivity_sptr(const int subset_num) const;
@@ -245,6 +289,12 @@ protected:
   //! set-up specifics for the derived class
   virtual Succeeded set_up_before_sensitivity(shared_ptr<const TargetT> const& target_sptr) = 0;
 
+  //! Describe all settings of the derived class that determine the sensitivity
+  /*! This is used as key for the sensitivity cache, after adding the image geometry and subset settings.
+      The default implementation returns an empty string, which disables the cache.
+  */
+  virtual std::string get_sensitivity_cache_description(const TargetT& target) const;
+
   //! compute subset and total sensitivity
   /*! This function fills in the sensitivity data by calling add_subset_sensitivity()
       for all subsets. It assumes that the subsensitivity for the 1st subset has been
@@ -3,7 +3,7 @@
 /*
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
     Copyright (C) 2015, Univ. of Leeds
-    Copyright (C) 2016, 2022, 2024 UCL
+    Copyright (C) 2016, 2022, 2024, 2026 UCL
     Copyright (C) 2021, University of Pennsylvania
     SPDX-License-Identifier: Apache-2.0
 
@@ -48,10 +48,11 @@ START_NAMESPACE_STIR
   any bins, then the log likelihood computed from list mode data and
   projection data will be identical.
 
-  Currently, the subset scheme is the same for the projection data and listmode data, i.e.
-  based on views. This is suboptimal for listmode data.
-
-  \todo implement a subset scheme based on events
+  By default, the subset scheme is the same for the projection data and listmode data, i.e.
+  based on views. Alternatively, events can be assigned to subsets randomly, see set_randomise_event_subsets().
+  In both cases, the events in every batch are partitioned according to their subset when the batch is
+  loaded, such that a subset computation only needs to visit its own events. If all events fit in a single
+  batch, it is kept in memory between subset computations.
 */
 
 template <typename TargetT>
@@ -108,6 +109,30 @@ public:
 
   void set_skip_balanced_subsets(const bool arg);
 
+  //! Set if events in each batch should be sorted and identical events merged
+  /*!
+    When enabled, events in every batch (see \c record_cache) are sorted on view, segment, axial and tangential position
+    and TOF bin, and events in the same bin are merged into a single entry with a count equal to the number of events.
+    The projection matrix row for a bin is then only computed once per batch, and successive rows are close in the image.
+    This can speed up computations considerably for high-count data. Gradient and Hessian are unchanged (up to
+    numerical rounding). The objective function value is also unchanged, except when the "singularity cancellation"
+    for bins with very small mean is triggered, as this is then applied to the merged entry.
+
+    Defaults to \c false.
+  */
+  void set_merge_identical_events(const bool arg);
+  bool get_merge_identical_events() const;
+
+  //! Set if events should be assigned to subsets randomly
+  /*!
+    When \c false (the default), an event is in the subset given by its (basic) view number, as for projection data.
+    When \c true, every event is assigned to a random subset (with a fixed seed for every batch, such that
+    results are reproducible). The subset sensitivity is then (on average) the total sensitivity divided by the
+    number of subsets, and you therefore have to set \c use_subset_sensitivities to \c false.
+  */
+  void set_randomise_event_subsets(const bool arg);
+  bool get_randomise_event_subsets() const;
+
 #if STIR_VERSION < 060000
   STIR_DEPRECATED
   void set_max_ring_difference(const int arg);
@@ -151,6 +176,12 @@ protected:
   //! Scanner geometry, you can skip future checks.
   bool skip_balanced_subsets;
 
+  //! \see set_merge_identical_events()
+  bool merge_identical_events;
+
+  //! \see set_randomise_event_subsets()
+  bool randomise_event_subsets;
+
 private:
   //! Cache of the current "batch" in the listmode file
   /*! \todo Move this higher-up in the hierarchy as it doesn't depend on ProjMatrixByBin
@@ -167,6 +198,19 @@ private:
    */
   bool load_listmode_batch(unsigned int ibatch) const;
 
+  //! Sort the events in \c record_cache on subset number and fill in \c subset_event_offsets
+  /*!
+    \param[in] ibatch the batch number of the events in \c record_cache (used as seed for random subsets)
+  */
+  void partition_events_in_subsets(unsigned int ibatch) const;
+
+  //! Events of subset \c s in \c record_cache are in <tt>[subset_event_offsets[s], subset_event_offsets[s+1])</tt>
+  mutable std::vector<std::size_t> subset_event_offsets;
+  //! Number of the batch that is currently in \c record_cache, or -1 if none (or it is no longer valid)
+  mutable int batch_num_in_record_cache;
+  //! Value returned by load_listmode_batch() for the batch in \c record_cache
+  mutable bool batch_in_record_cache_is_last;
+
   //! This function reads the next "batch" of data from the listmode file.
   /*!
     This function keeps on reading from the current position in the list-mode data and stores
@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2003 - 2011-02-23, Hammersmith Imanet Ltd
-    Copyright (C) 2018, 2022, University College London
+    Copyright (C) 2018, 2022, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -224,6 +224,13 @@ public:
 protected:
   Succeeded set_up_before_sensitivity(shared_ptr<const TargetT> const& target_sptr) override;
 
+  //! Describes projection data info, projectors, normalisation, segment range and time frame
+  /*! The normalisation is described by its parameters and a hash of the content of the files
+      they refer to (i.e. values of keywords containing "filename", including the data file of
+      Interfile headers), such that overwriting these files (e.g. the attenuation image) is detected.
+  */
+  std::string get_sensitivity_cache_description(const TargetT& target) const override;
+
   double actual_compute_objective_function_without_penalty(const TargetT& current_estimate, const int subset_num) override;
 
   /*!
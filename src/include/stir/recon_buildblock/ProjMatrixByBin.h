@@ -16,7 +16,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000-2009, Hammersmith Imanet Ltd
-    Copyright (C) 2013, 2015, 2022 University College London
+    Copyright (C) 2013, 2015, 2022, 2026 University College London
     Copyright (C) 2016, University of Hull
 
     This file is part of STIR.
@@ -194,6 +194,10 @@ protected:
   //! The method to store data in the cache.
   void cache_proj_matrix_elems_for_one_bin(const ProjMatrixElemsForOneBin&) const;
 
+  //! Remove all elements for one view from the cache
+  /*! This can be called while other threads access the cache for other views. */
+  void clear_cache_for_view(const int view_num) const;
+
 private:
   typedef std::uint64_t CacheKey;
   //! \name bit-field sizes for the cache key
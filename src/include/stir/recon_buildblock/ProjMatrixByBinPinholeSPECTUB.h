@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2022, Matthew Strugari
-    Copyright (C) 2021, University College London
+    Copyright (C) 2021, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -23,6 +23,10 @@
 
 // system libraries
 #include <iostream>
+#include <vector>
+#include <list>
+#include <mutex>
+#include <condition_variable>
 
 // user defined libraries
 #include "stir/RegisteredParsingObject.h"
@@ -31,6 +35,7 @@
 #include "stir/CartesianCoordinate3D.h"
 #include "stir/IndexRange.h"
 #include "stir/shared_ptr.h"
+#include "stir/recon_buildblock/ProjMatrixFileCache.h"
 #include "stir/recon_buildblock/PinholeSPECTUB_Tools.h"
 
 START_NAMESPACE_STIR
@@ -70,6 +75,10 @@ class Bin;
         mask from attenuation map := 0
 
         keep all views in cache := 0
+        ; maximum number of views kept in memory if the above is 0 (defaults to the number of threads)
+        ; maximum number of views in cache := 0
+        ; if set, the matrix is stored in (and reused from) files in this directory (default: empty, i.e. not used)
+        ; matrix cache directory :=
 
     End Projection Matrix By Bin Pinhole SPECT UB Parameters:=
 \endverbatim
@@ -201,6 +210,28 @@ public:
   bool get_keep_all_views_in_cache() const;
   void set_keep_all_views_in_cache(bool value = false);
 
+  //! Maximum number of views kept in memory when not keeping all views in the cache
+  /*! Views are computed when they are needed (in parallel for different views when using OpenMP).
+      When the number of views exceeds this maximum, the view that was computed first is removed from the
+      cache (i.e. first in, first out), as accesses to views that are already in the cache are handled by
+      ProjMatrixByBin and are not tracked.
+
+      If \a value is zero (the default), the number of threads at set_up() is used.
+  */
+  int get_maximum_number_of_views_in_cache() const;
+  void set_maximum_number_of_views_in_cache(const int value);
+
+  //! Directory where the matrix is stored in files
+  /*! The matrix elements for every view are written to a file in a subdirectory of \a value, whose name
+      depends on all parameters that determine the matrix (including the contents of the detector and collimator files,
+      and the attenuation and mask images). A later set_up() with the same parameters (also in another process)
+      will read the files instead of computing the matrix again. See ProjMatrixFileCache.
+
+      Empty (the default) disables this.
+  */
+  std::string get_matrix_cache_directory() const;
+  void set_matrix_cache_directory(const std::string& value);
+
   ProjMatrixByBinPinholeSPECTUB* clone() const override;
 
 private:
@@ -220,7 +251,9 @@ private:
   float object_radius;
   std::string mask_file;
   bool mask_from_attenuation_map;
-  bool keep_all_views_in_cache; //!< if set to false, only a single view is kept in memory
+  bool keep_all_views_in_cache; //!< if set to false, only a limited number of views is kept in memory
+  int maximum_number_of_views_in_cache; //!< used when \c keep_all_views_in_cache is false (0 means number of threads)
+  std::string matrix_cache_directory;   //!< if not empty, files in this directory are used to store the matrix
 
   // explicitly list necessary members for image details (should use an Info object instead)
   CartesianCoordinate3D<float> voxel_size;
@@ -257,15 +290,44 @@ private:
   SPECTUB_mph::prj_mph_type prj; //!< structure with projection information
   SPECTUB_mph::bin_type bin;     //!< structure with bin information
 
-  // mutable to allow compute_one_subset() const function to change the fields
+  // note: compute_one_subset() only uses the sizes of these, as every thread uses its own copy
   mutable SPECTUB_mph::psf2d_type psf_bin;  // structure for total psf distribution in bins (bidimensional)
   mutable SPECTUB_mph::psf2d_type psf_subs; // structure for total psf distribution: mid resolution (bidimensional)
   mutable SPECTUB_mph::psf2d_type
       psf_aux; // structure for total psf distribution: mid resolution auxiliar for convolution (bidimensional)
   mutable SPECTUB_mph::psf2d_type kern; // structure for intrinsic psf distribution: mid resolution (bidimensional)
 
-  void compute_one_subset(const int kOS) const;
+  //! compute the elements for all bins in a subset (i.e. view) and store them in the cache
+  /*! Uses a local copy of \c wm, such that different views can be computed in parallel.
+      The elements for the bin of \a lor are returned in \a lor.
+   */
+  void compute_one_subset(const int kOS, ProjMatrixElemsForOneBin& lor) const;
+
+  //! files with the matrix elements for each view
+  ProjMatrixFileCache file_cache;
+  //! description of all parameters determining the matrix, used for \c file_cache
+  std::string get_matrix_description() const;
+  //! flags if \c Nitems has been computed for a subset (char as std::vector<bool> is not thread-safe)
+  mutable std::vector<char> size_estimated;
+  //! estimate the number of elements in each row for a subset, i.e. fill \c Nitems[kOS]
+  void estimate_size_of_subset(const int kOS) const;
   void delete_PinholeSPECTUB_arrays();
+
+  //! \name variables keeping track of which subsets are in the cache
+  //@{
+  enum class SubsetState
+  {
+    not_computed,
+    computing,
+    computed
+  };
+  mutable std::vector<SubsetState> subset_states;
+  //! subsets in the cache, most recently computed first
+  mutable std::list<int> subsets_in_cache;
+  mutable std::mutex subsets_mutex;
+  mutable std::condition_variable subset_computed_condition;
+  int num_subsets_to_keep;
+  //@}
 };
 
 END_NAMESPACE_STIR
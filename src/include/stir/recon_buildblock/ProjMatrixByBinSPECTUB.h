@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2013, Institute for Bioengineering of Catalonia
-    Copyright (C) 2013, University College London
+    Copyright (C) 2013, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -25,7 +25,12 @@
 #include "stir/CartesianCoordinate3D.h"
 #include "stir/IndexRange.h"
 #include "stir/shared_ptr.h"
+#include "stir/recon_buildblock/ProjMatrixFileCache.h"
 #include <iostream>
+#include <vector>
+#include <list>
+#include <mutex>
+#include <condition_variable>
 
 #include "stir/recon_buildblock/SPECTUB_Tools.h"
 
@@ -69,8 +74,12 @@ http://dx.doi.org/10.1118/1.4816676
     mask type := Explicit Mask
     mask file := mask.hv
 
-    ; if next variable is set to 0, only a single view is kept in memory
+    ; if next variable is set to 0, only a limited number of views is kept in memory
    keep all views in cache:=1
+    ; maximum number of views kept in memory if the above is 0 (defaults to the number of threads)
+   ; maximum number of views in cache:=0
+    ; if set, the matrix is stored in (and reused from) files in this directory (default: empty, i.e. not used)
+   ; matrix cache directory:=
 
 End Projection Matrix By Bin SPECT UB Parameters:=
 \endverbatim
@@ -104,6 +113,36 @@ public:
     You have to call set_up() after this (unless the value didn't change).
   */
   void set_keep_all_views_in_cache(bool value = true);
+  int get_maximum_number_of_views_in_cache() const;
+  //! Set the maximum number of views kept in memory when not keeping all views in the cache
+  /*!
+    Views are computed when they are needed (in parallel for different views when using OpenMP).
+    When the number of views exceeds this maximum, the view that was computed first is removed from the
+    cache (i.e. first in, first out). Note that this is not "least recently used", as bins of views that
+    are already in the cache are found by ProjMatrixByBin without calling this class (and therefore without
+    locking), such that these accesses are not tracked. Accessing the views in the order of the subsets
+    (as iterative reconstructions do) therefore works well.
+
+    If \a value is zero (the default), the number of threads at set_up() is used.
+
+    You have to call set_up() after this (unless the value didn't change).
+  */
+  void set_maximum_number_of_views_in_cache(const int value);
+  //! Get the number of views currently in the cache
+  int get_num_views_in_cache() const;
+  std::string get_matrix_cache_directory() const;
+  //! Set a directory where the matrix is stored in files
+  /*!
+    The matrix elements for every view are written to a file in a subdirectory of \a value, whose name
+    depends on all parameters that determine the matrix (including the contents of the attenuation and mask images).
+    A later set_up() with the same parameters (also in another process) will read the files instead of
+    computing the matrix again. See ProjMatrixFileCache.
+
+    Empty (the default) disables this.
+
+    You have to call set_up() after this (unless the value didn't change).
+  */
+  void set_matrix_cache_directory(const std::string& value);
   std::string get_attenuation_type() const;
   //! Set type of attenuation modelling
   /*! Has to be "no", "simple" or "full"
@@ -157,7 +196,9 @@ private:
   std::string attenuation_map;
   std::string mask_type;
   std::string mask_file;
-  bool keep_all_views_in_cache; //!< if set to false, only a single view is kept in memory
+  bool keep_all_views_in_cache; //!< if set to false, only a limited number of views is kept in memory
+  int maximum_number_of_views_in_cache; //!< used when \c keep_all_views_in_cache is false (0 means number of threads)
+  std::string matrix_cache_directory;   //!< if not empty, files in this directory are used to store the matrix
 
   // explicitly list necessary members for image details (should use an Info object instead)
   CartesianCoordinate3D<float> voxel_size;
@@ -202,9 +243,37 @@ private:
 
   int maxszb;
 
-  void compute_one_subset(const int kOS, const float* Rrad) const;
+  //! files with the matrix elements for each view
+  ProjMatrixFileCache file_cache;
+  //! description of all parameters determining the matrix, used for \c file_cache
+  std::string get_matrix_description() const;
+  //! flags if \c NITEMS has been computed for a subset (char as std::vector<bool> is not thread-safe)
+  mutable std::vector<char> size_estimated;
+  //! estimate the number of elements in each row for a subset, i.e. fill \c NITEMS[kOS]
+  void estimate_size_of_subset(const int kOS) const;
+
+  //! compute the elements for all bins in a subset (i.e. view) and store them in the cache
+  /*! Uses local copies of \c wm and \c wmh, such that different views can be computed in parallel.
+      The elements for the bin of \a lor are returned in \a lor.
+   */
+  void compute_one_subset(const int kOS, const float* Rrad, ProjMatrixElemsForOneBin& lor) const;
   void delete_UB_SPECT_arrays();
-  mutable std::vector<bool> subset_already_processed;
+
+  //! \name variables keeping track of which subsets are in the cache
+  //@{
+  enum class SubsetState
+  {
+    not_computed,
+    computing,
+    computed
+  };
+  mutable std::vector<SubsetState> subset_states;
+  //! subsets in the cache, most recently computed first
+  mutable std::list<int> subsets_in_cache;
+  mutable std::mutex subsets_mutex;
+  mutable std::condition_variable subset_computed_condition;
+  int num_subsets_to_keep;
+  //@}
 };
 
 END_NAMESPACE_STIR
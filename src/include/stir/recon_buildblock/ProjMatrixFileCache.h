@@ -0,0 +1,93 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Declaration of class stir::ProjMatrixFileCache
+
+  \author Kris Thielemans
+*/
+#ifndef __stir_recon_buildblock_ProjMatrixFileCache_H__
+#define __stir_recon_buildblock_ProjMatrixFileCache_H__
+
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+START_NAMESPACE_STIR
+
+class Succeeded;
+
+/*!
+  \ingroup projection
+  \brief An on-disk store of projection matrix elements, organised per view
+
+  Some projection matrices (e.g. stir::ProjMatrixByBinSPECTUB) are expensive to compute, but are
+  identical for many reconstructions. This class allows storing the elements for all bins of a view
+  in a file, such that they can be reused by later reconstructions (or other processes running in parallel).
+
+  The files are stored in a subdirectory of the cache directory, whose name is constructed from
+  \a matrix_name and a hash of \a matrix_description (see set_up()). The description therefore
+  needs to contain all parameters that determine the matrix. It is also written to the file
+  \c parameters.txt in that subdirectory, and checked when using an existing subdirectory, such that
+  hash collisions are detected.
+
+  Files for a view are first written to a temporary file, which is then renamed. Other processes
+  will therefore never read a partially written file. Files are read via memory-mapping, but the
+  elements are copied into stir::ProjMatrixElemsForOneBin objects, such that every process holds its
+  own copy of the views it uses (only the operating system's file cache is shared).
+
+  The file format is a simple binary format in native byte order (a file written on a machine
+  with another byte order is ignored). It is not intended for archiving.
+*/
+class ProjMatrixFileCache
+{
+public:
+  //! Default constructor (disables the cache)
+  ProjMatrixFileCache();
+
+  //! Set the directory and the description of the matrix
+  /*! If \a cache_directory is empty, the cache is disabled. Otherwise, the subdirectory for this
+      matrix is created if it does not exist yet. If this fails, or the subdirectory was created for
+      a different description, a warning is written and the cache is disabled.
+  */
+  void set_up(const std::string& cache_directory, const std::string& matrix_name, const std::string& matrix_description);
+
+  //! Check if files will be read/written
+  bool is_enabled() const { return !directory.empty(); }
+
+  //! Get the directory where files are stored (empty if disabled)
+  const std::string& get_directory() const { return directory; }
+
+  //! Check if the file for a view exists
+  bool has_view(const int view_num, const int segment_num = 0) const;
+
+  //! Read the elements for all bins in a view from file
+  /*! \return Succeeded::no if the cache is disabled, the file does not exist or is corrupt, in which case
+      \a lors is not modified.
+  */
+  Succeeded read_view(std::vector<ProjMatrixElemsForOneBin>& lors, const int view_num, const int segment_num = 0) const;
+
+  //! Write the elements for all bins in a view to file
+  /*! An existing file is replaced. Failures to write result in a warning.
+   */
+  Succeeded write_view(const std::vector<ProjMatrixElemsForOneBin>& lors, const int view_num, const int segment_num = 0) const;
+
+private:
+  std::string directory;
+
+  std::string get_filename(const int view_num, const int segment_num) const;
+};
+
+END_NAMESPACE_STIR
+
+#endif
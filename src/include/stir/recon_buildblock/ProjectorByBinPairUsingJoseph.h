@@ -0,0 +1,56 @@
+//
+//
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Declares class stir::ProjectorByBinPairUsingJoseph
+
+  \author Kris Thielemans
+*/
+#ifndef __stir_recon_buildblock_ProjectorByBinPairUsingJoseph_h_
+#define __stir_recon_buildblock_ProjectorByBinPairUsingJoseph_h_
+
+#include "stir/RegisteredParsingObject.h"
+#include "stir/recon_buildblock/ProjectorByBinPair.h"
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup projection
+  \brief A projector pair using ForwardProjectorByBinUsingJoseph and BackProjectorByBinUsingJoseph
+
+  \par Parsing details
+  \verbatim
+  Projector Pair Using Joseph Parameters:=
+  End Projector Pair Using Joseph Parameters:=
+  \endverbatim
+*/
+class ProjectorByBinPairUsingJoseph
+    : public RegisteredParsingObject<ProjectorByBinPairUsingJoseph, ProjectorByBinPair, ProjectorByBinPair>
+{
+private:
+  typedef RegisteredParsingObject<ProjectorByBinPairUsingJoseph, ProjectorByBinPair, ProjectorByBinPair> base_type;
+
+public:
+  //! Name which will be used when parsing a ProjectorByBinPair object
+  static const char* const registered_name;
+
+  //! Default constructor
+  ProjectorByBinPairUsingJoseph();
+
+private:
+  void initialise_keymap() override;
+};
+
+END_NAMESPACE_STIR
+
+#endif // __stir_recon_buildblock_ProjectorByBinPairUsingJoseph_h_
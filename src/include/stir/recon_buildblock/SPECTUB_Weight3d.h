@@ -1,6 +1,6 @@
 /*
    Copyright (c) 2013, Biomedical Image Group (GIB), Universitat de Barcelona, Barcelona, Spain.
-   Copyright (c) 2013, University College London
+   Copyright (c) 2013, 2026, University College London
    This file is part of STIR.
 
    SPDX-License-Identifier: Apache-2.0
@@ -28,6 +28,13 @@
 namespace SPECTUB
 {
 
+//! compute the weights for the angles in \c wmh.index
+/*! Image rows are distributed over OpenMP threads (if enabled). The weights are stored in \a wm
+    in the same order as for a sequential calculation. \a wm.val and \a wm.col need to be allocated
+    with \a NITEMS elements for every row, and \a wm.ne needs to be initialised to 0.
+
+    The image indices for STIR (\a wm.nx etc) are not filled in by this function.
+*/
 void wm_calculation(const int kOS,
                     const SPECTUB::angle_type* const ang,
                     SPECTUB::voxel_type vox,
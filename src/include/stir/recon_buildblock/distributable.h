@@ -204,6 +204,27 @@ void LM_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
                                   double* double_out_ptr,
                                   CallBackT&& call_back);
 
+/*!
+  \brief This function essentially implements a loop over a range of events in a cached listmode file
+  \ingroup distributable
+
+  As LM_distributable_computation(), but only the events with index in <tt>[first_event, end_event)</tt> are
+  processed, without checking subset membership. This is useful if \c record_cache has been partitioned
+  into (contiguous) subsets, as a subset then only needs to visit its own events.
+!*/
+template <typename CallBackT>
+void LM_distributable_computation_for_events(const shared_ptr<ProjMatrixByBin> PM_sptr,
+                                             const shared_ptr<ProjDataInfo>& proj_data_info_sptr,
+                                             DiscretisedDensity<3, float>* output_image_ptr,
+                                             const DiscretisedDensity<3, float>* input_image_ptr,
+                                             const std::vector<BinAndCorr>& record_cache,
+                                             const std::size_t first_event,
+                                             const std::size_t end_event,
+                                             const bool has_add,
+                                             const bool accumulate,
+                                             double* double_out_ptr,
+                                             CallBackT&& call_back);
+
 /*! \name Tag-names currently used by stir::distributable_computation and related functions
    \ingroup distributable
 */
@@ -1,5 +1,5 @@
 /*
-    Copyright (C) 2024 University College London
+    Copyright (C) 2024, 2026 University College London
     Copyright (C) 2020, 2022, Univeristy of Pennsylvania
     This file is part of STIR.
 
@@ -31,22 +31,27 @@
 #include "stir/Bin.h"
 
 #include "stir/num_threads.h"
+#include <utility>
 
 START_NAMESPACE_STIR
 
+namespace detail
+{
+//! loop over events in [first_event, end_event), skipping those that are not in the subset (if num_subsets > 1)
 template <typename CallBackT>
 void
-LM_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
-                             const shared_ptr<ProjDataInfo>& proj_data_info_sptr,
-                             DiscretisedDensity<3, float>* output_image_ptr,
-                             const DiscretisedDensity<3, float>* input_image_ptr,
-                             const std::vector<BinAndCorr>& record_ptr,
-                             const int subset_num,
-                             const int num_subsets,
-                             const bool has_add,
-                             const bool accumulate,
-                             double* double_out_ptr,
-                             CallBackT&& call_back)
+LM_distributable_computation_core(const shared_ptr<ProjMatrixByBin> PM_sptr,
+                                  DiscretisedDensity<3, float>* output_image_ptr,
+                                  const DiscretisedDensity<3, float>* input_image_ptr,
+                                  const std::vector<BinAndCorr>& record_ptr,
+                                  const std::size_t first_event,
+                                  const std::size_t end_event,
+                                  const int subset_num,
+                                  const int num_subsets,
+                                  const bool has_add,
+                                  const bool accumulate,
+                                  double* double_out_ptr,
+                                  CallBackT&& call_back)
 {
 
   CPUTimer CPU_timer;
@@ -54,7 +59,8 @@ LM_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
   HighResWallClockTimer wall_clock_timer;
   wall_clock_timer.start();
 
-  assert(!record_ptr.empty());
+  assert(first_event <= end_event);
+  assert(end_event <= record_ptr.size());
 
   if (output_image_ptr != NULL && !accumulate)
     output_image_ptr->fill(0.F);
@@ -98,7 +104,7 @@ LM_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
     }
 #endif
     // note: VC uses OpenMP 2.0, so need signed integer for loop
-    for (long int ievent = 0; ievent < static_cast<long>(record_ptr.size()); ++ievent)
+    for (long int ievent = static_cast<long>(first_event); ievent < static_cast<long>(end_event); ++ievent)
       {
         auto& record = record_ptr.at(ievent);
         if (record.my_bin.get_bin_value() == 0.0f) // shouldn't happen really, but a check probably doesn't hurt
@@ -139,9 +145,9 @@ LM_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
                   local_double_out_ptrs[thread_num]);
       }
   }
-#ifdef STIR_OPENMP
   // flatten data constructed by threads
   {
+#ifdef STIR_OPENMP
     if (double_out_ptr != NULL)
       {
         for (int i = 0; i < static_cast<int>(local_double_outs.size()); ++i)
@@ -149,7 +155,9 @@ LM_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
       }
     // count += std::accumulate(local_counts.begin(), local_counts.end(), 0);
     // count2 += std::accumulate(local_count2s.begin(), local_count2s.end(), 0);
+#endif
 
+    // note: also needed without OpenMP, as the call-back writes into a local image
     if (output_image_ptr != NULL)
       {
         for (int i = 0; i < static_cast<int>(local_output_image_sptrs.size()); ++i)
@@ -157,11 +165,68 @@ LM_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
             *output_image_ptr += *(local_output_image_sptrs[i]);
       }
   }
-#endif
   CPU_timer.stop();
   wall_clock_timer.stop();
   info(boost::format("Computation times for distributable_computation, CPU %1%s, wall-clock %2%s") % CPU_timer.value()
        % wall_clock_timer.value());
 }
+} // namespace detail
+
+template <typename CallBackT>
+void
+LM_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
+                             const shared_ptr<ProjDataInfo>& proj_data_info_sptr,
+                             DiscretisedDensity<3, float>* output_image_ptr,
+                             const DiscretisedDensity<3, float>* input_image_ptr,
+                             const std::vector<BinAndCorr>& record_ptr,
+                             const int subset_num,
+                             const int num_subsets,
+                             const bool has_add,
+                             const bool accumulate,
+                             double* double_out_ptr,
+                             CallBackT&& call_back)
+{
+  assert(!record_ptr.empty());
+  detail::LM_distributable_computation_core(PM_sptr,
+                                            output_image_ptr,
+                                            input_image_ptr,
+                                            record_ptr,
+                                            0,
+                                            record_ptr.size(),
+                                            subset_num,
+                                            num_subsets,
+                                            has_add,
+                                            accumulate,
+                                            double_out_ptr,
+                                            std::forward<CallBackT>(call_back));
+}
+
+template <typename CallBackT>
+void
+LM_distributable_computation_for_events(const shared_ptr<ProjMatrixByBin> PM_sptr,
+                                        const shared_ptr<ProjDataInfo>& proj_data_info_sptr,
+                                        DiscretisedDensity<3, float>* output_image_ptr,
+                                        const DiscretisedDensity<3, float>* input_image_ptr,
+                                        const std::vector<BinAndCorr>& record_cache,
+                                        const std::size_t first_event,
+                                        const std::size_t end_event,
+                                        const bool has_add,
+                                        const bool accumulate,
+                                        double* double_out_ptr,
+                                        CallBackT&& call_back)
+{
+  detail::LM_distributable_computation_core(PM_sptr,
+                                            output_image_ptr,
+                                            input_image_ptr,
+                                            record_cache,
+                                            first_event,
+                                            end_event,
+                                            /* subset_num = */ 0,
+                                            /* num_subsets = */ 1,
+                                            has_add,
+                                            accumulate,
+                                            double_out_ptr,
+                                            std::forward<CallBackT>(call_back));
+}
 
 END_NAMESPACE_STIR
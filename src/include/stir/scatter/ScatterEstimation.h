@@ -4,7 +4,7 @@
 
 /*
     Copyright (C) 2018 - 2019 University of Hull
-    Copyright (C) 2016,2020 University College London
+    Copyright (C) 2016,2020, 2026 University College London
     Copyright (C) 2022 National Physical Laboratory
 
     This file is part of STIR.
@@ -192,6 +192,15 @@ public:
   void set_restart_reconstruction_every_scatter_iteration(bool setting);
   bool get_restart_reconstruction_every_scatter_iteration() const;
 
+  //! Set the threshold for stopping the scatter iterations early
+  /*! After every iteration, the relative change of the (scaled) scatter estimate compared to the previous iteration
+      is computed as the L2-norm of the difference divided by the L2-norm of the new estimate. If this is smaller than
+      the threshold, the iterations stop (after finishing the current one, including saving the estimates).
+      A value of 0 (the default) disables this check, such that all iterations are performed.
+  */
+  void set_scatter_convergence_threshold(float threshold);
+  float get_scatter_convergence_threshold() const;
+
   //! Set the zoom factor in the XY plane for the downsampling of the activity and attenuation image.
   // inline void set_zoom_xy(float);
   //! Set the zoom factor in the Z axis for the downsampling of the activity and attenuation image.
@@ -228,6 +237,8 @@ protected:
   //! each iteration of the scatter estimation. Therefore, more
   //! reconstruction subiterations will be required for convergence.
   bool restart_reconstruction_every_scatter_iteration;
+  //! Threshold on the relative change of the scatter estimate for stopping iterations, see set_scatter_convergence_threshold()
+  float scatter_convergence_threshold;
 
   //! This is the reconstruction object which is going to be used for the scatter estimation
   //! and the calculation of the initial activity image (if recompute set). It can be defined in the same
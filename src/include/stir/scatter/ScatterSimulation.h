@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2018 - 2019 University of Hull
     Copyright (C) 2004 - 2009 Hammersmith Imanet Ltd
-    Copyright (C) 2013 - 2016, 2019, 2020, 2022 University College London
+    Copyright (C) 2013 - 2016, 2019, 2020, 2022, 2026 University College London
     Copyright (C) 2022, National Physical Laboratory
     This file is part of STIR.
 
@@ -240,6 +240,19 @@ public:
   //! Return if line integrals are cached or not
   bool get_use_cache() const;
 
+  //! Set the tolerance for keeping cached integrals over the activity image
+  /*! By default (a tolerance of 0), all cached integrals over the activity image are removed when
+      a new activity image is set. When the tolerance is positive (and the cache is used), set_up() will
+      instead check for every scatter point if the integrals to a sample of detectors changed by more
+      than this (relative) tolerance. Only the integrals for those scatter points are then recomputed.
+      This is useful when the activity image is updated in small steps, as in ScatterEstimation.
+
+      \warning The integrals are only checked after calling set_activity_image_sptr() (followed by set_up()),
+      also when the activity image was modified in place.
+  */
+  void set_activity_integrals_tolerance(const float);
+  float get_activity_integrals_tolerance() const;
+
 protected:
   //! computes scatter for one viewgram
   /*! \return total scatter estimated for this viewgram */
@@ -359,6 +372,9 @@ protected:
       call remove_cache_for_scattpoint_det_integrals_over_activity() first.
   */
   void initialise_cache_for_scattpoint_det_integrals_over_activity();
+  //! remove cached activity integrals for those scatter points where they changed too much
+  /*! See set_activity_integrals_tolerance(). */
+  void update_cache_for_integrals_over_activity();
 
   //! Output proj_data fileanme prefix
   std::string output_proj_data_filename;
@@ -375,6 +391,8 @@ protected:
       of memory, you can switch this off, but performance will suffer dramatically.
   */
   bool use_cache;
+  //! relative tolerance for keeping cached activity integrals, see set_activity_integrals_tolerance()
+  float activity_integrals_tolerance;
   //! Filename for the initial activity estimate.
   std::string activity_image_filename;
   //! Zoom factor on plane XY. Defaults on 1.f.
@@ -398,6 +416,8 @@ private:
 
   Array<2, float> cached_activity_integral_scattpoint_det;
   Array<2, float> cached_attenuation_integral_scattpoint_det;
+  //! set when a new activity image was set, and the cached activity integrals need to be checked in set_up()
+  bool check_cached_activity_integrals;
   shared_ptr<DiscretisedDensity<3, float>> density_image_for_scatter_points_sptr;
 
   // numbers that we don't want to recompute all the time
@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2007, Hammersmith Imanet Ltd
-    Copyright (C) 2018-2019, University College London
+    Copyright (C) 2018-2019, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -25,7 +25,8 @@
 
   These functions can be used for zooming of projection data or image data.
   Zooming requires interpolation. Currently, this is done using
-  stir::overlap_interpolate.
+  'overlap' interpolation, as in stir::overlap_interpolate. The interpolation weights
+  are computed once for every axis, and images are processed in parallel over planes when OpenMP is enabled.
 
   The first set of functions allows zooming and translation in transaxial
   planes only. These parameters are the same for projection data or image data.
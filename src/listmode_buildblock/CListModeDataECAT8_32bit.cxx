@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2003-2012 Hammersmith Imanet Ltd
-    Copyright (C) 2013-2014 University College London
+    Copyright (C) 2013-2014, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -91,6 +91,13 @@ CListModeDataECAT8_32bit::get_next_record(CListRecord& record_of_general_type) c
   return current_lm_data_ptr->get_next_record(record);
 }
 
+std::size_t
+CListModeDataECAT8_32bit::get_next_records(const shared_ptr<ListRecord>* const records, const std::size_t max_num_records) const
+{
+  return current_lm_data_ptr->get_next_records(
+      [records](const std::size_t i) -> CListRecordT& { return static_cast<CListRecordT&>(*records[i]); }, max_num_records);
+}
+
 Succeeded
 CListModeDataECAT8_32bit::reset()
 {
@@ -1,5 +1,5 @@
 /*
-    Copyright (C) 2013-2020 University College London
+    Copyright (C) 2013-2020, 2026 University College London
     Copyright (C) 2017-2018 University of Hull
     Copyright (C) 2017-2019 University of Leeds
 
@@ -102,6 +102,13 @@ CListModeDataGEHDF5::get_next_record(CListRecord& record_of_general_type) const
   return current_lm_data_ptr->get_next_record(record);
 }
 
+std::size_t
+CListModeDataGEHDF5::get_next_records(const shared_ptr<ListRecord>* const records, const std::size_t max_num_records) const
+{
+  return current_lm_data_ptr->get_next_records(
+      [records](const std::size_t i) -> CListRecordT& { return static_cast<CListRecordT&>(*records[i]); }, max_num_records);
+}
+
 Succeeded
 CListModeDataGEHDF5::reset()
 {
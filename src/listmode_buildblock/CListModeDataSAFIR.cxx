@@ -4,7 +4,7 @@ Coincidence LM Data Class for SAFIR: Implementation
 
         Copyright 2015 ETH Zurich, Institute of Particle Physics
         Copyright 2020 Positrigo AG, Zurich
-    Copyright 2021 University College London
+    Copyright 2021, 2026 University College London
 
         Licensed under the Apache License, Version 2.0 (the "License");
         you may not use this file except in compliance with the License.
@@ -122,6 +122,15 @@ CListModeDataSAFIR<CListRecordT>::get_next_record(CListRecord& record_of_general
   return status;
 }
 
+template <class CListRecordT>
+std::size_t
+CListModeDataSAFIR<CListRecordT>::get_next_records(const shared_ptr<ListRecord>* const records,
+                                                   const std::size_t max_num_records) const
+{
+  return current_lm_data_ptr->get_next_records(
+      [records](const std::size_t i) -> CListRecordT& { return static_cast<CListRecordT&>(*records[i]); }, max_num_records);
+}
+
 template <class CListRecordT>
 Succeeded
 CListModeDataSAFIR<CListRecordT>::reset()
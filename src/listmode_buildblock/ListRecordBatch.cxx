@@ -0,0 +1,103 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup listmode
+  \brief Implementation of class stir::ListRecordBatch
+
+  \author Kris Thielemans
+*/
+
+#include "stir/listmode/ListRecordBatch.h"
+#include "stir/listmode/ListModeData.h"
+#include "stir/listmode/ListRecord.h"
+#include "stir/Succeeded.h"
+#include "stir/error.h"
+#include <algorithm>
+
+START_NAMESPACE_STIR
+
+ListRecordBatch::ListRecordBatch(const ListModeData& lm_data, const std::size_t max_num_events)
+    : num_events(0),
+      first_pending_record(0),
+      num_pending_records(0),
+      pending_record_has_time(false)
+{
+  if (max_num_events == 0)
+    error("ListRecordBatch: maximum number of events has to be larger than 0");
+  records.resize(max_num_events);
+  for (auto& record_sptr : records)
+    record_sptr = lm_data.get_empty_record_sptr();
+  times.resize(max_num_events);
+}
+
+Succeeded
+ListRecordBatch::read(ListModeData& lm_data, double& current_time, const double end_time, const std::size_t max_num_events)
+{
+  const std::size_t max_num_events_to_read = std::min(max_num_events, records.size());
+  if (max_num_events_to_read == 0)
+    error("ListRecordBatch::read: maximum number of events has to be larger than 0");
+  num_events = 0;
+  // move records that were read in the previous call, but not processed, to the start
+  for (std::size_t i = 0; i < num_pending_records; ++i)
+    std::swap(records[i], records[first_pending_record + i]);
+  first_pending_record = 0;
+
+  while (num_events < max_num_events_to_read)
+    {
+      if (num_pending_records == 0)
+        {
+          // Read all remaining records in one go. As every record is either an event or a time record,
+          // this never reads more events than requested.
+          first_pending_record = num_events;
+          num_pending_records = lm_data.get_next_records(&records[num_events], max_num_events_to_read - num_events);
+          if (num_pending_records == 0)
+            return Succeeded::no;
+        }
+      ListRecord& record = *records[first_pending_record];
+      double event_time = current_time;
+      if (pending_record_has_time)
+        {
+          // an event that was read (with its time) in the previous call, but was after the end_time then
+          event_time = pending_record_time;
+          pending_record_has_time = false;
+        }
+      else if (record.is_time())
+        {
+          current_time = record.time().get_time_in_secs();
+          if (current_time >= end_time)
+            {
+              // some formats store the time in every event, so we need to keep it for the next batch
+              if (record.is_event())
+                {
+                  pending_record_has_time = true;
+                  pending_record_time = current_time;
+                }
+              else
+                {
+                  ++first_pending_record;
+                  --num_pending_records;
+                }
+              break;
+            }
+          event_time = current_time;
+        }
+      if (record.is_event())
+        {
+          // this never overwrites a pending record, as first_pending_record >= num_events
+          std::swap(records[num_events], records[first_pending_record]);
+          times[num_events++] = event_time;
+        }
+      ++first_pending_record;
+      --num_pending_records;
+    }
+  return Succeeded::yes;
+}
+
+END_NAMESPACE_STIR
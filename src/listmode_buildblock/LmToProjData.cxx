@@ -11,7 +11,7 @@
 /*
     Copyright (C) 2000 - 2011-12-31, Hammersmith Imanet Ltd
     Copyright (C) 2017, University of Hull
-    Copyright (C) 2013, 2021 University College London
+    Copyright (C) 2013, 2021, 2026 University College London
     Copright (C) 2019, National Physical Laboratory
     This file is part of STIR.
 
@@ -59,6 +59,7 @@ typedef short elem_type;
 #include "stir/listmode/ListModeData.h"
 #include "stir/ExamInfo.h"
 #include "stir/ProjDataInfoCylindricalNoArcCorr.h"
+#include "stir/ProjDataSparse.h"
 
 #include "stir/Scanner.h"
 #ifdef USE_SegmentByView
@@ -227,6 +228,19 @@ LmToProjData::get_num_segments_in_memory() const
   return num_segments_in_memory;
 }
 
+void
+LmToProjData::set_store_sparse_histogram(bool v)
+{
+  this->_already_setup = false;
+  this->store_sparse_histogram = v;
+}
+
+bool
+LmToProjData::get_store_sparse_histogram() const
+{
+  return store_sparse_histogram;
+}
+
 void
 LmToProjData::set_num_events_to_store(long int v)
 {
@@ -263,6 +277,7 @@ LmToProjData::set_defaults()
   interactive = false;
   num_segments_in_memory = -1;
   num_timing_poss_in_memory = -1;
+  store_sparse_histogram = false;
   normalisation_ptr.reset(new TrivialBinNormalisation);
   post_normalisation_ptr.reset(new TrivialBinNormalisation);
   do_pre_normalisation = 0;
@@ -285,6 +300,7 @@ LmToProjData::initialise_keymap()
   parser.add_key("do pre normalisation ", &do_pre_normalisation);
   parser.add_key("num_TOF_bins_in_memory", &num_timing_poss_in_memory);
   parser.add_key("num_segments_in_memory", &num_segments_in_memory);
+  parser.add_key("store sparse histogram", &store_sparse_histogram);
 
   // if (lm_data_ptr->has_delayeds()) TODO we haven't read the ListModeData yet, so cannot access has_delayeds() yet
   //  one could add the next 2 keywords as part of a callback function for the 'input file' keyword.
@@ -368,7 +384,8 @@ LmToProjData::set_up()
     }
 
   const int num_segments = template_proj_data_info_ptr->get_num_segments();
-  if (num_segments_in_memory == -1 || interactive)
+  // a sparse histogram is small enough to process all data in a single pass
+  if (num_segments_in_memory == -1 || interactive || store_sparse_histogram)
     num_segments_in_memory = num_segments;
   else
     num_segments_in_memory = min(num_segments_in_memory, num_segments);
@@ -377,7 +394,7 @@ LmToProjData::set_up()
       error("LmToProjData: num_segments_in_memory cannot be 0");
     }
   const int num_timing_poss = template_proj_data_info_ptr->get_num_tof_poss();
-  if (num_timing_poss_in_memory == -1 || interactive)
+  if (num_timing_poss_in_memory == -1 || interactive || store_sparse_histogram)
     num_timing_poss_in_memory = num_timing_poss;
   else
     num_timing_poss_in_memory = min(num_timing_poss_in_memory, num_timing_poss);
@@ -666,14 +683,30 @@ LmToProjData::process_data()
 
       // *********** open output file
       shared_ptr<iostream> output;
+      string output_filename;
       if (!output_proj_data_sptr)
         {
           writing_to_file = true;
           char rest[50];
           sprintf(rest, "_f%dg1d0b0", current_frame_num);
-          const string output_filename = output_filename_prefix + rest;
+          output_filename = output_filename_prefix + rest;
 
-          output_proj_data_sptr = construct_proj_data(output, output_filename, this_frame_exam_info, template_proj_data_info_ptr);
+          if (store_sparse_histogram)
+            output_proj_data_sptr = std::make_shared<ProjDataSparse>(std::make_shared<ExamInfo>(this_frame_exam_info),
+                                                                     template_proj_data_info_ptr->create_shared_clone());
+          else
+            output_proj_data_sptr
+                = construct_proj_data(output, output_filename, this_frame_exam_info, template_proj_data_info_ptr);
+        }
+      // when storing a sparse histogram, events are added directly to the output
+      shared_ptr<ProjDataSparse> sparse_proj_data_sptr;
+      if (store_sparse_histogram)
+        {
+          sparse_proj_data_sptr = dynamic_pointer_cast<ProjDataSparse>(output_proj_data_sptr);
+          if (is_null_ptr(sparse_proj_data_sptr))
+            error("LmToProjData: when storing a sparse histogram, the output projection data has to be of type ProjDataSparse");
+          if (!writing_to_file)
+            sparse_proj_data_sptr->fill(0.F);
         }
 
       long num_prompts_in_frame = 0;
@@ -709,7 +742,7 @@ LmToProjData::process_data()
               const int end_segment_index
                   = min(output_proj_data_sptr->get_max_segment_num() + 1, start_segment_index + num_segments_in_memory) - 1;
 
-              if (!interactive)
+              if (!interactive && !store_sparse_histogram)
                 allocate_segments(segments,
                                   start_timing_pos_index,
                                   end_timing_pos_index,
@@ -841,6 +874,8 @@ LmToProjData::process_data()
                                           bin.tangential_pos_num(),
                                           current_time,
                                           event_increment);
+                                    else if (store_sparse_histogram)
+                                      sparse_proj_data_sptr->increment_bin_value(bin, bin.get_bin_value() * event_increment);
                                     else
                                       (*segments[bin.timing_pos_num()][bin.segment_num()])[bin.view_num()][bin.axial_pos_num()]
                                                                                           [bin.tangential_pos_num()]
@@ -865,7 +900,7 @@ LmToProjData::process_data()
                 time_of_last_stored_event = max(time_of_last_stored_event, current_time);
               }
 
-              if (!interactive)
+              if (!interactive && !store_sparse_histogram)
                 save_and_delete_segments(output,
                                          segments,
                                          start_timing_pos_index,
@@ -879,6 +914,13 @@ LmToProjData::process_data()
       cerr << "\nNumber of prompts stored in this time period : " << num_prompts_in_frame
            << "\nNumber of delayeds stored in this time period: " << num_delayeds_in_frame << '\n';
 
+      if (store_sparse_histogram)
+        {
+          cerr << "Number of non-zero bins stored in this time period: " << sparse_proj_data_sptr->get_num_stored_bins() << '\n';
+          if (writing_to_file && !interactive && sparse_proj_data_sptr->write_to_sparse_file(output_filename) == Succeeded::no)
+            error("LmToProjData: error writing sparse projection data " + output_filename);
+        }
+
       // if we used the member variable for writing to file, reset it to null again
       if (writing_to_file)
         {
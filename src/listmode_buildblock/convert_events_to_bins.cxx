@@ -0,0 +1,78 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup listmode
+  \brief Implementation of stir::convert_events_to_bins
+
+  \author Kris Thielemans
+*/
+
+#include "stir/listmode/convert_events_to_bins.h"
+#include "stir/listmode/ListRecordBatch.h"
+#include "stir/listmode/ListRecord.h"
+#include "stir/listmode/CListEventScannerWithDiscreteDetectors.h"
+#include "stir/ProjDataInfoCylindricalNoArcCorr.h"
+#include "stir/DetectionPositionPair.h"
+#include "stir/Succeeded.h"
+
+START_NAMESPACE_STIR
+
+namespace detail
+{
+//! Convert events to bins if all types match and get_bin() is not overridden, returns \c false otherwise
+/*! All records in a batch come from the same ListModeData, so we only check the first event. */
+template <class ProjDataInfoT>
+static bool
+convert_events_to_bins_for_discrete_detectors(std::vector<Bin>& bins,
+                                              const ListRecordBatch& batch,
+                                              const ProjDataInfo& proj_data_info)
+{
+  typedef CListEventScannerWithDiscreteDetectors<ProjDataInfoT> EventT;
+  const ProjDataInfoT* const proj_data_info_ptr = dynamic_cast<const ProjDataInfoT*>(&proj_data_info);
+  const EventT* const first_event_ptr = dynamic_cast<const EventT*>(&batch.get_record(0).event());
+  if (!proj_data_info_ptr || !first_event_ptr || !first_event_ptr->get_bin_uses_detection_position())
+    return false;
+
+  const long num_events = static_cast<long>(batch.size());
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(static)
+#endif
+  for (long i = 0; i < num_events; ++i)
+    {
+      const EventT& event = static_cast<const EventT&>(batch.get_record(i).event());
+      DetectionPositionPair<> det_pos;
+      event.get_detection_position(det_pos);
+      Bin& bin = bins[i];
+      bin.set_bin_value(proj_data_info_ptr->get_bin_for_det_pos_pair(bin, det_pos) == Succeeded::yes ? 1.F : 0.F);
+    }
+  return true;
+}
+} // namespace detail
+
+void
+convert_events_to_bins(std::vector<Bin>& bins, const ListRecordBatch& batch, const ProjDataInfo& proj_data_info)
+{
+  bins.resize(batch.size());
+  if (batch.size() == 0)
+    return;
+
+  if (detail::convert_events_to_bins_for_discrete_detectors<ProjDataInfoCylindricalNoArcCorr>(bins, batch, proj_data_info))
+    return;
+
+  // generic case: CListEvent::get_bin() might not be thread-safe for all event types, so use a serial loop
+  // Note that some implementations only set the bin value to 0 if the event is rejected.
+  for (std::size_t i = 0; i < batch.size(); ++i)
+    {
+      bins[i].set_bin_value(1.F);
+      batch.get_record(i).event().get_bin(bins[i], proj_data_info);
+    }
+}
+
+END_NAMESPACE_STIR
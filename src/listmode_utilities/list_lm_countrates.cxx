@@ -8,13 +8,15 @@
   \verbatim
   start_time_in_secs , end_time_in_secs , num_prompts , num_delayeds
   \endverbatim
+  Time intervals start at the first time record in the file. Events are read in batches
+  (see stir::ListRecordBatch) and counted in parallel when OpenMP is enabled.
 
   \author Kris Thielemans
   \author Daniel Deidda
 */
 /*
     Copyright (C) 2003- 2012, Hammersmith Imanet Ltd
-    Copyright (C) 2017, University College London
+    Copyright (C) 2017, 2026, University College London
     Copyright (C) 2019, National Physical Laboratory
     Copyright (C) 2019, University College of London
 
@@ -22,15 +24,22 @@
 */
 #include "stir/listmode/ListModeData.h"
 #include "stir/listmode/ListRecord.h"
+#include "stir/listmode/ListRecordBatch.h"
 #include "stir/shared_ptr.h"
 #include "stir/Succeeded.h"
 #include "stir/utilities.h"
 #include "stir/IO/read_from_file.h"
 #include "stir/warning.h"
+#include "stir/num_threads.h"
 #include <fstream>
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <vector>
+#include <algorithm>
+#ifdef STIR_OPENMP
+#  include <omp.h>
+#endif
 
 USING_NAMESPACE_STIR
 
@@ -56,46 +65,97 @@ main(int argc, char* argv[])
 
   const double interval = argc > 3 ? atof(argv[3]) : 1;
 
-  shared_ptr<ListRecord> record_sptr = lm_data_ptr->get_empty_record_sptr();
-  ListRecord& record = *record_sptr;
+  // find the time of the first timing event, all events before are ignored
+  double start_time = 0;
+  std::vector<unsigned long> num_prompts(1, 0UL);
+  std::vector<unsigned long> num_delayeds(1, 0UL);
+  {
+    shared_ptr<ListRecord> record_sptr = lm_data_ptr->get_empty_record_sptr();
+    ListRecord& record = *record_sptr;
+    while (true)
+      {
+        if (lm_data_ptr->get_next_record(record) == Succeeded::no)
+          return EXIT_SUCCESS; // no timing events
+        if (record.is_time())
+          {
+            start_time = record.time().get_time_in_secs();
+            // some formats store the time in every event
+            if (record.is_event())
+              ++(record.event().is_prompt() ? num_prompts : num_delayeds)[0];
+            break;
+          }
+      }
+  }
 
-  double current_time = 0;
-  bool first_timing_event_read = false;
-  unsigned long num_prompts = 0UL;
-  unsigned long num_delayeds = 0UL;
-  while (true)
+  // Read events in batches, and count them in parallel. Counts are stored per time interval, which are written once
+  // a timing event past their end has been seen.
+  // Interval n is [interval_boundaries[n], interval_boundaries[n+1]). As in previous versions of this utility,
+  // boundaries are found by adding the interval length, such that rounding is the same.
+  std::vector<double> interval_boundaries(1, start_time);
+  auto add_interval_boundaries_up_to = [&interval_boundaries, interval](const double time) {
+    while (interval_boundaries.back() <= time)
+      interval_boundaries.push_back(interval_boundaries.back() + interval);
+  };
+  // only valid after calling add_interval_boundaries_up_to(time)
+  auto get_interval_num = [&interval_boundaries](const double time) -> std::size_t {
+    return static_cast<std::size_t>(std::upper_bound(interval_boundaries.begin(), interval_boundaries.end(), time)
+                                    - interval_boundaries.begin())
+           - 1;
+  };
+  ListRecordBatch batch(*lm_data_ptr, 1000000);
+  double current_time = start_time;
+  std::size_t num_written_intervals = 0;
+  bool more_data = true;
+  while (more_data)
     {
-      if (lm_data_ptr->get_next_record(record) == Succeeded::no)
+      more_data = batch.read(*lm_data_ptr, current_time) == Succeeded::yes;
+      const long num_events = static_cast<long>(batch.size());
+      if (num_events > 0)
         {
-          // no more events in file for some reason
-          break; // get out of while loop
-        }
-      if (record.is_time())
-        {
-          const double new_time = record.time().get_time_in_secs();
-          if (!first_timing_event_read)
+          add_interval_boundaries_up_to(batch.get_time(num_events - 1));
+          const std::size_t last_interval_num = get_interval_num(batch.get_time(num_events - 1));
+          if (last_interval_num >= num_prompts.size())
             {
-              current_time = new_time;
-              num_prompts = 0UL;
-              num_delayeds = 0UL;
-              first_timing_event_read = true;
+              num_prompts.resize(last_interval_num + 1, 0UL);
+              num_delayeds.resize(last_interval_num + 1, 0UL);
             }
-          else if (new_time >= current_time + interval)
+          const std::size_t first_interval_num = get_interval_num(batch.get_time(0));
+          const std::size_t num_intervals_in_batch = last_interval_num - first_interval_num + 1;
+          // per thread counts
+          std::vector<std::vector<unsigned long>> local_num_prompts(get_max_num_threads(),
+                                                                    std::vector<unsigned long>(num_intervals_in_batch, 0UL));
+          std::vector<std::vector<unsigned long>> local_num_delayeds(get_max_num_threads(),
+                                                                     std::vector<unsigned long>(num_intervals_in_batch, 0UL));
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(static)
+#endif
+          for (long i = 0; i < num_events; ++i)
             {
-              headcurve << std::fixed << std::setprecision(3) << current_time << " , " << current_time + interval << " , "
-                        << num_prompts << " , " << num_delayeds << '\n';
-              num_prompts = 0UL;
-              num_delayeds = 0UL;
-              current_time += interval;
+#ifdef STIR_OPENMP
+              const int thread_num = omp_get_thread_num();
+#else
+              const int thread_num = 0;
+#endif
+              const std::size_t interval_num = get_interval_num(batch.get_time(i)) - first_interval_num;
+              if (batch.get_record(i).event().is_prompt())
+                ++local_num_prompts[thread_num][interval_num];
+              else
+                ++local_num_delayeds[thread_num][interval_num];
             }
+          for (int thread_num = 0; thread_num < get_max_num_threads(); ++thread_num)
+            for (std::size_t interval_num = 0; interval_num < num_intervals_in_batch; ++interval_num)
+              {
+                num_prompts[first_interval_num + interval_num] += local_num_prompts[thread_num][interval_num];
+                num_delayeds[first_interval_num + interval_num] += local_num_delayeds[thread_num][interval_num];
+              }
         }
-      if (record.is_event())
-        {
-          if (record.event().is_prompt())
-            ++num_prompts;
-          else
-            ++num_delayeds;
-        }
+      // write finished intervals
+      add_interval_boundaries_up_to(current_time);
+      const std::size_t num_finished_intervals = std::min(num_prompts.size(), get_interval_num(current_time));
+      for (; num_written_intervals < num_finished_intervals; ++num_written_intervals)
+        headcurve << std::fixed << std::setprecision(3) << interval_boundaries[num_written_intervals] << " , "
+                  << interval_boundaries[num_written_intervals + 1] << " , " << num_prompts[num_written_intervals] << " , "
+                  << num_delayeds[num_written_intervals] << '\n';
     }
   return EXIT_SUCCESS;
 }
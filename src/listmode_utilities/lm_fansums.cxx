@@ -6,12 +6,16 @@
 
   \brief Program to compute detector fansums directly from listmode data
 
+  Events are read in batches (see stir::ListRecordBatch), whose size can be set with the
+  "number of events per batch" keyword. When OpenMP is enabled, every batch is processed in parallel.
+
   \author Kris Thielemans
 
   $Revision $
 */
 /*
     Copyright (C) 2002- 2011, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -25,6 +29,7 @@
 #include "stir/listmode/ListRecord.h"
 #include "stir/listmode/CListEventCylindricalScannerWithDiscreteDetectors.h"
 #include "stir/listmode/ListModeData.h"
+#include "stir/listmode/ListRecordBatch.h"
 #include "stir/TimeFrameDefinitions.h"
 #include "stir/Scanner.h"
 #include "stir/Array.h"
@@ -33,11 +38,16 @@
 #include "stir/CPUTimer.h"
 #include "stir/IO/read_from_file.h"
 #include "stir/error.h"
+#include "stir/warning.h"
+#include "stir/num_threads.h"
 
 #include "stir/ProjDataInfoCylindricalNoArcCorr.h"
 #include <fstream>
 #include <iostream>
 #include <vector>
+#ifdef STIR_OPENMP
+#  include <omp.h>
+#endif
 
 using std::fstream;
 using std::ifstream;
@@ -59,6 +69,7 @@ public:
 
   int max_segment_num_to_process;
   int fan_size;
+  int num_events_per_batch;
   shared_ptr<ListModeData> lm_data_ptr;
   TimeFrameDefinitions frame_defs;
 
@@ -84,6 +95,7 @@ LmFansums::set_defaults()
 {
   max_segment_num_to_process = -1;
   fan_size = -1;
+  num_events_per_batch = 1000000;
   store_prompts = true;
   delayed_increment = -1;
   interactive = false;
@@ -98,6 +110,7 @@ LmFansums::initialise_keymap()
   parser.add_key("output filename prefix", &output_filename_prefix);
   parser.add_key("tangential fan_size", &fan_size);
   parser.add_key("maximum absolute segment number to process", &max_segment_num_to_process);
+  parser.add_key("number of events per batch", &num_events_per_batch);
   // TODO can't do this yet
   // if (CListEvent::has_delayeds())
   {
@@ -125,6 +138,12 @@ LmFansums::post_processing()
   else
     fan_size = min(fan_size, max_fan_size);
 
+  if (num_events_per_batch <= 0)
+    {
+      warning("number of events per batch has to be positive");
+      return true;
+    }
+
   frame_defs = TimeFrameDefinitions(frame_definition_filename);
   return false;
 }
@@ -154,83 +173,87 @@ LmFansums::compute()
   double time_of_last_stored_event = 0;
   long num_stored_events = 0;
   Array<2, float> data_fan_sums(IndexRange2D(num_rings, num_detectors_per_ring));
+  // fan sums per thread
+  std::vector<Array<2, float>> local_data_fan_sums(get_max_num_threads(), data_fan_sums);
 
   // go to the beginning of the binary data
   lm_data_ptr->reset();
 
   unsigned int current_frame_num = 1;
   {
-    // loop over all events in the listmode file
-    shared_ptr<ListRecord> record_sptr = lm_data_ptr->get_empty_record_sptr();
-    ListRecord& record = *record_sptr;
+    // Read events in batches, and compute the fan sums in parallel
+    ListRecordBatch batch(*lm_data_ptr, num_events_per_batch);
 
     bool first_event = true;
+    bool more_data = true;
 
     double current_time = 0;
-    while (true)
+    for (; current_frame_num <= frame_defs.get_num_frames(); ++current_frame_num)
       {
-        if (lm_data_ptr->get_next_record(record) == Succeeded::no)
-          {
-            // no more events in file for some reason
-            write_fan_sums(data_fan_sums, current_frame_num);
-            break; // get out of while loop
-          }
-        if (record.is_time())
-          {
-            const double new_time = record.time().get_time_in_secs();
-            if (new_time >= frame_defs.get_end_time(current_frame_num))
-              {
-                while (current_frame_num <= frame_defs.get_num_frames() && new_time >= frame_defs.get_end_time(current_frame_num))
-                  {
-                    write_fan_sums(data_fan_sums, current_frame_num++);
-                    data_fan_sums.fill(0);
-                  }
-                if (current_frame_num > frame_defs.get_num_frames())
-                  break; // get out of while loop
-              }
-            current_time = new_time;
-          }
-        else if (record.is_event() && frame_defs.get_start_time(current_frame_num) <= current_time)
+        const double start_time = frame_defs.get_start_time(current_frame_num);
+        const double end_time = frame_defs.get_end_time(current_frame_num);
+        for (auto& local_fan_sums : local_data_fan_sums)
+          local_fan_sums.fill(0);
+
+        while (more_data && current_time < end_time)
           {
+            more_data = batch.read(*lm_data_ptr, current_time, end_time) == Succeeded::yes;
+            const long num_events = static_cast<long>(batch.size());
+            if (num_events == 0)
+              continue;
             // do a consistency check with dynamic_cast first
-            if (first_event && dynamic_cast<const CListEventCylindricalScannerWithDiscreteDetectors*>(&record.event()) == 0)
+            if (first_event && dynamic_cast<const CListEventCylindricalScannerWithDiscreteDetectors*>(&batch.get_record(0).event()) == 0)
               error("Currently only works for scanners with discrete detectors.");
             first_event = false;
 
-            // see if we increment or decrement the value in the sinogram
-            const int event_increment = record.event().is_prompt() ? (store_prompts ? 1 : 0) // it's a prompt
-                                                                   : delayed_increment;      // it is a delayed-coincidence event
-
-            if (event_increment == 0)
-              continue;
-
-            DetectionPositionPair<> det_pos;
-            // because of above consistency check, we can use static_cast here (saving a bit of time)
-            dynamic_cast<const CListEventCylindricalScannerWithDiscreteDetectors&>(record.event())
-                .get_detection_position(det_pos);
-            const int ra = det_pos.pos1().axial_coord();
-            const int rb = det_pos.pos2().axial_coord();
-            const int a = det_pos.pos1().tangential_coord();
-            const int b = det_pos.pos2().tangential_coord();
-            if (abs(ra - rb) <= max_segment_num_to_process)
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(static) reduction(+ : num_stored_events)
+#endif
+            for (long i = 0; i < num_events; ++i)
               {
-                const int det_num_diff = (a - b + 3 * num_detectors_per_ring / 2) % num_detectors_per_ring;
-                if (det_num_diff <= fan_size / 2 || det_num_diff >= num_detectors_per_ring - fan_size / 2)
+                if (batch.get_time(i) < start_time)
+                  continue;
+                const ListRecord& record = batch.get_record(i);
+                // see if we increment or decrement the value in the sinogram
+                const int event_increment = record.event().is_prompt() ? (store_prompts ? 1 : 0) // it's a prompt
+                                                                       : delayed_increment;      // it is a delayed-coincidence event
+
+                if (event_increment == 0)
+                  continue;
+
+                DetectionPositionPair<> det_pos;
+                // because of above consistency check, we can use static_cast here (saving a bit of time)
+                static_cast<const CListEventCylindricalScannerWithDiscreteDetectors&>(record.event()).get_detection_position(det_pos);
+                const int ra = det_pos.pos1().axial_coord();
+                const int rb = det_pos.pos2().axial_coord();
+                const int a = det_pos.pos1().tangential_coord();
+                const int b = det_pos.pos2().tangential_coord();
+                if (abs(ra - rb) <= max_segment_num_to_process)
                   {
-                    data_fan_sums[ra][a] += event_increment;
-                    data_fan_sums[rb][b] += event_increment;
-                    num_stored_events += event_increment;
+                    const int det_num_diff = (a - b + 3 * num_detectors_per_ring / 2) % num_detectors_per_ring;
+                    if (det_num_diff <= fan_size / 2 || det_num_diff >= num_detectors_per_ring - fan_size / 2)
+                      {
+#ifdef STIR_OPENMP
+                        Array<2, float>& fan_sums = local_data_fan_sums[omp_get_thread_num()];
+#else
+                        Array<2, float>& fan_sums = local_data_fan_sums[0];
+#endif
+                        fan_sums[ra][a] += event_increment;
+                        fan_sums[rb][b] += event_increment;
+                        num_stored_events += event_increment;
+                      }
                   }
-                else
-                  {}
-              }
-            else
-              {}
-
-          } // end of spatial event processing
-      }     // end of while loop over all events
-
-    time_of_last_stored_event = max(time_of_last_stored_event, current_time);
+              } // end of loop over events in batch
+          }     // end of while loop over batches
+
+        data_fan_sums.fill(0);
+        for (const auto& local_fan_sums : local_data_fan_sums)
+          data_fan_sums += local_fan_sums;
+        write_fan_sums(data_fan_sums, current_frame_num);
+        time_of_last_stored_event = max(time_of_last_stored_event, current_time);
+        if (!more_data)
+          break; // get out of loop over frames
+      }
   }
 
   timer.stop();
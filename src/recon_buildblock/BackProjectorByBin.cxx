@@ -14,7 +14,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2015, 2018-2019, University College London
+    Copyright (C) 2015, 2018-2019, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -32,6 +32,7 @@
 #include "stir/is_null_ptr.h"
 #include "stir/DataProcessor.h"
 #include <vector>
+#include <algorithm>
 #ifdef STIR_OPENMP
 #  include "stir/is_null_ptr.h"
 #  include "stir/DiscretisedDensity.h"
@@ -47,6 +48,44 @@ BackProjectorByBin::BackProjectorByBin()
   set_defaults();
 }
 
+BackProjectorByBin::BackProjectorByBin(const BackProjectorByBin& other)
+    : TimedObject(other),
+      RegisteredObject<BackProjectorByBin>(other),
+      _already_set_up(other._already_set_up),
+      _max_num_thread_local_images(other._max_num_thread_local_images),
+      _density_sptr(is_null_ptr(other._density_sptr) ? nullptr : other._density_sptr->clone()),
+      _post_data_processor_sptr(other._post_data_processor_sptr),
+      _proj_data_info_sptr(other._proj_data_info_sptr)
+#ifdef STIR_OPENMP
+      ,
+      // images will be allocated when used, locks are newly initialised
+      _local_output_image_sptrs(other._local_output_image_sptrs.size()),
+      _local_output_image_locks(other._local_output_image_locks.size()),
+      _local_output_image_num_of_thread(other._local_output_image_num_of_thread)
+#endif
+{}
+
+BackProjectorByBin&
+BackProjectorByBin::operator=(const BackProjectorByBin& other)
+{
+  if (this == &other)
+    return *this;
+  TimedObject::operator=(other);
+  RegisteredObject<BackProjectorByBin>::operator=(other);
+  _already_set_up = other._already_set_up;
+  _max_num_thread_local_images = other._max_num_thread_local_images;
+  _density_sptr.reset(is_null_ptr(other._density_sptr) ? nullptr : other._density_sptr->clone());
+  _post_data_processor_sptr = other._post_data_processor_sptr;
+  _proj_data_info_sptr = other._proj_data_info_sptr;
+#ifdef STIR_OPENMP
+  // images will be allocated when used, locks are newly initialised
+  _local_output_image_sptrs.assign(other._local_output_image_sptrs.size(), shared_ptr<DiscretisedDensity<3, float>>());
+  _local_output_image_locks = std::vector<ImageLock>(other._local_output_image_locks.size());
+  _local_output_image_num_of_thread = other._local_output_image_num_of_thread;
+#endif
+  return *this;
+}
+
 BackProjectorByBin::~BackProjectorByBin()
 {}
 
@@ -54,6 +93,7 @@ void
 BackProjectorByBin::set_defaults()
 {
   _post_data_processor_sptr.reset();
+  _max_num_thread_local_images = 0;
 }
 
 void
@@ -62,6 +102,7 @@ BackProjectorByBin::initialise_keymap()
   parser.add_start_key("Back Projector Parameters");
   parser.add_stop_key("End Back Projector Parameters");
   parser.add_parsing_key("post data processor", &_post_data_processor_sptr);
+  parser.add_key("maximum number of thread-local images", &_max_num_thread_local_images);
 }
 
 void
@@ -73,11 +114,19 @@ BackProjectorByBin::set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_
   _density_sptr.reset(density_info_sptr->clone());
 
 #ifdef STIR_OPENMP
+  int num_threads = 1;
 #  pragma omp parallel
   {
 #  pragma omp single
-    _local_output_image_sptrs.resize(omp_get_num_threads(), shared_ptr<DiscretisedDensity<3, float>>());
+    num_threads = omp_get_num_threads();
   }
+  const int num_images = _max_num_thread_local_images > 0 ? std::min(_max_num_thread_local_images, num_threads) : num_threads;
+  _local_output_image_sptrs.resize(num_images, shared_ptr<DiscretisedDensity<3, float>>());
+  // locks are initialised (and destroyed when no longer needed) by ImageLock
+  _local_output_image_locks.resize(num_images);
+  _local_output_image_num_of_thread.resize(num_threads);
+  for (int thread_num = 0; thread_num < num_threads; ++thread_num)
+    _local_output_image_num_of_thread[thread_num] = thread_num % num_images;
   for (int i = 0; i < static_cast<int>(_local_output_image_sptrs.size()); ++i)
     if (!is_null_ptr(_local_output_image_sptrs[i])) // already created in previous run
       if (!_local_output_image_sptrs[i]->has_same_characteristics(*density_info_sptr))
@@ -265,12 +314,6 @@ BackProjectorByBin::back_project(const RelatedViewgrams<float>& viewgrams,
 
   check(*viewgrams.get_proj_data_info_sptr());
 
-#ifdef STIR_OPENMP
-  const int thread_num = omp_get_thread_num();
-  if (is_null_ptr(_local_output_image_sptrs[thread_num]))
-    _local_output_image_sptrs[thread_num].reset(_density_sptr->get_empty_copy());
-#endif
-
   // first check symmetries
   {
     const ViewSegmentNumbers basic_vs = viewgrams.get_basic_view_segment_num();
@@ -289,7 +332,39 @@ BackProjectorByBin::back_project(const RelatedViewgrams<float>& viewgrams,
       }
   }
 
+#ifdef STIR_OPENMP
+  // lock an image for this thread, as images might be shared with other threads
+  const int num_images = static_cast<int>(_local_output_image_sptrs.size());
+  const int thread_num = omp_get_thread_num();
+  int image_num = thread_num % num_images;
+  if (!omp_test_lock(&_local_output_image_locks[image_num].lock))
+    {
+      // the default image for this thread is in use, so try to find a free one
+      bool found = false;
+      if (thread_num < static_cast<int>(_local_output_image_num_of_thread.size()))
+        for (int i = 1; i < num_images && !found; ++i)
+          {
+            const int other_image_num = (image_num + i) % num_images;
+            if (omp_test_lock(&_local_output_image_locks[other_image_num].lock))
+              {
+                image_num = other_image_num;
+                found = true;
+              }
+          }
+      if (!found)
+        omp_set_lock(&_local_output_image_locks[image_num].lock);
+    }
+  if (thread_num < static_cast<int>(_local_output_image_num_of_thread.size()))
+    _local_output_image_num_of_thread[thread_num] = image_num;
+  if (is_null_ptr(_local_output_image_sptrs[image_num]))
+    _local_output_image_sptrs[image_num].reset(_density_sptr->get_empty_copy());
+#endif
+
   actual_back_project(viewgrams, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
+
+#ifdef STIR_OPENMP
+  omp_unset_lock(&_local_output_image_locks[image_num].lock);
+#endif
 }
 
 void
@@ -301,13 +376,15 @@ BackProjectorByBin::start_accumulating_in_new_target()
   if (omp_get_num_threads() != 1)
     error("BackProjectorByBin::start_accumulating_in_new_target cannot be called inside a thread");
 
+  for (int i = 0; i < static_cast<int>(_local_output_image_sptrs.size()); ++i)
+    if (!is_null_ptr(_local_output_image_sptrs[i]))
+      if (!_local_output_image_sptrs.at(i)->has_same_characteristics(*_density_sptr))
+        error("BackProjectorByBin implementation error: local images for openmp have wrong size");
+
+#  pragma omp parallel for schedule(dynamic)
   for (int i = 0; i < static_cast<int>(_local_output_image_sptrs.size()); ++i)
     if (!is_null_ptr(_local_output_image_sptrs[i])) // only reset to zero if a thread filled something in
-      {
-        if (!_local_output_image_sptrs.at(i)->has_same_characteristics(*_density_sptr))
-          error("BackProjectorByBin implementation error: local images for openmp have wrong size");
-        _local_output_image_sptrs.at(i)->fill(0.F);
-      }
+      _local_output_image_sptrs[i]->fill(0.F);
 
 #endif
   _density_sptr->fill(0.);
@@ -323,15 +400,17 @@ BackProjectorByBin::get_output(DiscretisedDensity<3, float>& density) const
   if (omp_get_num_threads() != 1)
     error("BackProjectorByBin::get_output() cannot be called inside a thread");
 
-  // "reduce" data constructed by threads
-  {
-    density.fill(0.F);
-    for (int i = 0; i < static_cast<int>(_local_output_image_sptrs.size()); ++i)
-      {
-        if (!is_null_ptr(_local_output_image_sptrs[i])) // only accumulate if a thread filled something in
-          density += *(_local_output_image_sptrs[i]);
-      }
-  }
+  // "reduce" data constructed by threads, in parallel over planes
+#  pragma omp parallel for schedule(static)
+  for (int z = density.get_min_index(); z <= density.get_max_index(); ++z)
+    {
+      density[z].fill(0.F);
+      for (int i = 0; i < static_cast<int>(_local_output_image_sptrs.size()); ++i)
+        {
+          if (!is_null_ptr(_local_output_image_sptrs[i])) // only accumulate if a thread filled something in
+            density[z] += (*_local_output_image_sptrs[i])[z];
+        }
+    }
 #else
   std::copy(_density_sptr->begin_all(), _density_sptr->end_all(), density.begin_all());
 #endif
@@ -345,6 +424,31 @@ BackProjectorByBin::get_output(DiscretisedDensity<3, float>& density) const
     }
 }
 
+void
+BackProjectorByBin::set_max_num_thread_local_images(const int arg)
+{
+  _already_set_up = _already_set_up && (_max_num_thread_local_images == arg);
+  _max_num_thread_local_images = arg;
+}
+
+int
+BackProjectorByBin::get_max_num_thread_local_images() const
+{
+  return _max_num_thread_local_images;
+}
+
+#ifdef STIR_OPENMP
+int
+BackProjectorByBin::get_local_output_image_num() const
+{
+  const int thread_num = omp_get_thread_num();
+  if (thread_num < static_cast<int>(_local_output_image_num_of_thread.size()))
+    return _local_output_image_num_of_thread[thread_num];
+  else
+    return thread_num % static_cast<int>(_local_output_image_sptrs.size());
+}
+#endif
+
 void
 BackProjectorByBin::set_post_data_processor(shared_ptr<DataProcessor<DiscretisedDensity<3, float>>> post_data_processor_sptr)
 {
@@ -367,8 +471,7 @@ BackProjectorByBin::actual_back_project(const RelatedViewgrams<float>& viewgrams
 {
   shared_ptr<DiscretisedDensity<3, float>> density_sptr = _density_sptr;
 #ifdef STIR_OPENMP
-  const int thread_num = omp_get_thread_num();
-  density_sptr = _local_output_image_sptrs[thread_num];
+  density_sptr = _local_output_image_sptrs[get_local_output_image_num()];
 #endif
   actual_back_project(
       *density_sptr, viewgrams, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
@@ -0,0 +1,120 @@
+//
+//
+/*!
+  \file
+  \ingroup projection
+
+  \brief non-inline implementations for stir::BackProjectorByBinUsingJoseph
+
+  \author Kris Thielemans
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+
+#include "stir/recon_buildblock/BackProjectorByBinUsingJoseph.h"
+#include "stir/recon_buildblock/JosephProjectionHelper.h"
+#include "stir/recon_buildblock/DataSymmetriesForBins_PET_CartesianGrid.h"
+#include "stir/DiscretisedDensity.h"
+#include "stir/RelatedViewgrams.h"
+#include "stir/Viewgram.h"
+#include "stir/Bin.h"
+#include "stir/error.h"
+#include <algorithm>
+#include <vector>
+
+START_NAMESPACE_STIR
+
+const char* const BackProjectorByBinUsingJoseph::registered_name = "Joseph";
+
+BackProjectorByBinUsingJoseph::BackProjectorByBinUsingJoseph()
+{
+  set_defaults();
+}
+
+BackProjectorByBinUsingJoseph::~BackProjectorByBinUsingJoseph()
+{}
+
+void
+BackProjectorByBinUsingJoseph::set_defaults()
+{
+  BackProjectorByBin::set_defaults();
+}
+
+void
+BackProjectorByBinUsingJoseph::initialise_keymap()
+{
+  parser.add_start_key("Back Projector Using Joseph Parameters");
+  parser.add_stop_key("End Back Projector Using Joseph Parameters");
+  BackProjectorByBin::initialise_keymap();
+}
+
+void
+BackProjectorByBinUsingJoseph::set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                                      const shared_ptr<const DiscretisedDensity<3, float>>& density_info_sptr)
+{
+  BackProjectorByBin::set_up(proj_data_info_sptr, density_info_sptr);
+  symmetries_sptr.reset(new DataSymmetriesForBins_PET_CartesianGrid(proj_data_info_sptr, density_info_sptr));
+  helper_sptr.reset(new detail::JosephProjectionHelper(proj_data_info_sptr, *density_info_sptr));
+}
+
+const DataSymmetriesForViewSegmentNumbers*
+BackProjectorByBinUsingJoseph::get_symmetries_used() const
+{
+  if (!this->_already_set_up)
+    error("BackProjectorByBin method called without calling set_up first.");
+  return symmetries_sptr.get();
+}
+
+BackProjectorByBinUsingJoseph*
+BackProjectorByBinUsingJoseph::clone() const
+{
+  return new BackProjectorByBinUsingJoseph(*this);
+}
+
+void
+BackProjectorByBinUsingJoseph::actual_back_project(DiscretisedDensity<3, float>& density,
+                                                   const RelatedViewgrams<float>& viewgrams,
+                                                   const int min_axial_pos_num,
+                                                   const int max_axial_pos_num,
+                                                   const int min_tangential_pos_num,
+                                                   const int max_tangential_pos_num)
+{
+  // density is only used by the current thread, so we can access its data directly if it is contiguous
+  std::vector<float> image_data;
+  float* image_ptr;
+  if (density.is_contiguous())
+    image_ptr = density.get_full_data_ptr();
+  else
+    {
+      image_data.assign(helper_sptr->get_num_voxels(), 0.F);
+      image_ptr = image_data.data();
+    }
+
+  for (RelatedViewgrams<float>::const_iterator viewgram_iter = viewgrams.begin(); viewgram_iter != viewgrams.end();
+       ++viewgram_iter)
+    {
+      const Viewgram<float>& viewgram = *viewgram_iter;
+      Bin bin(viewgram.get_segment_num(), viewgram.get_view_num(), 0, 0, viewgram.get_timing_pos_num());
+      for (bin.axial_pos_num() = min_axial_pos_num; bin.axial_pos_num() <= max_axial_pos_num; ++bin.axial_pos_num())
+        for (bin.tangential_pos_num() = min_tangential_pos_num; bin.tangential_pos_num() <= max_tangential_pos_num;
+             ++bin.tangential_pos_num())
+          helper_sptr->back_project_bin(image_ptr, bin, viewgram[bin.axial_pos_num()][bin.tangential_pos_num()]);
+    }
+
+  if (density.is_contiguous())
+    density.release_full_data_ptr();
+  else
+    {
+      auto image_iter = image_data.begin();
+      for (auto density_iter = density.begin_all(); density_iter != density.end_all(); ++density_iter, ++image_iter)
+        *density_iter += *image_iter;
+    }
+}
+
+END_NAMESPACE_STIR
@@ -2,6 +2,7 @@
 //
 /*
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -21,18 +22,165 @@
 #include "stir/recon_buildblock/ForwardProjectorByBinUsingRayTracing.h"
 #include "stir/DiscretisedDensityOnCartesianGrid.h" // used for rescaling attenuation image
 #include "stir/RelatedViewgrams.h"
+#include "stir/Viewgram.h"
 #include "stir/ArrayFunction.h"
 #include "stir/Succeeded.h"
 #include "stir/is_null_ptr.h"
 #include "stir/IO/read_from_file.h"
+#include "stir/info.h"
 #include "stir/warning.h"
 #include "stir/error.h"
 #include <boost/format.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
 
 START_NAMESPACE_STIR
 
 const char* const BinNormalisationFromAttenuationImage::registered_name = "From Attenuation Image";
 
+/*!
+  \brief Thread-safe store of attenuation correction factors per viewgram
+
+  Viewgrams are kept in memory until the budget is used up. Afterwards, they are
+  appended to a temporary file (which is deleted when the cache is destroyed).
+*/
+class BinNormalisationFromAttenuationImage::ACFCache
+{
+public:
+  explicit ACFCache(const std::size_t memory_budget_in_bytes)
+      : memory_budget_in_bytes(memory_budget_in_bytes),
+        memory_used_in_bytes(0),
+        spill_file_num_elements(0)
+  {}
+
+  ~ACFCache()
+  {
+    if (!spill_filename.empty())
+      {
+        spill_file.close();
+        std::error_code ec;
+        std::filesystem::remove(spill_filename, ec);
+      }
+  }
+
+  ACFCache(const ACFCache&) = delete;
+  ACFCache& operator=(const ACFCache&) = delete;
+
+  //! Fill \a viewgram with the cached values, returning \c false if they are not in the cache
+  bool get(Viewgram<float>& viewgram)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto iter = entries.find(make_key(viewgram));
+    if (iter == entries.end())
+      return false;
+    const Entry& entry = iter->second;
+    if (entry.num_elements != static_cast<std::size_t>(viewgram.size_all()))
+      error(boost::format("BinNormalisationFromAttenuationImage: internal error: cached attenuation correction factors for "
+                          "segment %1%, view %2% have %3% elements, while the viewgram has %4%")
+            % viewgram.get_segment_num() % viewgram.get_view_num() % entry.num_elements % viewgram.size_all());
+    if (!entry.data.empty())
+      {
+        std::copy(entry.data.begin(), entry.data.end(), viewgram.begin_all());
+        return true;
+      }
+    buffer.resize(entry.num_elements);
+    spill_file.seekg(get_file_position(entry.file_offset));
+    spill_file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(float)));
+    if (!spill_file)
+      error("BinNormalisationFromAttenuationImage: error reading attenuation correction factors from the cache file");
+    std::copy(buffer.begin(), buffer.end(), viewgram.begin_all());
+    return true;
+  }
+
+  //! Store the values of \a viewgram (if not yet present)
+  void store(const Viewgram<float>& viewgram)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[make_key(viewgram)];
+    if (entry.num_elements != 0)
+      return; // another thread was faster
+    entry.num_elements = static_cast<std::size_t>(viewgram.size_all());
+    const std::size_t num_bytes = entry.num_elements * sizeof(float);
+    if (memory_used_in_bytes + num_bytes <= memory_budget_in_bytes)
+      {
+        entry.data.assign(viewgram.begin_all(), viewgram.end_all());
+        memory_used_in_bytes += num_bytes;
+        return;
+      }
+    if (spill_filename.empty())
+      {
+        std::random_device random;
+        spill_filename = (std::filesystem::temp_directory_path()
+                          / ("stir_acf_cache_" + std::to_string(random()) + std::to_string(random()) + ".tmp"))
+                             .string();
+        spill_file.open(spill_filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!spill_file)
+          error("BinNormalisationFromAttenuationImage: cannot create temporary file " + spill_filename
+                + " for caching attenuation correction factors");
+        info("BinNormalisationFromAttenuationImage: cache memory budget exhausted. Further factors will be cached in "
+                 + spill_filename,
+             2);
+      }
+    buffer.assign(viewgram.begin_all(), viewgram.end_all());
+    spill_file.seekp(get_file_position(spill_file_num_elements));
+    spill_file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(float)));
+    if (!spill_file)
+      error("BinNormalisationFromAttenuationImage: error writing attenuation correction factors to the cache file");
+    entry.file_offset = spill_file_num_elements;
+    spill_file_num_elements += entry.num_elements;
+  }
+
+private:
+  //! segment, view, timing position, and min/max axial and tangential position numbers
+  typedef std::tuple<int, int, int, int, int, int, int> key_type;
+  struct Entry
+  {
+    Entry()
+        : num_elements(0),
+          file_offset(0)
+    {}
+    std::size_t num_elements;
+    //! empty if the values are stored in the file
+    std::vector<float> data;
+    //! offset (in number of floats) in the spill file
+    std::size_t file_offset;
+  };
+
+  //! position in the file (in bytes) of the element at \a offset (in number of floats), using 64-bit arithmetic
+  static std::streamoff get_file_position(const std::size_t offset)
+  {
+    return static_cast<std::streamoff>(offset) * static_cast<std::streamoff>(sizeof(float));
+  }
+
+  static key_type make_key(const Viewgram<float>& viewgram)
+  {
+    return key_type(viewgram.get_segment_num(),
+                    viewgram.get_view_num(),
+                    viewgram.get_timing_pos_num(),
+                    viewgram.get_min_axial_pos_num(),
+                    viewgram.get_max_axial_pos_num(),
+                    viewgram.get_min_tangential_pos_num(),
+                    viewgram.get_max_tangential_pos_num());
+  }
+
+  std::mutex mutex;
+  std::map<key_type, Entry> entries;
+  const std::size_t memory_budget_in_bytes;
+  std::size_t memory_used_in_bytes;
+  std::string spill_filename;
+  std::fstream spill_file;
+  std::size_t spill_file_num_elements;
+  //! used for conversion to/from the file
+  std::vector<float> buffer;
+};
+
 void
 BinNormalisationFromAttenuationImage::set_defaults()
 {
@@ -40,6 +188,9 @@ BinNormalisationFromAttenuationImage::set_defaults()
   attenuation_image_ptr.reset();
   forward_projector_ptr.reset();
   attenuation_image_filename = "";
+  use_cache = false;
+  cache_memory_budget_in_MB = 1024.F;
+  acf_cache_sptr.reset();
 }
 
 void
@@ -49,6 +200,8 @@ BinNormalisationFromAttenuationImage::initialise_keymap()
   parser.add_start_key("Bin Normalisation From Attenuation Image");
   parser.add_key("attenuation_image_filename", &attenuation_image_filename);
   parser.add_parsing_key("forward projector type", &forward_projector_ptr);
+  parser.add_key("cache attenuation correction factors", &use_cache);
+  parser.add_key("cache memory budget (in MB)", &cache_memory_budget_in_MB);
   parser.add_stop_key("End Bin Normalisation From Attenuation Image");
 }
 
@@ -104,6 +257,8 @@ BinNormalisationFromAttenuationImage::BinNormalisationFromAttenuationImage()
 BinNormalisationFromAttenuationImage::BinNormalisationFromAttenuationImage(
     const std::string& filename, shared_ptr<ForwardProjectorByBin> const& forward_projector_ptr)
     : forward_projector_ptr(forward_projector_ptr),
+      use_cache(false),
+      cache_memory_budget_in_MB(1024.F),
       attenuation_image_filename(filename)
 {
   attenuation_image_ptr.reset();
@@ -115,7 +270,9 @@ BinNormalisationFromAttenuationImage::BinNormalisationFromAttenuationImage(
     shared_ptr<ForwardProjectorByBin> const& forward_projector_ptr)
     : attenuation_image_ptr(
         attenuation_image_ptr_v->clone()), // need a clone as it guarantees we won't be affected by the caller, and vice versa
-      forward_projector_ptr(forward_projector_ptr)
+      forward_projector_ptr(forward_projector_ptr),
+      use_cache(false),
+      cache_memory_budget_in_MB(1024.F)
 {
   post_processing();
 }
@@ -132,23 +289,78 @@ BinNormalisationFromAttenuationImage::set_up(const shared_ptr<const ExamInfo>& e
   base_type::set_up(exam_info_sptr, proj_data_info_ptr);
   forward_projector_ptr->set_up(proj_data_info_ptr, attenuation_image_ptr);
   forward_projector_ptr->set_input(*attenuation_image_ptr);
+  if (use_cache)
+    {
+      if (cache_memory_budget_in_MB < 0)
+        error("BinNormalisationFromAttenuationImage: cache memory budget should be non-negative");
+      acf_cache_sptr = std::make_shared<ACFCache>(static_cast<std::size_t>(cache_memory_budget_in_MB * 1024 * 1024));
+    }
+  else
+    acf_cache_sptr.reset();
   return Succeeded::yes;
 }
 
 void
-BinNormalisationFromAttenuationImage::apply(RelatedViewgrams<float>& viewgrams) const
+BinNormalisationFromAttenuationImage::set_use_cache(const bool arg)
 {
-  this->check(*viewgrams.get_proj_data_info_sptr());
-  RelatedViewgrams<float> attenuation_viewgrams = viewgrams.get_empty_copy();
-  forward_projector_ptr->forward_project(attenuation_viewgrams);
+  use_cache = arg;
+}
+
+bool
+BinNormalisationFromAttenuationImage::get_use_cache() const
+{
+  return use_cache;
+}
+
+void
+BinNormalisationFromAttenuationImage::set_cache_memory_budget_in_MB(const float arg)
+{
+  cache_memory_budget_in_MB = arg;
+}
+
+float
+BinNormalisationFromAttenuationImage::get_cache_memory_budget_in_MB() const
+{
+  return cache_memory_budget_in_MB;
+}
+
+void
+BinNormalisationFromAttenuationImage::get_attenuation_correction_factors(RelatedViewgrams<float>& acf_viewgrams) const
+{
+  if (acf_cache_sptr)
+    {
+      bool all_cached = true;
+      for (RelatedViewgrams<float>::iterator viewgrams_iter = acf_viewgrams.begin(); viewgrams_iter != acf_viewgrams.end();
+           ++viewgrams_iter)
+        {
+          if (!acf_cache_sptr->get(*viewgrams_iter))
+            {
+              all_cached = false;
+              break;
+            }
+        }
+      if (all_cached)
+        return;
+    }
+
+  forward_projector_ptr->forward_project(acf_viewgrams);
 
   // TODO cannot use std::transform ?
-  for (RelatedViewgrams<float>::iterator viewgrams_iter = attenuation_viewgrams.begin();
-       viewgrams_iter != attenuation_viewgrams.end();
+  for (RelatedViewgrams<float>::iterator viewgrams_iter = acf_viewgrams.begin(); viewgrams_iter != acf_viewgrams.end();
        ++viewgrams_iter)
     {
       in_place_exp(*viewgrams_iter);
+      if (acf_cache_sptr)
+        acf_cache_sptr->store(*viewgrams_iter);
     }
+}
+
+void
+BinNormalisationFromAttenuationImage::apply(RelatedViewgrams<float>& viewgrams) const
+{
+  this->check(*viewgrams.get_proj_data_info_sptr());
+  RelatedViewgrams<float> attenuation_viewgrams = viewgrams.get_empty_copy();
+  get_attenuation_correction_factors(attenuation_viewgrams);
   viewgrams *= attenuation_viewgrams;
 }
 
@@ -157,15 +369,7 @@ BinNormalisationFromAttenuationImage::undo(RelatedViewgrams<float>& viewgrams) c
 {
   this->check(*viewgrams.get_proj_data_info_sptr());
   RelatedViewgrams<float> attenuation_viewgrams = viewgrams.get_empty_copy();
-  forward_projector_ptr->forward_project(attenuation_viewgrams);
-
-  // TODO cannot use std::transform ?
-  for (RelatedViewgrams<float>::iterator viewgrams_iter = attenuation_viewgrams.begin();
-       viewgrams_iter != attenuation_viewgrams.end();
-       ++viewgrams_iter)
-    {
-      in_place_exp(*viewgrams_iter);
-    }
+  get_attenuation_correction_factors(attenuation_viewgrams);
   viewgrams /= attenuation_viewgrams;
 }
 
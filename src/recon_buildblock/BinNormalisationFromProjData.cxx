@@ -2,7 +2,7 @@
 //
 /*
     Copyright (C) 2000- 2013, Hammersmith Imanet Ltd
-    Copyright (C) 2023, 2024 University College London
+    Copyright (C) 2023, 2024, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -63,7 +63,8 @@ BinNormalisationFromProjData::BinNormalisationFromProjData()
 }
 
 BinNormalisationFromProjData::BinNormalisationFromProjData(const std::string& filename)
-    : norm_proj_data_ptr(ProjData::read_from_file(filename))
+    : norm_proj_data_ptr(ProjData::read_from_file(filename)),
+      normalisation_projdata_filename(filename)
 {}
 
 BinNormalisationFromProjData::BinNormalisationFromProjData(const shared_ptr<ProjData>& norm_proj_data_ptr)
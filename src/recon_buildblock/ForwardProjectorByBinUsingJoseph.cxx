@@ -0,0 +1,115 @@
+//
+//
+/*!
+  \file
+  \ingroup projection
+
+  \brief non-inline implementations for stir::ForwardProjectorByBinUsingJoseph
+
+  \author Kris Thielemans
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+
+#include "stir/recon_buildblock/ForwardProjectorByBinUsingJoseph.h"
+#include "stir/recon_buildblock/JosephProjectionHelper.h"
+#include "stir/recon_buildblock/DataSymmetriesForBins_PET_CartesianGrid.h"
+#include "stir/RelatedViewgrams.h"
+#include "stir/Viewgram.h"
+#include "stir/Bin.h"
+#include "stir/error.h"
+
+START_NAMESPACE_STIR
+
+const char* const ForwardProjectorByBinUsingJoseph::registered_name = "Joseph";
+
+ForwardProjectorByBinUsingJoseph::ForwardProjectorByBinUsingJoseph()
+{
+  set_defaults();
+}
+
+ForwardProjectorByBinUsingJoseph::~ForwardProjectorByBinUsingJoseph()
+{}
+
+void
+ForwardProjectorByBinUsingJoseph::set_defaults()
+{
+  ForwardProjectorByBin::set_defaults();
+}
+
+void
+ForwardProjectorByBinUsingJoseph::initialise_keymap()
+{
+  ForwardProjectorByBin::initialise_keymap();
+  parser.add_start_key("Forward Projector Using Joseph Parameters");
+  parser.add_stop_key("End Forward Projector Using Joseph Parameters");
+}
+
+void
+ForwardProjectorByBinUsingJoseph::set_up(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                                         const shared_ptr<const DiscretisedDensity<3, float>>& density_info_sptr)
+{
+  ForwardProjectorByBin::set_up(proj_data_info_sptr, density_info_sptr);
+  symmetries_sptr.reset(new DataSymmetriesForBins_PET_CartesianGrid(proj_data_info_sptr, density_info_sptr));
+  helper_sptr.reset(new detail::JosephProjectionHelper(proj_data_info_sptr, *density_info_sptr));
+  density_data_ptr = nullptr;
+  image_data.clear();
+}
+
+const DataSymmetriesForViewSegmentNumbers*
+ForwardProjectorByBinUsingJoseph::get_symmetries_used() const
+{
+  if (!this->_already_set_up)
+    error("ForwardProjectorByBin method called without calling set_up first.");
+  return symmetries_sptr.get();
+}
+
+void
+ForwardProjectorByBinUsingJoseph::set_input(const DiscretisedDensity<3, float>& density)
+{
+  ForwardProjectorByBin::set_input(density);
+  if (this->_density_sptr->size_all() != helper_sptr->get_num_voxels())
+    error("ForwardProjectorByBinUsingJoseph::set_input: image has different size than at set_up");
+  // get the pointer here, such that we do not need to call get_const_full_data_ptr() from multiple threads
+  if (this->_density_sptr->is_contiguous())
+    {
+      image_data.clear();
+      density_data_ptr = this->_density_sptr->get_const_full_data_ptr();
+      this->_density_sptr->release_const_full_data_ptr();
+    }
+  else
+    {
+      density_data_ptr = nullptr;
+      image_data.assign(this->_density_sptr->begin_all_const(), this->_density_sptr->end_all_const());
+    }
+}
+
+void
+ForwardProjectorByBinUsingJoseph::actual_forward_project(RelatedViewgrams<float>& viewgrams,
+                                                         const int min_axial_pos_num,
+                                                         const int max_axial_pos_num,
+                                                         const int min_tangential_pos_num,
+                                                         const int max_tangential_pos_num)
+{
+  const float* const image_data_ptr = image_data.empty() ? density_data_ptr : image_data.data();
+  if (!image_data_ptr)
+    error("ForwardProjectorByBinUsingJoseph: you need to call set_input() first");
+
+  for (RelatedViewgrams<float>::iterator viewgram_iter = viewgrams.begin(); viewgram_iter != viewgrams.end(); ++viewgram_iter)
+    {
+      Viewgram<float>& viewgram = *viewgram_iter;
+      Bin bin(viewgram.get_segment_num(), viewgram.get_view_num(), 0, 0, viewgram.get_timing_pos_num());
+      for (bin.axial_pos_num() = min_axial_pos_num; bin.axial_pos_num() <= max_axial_pos_num; ++bin.axial_pos_num())
+        for (bin.tangential_pos_num() = min_tangential_pos_num; bin.tangential_pos_num() <= max_tangential_pos_num;
+             ++bin.tangential_pos_num())
+          viewgram[bin.axial_pos_num()][bin.tangential_pos_num()] = helper_sptr->forward_project_bin(image_data_ptr, bin);
+    }
+}
+
+END_NAMESPACE_STIR
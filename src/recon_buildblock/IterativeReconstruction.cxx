@@ -38,6 +38,7 @@
 #include "stir/is_null_ptr.h"
 #include "stir/modelling/ParametricDiscretisedDensity.h"
 #include "stir/modelling/KineticParameters.h"
+#include "stir/IO/OutputFileFormat.h"
 
 #include "stir/info.h"
 #include "stir/warning.h"
@@ -65,6 +66,7 @@ IterativeReconstruction<TargetT>::set_defaults()
 
   this->max_num_full_iterations = NumericInfo<int>().max_value();
   this->save_interval = 1;
+  this->write_intermediate_images_in_background = false;
   this->inter_iteration_filter_interval = 0;
   this->inter_iteration_filter_ptr.reset();
   // MJ 02/08/99 added subset randomization
@@ -81,6 +83,7 @@ IterativeReconstruction<TargetT>::initialise_keymap()
   this->parser.add_key("number of subiterations", &num_subiterations);
   this->parser.add_key("start at subiteration number", &start_subiteration_num);
   this->parser.add_key("save estimates at subiteration intervals", &save_interval);
+  this->parser.add_key("write intermediate images in background", &write_intermediate_images_in_background);
   this->parser.add_key("initial estimate", &initial_data_filename);
   this->parser.add_key("number of subsets", &this->num_subsets);
   this->parser.add_key("start at subset", &start_subset_num);
@@ -209,6 +212,13 @@ IterativeReconstruction<TargetT>::get_save_interval() const
   return this->save_interval;
 }
 
+template <typename TargetT>
+bool
+IterativeReconstruction<TargetT>::get_write_intermediate_images_in_background() const
+{
+  return this->write_intermediate_images_in_background;
+}
+
 template <typename TargetT>
 const bool
 IterativeReconstruction<TargetT>::get_randomise_subset_order() const
@@ -297,6 +307,13 @@ IterativeReconstruction<TargetT>::set_save_interval(const int arg)
   this->save_interval = arg;
 }
 
+template <typename TargetT>
+void
+IterativeReconstruction<TargetT>::set_write_intermediate_images_in_background(const bool arg)
+{
+  this->write_intermediate_images_in_background = arg;
+}
+
 template <typename TargetT>
 void
 IterativeReconstruction<TargetT>::set_randomise_subset_order(const bool arg)
@@ -417,6 +434,8 @@ IterativeReconstruction<TargetT>::reconstruct(shared_ptr<TargetT> const& target_
       this->update_estimate(*target_data_sptr);
       this->end_of_iteration_processing(*target_data_sptr);
     }
+  // make sure all images are written (in case we terminated early)
+  this->wait_for_background_output();
 
   this->stop_timers();
 
@@ -568,10 +587,39 @@ IterativeReconstruction<TargetT>::end_of_iteration_processing(TargetT& current_e
   if ((!(this->subiteration_num % this->save_interval) || this->subiteration_num == this->num_subiterations)
       && !this->_disable_output)
     {
-      this->output_file_format_ptr->write_to_file(this->make_filename_prefix_subiteration_num(), current_estimate);
+      // only keep one image in the background, such that we do not use too much memory
+      this->wait_for_background_output();
+      if (this->write_intermediate_images_in_background && this->subiteration_num != this->num_subiterations)
+        {
+          // write a snapshot, as the current estimate will be modified by the next subiteration
+          const shared_ptr<const TargetT> snapshot_sptr(current_estimate.clone());
+          const shared_ptr<OutputFileFormat<TargetT>> output_file_format_sptr = this->output_file_format_ptr;
+          const std::string filename = this->make_filename_prefix_subiteration_num();
+          this->_background_output = std::async(std::launch::async, [output_file_format_sptr, snapshot_sptr, filename]() {
+                                       std::string filename_used = filename;
+                                       return output_file_format_sptr->write_to_file(filename_used, *snapshot_sptr);
+                                     }).share();
+        }
+      else
+        {
+          this->output_file_format_ptr->write_to_file(this->make_filename_prefix_subiteration_num(), current_estimate);
+        }
     }
 }
 
+template <typename TargetT>
+void
+IterativeReconstruction<TargetT>::wait_for_background_output()
+{
+  if (!this->_background_output.valid())
+    return;
+  // get() rethrows any exception that occurred in the background thread
+  const Succeeded success = this->_background_output.get();
+  this->_background_output = std::shared_future<Succeeded>();
+  if (success == Succeeded::no)
+    error("IterativeReconstruction: error writing image in the background");
+}
+
 template <typename TargetT>
 VectorWithOffset<int>
 IterativeReconstruction<TargetT>::randomly_permute_subset_order() const
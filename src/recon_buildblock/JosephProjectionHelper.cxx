@@ -0,0 +1,201 @@
+//
+//
+/*!
+  \file
+  \ingroup projection
+
+  \brief non-inline implementations for stir::detail::JosephProjectionHelper
+
+  \author Kris Thielemans
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+
+#include "stir/recon_buildblock/JosephProjectionHelper.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/LORCoordinates.h"
+#include "stir/Bin.h"
+#include "stir/TOF_conversions.h"
+#include "stir/error.h"
+#include <algorithm>
+#include <cmath>
+
+START_NAMESPACE_STIR
+
+namespace detail
+{
+
+JosephProjectionHelper::JosephProjectionHelper(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr_v,
+                                               const DiscretisedDensity<3, float>& density_info)
+    : proj_data_info_sptr(proj_data_info_sptr_v)
+{
+  auto image_ptr = dynamic_cast<const VoxelsOnCartesianGrid<float>*>(&density_info);
+  if (!image_ptr)
+    error("JosephProjectionHelper: can only handle images of type VoxelsOnCartesianGrid");
+  const VoxelsOnCartesianGrid<float>& image = *image_ptr;
+
+  BasicCoordinate<3, int> min_indices, max_indices;
+  if (!image.get_regular_range(min_indices, max_indices))
+    error("JosephProjectionHelper: can only handle images with a regular range");
+  dimensions = max_indices - min_indices + 1;
+  strides = CartesianCoordinate3D<int>(dimensions.y() * dimensions.x(), dimensions.x(), 1);
+  voxel_size = image.get_voxel_size();
+
+  first_voxel = image.get_physical_coordinates_for_indices(min_indices);
+  // get_LOR() uses a coordinate system where z=0 is in the centre of the scanner. We assume that the middle of the image
+  // is there (as ParallelprojHelper)
+  first_voxel.z() -= (image.get_min_index() + image.get_max_index()) / 2.F * voxel_size.z();
+
+#ifndef NEWSCALE
+  // projectors work in pixel units, so convert the LOR length
+  rescale = 1 / voxel_size.x();
+#else
+  rescale = 1.F;
+#endif
+
+  if (proj_data_info_sptr->is_tof_data())
+    {
+      const float gauss_sigma_in_mm
+          = tof_delta_time_to_mm(proj_data_info_sptr->get_scanner_ptr()->get_timing_resolution()) / 2.355F;
+      r_sqrt2_gauss_sigma = 1.F / (gauss_sigma_in_mm * static_cast<float>(std::sqrt(2.)));
+    }
+  else
+    r_sqrt2_gauss_sigma = 0.F;
+}
+
+std::size_t
+JosephProjectionHelper::get_num_voxels() const
+{
+  return static_cast<std::size_t>(dimensions.z()) * dimensions.y() * dimensions.x();
+}
+
+// restrict [t_min, t_max] such that start + t*delta is in the open interval (low, high)
+static inline void
+restrict_parameter_range(float& t_min, float& t_max, const float start, const float delta, const float low, const float high)
+{
+  if (delta == 0)
+    {
+      if (start <= low || start >= high)
+        t_max = t_min - 1; // empty range
+      return;
+    }
+  float t_low = (low - start) / delta;
+  float t_high = (high - start) / delta;
+  if (t_low > t_high)
+    std::swap(t_low, t_high);
+  t_min = std::max(t_min, t_low);
+  t_max = std::min(t_max, t_high);
+}
+
+template <class FunctionT>
+void
+JosephProjectionHelper::for_all_voxels_on_LOR(const Bin& bin, FunctionT& func) const
+{
+  LORInAxialAndNoArcCorrSinogramCoordinates<float> lor;
+  proj_data_info_sptr->get_LOR(lor, bin);
+  const LORAs2Points<float> lor_points(lor);
+
+  // LOR in (continuous) voxel indices, starting from 0: start + t*delta, with t in [0,1]
+  const CartesianCoordinate3D<float> start = (lor_points.p1() - first_voxel) / voxel_size;
+  const CartesianCoordinate3D<float> delta = (lor_points.p2() - lor_points.p1()) / voxel_size;
+  const float LOR_length = static_cast<float>(norm(lor_points.p2() - lor_points.p1()));
+
+  // find main direction
+  int main_dim = 1;
+  for (int d = 2; d <= 3; ++d)
+    if (std::fabs(delta[d]) > std::fabs(delta[main_dim]))
+      main_dim = d;
+  if (delta[main_dim] == 0)
+    return;
+  const int dim1 = main_dim == 1 ? 2 : 1;
+  const int dim2 = main_dim == 3 ? 2 : 3;
+
+  float t_min = 0.F;
+  float t_max = 1.F;
+  float tof_low = 0.F;
+  float tof_high = 0.F;
+  if (r_sqrt2_gauss_sigma > 0)
+    {
+      // the distance to the middle of the LOR (towards p1) is (1/2 - t) * LOR_length, see ProjMatrixByBin::apply_tof_kernel
+      tof_low = proj_data_info_sptr->tof_bin_boundaries_mm[bin.timing_pos_num()].low_lim;
+      tof_high = proj_data_info_sptr->tof_bin_boundaries_mm[bin.timing_pos_num()].high_lim;
+      const float max_dist = 4.F / r_sqrt2_gauss_sigma / static_cast<float>(std::sqrt(2.));
+      t_min = std::max(t_min, .5F - (tof_high + max_dist) / LOR_length);
+      t_max = std::min(t_max, .5F - (tof_low - max_dist) / LOR_length);
+    }
+  // samples where at least one of the interpolation voxels is inside the image
+  restrict_parameter_range(t_min, t_max, start[main_dim], delta[main_dim], -1.F, static_cast<float>(dimensions[main_dim]));
+  restrict_parameter_range(t_min, t_max, start[dim1], delta[dim1], -1.F, static_cast<float>(dimensions[dim1]));
+  restrict_parameter_range(t_min, t_max, start[dim2], delta[dim2], -1.F, static_cast<float>(dimensions[dim2]));
+  if (t_min >= t_max)
+    return;
+
+  // planes along the main direction
+  const float u_at_t_min = start[main_dim] + t_min * delta[main_dim];
+  const float u_at_t_max = start[main_dim] + t_max * delta[main_dim];
+  const int first_plane = std::max(0, static_cast<int>(std::ceil(std::min(u_at_t_min, u_at_t_max))));
+  const int last_plane = std::min(dimensions[main_dim] - 1, static_cast<int>(std::floor(std::max(u_at_t_min, u_at_t_max))));
+
+  const float sample_weight = LOR_length / std::fabs(delta[main_dim]) * rescale;
+  const float r_delta_main = 1 / delta[main_dim];
+
+  for (int plane = first_plane; plane <= last_plane; ++plane)
+    {
+      const float t = (plane - start[main_dim]) * r_delta_main;
+      const float u1 = start[dim1] + t * delta[dim1];
+      const float u2 = start[dim2] + t * delta[dim2];
+      const int i1 = static_cast<int>(std::floor(u1));
+      const int i2 = static_cast<int>(std::floor(u2));
+      const float f1 = u1 - i1;
+      const float f2 = u2 - i2;
+
+      float weight = sample_weight;
+      if (r_sqrt2_gauss_sigma > 0)
+        {
+          const float dist = (.5F - t) * LOR_length;
+          weight *= .5F
+                    * static_cast<float>(std::erf((tof_high - dist) * r_sqrt2_gauss_sigma)
+                                         - std::erf((tof_low - dist) * r_sqrt2_gauss_sigma));
+        }
+
+      const int plane_offset = plane * strides[main_dim];
+      for (int c1 = std::max(i1, 0); c1 <= std::min(i1 + 1, dimensions[dim1] - 1); ++c1)
+        {
+          const float w1 = c1 == i1 ? 1 - f1 : f1;
+          for (int c2 = std::max(i2, 0); c2 <= std::min(i2 + 1, dimensions[dim2] - 1); ++c2)
+            {
+              const float w2 = c2 == i2 ? 1 - f2 : f2;
+              func(plane_offset + c1 * strides[dim1] + c2 * strides[dim2], weight * w1 * w2);
+            }
+        }
+    }
+}
+
+float
+JosephProjectionHelper::forward_project_bin(const float* image_ptr, const Bin& bin) const
+{
+  float sum = 0.F;
+  auto accumulate = [image_ptr, &sum](const int index, const float weight) { sum += image_ptr[index] * weight; };
+  this->for_all_voxels_on_LOR(bin, accumulate);
+  return sum;
+}
+
+void
+JosephProjectionHelper::back_project_bin(float* image_ptr, const Bin& bin, const float value) const
+{
+  if (value == 0)
+    return;
+  auto add = [image_ptr, value](const int index, const float weight) { image_ptr[index] += value * weight; };
+  this->for_all_voxels_on_LOR(bin, add);
+}
+
+} // namespace detail
+
+END_NAMESPACE_STIR
@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2001- 2008, Hammersmith Imanet Ltd
-    Copyright (C) 2019-2020, 2022, University College London
+    Copyright (C) 2019-2020, 2022, 2026, University College London
     Copyright (C) 2016-2017, PETsys Electronics
     Copyright (C) 2021, Gefei Chen
     This file is part of STIR.
@@ -27,6 +27,7 @@
 #include "stir/display.h"
 #include "stir/info.h"
 #include "stir/warning.h"
+#include "stir/error.h"
 #include "stir/ProjData.h"
 #include <boost/format.hpp>
 #include <fstream>
@@ -45,8 +46,11 @@ ML_estimate_component_based_normalisation(const std::string& out_filename_prefix
                                           bool do_block,
                                           bool do_symmetry_per_block,
                                           bool do_KL,
-                                          bool do_display)
+                                          bool do_display,
+                                          const int KL_interval)
 {
+  if (KL_interval < 1)
+    error("ML_estimate_component_based_normalisation: KL_interval has to be at least 1");
 
   const int num_transaxial_blocks = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_transaxial_blocks();
   const int num_axial_blocks = measured_data.get_proj_data_info_sptr()->get_scanner_sptr()->get_num_axial_blocks();
@@ -111,6 +115,9 @@ ML_estimate_component_based_normalisation(const std::string& out_filename_prefix
       make_fan_data_remove_gaps(measured_fan_data, measured_data);
 
       /* TEMP FIX */
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
       for (int ra = model_fan_data.get_min_ra(); ra <= model_fan_data.get_max_ra(); ++ra)
         {
           for (int a = model_fan_data.get_min_a(); a <= model_fan_data.get_max_a(); ++a)
@@ -157,8 +164,11 @@ ML_estimate_component_based_normalisation(const std::string& out_filename_prefix
         }
 #endif
 
-    for (int iter_num = 1; iter_num <= std::max(num_iterations, 1); ++iter_num)
+    const int last_iter_num = std::max(num_iterations, 1);
+    for (int iter_num = 1; iter_num <= last_iter_num; ++iter_num)
       {
+        // only compute the KL every KL_interval iterations (and at the end), as it is relatively expensive
+        const bool do_KL_this_iter = do_KL && (iter_num % KL_interval == 0 || iter_num == last_iter_num);
         if (iter_num == 1)
           {
             efficiencies.fill(sqrt(data_fan_sums.sum() / model_fan_data.sum()));
@@ -182,19 +192,17 @@ ML_estimate_component_based_normalisation(const std::string& out_filename_prefix
                 out << efficiencies;
                 delete[] out_filename;
               }
-              if (do_KL)
+              if (do_KL_this_iter && (eff_iter_num % KL_interval == 0 || eff_iter_num == num_eff_iterations))
                 {
-                  apply_efficiencies(fan_data, efficiencies);
+                  FanProjData model_times_norm = fan_data;
+                  apply_efficiencies(model_times_norm, efficiencies);
                   std::cerr << "measured*norm min " << measured_fan_data.find_min() << " ,max " << measured_fan_data.find_max()
                             << std::endl;
-                  std::cerr << "model*norm min " << fan_data.find_min() << " ,max " << fan_data.find_max() << std::endl;
+                  std::cerr << "model*norm min " << model_times_norm.find_min() << " ,max " << model_times_norm.find_max()
+                            << std::endl;
                   if (do_display)
-                    display(fan_data, "model_times_norm");
-                  info(boost::format("KL %1%") % KL(measured_fan_data, fan_data, threshold_for_KL));
-                  // now restore for further iterations
-                  fan_data = model_fan_data;
-                  apply_geo_norm(fan_data, norm_geo_data);
-                  apply_block_norm(fan_data, norm_block_data);
+                    display(model_times_norm, "model_times_norm");
+                  info(boost::format("KL %1%") % KL(measured_fan_data, model_times_norm, threshold_for_KL));
                 }
               if (do_display)
                 {
@@ -236,7 +244,7 @@ ML_estimate_component_based_normalisation(const std::string& out_filename_prefix
           out << norm_geo_data;
           delete[] out_filename;
         }
-        if (do_KL)
+        if (do_KL_this_iter)
           {
             apply_geo_norm(fan_data, norm_geo_data);
             info(boost::format("KL %1%") % KL(measured_fan_data, fan_data, threshold_for_KL));
@@ -271,7 +279,7 @@ ML_estimate_component_based_normalisation(const std::string& out_filename_prefix
             out << norm_block_data;
             delete[] out_filename;
           }
-          if (do_KL)
+          if (do_KL_this_iter)
             {
               apply_block_norm(fan_data, norm_block_data);
               info(boost::format("KL %1%") % KL(measured_fan_data, fan_data, threshold_for_KL));
@@ -286,7 +294,7 @@ ML_estimate_component_based_normalisation(const std::string& out_filename_prefix
         } // end block
 
         //// print KL for fansums
-        if (do_KL)
+        if (do_KL_this_iter)
           {
             DetectorEfficiencies fan_sums(IndexRange2D(num_physical_rings, num_physical_detectors_per_ring));
             GeoData3D geo_data(num_physical_axial_crystals_per_basic_unit,
@@ -299,7 +307,7 @@ ML_estimate_component_based_normalisation(const std::string& out_filename_prefix
             make_geo_data(geo_data, fan_data);
             make_block_data(block_data, measured_fan_data);
 
-            info(boost::format("KL on fans: %1%, %2") % KL(measured_fan_data, fan_data, 0) % KL(measured_geo_data, geo_data, 0));
+            info(boost::format("KL on fans: %1%, %2%") % KL(measured_fan_data, fan_data, 0) % KL(measured_geo_data, geo_data, 0));
           }
       }
   }
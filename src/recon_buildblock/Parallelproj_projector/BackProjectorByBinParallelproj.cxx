@@ -10,7 +10,7 @@
   \author Kris Thielemans
   \author Nicole Jurjew
 
-    Copyright (C) 2019, 2021, 2024 University College London
+    Copyright (C) 2019, 2021, 2024, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -29,7 +29,10 @@
 #include "stir/recon_array_functions.h"
 #include "stir/ProjDataInMemory.h"
 #include "stir/LORCoordinates.h"
-#include "stir/recon_array_functions.h"
+#include "stir/recon_buildblock/find_basic_vs_nums_in_subsets.h"
+#include "stir/Viewgram.h"
+#include "stir/ViewSegmentNumbers.h"
+#include <boost/format.hpp>
 #ifdef parallelproj_built_with_CUDA
 #  include "parallelproj_cuda.h"
 #else
@@ -88,8 +91,10 @@ BackProjectorByBinParallelproj::set_up(const shared_ptr<const ProjDataInfo>& pro
   check(*proj_data_info_sptr, *_density_sptr);
   _symmetries_sptr.reset(new TrivialDataSymmetriesForBins(proj_data_info_sptr));
 
+#ifdef parallelproj_built_with_CUDA
   // Create sinogram
   _proj_data_to_backproject_sptr.reset(new ProjDataInMemory(this->_density_sptr->get_exam_info_sptr(), proj_data_info_sptr));
+#endif
 
   if (!this->_do_not_setup_helper)
     _helper = std::make_shared<detail::ParallelprojHelper>(*proj_data_info_sptr, *density_info_sptr);
@@ -102,20 +107,7 @@ BackProjectorByBinParallelproj::get_symmetries_used() const
     error("BackProjectorByBin method called without calling set_up first.");
   return _symmetries_sptr.get();
 }
-#if 0
-void
-BackProjectorByBinParallelproj::
-back_project(const ProjData& proj_data, int subset_num, int num_subsets)
-{
-    // Check the user has tried to project all data
-    if (subset_num != 0 || num_subsets != 1)
-        error("BackProjectorByBinParallelproj::back_project "
-              "only works with all data (no subsets).");
-
-    _helper.convert_proj_data_stir_to_niftyPET(_np_sino_w_gaps,proj_data);
-}
-#endif
-
+#ifdef parallelproj_built_with_CUDA
 static void
 TOF_transpose(std::vector<float>& mem_for_PP_back,
               const float* STIR_mem,
@@ -129,10 +121,12 @@ TOF_transpose(std::vector<float>& mem_for_PP_back,
         mem_for_PP_back[lor_idx * num_tof_bins + tof_idx] = STIR_mem[offset + tof_idx * _helper->num_lors + lor_idx];
       }
 }
+#endif
 
 void
 BackProjectorByBinParallelproj::get_output(DiscretisedDensity<3, float>& density) const
 {
+#ifdef parallelproj_built_with_CUDA
   std::vector<float> image_vec;
   float* image_ptr;
   if (_density_sptr->is_contiguous())
@@ -151,8 +145,6 @@ BackProjectorByBinParallelproj::get_output(DiscretisedDensity<3, float>& density
 
   info("Calling parallelproj backprojector", 2);
 
-#ifdef parallelproj_built_with_CUDA
-
   long long num_lors_per_chunk_floor = _helper->num_lors / _num_gpu_chunks;
   long long remainder = _helper->num_lors % _num_gpu_chunks;
 
@@ -173,6 +165,9 @@ BackProjectorByBinParallelproj::get_output(DiscretisedDensity<3, float>& density
         {
           num_lors_per_chunk = num_lors_per_chunk_floor;
         }
+      std::vector<float> xstart, xend;
+      _helper->get_LOR_endpoints(xstart, xend, offset, num_lors_per_chunk);
+
       if (p.get_proj_data_info_sptr()->is_tof_data())
         {
           info("running the CUDA version of parallelproj, about to call function joseph3d_back_tof_sino_cuda", 2);
@@ -183,8 +178,8 @@ BackProjectorByBinParallelproj::get_output(DiscretisedDensity<3, float>& density
           TOF_transpose(mem_for_PP_back, STIR_mem, _helper, offset);
 
           // info("created object mem_for_PP_img", 2);
-          joseph3d_back_tof_sino_cuda(_helper->xend.data() + 3 * offset,
-                                      _helper->xstart.data() + 3 * offset,
+          joseph3d_back_tof_sino_cuda(xend.data(),
+                                      xstart.data(),
                                       image_on_cuda_devices,
                                       _helper->origin.data(),
                                       _helper->voxsize.data(),
@@ -205,8 +200,8 @@ BackProjectorByBinParallelproj::get_output(DiscretisedDensity<3, float>& density
         }
       else
         {
-          joseph3d_back_cuda(_helper->xstart.data() + 3 * offset,
-                             _helper->xend.data() + 3 * offset,
+          joseph3d_back_cuda(xstart.data(),
+                             xend.data(),
                              image_on_cuda_devices,
                              _helper->origin.data(),
                              _helper->voxsize.data(),
@@ -227,43 +222,6 @@ BackProjectorByBinParallelproj::get_output(DiscretisedDensity<3, float>& density
   // free image array from CUDA devices
   free_float_array_on_all_devices(image_on_cuda_devices);
 
-#else
-  if (this->_proj_data_info_sptr->is_tof_data() == 1)
-    {
-      std::vector<float> mem_for_PP_back(_helper->num_lors * _helper->num_tof_bins);
-      const float* STIR_mem = p.get_const_data_ptr();
-
-      TOF_transpose(mem_for_PP_back, STIR_mem, _helper, 0);
-
-      joseph3d_back_tof_sino(_helper->xend.data(),
-                             _helper->xstart.data(),
-                             image_ptr,
-                             _helper->origin.data(),
-                             _helper->voxsize.data(),
-                             mem_for_PP_back.data(),
-                             _helper->num_lors,
-                             _helper->imgdim.data(),
-                             _helper->tofbin_width,
-                             &_helper->sigma_tof,
-                             &_helper->tofcenter_offset,
-                             4, // float n_sigmas,
-                             _helper->num_tof_bins,
-                             0, //  unsigned char lor_dependent_sigma_tof
-                             0  // unsigned char lor_dependent_tofcenter_offset
-      );
-    }
-  else
-    {
-      joseph3d_back(_helper->xstart.data(),
-                    _helper->xend.data(),
-                    image_ptr,
-                    _helper->origin.data(),
-                    _helper->voxsize.data(),
-                    p.get_const_data_ptr(),
-                    static_cast<long long>(p.get_proj_data_info_sptr()->size_all()),
-                    _helper->imgdim.data());
-    }
-#endif
   info("done", 2);
 
   p.release_const_data_ptr();
@@ -279,13 +237,17 @@ BackProjectorByBinParallelproj::get_output(DiscretisedDensity<3, float>& density
     {
       std::copy(image_vec.begin(), image_vec.end(), density.begin_all());
     }
+#else
+  // back projection has already been done in actual_back_project() or back_project()
+  std::copy(_image_vec.begin(), _image_vec.end(), density.begin_all());
+#endif
 
   // After the back projection, we enforce a truncation outside of the FOV.
   // This is because the parallelproj projector seems to have some trouble at the edges and this
   // could cause some voxel values to spiral out of control.
   // if (_use_truncation)
   {
-    const float radius = p.get_proj_data_info_sptr()->get_scanner_sptr()->get_inner_ring_radius();
+    const float radius = this->_proj_data_info_sptr->get_scanner_sptr()->get_inner_ring_radius();
     const float image_radius = _helper->voxsize[2] * _helper->imgdim[2] / 2;
     truncate_rim(density, static_cast<int>(std::max((image_radius - radius) / _helper->voxsize[2], 0.F)));
   }
@@ -296,10 +258,33 @@ BackProjectorByBinParallelproj::start_accumulating_in_new_target()
 {
   // Call base level
   BackProjectorByBin::start_accumulating_in_new_target();
+#ifdef parallelproj_built_with_CUDA
   //  reset the Parallelproj sinogram
   _proj_data_to_backproject_sptr->fill(0.F);
+#else
+  _image_vec.assign(_helper->num_image_voxel, 0.F);
+#endif
 }
 
+#ifndef parallelproj_built_with_CUDA
+//! copy one TOF bin of a viewgram into the input for Parallelproj
+static void
+copy_to_PP(std::vector<float>& mem_for_PP,
+           const Viewgram<float>& viewgram,
+           const int tof_idx,
+           const int num_tof_bins,
+           const int min_axial_pos_num,
+           const int max_axial_pos_num,
+           const int min_tangential_pos_num,
+           const int max_tangential_pos_num)
+{
+  std::size_t lor_idx = 0;
+  for (int axial_pos_num = min_axial_pos_num; axial_pos_num <= max_axial_pos_num; ++axial_pos_num)
+    for (int tangential_pos_num = min_tangential_pos_num; tangential_pos_num <= max_tangential_pos_num; ++tangential_pos_num)
+      mem_for_PP[lor_idx++ * num_tof_bins + tof_idx] = viewgram[axial_pos_num][tangential_pos_num];
+}
+#endif
+
 void
 BackProjectorByBinParallelproj::actual_back_project(const RelatedViewgrams<float>& related_viewgrams,
                                                     const int min_axial_pos_num,
@@ -307,6 +292,7 @@ BackProjectorByBinParallelproj::actual_back_project(const RelatedViewgrams<float
                                                     const int min_tangential_pos_num,
                                                     const int max_tangential_pos_num)
 {
+#ifdef parallelproj_built_with_CUDA
   if ((min_axial_pos_num != this->_proj_data_info_sptr->get_min_axial_pos_num(related_viewgrams.get_basic_segment_num()))
       || (max_axial_pos_num != this->_proj_data_info_sptr->get_max_axial_pos_num(related_viewgrams.get_basic_segment_num()))
       || (min_tangential_pos_num != this->_proj_data_info_sptr->get_min_tangential_pos_num())
@@ -314,6 +300,128 @@ BackProjectorByBinParallelproj::actual_back_project(const RelatedViewgrams<float
     error("STIR wrapping of Parallelproj projectors current only handles projecting all data");
 
   _proj_data_to_backproject_sptr->set_related_viewgrams(related_viewgrams);
+#else
+  // only back project the TOF bin of the viewgrams
+  const int tof_idx = related_viewgrams.get_basic_timing_pos_num() - this->_proj_data_info_sptr->get_min_tof_pos_num();
+  const std::size_t num_lors = static_cast<std::size_t>(max_axial_pos_num - min_axial_pos_num + 1)
+                               * static_cast<std::size_t>(max_tangential_pos_num - min_tangential_pos_num + 1);
+  std::vector<float> mem_for_PP(num_lors);
+  for (RelatedViewgrams<float>::const_iterator iter = related_viewgrams.begin(); iter != related_viewgrams.end(); ++iter)
+    {
+      copy_to_PP(mem_for_PP,
+                 *iter,
+                 /* tof_idx */ 0,
+                 /* num_tof_bins */ 1,
+                 min_axial_pos_num,
+                 max_axial_pos_num,
+                 min_tangential_pos_num,
+                 max_tangential_pos_num);
+      const ViewSegmentNumbers vs(iter->get_view_num(), iter->get_segment_num());
+      back_project_LORs(
+          mem_for_PP, vs, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num, tof_idx);
+    }
+#endif
+}
+
+void
+BackProjectorByBinParallelproj::back_project(const ProjData& proj_data, int subset_num, int num_subsets)
+{
+#ifdef parallelproj_built_with_CUDA
+  BackProjectorByBin::back_project(proj_data, subset_num, num_subsets);
+#else
+  if (!_density_sptr)
+    error("You need to call start_accumulating_in_new_target() before back_project()");
+
+  check(*proj_data.get_proj_data_info_sptr(), *_density_sptr);
+
+  const std::vector<ViewSegmentNumbers> vs_nums_to_process
+      = detail::find_basic_vs_nums_in_subset(*proj_data.get_proj_data_info_sptr(),
+                                             *_symmetries_sptr,
+                                             proj_data.get_min_segment_num(),
+                                             proj_data.get_max_segment_num(),
+                                             subset_num,
+                                             num_subsets);
+
+  // Parallelproj is multi-threaded over LORs, so we loop over views sequentially, handling all TOF bins at once
+  std::vector<float> mem_for_PP;
+  for (const auto& vs : vs_nums_to_process)
+    {
+      info(boost::format("Processing view %1% of segment %2%") % vs.view_num() % vs.segment_num(), 3);
+      const int min_axial_pos_num = proj_data.get_min_axial_pos_num(vs.segment_num());
+      const int max_axial_pos_num = proj_data.get_max_axial_pos_num(vs.segment_num());
+      const int min_tangential_pos_num = proj_data.get_min_tangential_pos_num();
+      const int max_tangential_pos_num = proj_data.get_max_tangential_pos_num();
+      mem_for_PP.resize(static_cast<std::size_t>(max_axial_pos_num - min_axial_pos_num + 1)
+                        * static_cast<std::size_t>(max_tangential_pos_num - min_tangential_pos_num + 1) * _helper->num_tof_bins);
+      for (int k = proj_data.get_min_tof_pos_num(); k <= proj_data.get_max_tof_pos_num(); ++k)
+        {
+          ViewgramIndices viewgram_indices = vs;
+          viewgram_indices.timing_pos_num() = k;
+          copy_to_PP(mem_for_PP,
+                     proj_data.get_viewgram(viewgram_indices),
+                     k - proj_data.get_min_tof_pos_num(),
+                     _helper->num_tof_bins,
+                     min_axial_pos_num,
+                     max_axial_pos_num,
+                     min_tangential_pos_num,
+                     max_tangential_pos_num);
+        }
+      back_project_LORs(mem_for_PP, vs, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
+    }
+#endif
+}
+
+void
+BackProjectorByBinParallelproj::back_project_LORs(const std::vector<float>& mem_for_PP,
+                                                  const ViewSegmentNumbers& vs,
+                                                  const int min_axial_pos_num,
+                                                  const int max_axial_pos_num,
+                                                  const int min_tangential_pos_num,
+                                                  const int max_tangential_pos_num,
+                                                  const int tof_idx)
+{
+#ifdef parallelproj_built_with_CUDA
+  error("BackProjectorByBinParallelproj::back_project_LORs is only implemented for the CPU version of Parallelproj");
+#else
+  std::vector<float> xstart, xend;
+  _helper->get_LOR_endpoints(
+      xstart, xend, vs, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
+  const auto num_lors = static_cast<long long>(xstart.size() / 3);
+
+  if (this->_proj_data_info_sptr->is_tof_data())
+    {
+      const short num_tof_bins = tof_idx >= 0 ? 1 : _helper->num_tof_bins;
+      const float tofcenter_offset
+          = tof_idx >= 0 ? _helper->get_tofcenter_offset_for_TOF_bin(tof_idx) : _helper->tofcenter_offset;
+      joseph3d_back_tof_sino(xend.data(),
+                             xstart.data(),
+                             _image_vec.data(),
+                             _helper->origin.data(),
+                             _helper->voxsize.data(),
+                             mem_for_PP.data(),
+                             num_lors,
+                             _helper->imgdim.data(),
+                             _helper->tofbin_width,
+                             &_helper->sigma_tof,
+                             &tofcenter_offset,
+                             4, // float n_sigmas,
+                             num_tof_bins,
+                             0, //  unsigned char lor_dependent_sigma_tof
+                             0  // unsigned char lor_dependent_tofcenter_offset
+      );
+    }
+  else
+    {
+      joseph3d_back(xstart.data(),
+                    xend.data(),
+                    _image_vec.data(),
+                    _helper->origin.data(),
+                    _helper->voxsize.data(),
+                    mem_for_PP.data(),
+                    num_lors,
+                    _helper->imgdim.data());
+    }
+#endif
 }
 
 END_NAMESPACE_STIR
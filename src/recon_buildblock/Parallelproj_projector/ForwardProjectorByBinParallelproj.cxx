@@ -10,7 +10,7 @@
   \author Richard Brown
   \author Kris Thielemans
   \author Nicole Jurjew
-    Copyright (C) 2019, 2021, 2024 University College London
+    Copyright (C) 2019, 2021, 2024, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -24,11 +24,17 @@
 #include "stir/RelatedViewgrams.h"
 #include "stir/ProjDataInfoCylindricalNoArcCorr.h"
 #include "stir/recon_buildblock/TrivialDataSymmetriesForBins.h"
+#include "stir/recon_buildblock/find_basic_vs_nums_in_subsets.h"
+#include "stir/Viewgram.h"
+#include "stir/ViewSegmentNumbers.h"
+#include "stir/Succeeded.h"
 #include "stir/info.h"
 #include "stir/error.h"
+#include "stir/warning.h"
 #include "stir/recon_array_functions.h"
 #include "stir/utilities.h"
 #include "stir/TOF_conversions.h"
+#include <boost/format.hpp>
 #include <algorithm>
 #ifdef parallelproj_built_with_CUDA
 #  include "parallelproj_cuda.h"
@@ -93,8 +99,10 @@ ForwardProjectorByBinParallelproj::set_up(const shared_ptr<const ProjDataInfo>&
     if (is_null_ptr(proj_data_info_cy_no_ar_cor_sptr))
         error("ForwardProjectorByBinParallelproj: Failed casting to ProjDataInfoCylindricalNoArcCorr");
 #endif
+#ifdef parallelproj_built_with_CUDA
   // Initialise projected_data_sptr from this->_proj_data_info_sptr
   _projected_data_sptr.reset(new ProjDataInMemory(this->_density_sptr->get_exam_info_sptr(), proj_data_info_sptr));
+#endif
   if (!this->_do_not_setup_helper)
     _helper = std::make_shared<detail::ParallelprojHelper>(*proj_data_info_sptr, *density_info_sptr);
 }
@@ -107,6 +115,25 @@ ForwardProjectorByBinParallelproj::get_symmetries_used() const
   return _symmetries_sptr.get();
 }
 
+#ifndef parallelproj_built_with_CUDA
+//! copy the output of Parallelproj for one TOF bin into a viewgram
+static void
+copy_from_PP(Viewgram<float>& viewgram,
+             const std::vector<float>& mem_for_PP,
+             const int tof_idx,
+             const int num_tof_bins,
+             const int min_axial_pos_num,
+             const int max_axial_pos_num,
+             const int min_tangential_pos_num,
+             const int max_tangential_pos_num)
+{
+  std::size_t lor_idx = 0;
+  for (int axial_pos_num = min_axial_pos_num; axial_pos_num <= max_axial_pos_num; ++axial_pos_num)
+    for (int tangential_pos_num = min_tangential_pos_num; tangential_pos_num <= max_tangential_pos_num; ++tangential_pos_num)
+      viewgram[axial_pos_num][tangential_pos_num] = mem_for_PP[lor_idx++ * num_tof_bins + tof_idx];
+}
+#endif
+
 void
 ForwardProjectorByBinParallelproj::actual_forward_project(RelatedViewgrams<float>& viewgrams,
                                                           const int min_axial_pos_num,
@@ -114,6 +141,7 @@ ForwardProjectorByBinParallelproj::actual_forward_project(RelatedViewgrams<float
                                                           const int min_tangential_pos_num,
                                                           const int max_tangential_pos_num)
 {
+#ifdef parallelproj_built_with_CUDA
   if ((min_axial_pos_num != this->_proj_data_info_sptr->get_min_axial_pos_num(viewgrams.get_basic_segment_num()))
       || (max_axial_pos_num != this->_proj_data_info_sptr->get_max_axial_pos_num(viewgrams.get_basic_segment_num()))
       || (min_tangential_pos_num != this->_proj_data_info_sptr->get_min_tangential_pos_num())
@@ -122,8 +150,142 @@ ForwardProjectorByBinParallelproj::actual_forward_project(RelatedViewgrams<float
 
   viewgrams = _projected_data_sptr->get_related_viewgrams(
       viewgrams.get_basic_view_segment_num(), _symmetries_sptr, false, viewgrams.get_basic_timing_pos_num());
+#else
+  // only compute the TOF bin of the viewgrams
+  const int tof_idx = viewgrams.get_basic_timing_pos_num() - this->_proj_data_info_sptr->get_min_tof_pos_num();
+  std::vector<float> mem_for_PP;
+  for (RelatedViewgrams<float>::iterator iter = viewgrams.begin(); iter != viewgrams.end(); ++iter)
+    {
+      const ViewSegmentNumbers vs(iter->get_view_num(), iter->get_segment_num());
+      project_LORs(mem_for_PP, vs, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num, tof_idx);
+      copy_from_PP(*iter,
+                   mem_for_PP,
+                   /* tof_idx */ 0,
+                   /* num_tof_bins */ 1,
+                   min_axial_pos_num,
+                   max_axial_pos_num,
+                   min_tangential_pos_num,
+                   max_tangential_pos_num);
+    }
+#endif
+}
+
+void
+ForwardProjectorByBinParallelproj::forward_project(ProjData& proj_data, int subset_num, int num_subsets, bool zero)
+{
+#ifdef parallelproj_built_with_CUDA
+  ForwardProjectorByBin::forward_project(proj_data, subset_num, num_subsets, zero);
+#else
+  if (!_density_sptr)
+    error("You need to call set_input() forward_project()");
+
+  if (_density_sptr->get_exam_info().imaging_modality.is_unknown() || proj_data.get_exam_info().imaging_modality.is_unknown())
+    warning("forward_project. Imaging modality unknown for either the image or the projection data or both.\n"
+            "Going ahead anyway.");
+  else if (_density_sptr->get_exam_info().imaging_modality != proj_data.get_exam_info().imaging_modality)
+    error("forward_project: Imaging modality should be the same for the image and the projection data");
+  if (subset_num < 0 || subset_num > num_subsets - 1)
+    error(boost::format("forward_project: wrong subset number %1% (must be less than the number of subsets %2%)") % subset_num
+          % num_subsets);
+  if (zero && num_subsets > 1)
+    proj_data.fill(0.0);
+
+  check(*proj_data.get_proj_data_info_sptr(), *_density_sptr);
+
+  const std::vector<ViewSegmentNumbers> vs_nums_to_process
+      = detail::find_basic_vs_nums_in_subset(*proj_data.get_proj_data_info_sptr(),
+                                             *_symmetries_sptr,
+                                             proj_data.get_min_segment_num(),
+                                             proj_data.get_max_segment_num(),
+                                             subset_num,
+                                             num_subsets);
+
+  // Parallelproj is multi-threaded over LORs, so we loop over views sequentially, computing all TOF bins at once
+  std::vector<float> mem_for_PP;
+  for (const auto& vs : vs_nums_to_process)
+    {
+      info(boost::format("Processing view %1% of segment %2%") % vs.view_num() % vs.segment_num(), 3);
+      const int min_axial_pos_num = proj_data.get_min_axial_pos_num(vs.segment_num());
+      const int max_axial_pos_num = proj_data.get_max_axial_pos_num(vs.segment_num());
+      const int min_tangential_pos_num = proj_data.get_min_tangential_pos_num();
+      const int max_tangential_pos_num = proj_data.get_max_tangential_pos_num();
+      project_LORs(mem_for_PP, vs, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
+      for (int k = proj_data.get_min_tof_pos_num(); k <= proj_data.get_max_tof_pos_num(); ++k)
+        {
+          ViewgramIndices viewgram_indices = vs;
+          viewgram_indices.timing_pos_num() = k;
+          Viewgram<float> viewgram = proj_data.get_empty_viewgram(viewgram_indices);
+          copy_from_PP(viewgram,
+                       mem_for_PP,
+                       k - proj_data.get_min_tof_pos_num(),
+                       _helper->num_tof_bins,
+                       min_axial_pos_num,
+                       max_axial_pos_num,
+                       min_tangential_pos_num,
+                       max_tangential_pos_num);
+          if (proj_data.set_viewgram(viewgram) != Succeeded::yes)
+            error("Error set_viewgram in forward projecting");
+        }
+    }
+#endif
+}
+
+void
+ForwardProjectorByBinParallelproj::project_LORs(std::vector<float>& mem_for_PP,
+                                                const ViewSegmentNumbers& vs,
+                                                const int min_axial_pos_num,
+                                                const int max_axial_pos_num,
+                                                const int min_tangential_pos_num,
+                                                const int max_tangential_pos_num,
+                                                const int tof_idx) const
+{
+#ifdef parallelproj_built_with_CUDA
+  error("ForwardProjectorByBinParallelproj::project_LORs is only implemented for the CPU version of Parallelproj");
+#else
+  std::vector<float> xstart, xend;
+  _helper->get_LOR_endpoints(
+      xstart, xend, vs, min_axial_pos_num, max_axial_pos_num, min_tangential_pos_num, max_tangential_pos_num);
+  const auto num_lors = static_cast<long long>(xstart.size() / 3);
+
+  if (this->_proj_data_info_sptr->is_tof_data())
+    {
+      const short num_tof_bins = tof_idx >= 0 ? 1 : _helper->num_tof_bins;
+      const float tofcenter_offset
+          = tof_idx >= 0 ? _helper->get_tofcenter_offset_for_TOF_bin(tof_idx) : _helper->tofcenter_offset;
+      mem_for_PP.resize(num_lors * num_tof_bins);
+      joseph3d_fwd_tof_sino(xend.data(),
+                            xstart.data(),
+                            _image_vec.data(),
+                            _helper->origin.data(),
+                            _helper->voxsize.data(),
+                            mem_for_PP.data(),
+                            num_lors,
+                            _helper->imgdim.data(),
+                            _helper->tofbin_width,
+                            &_helper->sigma_tof,
+                            &tofcenter_offset,
+                            4, // float n_sigmas,
+                            num_tof_bins,
+                            0, //  unsigned char lor_dependent_sigma_tof
+                            0  // unsigned char lor_dependent_tofcenter_offset
+      );
+    }
+  else
+    {
+      mem_for_PP.resize(num_lors);
+      joseph3d_fwd(xstart.data(),
+                   xend.data(),
+                   _image_vec.data(),
+                   _helper->origin.data(),
+                   _helper->voxsize.data(),
+                   mem_for_PP.data(),
+                   num_lors,
+                   _helper->imgdim.data());
+    }
+#endif
 }
 
+#ifdef parallelproj_built_with_CUDA
 static void
 TOF_transpose(float* STIR_mem,
               const std::vector<float>& mem_for_PP,
@@ -138,6 +300,7 @@ TOF_transpose(float* STIR_mem,
         STIR_mem[offset + tof_idx * _helper->num_lors + lor_idx] = mem_for_PP[lor_idx * num_tof_bins + tof_idx];
       }
 }
+#endif
 
 void
 ForwardProjectorByBinParallelproj::set_input(const DiscretisedDensity<3, float>& density)
@@ -154,6 +317,7 @@ ForwardProjectorByBinParallelproj::set_input(const DiscretisedDensity<3, float>&
     truncate_rim(*_density_sptr, static_cast<int>(std::max((image_radius - radius) / _helper->voxsize[2], 0.F)));
   }
 
+#ifdef parallelproj_built_with_CUDA
   std::vector<float> image_vec;
   float* image_ptr;
   if (_density_sptr->is_contiguous())
@@ -167,15 +331,8 @@ ForwardProjectorByBinParallelproj::set_input(const DiscretisedDensity<3, float>&
       image_ptr = image_vec.data();
     }
 
-#if 0
-    // needed to set output to zero as parallelproj accumulates but is no longer the case
-    _projected_data_sptr->fill(0.F);
-#endif
-
   info("Calling parallelproj forward", 2);
 
-#ifdef parallelproj_built_with_CUDA
-
   long long num_lors_per_chunk_floor
       = _helper->num_lors / _num_gpu_chunks; // num_lors=407, num_GPU_chunks = 10, --> num_lors_per_chunk_floor = 407/10 = 40
   long long remainder = _helper->num_lors % _num_gpu_chunks; // remainder = 7; so in 7 chunks I'll have 1 LOR more
@@ -198,12 +355,15 @@ ForwardProjectorByBinParallelproj::set_input(const DiscretisedDensity<3, float>&
           num_lors_per_chunk = num_lors_per_chunk_floor;
         }
 
+      std::vector<float> xstart, xend;
+      _helper->get_LOR_endpoints(xstart, xend, offset, num_lors_per_chunk);
+
       if (_proj_data_info_sptr->is_tof_data())
         {
 
           std::vector<float> mem_for_PP(num_lors_per_chunk * _helper->num_tof_bins);
-          joseph3d_fwd_tof_sino_cuda(_helper->xend.data() + 3 * offset,
-                                     _helper->xstart.data() + 3 * offset,
+          joseph3d_fwd_tof_sino_cuda(xend.data(),
+                                     xstart.data(),
                                      image_on_cuda_devices,
                                      _helper->origin.data(),
                                      _helper->voxsize.data(),
@@ -231,8 +391,8 @@ ForwardProjectorByBinParallelproj::set_input(const DiscretisedDensity<3, float>&
         }
       else
         {
-          joseph3d_fwd_cuda(_helper->xstart.data() + 3 * offset,
-                            _helper->xend.data() + 3 * offset,
+          joseph3d_fwd_cuda(xstart.data(),
+                            xend.data(),
                             image_on_cuda_devices,
                             _helper->origin.data(),
                             _helper->voxsize.data(),
@@ -249,43 +409,6 @@ ForwardProjectorByBinParallelproj::set_input(const DiscretisedDensity<3, float>&
   // free image array from CUDA devices
   free_float_array_on_all_devices(image_on_cuda_devices);
 
-#else
-  if (this->_proj_data_info_sptr->is_tof_data() == 1)
-    {
-
-      std::vector<float> mem_for_PP(_helper->num_lors * _helper->num_tof_bins);
-      joseph3d_fwd_tof_sino(_helper->xend.data(),
-                            _helper->xstart.data(),
-                            image_ptr,
-                            _helper->origin.data(),
-                            _helper->voxsize.data(),
-                            mem_for_PP.data(),
-                            _helper->num_lors,
-                            _helper->imgdim.data(),
-                            _helper->tofbin_width,
-                            &_helper->sigma_tof,
-                            &_helper->tofcenter_offset,
-                            4, // float n_sigmas,
-                            _helper->num_tof_bins,
-                            0, //  unsigned char lor_dependent_sigma_tof
-                            0  // unsigned char lor_dependent_tofcenter_offset
-      );
-
-      float* STIR_mem = _projected_data_sptr->get_data_ptr();
-      TOF_transpose(STIR_mem, mem_for_PP, _helper, 0, _helper->num_lors);
-    }
-  else
-    {
-      joseph3d_fwd(_helper->xstart.data(),
-                   _helper->xend.data(),
-                   image_ptr,
-                   _helper->origin.data(),
-                   _helper->voxsize.data(),
-                   _projected_data_sptr->get_data_ptr(),
-                   static_cast<long long>(_projected_data_sptr->get_proj_data_info_sptr()->size_all()),
-                   _helper->imgdim.data());
-    }
-#endif
   info("done", 2);
 
   if (_density_sptr->is_contiguous())
@@ -293,6 +416,11 @@ ForwardProjectorByBinParallelproj::set_input(const DiscretisedDensity<3, float>&
       _density_sptr->release_full_data_ptr();
     }
   _projected_data_sptr->release_data_ptr();
+#else
+  // projection itself is done per view in actual_forward_project() or forward_project()
+  _image_vec.resize(_density_sptr->size_all());
+  std::copy(_density_sptr->begin_all_const(), _density_sptr->end_all_const(), _image_vec.begin());
+#endif
 }
 
 END_NAMESPACE_STIR
@@ -8,7 +8,7 @@
 
   \author Kris Thielemans
   \author Nicole Jurjew
-    Copyright (C) 2021, 2023, 2024 University College London
+    Copyright (C) 2021, 2023, 2024, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -22,12 +22,10 @@
 #include "stir/LORCoordinates.h"
 #include "stir/Bin.h"
 #include "stir/TOF_conversions.h"
-
-// for debugging, remove later
+#include "stir/ViewSegmentNumbers.h"
 #include "stir/info.h"
-#include "stir/stream.h"
-#include <iostream>
-#include "stir/num_threads.h"
+#include "stir/error.h"
+#include <algorithm>
 
 START_NAMESPACE_STIR
 
@@ -42,8 +40,7 @@ copy_to_array(const BasicCoordinate<3, T>& c, std::array<T, 3>& a)
 }
 
 detail::ParallelprojHelper::ParallelprojHelper(const ProjDataInfo& p_info, const DiscretisedDensity<3, float>& density)
-    : xstart(p_info.size_all() * 3),
-      xend(p_info.size_all() * 3)
+    : proj_data_info_sptr(p_info.create_shared_clone())
 {
   info("Creating parallelproj data-structures", 2);
 
@@ -53,9 +50,9 @@ detail::ParallelprojHelper::ParallelprojHelper(const ProjDataInfo& p_info, const
 #ifndef NEWSCALE
   // parallelproj projectors work in units of the voxel_size passed.
   // STIR projectors have to be in pixel units, so convert the voxel-size
-  const float rescale = 1 / stir_voxel_size[3];
+  rescale = 1 / stir_voxel_size[3];
 #else
-  const float rescale = 1.F;
+  rescale = 1.F;
 #endif
 
   num_image_voxel = static_cast<long long>(stir_image.size_all());
@@ -77,93 +74,120 @@ detail::ParallelprojHelper::ParallelprojHelper(const ProjDataInfo& p_info, const
   coord_first_voxel[1] -= (stir_image.get_min_index() + stir_image.get_max_index()) / 2.F * stir_voxel_size[1];
   copy_to_array(coord_first_voxel * rescale, origin);
 
-  // loop over all LORs in the projdata
-  const float radius = p_info.get_scanner_sptr()->get_max_FOV_radius();
-
-  // warning: next loop needs to be the same as how ProjDataInMemory stores its data. There is no guarantee that this will remain
+  radius = p_info.get_scanner_sptr()->get_max_FOV_radius();
+  // warning: this needs to be the same as how ProjDataInMemory stores its data. There is no guarantee that this will remain
   // the case in the future.
-  const auto segment_sequence = ProjData::standard_segment_sequence(p_info);
-  std::size_t index(0);
+  segment_sequence = ProjData::standard_segment_sequence(p_info);
+
+  info("done", 2);
+}
+
+float
+detail::ParallelprojHelper::get_tofcenter_offset_for_TOF_bin(const int tof_idx) const
+{
+  return tofcenter_offset + (tof_idx - num_tof_bins / 2) * tofbin_width;
+}
+
+void
+detail::ParallelprojHelper::set_LOR_endpoints(float* xstart_ptr, float* xend_ptr, const Bin& bin) const
+{
+  LORInAxialAndNoArcCorrSinogramCoordinates<float> lor;
+  LORAs2Points<float> lor_points;
+
+  proj_data_info_sptr->get_LOR(lor, bin);
+  if (lor.get_intersections_with_cylinder(lor_points, radius) == Succeeded::no)
+    {
+      // just passing in points that will produce nothing
+      std::fill(xstart_ptr, xstart_ptr + 3, 0.F);
+      std::fill(xend_ptr, xend_ptr + 3, 0.F);
+    }
+  else
+    {
+      const auto p1 = lor_points.p1() * rescale;
+      const auto p2 = lor_points.p2() * rescale;
+      std::copy(p1.begin(), p1.end(), xstart_ptr);
+      std::copy(p2.begin(), p2.end(), xend_ptr);
+    }
+}
+
+void
+detail::ParallelprojHelper::get_LOR_endpoints(std::vector<float>& xstart,
+                                              std::vector<float>& xend,
+                                              const long long first_lor_num,
+                                              const long long num_lors_to_compute) const
+{
+  xstart.resize(num_lors_to_compute * 3);
+  xend.resize(num_lors_to_compute * 3);
 
+  const ProjDataInfo& p_info = *proj_data_info_sptr;
+  const long long num_tangential_poss = p_info.get_num_tangential_poss();
+  const long long num_lors_per_axial_pos = p_info.get_num_views() * num_tangential_poss;
+
+  // find segment and axial position of the first LOR
+  auto seg_iter = segment_sequence.begin();
+  long long lor_num = first_lor_num;
+  while (lor_num >= p_info.get_num_axial_poss(*seg_iter) * num_lors_per_axial_pos)
+    {
+      lor_num -= p_info.get_num_axial_poss(*seg_iter) * num_lors_per_axial_pos;
+      ++seg_iter;
+      if (seg_iter == segment_sequence.end())
+        error("ParallelprojHelper::get_LOR_endpoints: LOR number too large");
+    }
+
+  long long index = 0;
+  for (; seg_iter != segment_sequence.end() && index < num_lors_to_compute; ++seg_iter)
+    {
+      const int seg = *seg_iter;
+      const long long num_lors_in_segment = p_info.get_num_axial_poss(seg) * num_lors_per_axial_pos;
+      const long long num_lors_in_this_segment = std::min(num_lors_in_segment - lor_num, num_lors_to_compute - index);
 #ifdef STIR_OPENMP
-  // Using too many threads is counterproductive according to my timings, so I limited to 8 (not necessarily optimal!).
-  const auto num_threads_to_use = std::min(8, get_max_num_threads());
-#  if _OPENMP >= 201012
-#    define ATOMICWRITE _Pragma("omp atomic write")
-
-#    define CRITICALSECTION
-#  else
-#    define ATOMICWRITE
-#    if defined(_MSC_VER) && (_MSC_VER < 1910)
-  // no _Pragma until VS 2017
-#      define CRITICALSECTION
-#    else
-#      define CRITICALSECTION _Pragma("omp critical(PARALLELPROJHELPER_INIT)")
-#    endif
-#  endif
-#else
-#  define ATOMICWRITE
-#  define CRITICALSECTION
+#  pragma omp parallel for
 #endif
-  for (int seg : segment_sequence)
-    {
-      for (int axial_pos_num = p_info.get_min_axial_pos_num(seg); axial_pos_num <= p_info.get_max_axial_pos_num(seg);
-           ++axial_pos_num)
+      for (long long i = 0; i < num_lors_in_this_segment; ++i)
         {
-          for (int view_num = p_info.get_min_view_num(); view_num <= p_info.get_max_view_num(); ++view_num)
-            {
+          const long long lor_num_in_segment = lor_num + i;
+          const Bin bin(seg,
+                        p_info.get_min_view_num() + static_cast<int>((lor_num_in_segment / num_tangential_poss) % p_info.get_num_views()),
+                        p_info.get_min_axial_pos_num(seg) + static_cast<int>(lor_num_in_segment / num_lors_per_axial_pos),
+                        p_info.get_min_tangential_pos_num() + static_cast<int>(lor_num_in_segment % num_tangential_poss));
+          set_LOR_endpoints(&xstart[(index + i) * 3], &xend[(index + i) * 3], bin);
+        }
+      index += num_lors_in_this_segment;
+      lor_num = 0;
+    }
+  if (index != num_lors_to_compute)
+    error("ParallelprojHelper::get_LOR_endpoints: LOR number too large");
+}
+
+void
+detail::ParallelprojHelper::get_LOR_endpoints(std::vector<float>& xstart,
+                                              std::vector<float>& xend,
+                                              const ViewSegmentNumbers& vs,
+                                              const int min_axial_pos_num,
+                                              const int max_axial_pos_num,
+                                              const int min_tangential_pos_num,
+                                              const int max_tangential_pos_num) const
+{
+  const int num_tangential_poss = max_tangential_pos_num - min_tangential_pos_num + 1;
+  const std::size_t num_lors_to_compute
+      = static_cast<std::size_t>(max_axial_pos_num - min_axial_pos_num + 1) * static_cast<std::size_t>(num_tangential_poss);
+  xstart.resize(num_lors_to_compute * 3);
+  xend.resize(num_lors_to_compute * 3);
+
 #ifdef STIR_OPENMP
-#  pragma omp parallel for num_threads(num_threads_to_use)
+#  pragma omp parallel for
 #endif
-              for (int tangential_pos_num = p_info.get_min_tangential_pos_num();
-                   tangential_pos_num <= p_info.get_max_tangential_pos_num();
-                   ++tangential_pos_num)
-                {
-                  Bin bin;
-                  bin.segment_num() = seg;
-                  bin.axial_pos_num() = axial_pos_num;
-                  bin.view_num() = view_num;
-                  bin.tangential_pos_num() = tangential_pos_num;
-                  // compute index for this bin (independent of multi-threading)
-                  const std::size_t this_index = index + (bin.tangential_pos_num() - p_info.get_min_tangential_pos_num()) * 3;
-                  LORInAxialAndNoArcCorrSinogramCoordinates<float> lor;
-                  LORAs2Points<float> lor_points;
-
-                  p_info.get_LOR(lor, bin);
-                  if (lor.get_intersections_with_cylinder(lor_points, radius) == Succeeded::no)
-                    {
-                      // memory is already allocated, so just passing in points that will produce nothing
-                      CRITICALSECTION
-                      {
-                        ATOMICWRITE xstart[this_index] = 0;
-                        ATOMICWRITE xend[this_index] = 0;
-                        ATOMICWRITE xstart[this_index + 1] = 0;
-                        ATOMICWRITE xend[this_index + 1] = 0;
-                        ATOMICWRITE xstart[this_index + 2] = 0;
-                        ATOMICWRITE xend[this_index + 2] = 0;
-                      }
-                    }
-                  else
-                    {
-                      const auto p1 = lor_points.p1() * rescale;
-                      const auto p2 = lor_points.p2() * rescale;
-                      CRITICALSECTION
-                      {
-                        ATOMICWRITE xstart[this_index] = p1[1];
-                        ATOMICWRITE xend[this_index] = p2[1];
-                        ATOMICWRITE xstart[this_index + 1] = p1[2];
-                        ATOMICWRITE xend[this_index + 1] = p2[2];
-                        ATOMICWRITE xstart[this_index + 2] = p1[3];
-                        ATOMICWRITE xend[this_index + 2] = p2[3];
-                      }
-                    }
-                }
-              index += p_info.get_num_tangential_poss() * 3;
-            }
+  for (int axial_pos_num = min_axial_pos_num; axial_pos_num <= max_axial_pos_num; ++axial_pos_num)
+    {
+      for (int tangential_pos_num = min_tangential_pos_num; tangential_pos_num <= max_tangential_pos_num; ++tangential_pos_num)
+        {
+          const Bin bin(vs.segment_num(), vs.view_num(), axial_pos_num, tangential_pos_num);
+          const std::size_t index = (static_cast<std::size_t>(axial_pos_num - min_axial_pos_num) * num_tangential_poss
+                                     + (tangential_pos_num - min_tangential_pos_num))
+                                    * 3;
+          set_LOR_endpoints(&xstart[index], &xend[index], bin);
         }
     }
-
-  info("done", 2);
 }
 
 END_NAMESPACE_STIR
@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2022, Matthew Strugari
     Copyright (C) 2014, Biomedical Image Group (GIB), Universitat de Barcelona, Barcelona, Spain. All rights reserved.
-    Copyright (C) 2014, 2021, University College London
+    Copyright (C) 2014, 2021, 2026, University College London
     This file is part of STIR.
 
     This software is distributed WITHOUT ANY WARRANTY;
@@ -18,6 +18,7 @@
 #include <iostream>
 #include <stdlib.h>
 #include <string>
+#include <vector>
 #include <math.h>
 
 // user defined libraries
@@ -54,6 +55,34 @@ namespace SPECTUB_mph
 
 using namespace std;
 
+namespace
+{
+//! one weight of the matrix, as stored before copying it into wm_da_type
+struct weight_item_type
+{
+  int jp;       // projection index (row index of the weight matrix)
+  int iv;       // volume index of the voxel (column index of the weight matrix)
+  float weight; // value
+};
+
+//! copy of a psf2d_type with its own memory for the values (for use as thread-local scratch space)
+struct psf2d_copy_type
+{
+  explicit psf2d_copy_type(const psf2d_type& psf_v)
+      : psf(psf_v),
+        values(psf_v.max_dimz, std::vector<float>(psf_v.max_dimx)),
+        rows(psf_v.max_dimz)
+  {
+    for (int i = 0; i < psf.max_dimz; i++)
+      rows[i] = values[i].data();
+    psf.val = rows.data();
+  }
+  psf2d_type psf;
+  std::vector<std::vector<float>> values;
+  std::vector<float*> rows;
+};
+} // namespace
+
 //==========================================================================
 //=== wm_calculation =======================================================
 //==========================================================================
@@ -72,25 +101,10 @@ wm_calculation_mph(bool do_calc,
                    wm_da_type& wm,
                    pcf_type& pcf)
 {
-  voxel_type vox;   // structure with voxel information
-  bin_type bin;     // structure with bin information
-  lor_type l;       // structure with lor information
-  discrf2d_type* f; // structure with cumsum function
-
-  float weight;
-  float coeff_att = (float)1.;
-  int jp;
-  float w_max = -1.;
-  int Dimxd2, Dimyd2;
-
   //... collimator parameters ........................................
 
   mphcoll_type* c = &wmh.collim;
 
-  //... STIR origin offset .......................................
-  Dimxd2 = wmh.vol.Dimx / 2;
-  Dimyd2 = wmh.vol.Dimy / 2;
-
   if (do_calc)
     {
 
@@ -99,7 +113,7 @@ wm_calculation_mph(bool do_calc,
       if (wm.do_save_STIR)
         {
 
-          jp = -1; // projection index (row index of the weight matrix )
+          int jp = -1; // projection index (row index of the weight matrix )
           int j1;
 
           for (int j = 0; j < wmh.prj.NdOS; j++)
@@ -125,183 +139,215 @@ wm_calculation_mph(bool do_calc,
         }
     }
 
-  //=== LOOP1: IMAGE SLICES ================================================================
+  //... weights are first stored per image slice, such that slices can be computed in parallel ..........
+  //... and the weight matrix can be filled in the same order as a sequential calculation ..........
+  //... (size estimation is done sequentially as it increments Nitems) ..........
 
-  for (vox.iz = wmh.vol.first_sl; vox.iz < wmh.vol.last_sl; vox.iz++)
-    {
+  std::vector<std::vector<weight_item_type>> weights_per_slice(do_calc ? wmh.vol.Dimz : 0);
 
-      vox.z = wmh.vol.z0 + vox.iz * wmh.vol.thcm;
+#ifdef STIR_OPENMP
+#  pragma omp parallel if (do_calc)
+#endif
+  {
+    voxel_type vox;   // structure with voxel information
+    bin_type bin;     // structure with bin information
+    lor_type l;       // structure with lor information
+    discrf2d_type* f; // structure with cumsum function
 
-      // cout << "weights: " << 100.*(vox.iz+1)/wmh.vol.Dimz << "%" << endl;
+    float weight;
+    float coeff_att = (float)1.;
+    int jp;
 
-      //=== LOOP2: IMAGE ROWS =======================================================================
+    //... local copies of the PSF structures (with their own memory for the values) .................
 
-      for (vox.iy = 0, vox.ip = 0; vox.iy < wmh.vol.Dimy; vox.iy++)
-        {
+    psf2d_copy_type psf_bin_copy(*psf_bin);
+    psf2d_copy_type psf_subs_copy(wmh.do_subsamp ? *psf_subs : psf2d_type());
+    psf2d_copy_type psf_aux_copy(wmh.do_subsamp && wmh.do_psfi ? *psf_aux : psf2d_type());
 
-          vox.y = wmh.vol.y0 + vox.iy * wmh.vol.szcm; // y coordinate of the voxel (index 0->Dimy-1: ix)
+    //=== LOOP1: IMAGE SLICES ================================================================
 
-          //=== LOOP3: IMAGE COLUMNS =================================================================
+#ifdef STIR_OPENMP
+#  pragma omp for schedule(dynamic)
+#endif
+    for (int iz = wmh.vol.first_sl; iz < wmh.vol.last_sl; iz++)
+      {
+        vox.iz = iz;
 
-          for (vox.ix = 0; vox.ix < wmh.vol.Dimx; vox.ix++, vox.ip++)
-            {
+        vox.z = wmh.vol.z0 + vox.iz * wmh.vol.thcm;
 
-              vox.iv = vox.iz * wmh.vol.Npix + vox.ip;
+        //=== LOOP2: IMAGE ROWS =======================================================================
 
-              if (!msk_3d[vox.iv])
-                continue;
+        for (vox.iy = 0, vox.ip = 0; vox.iy < wmh.vol.Dimy; vox.iy++)
+          {
 
-              vox.x = wmh.vol.x0 + vox.ix * wmh.vol.szcm; // x coordinate of the voxel (index 0->Dimx-1: ix)
+            vox.y = wmh.vol.y0 + vox.iy * wmh.vol.szcm; // y coordinate of the voxel (index 0->Dimy-1: ix)
 
-              //=== LOOP4: DETELS: DETECTOR ELEMENTS ===========================================
+            //=== LOOP3: IMAGE COLUMNS =================================================================
 
-              for (int k = 0; k < wmh.prj.NdOS; k++)
-                {
+            for (vox.ix = 0; vox.ix < wmh.vol.Dimx; vox.ix++, vox.ip++)
+              {
 
-                  detel_type* d = &wmh.detel[kOS];
+                vox.iv = vox.iz * wmh.vol.Npix + vox.ip;
 
-                  //... cordinates of the voxel in the rotated reference system. .................
+                if (!msk_3d[vox.iv])
+                  continue;
 
-                  vox.x1 = vox.x * d->costh + vox.y * d->sinth;
-                  vox.y1 = -vox.x * d->sinth + vox.y * d->costh;
+                vox.x = wmh.vol.x0 + vox.ix * wmh.vol.szcm; // x coordinate of the voxel (index 0->Dimx-1: ix)
 
-                  //=== LOOP5: HOLES PER DETEL ====================================
+                //=== LOOP4: DETELS: DETECTOR ELEMENTS ===========================================
 
-                  for (int ih = 0; ih < d->nh; ih++)
-                    {
+                for (int k = 0; k < wmh.prj.NdOS; k++)
+                  {
 
-                      hole_type* h = &c->holes[d->who[ih]];
+                    detel_type* d = &wmh.detel[kOS];
 
-                      if (!check_xang_par(&vox, h))
-                        continue;
-                      if (!check_zang_par(&vox, h))
-                        continue;
+                    //... cordinates of the voxel in the rotated reference system. .................
 
-                      //...vector voxel-hole, angles and distances...............................
+                    vox.x1 = vox.x * d->costh + vox.y * d->sinth;
+                    vox.y1 = -vox.x * d->sinth + vox.y * d->costh;
 
-                      voxel_projection_mph(&l, &vox, h, wmh);
+                    //=== LOOP5: HOLES PER DETEL ====================================
 
-                      //... hole shape .......................................
+                    for (int ih = 0; ih < d->nh; ih++)
+                      {
 
-                      if (h->do_round)
-                        f = &pcf.round;
-                      else
-                        f = &pcf.square;
+                        hole_type* h = &c->holes[d->who[ih]];
 
-                      //... geometrical part of the PSF ....................................
+                        if (!check_xang_par(&vox, h))
+                          continue;
+                        if (!check_zang_par(&vox, h))
+                          continue;
 
-                      if (wmh.do_subsamp)
-                        {
+                        //...vector voxel-hole, angles and distances...............................
 
-                          if (wmh.do_depth)
-                            fill_psf_depth(psf_subs, &l, f, wmh.subsamp, do_calc, wmh, pcf);
+                        voxel_projection_mph(&l, &vox, h, wmh);
 
-                          else
-                            fill_psf_geo(psf_subs, &l, f, wmh.subsamp, do_calc, wmh);
+                        //... hole shape .......................................
 
-                          if (wmh.do_psfi)
-                            psf_convol(psf_subs, psf_aux, kern, do_calc);
+                        if (h->do_round)
+                          f = &pcf.round;
+                        else
+                          f = &pcf.square;
 
-                          downsample_psf(psf_subs, psf_bin, wmh.subsamp, do_calc);
-                        }
+                        //... geometrical part of the PSF ....................................
 
-                      else
-                        fill_psf_geo(psf_bin, &l, f, 1, do_calc, wmh);
+                        psf2d_type* const psf_b = &psf_bin_copy.psf;
 
-                      //... calculus of simple attenuation .............................
+                        if (wmh.do_subsamp)
+                          {
 
-                      if (do_calc)
-                        {
+                            if (wmh.do_depth)
+                              fill_psf_depth(&psf_subs_copy.psf, &l, f, wmh.subsamp, do_calc, wmh, pcf);
 
-                          if (wmh.do_att && !wmh.do_full_att)
-                            { // simple correction for attenuation
+                            else
+                              fill_psf_geo(&psf_subs_copy.psf, &l, f, wmh.subsamp, do_calc, wmh);
 
-                              bin.x = d->x0 + l.x1d_l * d->costh; // x coord of the projection of the center of the voxel in
-                              bin.y = d->y0 + l.x1d_l * d->sinth;
-                              bin.z = d->z0 + l.z1d_l;
+                            if (wmh.do_psfi)
+                              psf_convol(&psf_subs_copy.psf, &psf_aux_copy.psf, kern, do_calc);
 
-                              coeff_att = calc_att_mph(bin, vox, attmap, wmh);
-                            }
-                        }
+                            downsample_psf(&psf_subs_copy.psf, psf_b, wmh.subsamp, do_calc);
+                          }
 
-                      //=== LOOP6: z-dim of PSF ====================================
+                        else
+                          fill_psf_geo(psf_b, &l, f, 1, do_calc, wmh);
 
-                      for (int j = 0, jb = psf_bin->jb0; j < psf_bin->dimz; j++, jb++)
-                        {
+                        //... calculus of simple attenuation .............................
 
-                          if (jb < 0)
-                            continue;
-                          if (jb >= wmh.prj.Nsli)
-                            continue;
+                        if (do_calc)
+                          {
 
-                          //=== LOOP7: x-dim of PSF ====================================
+                            if (wmh.do_att && !wmh.do_full_att)
+                              { // simple correction for attenuation
 
-                          for (int i = 0, ib = psf_bin->ib0; i < psf_bin->dimx; i++, ib++)
-                            {
+                                bin.x = d->x0 + l.x1d_l * d->costh; // x coord of the projection of the center of the voxel in
+                                bin.y = d->y0 + l.x1d_l * d->sinth;
+                                bin.z = d->z0 + l.z1d_l;
 
-                              if (ib < 0)
-                                continue;
-                              if (ib >= wmh.prj.Nbin)
-                                continue;
+                                coeff_att = calc_att_mph(bin, vox, attmap, wmh);
+                              }
+                          }
 
-                              jp = k * wmh.prj.NbOS + jb * wmh.prj.Nbin + ib;
+                        //=== LOOP6: z-dim of PSF ====================================
 
-                              if (do_calc)
-                                {
+                        for (int j = 0, jb = psf_b->jb0; j < psf_b->dimz; j++, jb++)
+                          {
 
-                                  weight = psf_bin->val[j][i] * l.eff / psf_bin->sum;
+                            if (jb < 0)
+                              continue;
+                            if (jb >= wmh.prj.Nsli)
+                              continue;
 
-                                  if (weight < wmh.mn_w)
-                                    continue;
+                            //=== LOOP7: x-dim of PSF ====================================
 
-                                  //... to fill image STIR indices ...........................
+                            for (int i = 0, ib = psf_b->ib0; i < psf_b->dimx; i++, ib++)
+                              {
 
-                                  if (wm.do_save_STIR)
-                                    {
-                                      wm.nx[vox.iv] = (short int)(vox.ix - Dimxd2); // centered index for STIR format
-                                      wm.ny[vox.iv] = (short int)(vox.iy - Dimyd2); // centered index for STIR format
-                                      wm.nz[vox.iv] = (short int)vox.iz;            // non-centered index for STIR format
-                                    }
+                                if (ib < 0)
+                                  continue;
+                                if (ib >= wmh.prj.Nbin)
+                                  continue;
 
-                                  //... calculus of full attenuation ...............
+                                jp = k * wmh.prj.NbOS + jb * wmh.prj.Nbin + ib;
 
-                                  if (wmh.do_full_att)
-                                    {
+                                if (do_calc)
+                                  {
 
-                                      bin.x = d->xbin0 + (float)ib * d->incx;
-                                      bin.y = d->ybin0 + (float)ib * d->incy;
-                                      bin.z = d->zbin0 + (float)jb * wmh.prj.thcm;
+                                    weight = psf_b->val[j][i] * l.eff / psf_b->sum;
 
-                                      coeff_att = calc_att_mph(bin, vox, attmap, wmh);
-                                    }
+                                    if (weight < wmh.mn_w)
+                                      continue;
 
-                                  //... calculus and storage of the weight............
+                                    //... calculus of full attenuation ...............
 
-                                  weight = weight * coeff_att;
+                                    if (wmh.do_full_att)
+                                      {
 
-                                  if (weight > w_max)
-                                    w_max = weight;
+                                        bin.x = d->xbin0 + (float)ib * d->incx;
+                                        bin.y = d->ybin0 + (float)ib * d->incy;
+                                        bin.z = d->zbin0 + (float)jb * wmh.prj.thcm;
 
-                                  wm.col[jp][wm.ne[jp]] = vox.iv;
-                                  wm.val[jp][wm.ne[jp]] = weight;
-                                  wm.ne[jp]++;
+                                        coeff_att = calc_att_mph(bin, vox, attmap, wmh);
+                                      }
 
-                                  if (wm.ne[jp] >= Nitems[jp])
-                                    error_weight3d(45, "");
-                                }
+                                    //... calculus and storage of the weight............
 
-                              else
-                                Nitems[jp]++; // for size estimation
+                                    weight = weight * coeff_att;
 
-                            } //....... end 0f LOOP7: x-dim of PSF
-                        }     //........... end 0f LOOP6: z-dim of PSF
-                    }         //............... end of LOOP5: hole in detection element
-                }             //................... end of LOOP4: detection element
-            }                 //....................... end of LOOP3: image rows
-        }                     //........................... end of LOOP2: image cols
-    }                         //............................... end of LOOP1: image slices
+                                    weights_per_slice[vox.iz].push_back(weight_item_type{ jp, vox.iv, weight });
+                                  }
 
-  // if ( do_calc ) cout << "Maximum weight: " << w_max << endl;
+                                else
+                                  Nitems[jp]++; // for size estimation
+
+                              } //....... end 0f LOOP7: x-dim of PSF
+                          }     //........... end 0f LOOP6: z-dim of PSF
+                      }         //............... end of LOOP5: hole in detection element
+                  }             //................... end of LOOP4: detection element
+              }                 //....................... end of LOOP3: image rows
+          }                     //........................... end of LOOP2: image cols
+      }                         //............................... end of LOOP1: image slices
+  }                             // end of parallel region
+
+  //... fill wm values (in the order of a sequential calculation) .....................
+
+  if (do_calc)
+    {
+      for (int iz = wmh.vol.first_sl; iz < wmh.vol.last_sl; iz++)
+        {
+          for (const weight_item_type& item : weights_per_slice[iz])
+            {
+              const int jp = item.jp;
+              wm.col[jp][wm.ne[jp]] = item.iv;
+              wm.val[jp][wm.ne[jp]] = item.weight;
+              wm.ne[jp]++;
+
+              if (wm.ne[jp] >= Nitems[jp])
+                error_weight3d(45, "");
+            }
+          // free memory as we go
+          std::vector<weight_item_type>().swap(weights_per_slice[iz]);
+        }
+    }
 }
 
 //==========================================================================
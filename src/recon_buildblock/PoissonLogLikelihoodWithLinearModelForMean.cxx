@@ -22,12 +22,21 @@
 #include "stir/IO/read_from_file.h"
 #include "stir/Succeeded.h"
 #include "stir/CPUTimer.h"
+#include "stir/FilePath.h"
+#include "stir/compute_hash.h"
+#include "stir/stream.h"
 #include <algorithm>
 #include <exception>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iterator>
+#include <cstdint>
 #include "stir/modelling/ParametricDiscretisedDensity.h"
 #include "stir/modelling/KineticParameters.h"
 #include "stir/info.h"
 #include "stir/error.h"
+#include "stir/warning.h"
 #include "boost/format.hpp"
 #include "boost/lexical_cast.hpp"
 
@@ -45,6 +54,7 @@ PoissonLogLikelihoodWithLinearModelForMean<TargetT>::set_defaults()
   this->subsensitivity_filenames = "";
   this->recompute_sensitivity = false;
   this->use_subset_sensitivities = true;
+  this->sensitivity_cache_directory = "";
   this->subsensitivity_sptrs.resize(0);
 }
 
@@ -58,6 +68,7 @@ PoissonLogLikelihoodWithLinearModelForMean<TargetT>::initialise_keymap()
   this->parser.add_key("subset sensitivity filenames", &this->subsensitivity_filenames);
   this->parser.add_key("recompute sensitivity", &this->recompute_sensitivity);
   this->parser.add_key("use_subset_sensitivities", &this->use_subset_sensitivities);
+  this->parser.add_key("sensitivity cache directory", &this->sensitivity_cache_directory);
 }
 
 template <typename TargetT>
@@ -84,6 +95,21 @@ PoissonLogLikelihoodWithLinearModelForMean<TargetT>::get_subsensitivity_filename
   return this->subsensitivity_filenames;
 }
 
+template <typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::get_sensitivity_cache_directory() const
+{
+  return this->sensitivity_cache_directory;
+}
+
+template <typename TargetT>
+void
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::set_sensitivity_cache_directory(const std::string& directory)
+{
+  this->already_set_up = false;
+  this->sensitivity_cache_directory = directory;
+}
+
 template <typename TargetT>
 void
 PoissonLogLikelihoodWithLinearModelForMean<TargetT>::set_sensitivity_filename(const std::string& filename)
@@ -114,7 +140,26 @@ template <typename TargetT>
 shared_ptr<TargetT>
 PoissonLogLikelihoodWithLinearModelForMean<TargetT>::get_subset_sensitivity_sptr(const int subset_num) const
 {
-  return this->subsensitivity_sptrs[subset_num];
+  if (this->subsensitivity_cache_filenames.empty())
+    return this->subsensitivity_sptrs[subset_num];
+
+  shared_ptr<TargetT> subsensitivity_sptr;
+#ifdef STIR_OPENMP
+#  pragma omp critical(STIR_POISSONLOGLIKELIHOOD_READ_SUBSENSITIVITY)
+#endif
+  {
+    // read subset sensitivity from the cache on first use
+    if (is_null_ptr(this->subsensitivity_sptrs[subset_num]))
+      {
+        const std::string& filename = this->subsensitivity_cache_filenames[subset_num];
+        info(boost::format("Reading subset sensitivity from cache '%1%'") % filename, 2);
+        this->subsensitivity_sptrs[subset_num] = read_from_file<TargetT>(filename);
+        if (!this->sensitivity_sptr->has_same_characteristics(*this->subsensitivity_sptrs[subset_num]))
+          error("Subset sensitivity read from cache '" + filename + "' does not have the expected characteristics");
+      }
+    subsensitivity_sptr = this->subsensitivity_sptrs[subset_num];
+  }
+  return subsensitivity_sptr;
 }
 
 template <typename TargetT>
@@ -177,6 +222,8 @@ PoissonLogLikelihoodWithLinearModelForMean<TargetT>::set_up(shared_ptr<TargetT>
     return Succeeded::no;
 
   this->subsensitivity_sptrs.resize(this->num_subsets);
+  this->subsensitivity_cache_filenames.clear();
+  bool try_reading_from_cache = false;
 
   if (!this->recompute_sensitivity)
     {
@@ -186,6 +233,7 @@ PoissonLogLikelihoodWithLinearModelForMean<TargetT>::set_up(shared_ptr<TargetT>
         {
           info("(subset)sensitivity filename(s) not set so I will compute the (subset)sensitivities", 2);
           this->recompute_sensitivity = true;
+          try_reading_from_cache = true;
           // initialisation of pointers will be done below
         }
       else if (this->sensitivity_filename == "1")
@@ -280,7 +328,12 @@ PoissonLogLikelihoodWithLinearModelForMean<TargetT>::set_up(shared_ptr<TargetT>
       return Succeeded::no;
     }
 
-  if (this->recompute_sensitivity)
+  const std::string cache_description
+      = this->recompute_sensitivity ? this->get_full_sensitivity_cache_description(*target_sptr) : std::string();
+  const bool sensitivity_read_from_cache
+      = try_reading_from_cache && !cache_description.empty() && this->read_sensitivities_from_cache(*target_sptr, cache_description);
+
+  if (this->recompute_sensitivity && !sensitivity_read_from_cache)
     {
       info("Computing sensitivity");
       CPUTimer sens_timer;
@@ -323,6 +376,8 @@ PoissonLogLikelihoodWithLinearModelForMean<TargetT>::set_up(shared_ptr<TargetT>
           error("Error writing sensitivity to file:\n%s", e.what());
           return Succeeded::no;
         }
+      if (!cache_description.empty())
+        this->write_sensitivities_to_cache(cache_description);
     }
   this->already_set_up = true;
   return Succeeded::yes;
@@ -434,6 +489,131 @@ PoissonLogLikelihoodWithLinearModelForMean<TargetT>::set_total_or_subset_sensiti
     }
 }
 
+template <typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::get_sensitivity_cache_description(const TargetT&) const
+{
+  return std::string();
+}
+
+template <typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::get_full_sensitivity_cache_description(const TargetT& target) const
+{
+  if (this->sensitivity_cache_directory.empty())
+    return std::string();
+  const std::string description = this->get_sensitivity_cache_description(target);
+  if (description.empty())
+    {
+      warning(this->get_registered_name() + " does not support the sensitivity cache. Sensitivities will not be cached.");
+      return std::string();
+    }
+
+  std::ostringstream s;
+  s << "objective function type := " << this->get_registered_name() << '\n'
+    << "number of subsets := " << this->num_subsets << '\n'
+    << "use_subset_sensitivities := " << this->use_subset_sensitivities << '\n';
+  BasicCoordinate<3, int> min_indices, max_indices;
+  if (!target.get_regular_range(min_indices, max_indices))
+    {
+      warning("Sensitivity cache can only be used for images with a regular range. Sensitivities will not be cached.");
+      return std::string();
+    }
+  // physical coordinates of the corners describe origin, voxel sizes and orientation
+  s << "image index range := " << min_indices << max_indices << '\n'
+    << "image first voxel := " << target.get_physical_coordinates_for_indices(min_indices) << '\n'
+    << "image last voxel := " << target.get_physical_coordinates_for_indices(max_indices) << '\n'
+    << description;
+  return s.str();
+}
+
+template <typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::get_sensitivity_cache_filename_prefix(const std::string& description) const
+{
+  // the hash is stable across platforms and runs
+  const std::uint64_t hash = compute_hash(description.data(), description.size());
+  std::ostringstream s;
+  s << "sensitivity_" << std::hex << std::setw(16) << std::setfill('0') << hash;
+  FilePath prefix(s.str(), false);
+  prefix.prepend_directory_name(this->sensitivity_cache_directory);
+  return prefix.get_as_string();
+}
+
+template <typename TargetT>
+bool
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::read_sensitivities_from_cache(const TargetT& target,
+                                                                                   const std::string& description)
+{
+  const std::string prefix = this->get_sensitivity_cache_filename_prefix(description);
+  // the description is written last, so its presence indicates that all images were written
+  {
+    std::ifstream description_file((prefix + ".txt").c_str());
+    if (!description_file)
+      return false;
+    const std::string cached_description((std::istreambuf_iterator<char>(description_file)), std::istreambuf_iterator<char>());
+    if (cached_description != description)
+      {
+        warning("Sensitivity cache file " + prefix + ".txt exists but is for different settings. Ignoring it.");
+        return false;
+      }
+  }
+
+  try
+    {
+      info(boost::format("Reading sensitivity from cache '%1%'") % (prefix + ".hv"));
+      this->sensitivity_sptr = read_from_file<TargetT>(prefix + ".hv");
+      if (!target.has_same_characteristics(*this->sensitivity_sptr))
+        {
+          warning("Sensitivity read from cache does not have the expected characteristics. Ignoring it.");
+          this->sensitivity_sptr.reset();
+          return false;
+        }
+    }
+  catch (std::exception& e)
+    {
+      warning("Error reading sensitivity from cache. It will be recomputed. Error message:\n" + std::string(e.what()));
+      this->sensitivity_sptr.reset();
+      return false;
+    }
+
+  if (this->get_use_subset_sensitivities())
+    {
+      // subset sensitivities will be read when needed by get_subset_sensitivity_sptr()
+      for (int subset_num = 0; subset_num < this->num_subsets; ++subset_num)
+        {
+          this->subsensitivity_sptrs[subset_num].reset();
+          this->subsensitivity_cache_filenames.push_back(prefix + "_subset" + std::to_string(subset_num) + ".hv");
+        }
+    }
+  else
+    this->set_total_or_subset_sensitivities();
+  return true;
+}
+
+template <typename TargetT>
+void
+PoissonLogLikelihoodWithLinearModelForMean<TargetT>::write_sensitivities_to_cache(const std::string& description) const
+{
+  const std::string prefix = this->get_sensitivity_cache_filename_prefix(description);
+  info(boost::format("Writing sensitivities to cache '%1%'") % prefix);
+  try
+    {
+      if (this->get_use_subset_sensitivities())
+        for (int subset_num = 0; subset_num < this->num_subsets; ++subset_num)
+          write_to_file(prefix + "_subset" + std::to_string(subset_num) + ".hv", *this->subsensitivity_sptrs[subset_num]);
+      write_to_file(prefix + ".hv", *this->sensitivity_sptr);
+      std::ofstream description_file((prefix + ".txt").c_str());
+      description_file << description;
+      if (!description_file)
+        warning("Error writing sensitivity cache description " + prefix + ".txt");
+    }
+  catch (std::exception& e)
+    {
+      warning("Error writing sensitivities to cache:\n" + std::string(e.what()));
+    }
+}
+
 template <typename TargetT>
 void
 PoissonLogLikelihoodWithLinearModelForMean<TargetT>::fill_nonidentifiable_target_parameters(TargetT& target,
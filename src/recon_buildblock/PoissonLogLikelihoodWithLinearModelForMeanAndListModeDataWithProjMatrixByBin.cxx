@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2003- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2014, 2016, 2018, 2022, 2024 University College London
+    Copyright (C) 2014, 2016, 2018, 2022, 2024, 2026 University College London
     Copyright (C) 2016, University of Hull
     Copyright (C) 2021, University of Pennsylvania
     This file is part of STIR.
@@ -26,6 +26,8 @@
 #include "stir/ProjDataInfoCylindrical.h"
 #include "stir/ProjData.h"
 #include "stir/listmode/ListRecord.h"
+#include "stir/listmode/ListRecordBatch.h"
+#include "stir/listmode/convert_events_to_bins.h"
 #include "stir/Viewgram.h"
 #include "stir/info.h"
 #include "stir/warning.h"
@@ -47,6 +49,9 @@
 #include <fstream>
 #include <cmath>
 #include <string>
+#include <tuple>
+#include <numeric>
+#include <random>
 
 #include "stir/recon_buildblock/ForwardProjectorByBinUsingProjMatrixByBin.h"
 #include "stir/recon_buildblock/BackProjectorByBinUsingProjMatrixByBin.h"
@@ -91,6 +96,9 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
 
   this->use_tofsens = false;
   skip_balanced_subsets = false;
+  merge_identical_events = false;
+  randomise_event_subsets = false;
+  batch_num_in_record_cache = -1;
 }
 
 template <typename TargetT>
@@ -108,6 +116,8 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
 
   this->parser.add_key("num_events_to_use", &this->num_events_to_use);
   this->parser.add_key("skip checking balanced subsets", &skip_balanced_subsets);
+  this->parser.add_key("merge identical events", &merge_identical_events);
+  this->parser.add_key("randomise event subsets", &randomise_event_subsets);
 }
 
 template <typename TargetT>
@@ -116,6 +126,7 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
 {
   this->already_set_up = this->already_set_up && (this->num_subsets == new_num_subsets);
   this->num_subsets = new_num_subsets;
+  this->batch_num_in_record_cache = -1;
   return this->num_subsets;
 }
 
@@ -155,6 +166,37 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
   skip_balanced_subsets = arg;
 }
 
+template <typename TargetT>
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::set_merge_identical_events(const bool arg)
+{
+  merge_identical_events = arg;
+  batch_num_in_record_cache = -1;
+}
+
+template <typename TargetT>
+bool
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::get_merge_identical_events() const
+{
+  return merge_identical_events;
+}
+
+template <typename TargetT>
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::set_randomise_event_subsets(const bool arg)
+{
+  this->already_set_up = this->already_set_up && (randomise_event_subsets == arg);
+  randomise_event_subsets = arg;
+  batch_num_in_record_cache = -1;
+}
+
+template <typename TargetT>
+bool
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::get_randomise_event_subsets() const
+{
+  return randomise_event_subsets;
+}
+
 #if STIR_VERSION < 060000
 template <typename TargetT>
 void
@@ -182,6 +224,10 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
   if (this->num_subsets == 1)
     return true;
 
+  // random subsets are balanced on average
+  if (randomise_event_subsets)
+    return true;
+
   if (skip_balanced_subsets)
     {
       warning("We skip the check on balanced subsets and presume they are balanced!");
@@ -258,6 +304,13 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
 {
   if (base_type::set_up_before_sensitivity(target_sptr) != Succeeded::yes)
     return Succeeded::no;
+  this->batch_num_in_record_cache = -1;
+  if (this->randomise_event_subsets && this->get_use_subset_sensitivities() && this->num_subsets > 1)
+    {
+      warning("PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin: "
+              "you need to set use_subset_sensitivities to false when using randomised event subsets.");
+      return Succeeded::no;
+    }
 #ifdef STIR_MPI
   // broadcast objective_function (100=PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin)
   distributed::send_int_value(100, -1);
@@ -466,7 +519,9 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
       error("Listmode: cannot allocate cache for " + std::to_string(this->cache_size) + " records. Reduce cache size.");
     }
 
-  const shared_ptr<ListRecord> record_sptr = this->list_mode_data_sptr->get_empty_record_sptr();
+  // Events are read in batches, and converted to bins in parallel (where possible)
+  ListRecordBatch batch(*this->list_mode_data_sptr, std::min(this->cache_size, 1000000UL));
+  std::vector<Bin> bins;
 
   const double start_time = this->frame_defs.get_start_time(this->current_frame_num);
   const double end_time = this->frame_defs.get_end_time(this->current_frame_num);
@@ -474,29 +529,34 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
 
   bool stop_caching = false;
 
-  while (true) // Start for the current cache
+  while (!stop_caching) // Start for the current cache
     {
-      if (this->list_mode_data_sptr->get_next_record(*record_sptr) == Succeeded::no)
-        {
-          stop_caching = true;
-          break;
-        }
-      if (record_sptr->is_time())
-        {
-          current_time = record_sptr->time().get_time_in_secs();
-          if (this->do_time_frame && current_time >= end_time)
-            {
-              stop_caching = true;
-              break; // get out of while loop
-            }
-        }
-      if (current_time < start_time)
-        continue; // skip
-      if (record_sptr->is_event() && record_sptr->event().is_prompt())
+      // Every event gives at most one cached event, so we never read more events than we can cache.
+      // This ensures that the next batch starts at the correct event.
+      std::size_t max_num_events_to_read = this->cache_size - record_cache.size();
+      if (this->num_events_to_use > 0)
+        max_num_events_to_read
+            = std::min(max_num_events_to_read, static_cast<std::size_t>(this->num_events_to_use) - cached_events);
+      if (batch.read(*this->list_mode_data_sptr,
+                     current_time,
+                     this->do_time_frame ? end_time : std::numeric_limits<double>::max(),
+                     max_num_events_to_read)
+          == Succeeded::no)
+        stop_caching = true;
+      if (this->do_time_frame && current_time >= end_time)
+        stop_caching = true;
+
+      convert_events_to_bins(bins, batch, *this->proj_data_info_sptr);
+
+      for (std::size_t i = 0; i < batch.size(); ++i)
         {
+          if (batch.get_time(i) < start_time)
+            continue; // skip
+          if (!batch.get_record(i).event().is_prompt())
+            continue;
+
           BinAndCorr tmp;
-          tmp.my_bin.set_bin_value(1.0);
-          record_sptr->event().get_bin(tmp.my_bin, *this->proj_data_info_sptr);
+          tmp.my_bin = bins[i];
 
           if (tmp.my_bin.get_bin_value() != 1.0f || tmp.my_bin.segment_num() < this->proj_data_info_sptr->get_min_segment_num()
               || tmp.my_bin.segment_num() > this->proj_data_info_sptr->get_max_segment_num()
@@ -523,17 +583,14 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
 
           if (record_cache.size() > 1 && record_cache.size() % 500000L == 0)
             info(boost::format("Read Prompt Events (this batch): %1% ") % record_cache.size(), 3);
+        }
 
-          if (this->num_events_to_use > 0)
-            if (cached_events >= static_cast<std::size_t>(this->num_events_to_use))
-              {
-                stop_caching = true;
-                break;
-              }
+      if (this->num_events_to_use > 0)
+        if (cached_events >= static_cast<std::size_t>(this->num_events_to_use))
+          stop_caching = true;
 
-          if (record_cache.size() == this->cache_size)
-            break; // cache is full.
-        }
+      if (record_cache.size() == this->cache_size)
+        break; // cache is full.
     }
   if (this->end_time_per_batch.size() < (ibatch + 1))
     {
@@ -599,19 +656,106 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<Tar
   return stop_caching;
 }
 
+//! Sort events on view, segment, axial and tangential position and TOF bin, and merge events in the same bin
+/*! The bin value of a merged event is the sum of the bin values. The additive term is the same for all events in a bin. */
+static void
+sort_and_merge_identical_events(std::vector<BinAndCorr>& record_cache)
+{
+  auto key = [](const Bin& bin) {
+    return std::make_tuple(
+        bin.view_num(), bin.segment_num(), bin.axial_pos_num(), bin.tangential_pos_num(), bin.timing_pos_num());
+  };
+  std::sort(record_cache.begin(), record_cache.end(), [&key](const BinAndCorr& a, const BinAndCorr& b) {
+    return key(a.my_bin) < key(b.my_bin);
+  });
+
+  auto out_iter = record_cache.begin();
+  for (auto in_iter = record_cache.begin(); in_iter != record_cache.end(); ++out_iter)
+    {
+      *out_iter = *in_iter++;
+      while (in_iter != record_cache.end() && key(in_iter->my_bin) == key(out_iter->my_bin))
+        {
+          out_iter->my_bin.set_bin_value(out_iter->my_bin.get_bin_value() + in_iter->my_bin.get_bin_value());
+          ++in_iter;
+        }
+    }
+  record_cache.erase(out_iter, record_cache.end());
+}
+
 template <typename TargetT>
 bool
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::load_listmode_batch(
     unsigned int ibatch) const
 {
-  if (this->cache_lm_file)
+  // no need to reload if this batch is still in memory (i.e. if there is only one batch)
+  if (static_cast<int>(ibatch) == this->batch_num_in_record_cache
+      && this->subset_event_offsets.size() == static_cast<std::size_t>(this->num_subsets + 1))
+    return this->batch_in_record_cache_is_last;
+
+  const bool stop = this->cache_lm_file ? this->load_listmode_cache_file(ibatch) : this->read_listmode_batch(ibatch);
+
+  if (this->merge_identical_events)
+    {
+      const std::size_t num_events = record_cache.size();
+      sort_and_merge_identical_events(record_cache);
+      info(boost::format("Merged %1% events into %2% bins") % num_events % record_cache.size(), 2);
+    }
+  this->partition_events_in_subsets(ibatch);
+
+  this->batch_num_in_record_cache = static_cast<int>(ibatch);
+  this->batch_in_record_cache_is_last = stop;
+  return stop;
+}
+
+template <typename TargetT>
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<TargetT>::partition_events_in_subsets(
+    const unsigned int ibatch) const
+{
+  const int num_subsets = this->num_subsets;
+  this->subset_event_offsets.assign(num_subsets + 1, 0);
+  if (num_subsets == 1)
     {
-      return this->load_listmode_cache_file(ibatch);
+      this->subset_event_offsets[1] = record_cache.size();
+      return;
+    }
+
+  // find subset of every event
+  std::vector<int> subset_nums(record_cache.size());
+  if (this->randomise_event_subsets)
+    {
+      // seed depends on the batch, but is fixed such that we get the same subsets when reloading the batch
+      std::mt19937 generator(42U + ibatch);
+      std::uniform_int_distribution<int> distribution(0, num_subsets - 1);
+      for (int& subset_num : subset_nums)
+        subset_num = distribution(generator);
     }
   else
     {
-      return this->read_listmode_batch(ibatch);
+      // warning: has to be same as subset scheme used in add_subset_sensitivity
+      const DataSymmetriesForBins& symmetries = *this->PM_sptr->get_symmetries_ptr();
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(static)
+#endif
+      for (long int ievent = 0; ievent < static_cast<long>(record_cache.size()); ++ievent)
+        {
+          Bin basic_bin = record_cache[ievent].my_bin;
+          if (!symmetries.is_basic(basic_bin))
+            symmetries.find_basic_bin(basic_bin);
+          subset_nums[ievent] = basic_bin.view_num() % num_subsets;
+        }
     }
+
+  // stable counting sort on subset number
+  for (const int subset_num : subset_nums)
+    ++this->subset_event_offsets[subset_num + 1];
+  std::partial_sum(this->subset_event_offsets.begin(), this->subset_event_offsets.end(), this->subset_event_offsets.begin());
+  std::vector<std::size_t> next_event_in_subset(this->subset_event_offsets.begin(), this->subset_event_offsets.end() - 1);
+  std::vector<BinAndCorr> partitioned_record_cache(record_cache.size());
+  for (std::size_t ievent = 0; ievent < record_cache.size(); ++ievent)
+    partitioned_record_cache[next_event_in_subset[subset_nums[ievent]]++] = record_cache[ievent];
+  record_cache.swap(partitioned_record_cache);
+  info(boost::format("Partitioned %1% events in %2% subsets") % record_cache.size() % num_subsets, 3);
 }
 
 template <typename TargetT>
@@ -824,23 +968,23 @@ LM_gradient_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
                                       DiscretisedDensity<3, float>* output_image_ptr,
                                       const DiscretisedDensity<3, float>* input_image_ptr,
                                       const std::vector<BinAndCorr>& record_ptr,
-                                      const int subset_num,
-                                      const int num_subsets,
+                                      const std::size_t first_event,
+                                      const std::size_t end_event,
                                       const bool has_add,
                                       const bool accumulate,
                                       double* value_ptr)
 {
-  LM_distributable_computation(PM_sptr,
-                               proj_data_info_sptr,
-                               output_image_ptr,
-                               input_image_ptr,
-                               record_ptr,
-                               subset_num,
-                               num_subsets,
-                               has_add,
-                               accumulate,
-                               value_ptr,
-                               LM_gradient_and_value<true, false>);
+  LM_distributable_computation_for_events(PM_sptr,
+                                          proj_data_info_sptr,
+                                          output_image_ptr,
+                                          input_image_ptr,
+                                          record_ptr,
+                                          first_event,
+                                          end_event,
+                                          has_add,
+                                          accumulate,
+                                          value_ptr,
+                                          LM_gradient_and_value<true, false>);
 }
 
 void
@@ -850,24 +994,24 @@ LM_Hessian_distributable_computation(const shared_ptr<ProjMatrixByBin> PM_sptr,
                                      const DiscretisedDensity<3, float>* input_image_ptr,
                                      const DiscretisedDensity<3, float>* rhs_ptr,
                                      const std::vector<BinAndCorr>& record_ptr,
-                                     const int subset_num,
-                                     const int num_subsets,
+                                     const std::size_t first_event,
+                                     const std::size_t end_event,
                                      const bool has_add,
                                      const bool accumulate)
 {
   using namespace std::placeholders;
   auto H_func = std::bind(LM_Hessian, _1, _2, _3, _4, _5, std::cref(*rhs_ptr));
-  LM_distributable_computation(PM_sptr,
-                               proj_data_info_sptr,
-                               output_image_ptr,
-                               input_image_ptr,
-                               record_ptr,
-                               subset_num,
-                               num_subsets,
-                               has_add,
-                               /* accumulate = */ true,
-                               nullptr,
-                               H_func);
+  LM_distributable_computation_for_events(PM_sptr,
+                                          proj_data_info_sptr,
+                                          output_image_ptr,
+                                          input_image_ptr,
+                                          record_ptr,
+                                          first_event,
+                                          end_event,
+                                          has_add,
+                                          /* accumulate = */ true,
+                                          nullptr,
+                                          H_func);
 }
 
 template <typename TargetT>
@@ -877,7 +1021,7 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
 {
   assert(subset_num >= 0);
   assert(subset_num < this->num_subsets);
-  if (!this->get_use_subset_sensitivities() && this->num_subsets > 1)
+  if (!this->get_use_subset_sensitivities() && this->num_subsets > 1 && !this->randomise_event_subsets)
     error("PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin::"
           "actual_compute_subset_gradient_without_penalty(): cannot subtract subset sensitivity because "
           "use_subset_sensitivities is false. This will result in an error in the gradient computation.");
@@ -887,17 +1031,17 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
   while (true)
     {
       bool stop = this->load_listmode_batch(icache);
-      LM_distributable_computation(this->PM_sptr,
-                                   this->proj_data_info_sptr,
-                                   nullptr,
-                                   &current_estimate,
-                                   record_cache,
-                                   subset_num,
-                                   this->num_subsets,
-                                   this->has_add,
-                                   /* accumulate */ true,
-                                   &accum,
-                                   LM_gradient_and_value<false, true>);
+      LM_distributable_computation_for_events(this->PM_sptr,
+                                              this->proj_data_info_sptr,
+                                              nullptr,
+                                              &current_estimate,
+                                              record_cache,
+                                              this->subset_event_offsets[subset_num],
+                                              this->subset_event_offsets[subset_num + 1],
+                                              this->has_add,
+                                              /* accumulate */ true,
+                                              &accum,
+                                              LM_gradient_and_value<false, true>);
       ++icache;
       if (stop)
         break;
@@ -919,7 +1063,7 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
 {
   assert(subset_num >= 0);
   assert(subset_num < this->num_subsets);
-  if (!add_sensitivity && !this->get_use_subset_sensitivities() && this->num_subsets > 1)
+  if (!add_sensitivity && !this->get_use_subset_sensitivities() && this->num_subsets > 1 && !this->randomise_event_subsets)
     error("PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin::"
           "actual_compute_subset_gradient_without_penalty(): cannot subtract subset sensitivity because "
           "use_subset_sensitivities is false. This will result in an error in the gradient computation.");
@@ -933,8 +1077,8 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
                                             &gradient,
                                             &current_estimate,
                                             record_cache,
-                                            subset_num,
-                                            this->num_subsets,
+                                            this->subset_event_offsets[subset_num],
+                                            this->subset_event_offsets[subset_num + 1],
                                             this->has_add,
                                             /* accumulate = */ icache != 0,
                                             nullptr);
@@ -992,8 +1136,8 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBin<
                                            &current_estimate,
                                            &rhs,
                                            record_cache,
-                                           subset_num,
-                                           this->num_subsets,
+                                           this->subset_event_offsets[subset_num],
+                                           this->subset_event_offsets[subset_num + 1],
                                            this->has_add,
                                            /* accumulate = */ icache != 0);
       ++icache;
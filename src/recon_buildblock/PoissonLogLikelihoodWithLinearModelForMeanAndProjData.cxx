@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000-2011, Hammersmith Imanet Ltd
-    Copyright (C) 2014, 2016-2024 University College London
+    Copyright (C) 2014, 2016-2024, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0 AND License-ref-PARAPET-license
@@ -53,6 +53,7 @@
 #include "stir/recon_buildblock/ProjectorByBinPairUsingSeparateProjectors.h"
 #include "stir/recon_buildblock/find_basic_vs_nums_in_subsets.h"
 #include "stir/recon_buildblock/BinNormalisationWithCalibration.h"
+#include "stir/compute_hash.h"
 
 #include "stir/ProjDataInMemory.h"
 
@@ -63,6 +64,9 @@
 #include <algorithm>
 #include <functional>
 #include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <cctype>
 #ifdef STIR_MPI
 #  include "stir/recon_buildblock/distributed_functions.h"
 #endif
@@ -685,6 +689,92 @@ PoissonLogLikelihoodWithLinearModelForMeanAndProjData<TargetT>::set_up_before_se
   return Succeeded::yes;
 }
 
+//! Continue \a hash with the content of \a filename (if it exists). For Interfile headers, the data file is included.
+static std::uint64_t
+add_file_to_hash(const std::string& filename, std::uint64_t hash)
+{
+  std::ifstream file(filename.c_str(), std::ios::binary);
+  if (!file)
+    return hash;
+  std::vector<char> buffer(1024 * 1024);
+  std::string header_start;
+  while (file)
+    {
+      file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+      const std::size_t num_read = static_cast<std::size_t>(file.gcount());
+      if (header_start.empty())
+        header_start.assign(buffer.data(), std::min(num_read, std::size_t(20)));
+      hash = compute_hash(buffer.data(), num_read, hash);
+    }
+  if (header_start.find("INTERFILE") == std::string::npos)
+    return hash;
+  // find the data file in the header
+  std::ifstream header(filename.c_str());
+  std::string line;
+  while (std::getline(header, line))
+    {
+      const std::string::size_type pos = line.find(":=");
+      if (pos == std::string::npos || line.find("name of data file") >= pos)
+        continue;
+      std::string data_filename = line.substr(pos + 2);
+      data_filename.erase(0, data_filename.find_first_not_of(" \t"));
+      data_filename.erase(data_filename.find_last_not_of(" \t\r") + 1);
+      if (data_filename.empty())
+        continue;
+      std::filesystem::path data_path(data_filename);
+      if (data_path.is_relative())
+        data_path = std::filesystem::path(filename).parent_path() / data_path;
+      return add_file_to_hash(data_path.string(), hash);
+    }
+  return hash;
+}
+
+//! Continue \a hash with the content of all files referred to by a "filename" key in \a parameter_info
+static std::uint64_t
+add_files_in_parameter_info_to_hash(const std::string& parameter_info, std::uint64_t hash)
+{
+  std::istringstream parameters(parameter_info);
+  std::string line;
+  while (std::getline(parameters, line))
+    {
+      const std::string::size_type pos = line.find(":=");
+      if (pos == std::string::npos)
+        continue;
+      std::string key = line.substr(0, pos);
+      std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+      if (key.find("filename") == std::string::npos)
+        continue;
+      std::string filename = line.substr(pos + 2);
+      filename.erase(0, filename.find_first_not_of(" \t"));
+      filename.erase(filename.find_last_not_of(" \t\r") + 1);
+      if (!filename.empty())
+        hash = add_file_to_hash(filename, hash);
+    }
+  return hash;
+}
+
+template <typename TargetT>
+std::string
+PoissonLogLikelihoodWithLinearModelForMeanAndProjData<TargetT>::get_sensitivity_cache_description(const TargetT&) const
+{
+  std::ostringstream s;
+  s << this->proj_data_sptr->get_proj_data_info_sptr()->parameter_info() << '\n'
+    << "maximum absolute segment number to process := " << this->max_segment_num_to_process << '\n'
+    << "zero end planes of segment 0 := " << this->zero_seg0_end_planes << '\n'
+    << "use time-of-flight sensitivities := " << this->use_tofsens << '\n'
+    << "time frame start := " << this->frame_defs.get_start_time(this->frame_num) << '\n'
+    << "time frame end := " << this->frame_defs.get_end_time(this->frame_num) << '\n'
+    << this->projector_pair_ptr->parameter_info() << '\n';
+  if (!is_null_ptr(this->normalisation_sptr))
+    {
+      // Files used by the normalisation (e.g. the attenuation image) can be overwritten, so we add a hash of their content.
+      const std::string norm_parameter_info = this->normalisation_sptr->parameter_info();
+      const std::uint64_t hash = add_files_in_parameter_info_to_hash(norm_parameter_info, compute_hash(nullptr, 0));
+      s << norm_parameter_info << '\n' << "normalisation files: hash " << std::hex << hash << std::dec << '\n';
+    }
+  return s.str();
+}
+
 /***************************************************************
   functions that compute the value/gradient of the objective function etc
 ***************************************************************/
@@ -14,7 +14,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000-2009, Hammersmith Imanet Ltd
-    Copyright (C) 2013, 2015, 2022 University College London
+    Copyright (C) 2013, 2015, 2022, 2026 University College London
     Copyright (C) 2016, University of Hull
 
     This file is part of STIR.
@@ -107,6 +107,21 @@ ProjMatrixByBin::clear_cache() const
     }
 }
 
+void
+ProjMatrixByBin::clear_cache_for_view(const int view_num) const
+{
+  for (int j = this->cache_collection[view_num].get_min_index(); j <= this->cache_collection[view_num].get_max_index(); ++j)
+    {
+#ifdef STIR_OPENMP
+      omp_set_lock(&this->cache_locks[view_num][j]);
+#endif
+      this->cache_collection[view_num][j].clear();
+#ifdef STIR_OPENMP
+      omp_unset_lock(&this->cache_locks[view_num][j]);
+#endif
+    }
+}
+
 /*
 void
 ProjMatrixByBin::
@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2022, Matthew Strugari
     Copyright (C) 2014, Biomedical Image Group (GIB), Universitat de Barcelona, Barcelona, Spain. All rights reserved.
-    Copyright (C) 2014, 2021, University College London
+    Copyright (C) 2014, 2021, 2026, University College London
     This file is part of STIR.
 
         Licensed under the Apache License, Version 2.0 (the "License");
@@ -32,6 +32,7 @@
 // system libraries
 #include <fstream>
 #include <algorithm>
+#include <limits>
 #include <stdio.h>
 #include <iostream>
 #include <sstream>
@@ -57,9 +58,8 @@
 #include "stir/Coordinate3D.h"
 #include "stir/info.h"
 #include "stir/CPUTimer.h"
-#ifdef STIR_OPENMP
-#  include "stir/num_threads.h"
-#endif
+#include "stir/num_threads.h"
+#include "stir/compute_hash.h"
 
 //#include "boost/cstdint.hpp"
 //#include "boost/scoped_ptr.hpp"
@@ -117,6 +117,8 @@ ProjMatrixByBinPinholeSPECTUB::initialise_keymap()
   parser.add_key("mask file", &mask_file);
   parser.add_key("mask from attenuation map", &mask_from_attenuation_map);
   parser.add_key("keep all views in cache", &keep_all_views_in_cache);
+  parser.add_key("maximum number of views in cache", &maximum_number_of_views_in_cache);
+  parser.add_key("matrix cache directory", &matrix_cache_directory);
 
   parser.add_stop_key("End Projection Matrix By Bin Pinhole SPECT UB Parameters");
 }
@@ -129,6 +131,8 @@ ProjMatrixByBinPinholeSPECTUB::set_defaults()
   this->already_setup = false;
 
   this->keep_all_views_in_cache = false;
+  this->maximum_number_of_views_in_cache = 0;
+  this->matrix_cache_directory = "";
   minimum_weight = 0.0;
   maximum_number_of_sigmas = 2.;
   spatial_resolution_PSF = 0.001;
@@ -440,6 +444,38 @@ ProjMatrixByBinPinholeSPECTUB::set_keep_all_views_in_cache(bool value)
     }
 }
 
+int
+ProjMatrixByBinPinholeSPECTUB::get_maximum_number_of_views_in_cache() const
+{
+  return this->maximum_number_of_views_in_cache;
+}
+
+void
+ProjMatrixByBinPinholeSPECTUB::set_maximum_number_of_views_in_cache(const int value)
+{
+  if (this->maximum_number_of_views_in_cache != value)
+    {
+      this->maximum_number_of_views_in_cache = value;
+      this->already_setup = false;
+    }
+}
+
+std::string
+ProjMatrixByBinPinholeSPECTUB::get_matrix_cache_directory() const
+{
+  return this->matrix_cache_directory;
+}
+
+void
+ProjMatrixByBinPinholeSPECTUB::set_matrix_cache_directory(const std::string& value)
+{
+  if (this->matrix_cache_directory != value)
+    {
+      this->matrix_cache_directory = value;
+      this->already_setup = false;
+    }
+}
+
 //******************** actual implementation *************
 
 void
@@ -451,14 +487,10 @@ ProjMatrixByBinPinholeSPECTUB::set_up(
 
   ProjMatrixByBin::set_up(proj_data_info_ptr_v, density_info_ptr);
 
-#ifdef STIR_OPENMP
-  if (!this->keep_all_views_in_cache)
-    {
-      warning("Pinhole SPECTUB matrix can currently only use single-threaded code unless all views are kept. Setting num_threads "
-              "to 1.");
-      set_num_threads(1);
-    }
-#endif
+  if (this->maximum_number_of_views_in_cache < 0)
+    error("Pinhole SPECTUB matrix: maximum number of views in cache has to be non-negative");
+  this->num_subsets_to_keep
+      = this->maximum_number_of_views_in_cache > 0 ? this->maximum_number_of_views_in_cache : get_max_num_threads();
 
   std::stringstream info_stream;
 
@@ -819,39 +851,53 @@ ProjMatrixByBinPinholeSPECTUB::set_up(
         Nitems[kOS][i] = 1; // Nitems initializated to one
     }
 
-  //... double array wm.val and wm.col .....................................................
-
-  if ((wm.val = new (nothrow) float*[wmh.prj.NbOS]) == nullptr)
-    error(
-        "Error allocating space to store values for SPECTUB matrix"); // error_wmtools_SPECT_mph( 200, wmh.prj.NbOS, "wm.val[]" );
+  //... wm.val, wm.col, wm.ne and projection indices are allocated in compute_one_subset ..........
 
-  if ((wm.col = new (nothrow) int*[wmh.prj.NbOS]) == nullptr)
-    error("Error allocating space to store column indices for SPECTUB matrix"); // error_wmtools_SPECT_mph( 200, wmh.prj.NbOS,
-                                                                                // "wm.col[]" );
+  wm.val = nullptr;
+  wm.col = nullptr;
+  wm.ne = nullptr;
+  wm.na = wm.nb = wm.ns = nullptr;
 
-  //... array wm.ne .........................................................................
+  //... STIR indices for image elements (the same for all subsets) ...........................
 
-  if ((wm.ne = new (nothrow) int[wmh.prj.NbOS + 1]) == 0)
-    error("Error allocating space to store number of elements for SPECTUB matrix"); // error_wmtools_SPECT_mph(200, wmh.prj.NbOS +
-                                                                                    // 1, "wm.ne[]");
-
-  // allocate memory for weight matrix
   if (wm.do_save_STIR)
     {
-      wm.ns = new int[wmh.prj.NbOS];
-      wm.nb = new int[wmh.prj.NbOS];
-      wm.na = new int[wmh.prj.NbOS];
-
       wm.nx = new short int[wmh.vol.Nvox];
       wm.ny = new short int[wmh.vol.Nvox];
       wm.nz = new short int[wmh.vol.Nvox];
+
+      const int Dimxd2 = wmh.vol.Dimx / 2;
+      const int Dimyd2 = wmh.vol.Dimy / 2;
+      for (int iz = 0; iz < wmh.vol.Dimz; iz++)
+        for (int iy = 0; iy < wmh.vol.Dimy; iy++)
+          for (int ix = 0; ix < wmh.vol.Dimx; ix++)
+            {
+              const int iv = iz * wmh.vol.Npix + iy * wmh.vol.Dimx + ix;
+              wm.nx[iv] = (short int)(ix - Dimxd2); // centered index for STIR format
+              wm.ny[iv] = (short int)(iy - Dimyd2); // centered index for STIR format
+              wm.nz[iv] = (short int)iz;            // non-centered index for STIR format
+            }
     }
 
-  // size estimation
+  //... files with the matrix (if any) ........................................................
+
+  this->file_cache.set_up(this->matrix_cache_directory, "PinholeSPECTUB", this->get_matrix_description());
+  if (this->file_cache.is_enabled())
+    info("Pinhole SPECTUB matrix: using files in " + this->file_cache.get_directory(), 2);
+
+  // size estimation (not needed for views which are read from file)
+  this->size_estimated.assign(wmh.prj.NOS, 0);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int kOS = 0; kOS < wmh.prj.NOS; kOS++)
     {
-      wm_calculation_mph(false, kOS, &psf_bin, &psf_subs, &psf_aux, &kern, attmap, msk_3d, Nitems[kOS], wmh, wm, pcf);
+      if (!this->file_cache.has_view(kOS))
+        this->estimate_size_of_subset(kOS);
     }
+
+  this->subset_states.assign(wmh.prj.NOS, SubsetState::not_computed);
+  this->subsets_in_cache.clear();
   info(boost::format("Done estimating size of matrix. Execution time, CPU %1% s") % timer.value(), 2);
 
   this->already_setup = true;
@@ -879,15 +925,8 @@ ProjMatrixByBinPinholeSPECTUB::delete_PinholeSPECTUB_arrays()
 
   //... freeing matrix memory....................................
 
-  delete[] wm.val;
-  delete[] wm.col;
-  delete[] wm.ne;
-
   if (wm.do_save_STIR)
     {
-      delete[] wm.ns;
-      delete[] wm.nb;
-      delete[] wm.na;
       delete[] wm.nx;
       delete[] wm.ny;
       delete[] wm.nz;
@@ -947,12 +986,79 @@ ProjMatrixByBinPinholeSPECTUB::delete_PinholeSPECTUB_arrays()
   delete[] msk_3d;
 }
 
+std::string
+ProjMatrixByBinPinholeSPECTUB::get_matrix_description() const
+{
+  const auto hash_of_file = [](const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    const std::string str = contents.str();
+    return compute_hash(str.data(), str.size());
+  };
+
+  // note: needs to be modified if the calculation of the matrix changes
+  std::stringstream s;
+  s.precision(std::numeric_limits<float>::max_digits10);
+  s << "Pinhole SPECT UB matrix version 1\n";
+  s << "projections: " << wmh.prj.Nbin << ' ' << wmh.prj.szcm << ' ' << wmh.prj.Nsli << ' ' << wmh.prj.thcm << ' '
+    << wmh.prj.rad << ' ' << wmh.prj.NOS << '\n';
+  s << "image: " << wmh.vol.Dimx << ' ' << wmh.vol.Dimy << ' ' << wmh.vol.Dimz << ' ' << wmh.vol.szcm << ' ' << wmh.vol.thcm
+    << '\n';
+  s << "detector file hash: " << std::hex << hash_of_file(wmh.detector_fn) << std::dec << '\n';
+  s << "collimator file hash: " << std::hex << hash_of_file(wmh.collim_fn) << std::dec << '\n';
+  s << "psf: " << wmh.Nsigm << ' ' << wmh.highres << ' ' << wmh.subsamp << ' ' << wmh.do_psfi << ' ' << wmh.do_depth << ' '
+    << wmh.mn_w << '\n';
+  s << "object radius: " << wmh.ro << '\n';
+  // attenuation is computed with the weights, so we need to include the image
+  s << "attenuation: " << wmh.do_att << ' ' << wmh.do_full_att;
+  if (wmh.do_att)
+    s << " hash " << std::hex << compute_hash(attmap, wmh.vol.Nvox * sizeof(*attmap)) << std::dec;
+  s << '\n';
+  s << "mask: hash " << std::hex << compute_hash(msk_3d, wmh.vol.Nvox * sizeof(*msk_3d)) << std::dec
+    << '\n';
+  return s.str();
+}
+
+void
+ProjMatrixByBinPinholeSPECTUB::estimate_size_of_subset(const int kOS) const
+{
+  wm_calculation_mph(false, kOS, &psf_bin, &psf_subs, &psf_aux, &kern, attmap, msk_3d, Nitems[kOS], wmh, wm, pcf);
+  this->size_estimated[kOS] = 1;
+}
+
 void
-ProjMatrixByBinPinholeSPECTUB::compute_one_subset(const int kOS) const
+ProjMatrixByBinPinholeSPECTUB::compute_one_subset(const int kOS, ProjMatrixElemsForOneBin& lor) const
 {
   CPUTimer timer;
   timer.start();
 
+  const Bin requested_bin = lor.get_bin();
+
+  //... read from file if possible .........................................................
+
+  std::vector<ProjMatrixElemsForOneBin> lors;
+  if (this->file_cache.read_view(lors, kOS) == Succeeded::yes)
+    {
+      for (const auto& lor_j : lors)
+        {
+          const Bin bin = lor_j.get_bin();
+          if (bin.segment_num() == requested_bin.segment_num() && bin.view_num() == requested_bin.view_num()
+              && bin.axial_pos_num() == requested_bin.axial_pos_num()
+              && bin.tangential_pos_num() == requested_bin.tangential_pos_num())
+            {
+              lor = lor_j;
+              lor.set_bin(requested_bin);
+            }
+          this->cache_proj_matrix_elems_for_one_bin(lor_j);
+        }
+      info(boost::format("Matrix elements for view %1% read from file, CPU %2% s") % kOS % timer.value(), 2);
+      return;
+    }
+
+  if (!this->size_estimated[kOS])
+    this->estimate_size_of_subset(kOS);
+
   //... size information ..........................................................................
 
   unsigned int ne = 0;
@@ -964,9 +1070,28 @@ ProjMatrixByBinPinholeSPECTUB::compute_one_subset(const int kOS) const
            % (wm.do_save_STIR ? (ne + 10 * wmh.prj.NbOS) / 104857.6 : ne / 131072),
        2);
 
-  //... memory allocation for wm float arrays ....................................................
+  //... local copy of wm, with memory allocation for the subset (initialised to zero) ...........
 
-  wm_alloc(Nitems[kOS], wm, wmh);
+  wm_da_type wm = this->wm;
+  std::vector<std::vector<float>> val(wmh.prj.NbOS);
+  std::vector<std::vector<int>> col(wmh.prj.NbOS);
+  std::vector<float*> val_ptrs(wmh.prj.NbOS);
+  std::vector<int*> col_ptrs(wmh.prj.NbOS);
+  for (int i = 0; i < wmh.prj.NbOS; i++)
+    {
+      val[i].resize(Nitems[kOS][i]);
+      col[i].resize(Nitems[kOS][i]);
+      val_ptrs[i] = val[i].data();
+      col_ptrs[i] = col[i].data();
+    }
+  std::vector<int> ne_per_row(wmh.prj.NbOS + 1, 0);
+  std::vector<int> na(wmh.prj.NbOS), nb(wmh.prj.NbOS), ns(wmh.prj.NbOS);
+  wm.val = val_ptrs.data();
+  wm.col = col_ptrs.data();
+  wm.ne = ne_per_row.data();
+  wm.na = na.data();
+  wm.nb = nb.data();
+  wm.ns = ns.data();
 
   //... wm calculation ...............................................................................
 
@@ -976,49 +1101,112 @@ ProjMatrixByBinPinholeSPECTUB::compute_one_subset(const int kOS) const
   //... fill lor ..........................
   for (int j = 0; j < wmh.prj.NbOS; j++)
     {
-      ProjMatrixElemsForOneBin lor;
+      ProjMatrixElemsForOneBin lor_j;
       Bin bin;
       bin.segment_num() = 0;
       bin.view_num() = wm.na[j];
       bin.axial_pos_num() = wm.ns[j];
       bin.tangential_pos_num() = wm.nb[j];
       bin.set_bin_value(0);
-      lor.set_bin(bin);
+      lor_j.set_bin(bin);
 
-      lor.reserve(wm.ne[j]);
+      lor_j.reserve(wm.ne[j]);
       for (int i = 0; i < wm.ne[j]; i++)
         {
 
           const ProjMatrixElemsForOneBin::value_type elem(
               Coordinate3D<int>(wm.nz[wm.col[j][i]], wm.ny[wm.col[j][i]], wm.nx[wm.col[j][i]]), wm.val[j][i]);
-          lor.push_back(elem);
+          lor_j.push_back(elem);
         }
 
-      delete[] wm.val[j];
-      delete[] wm.col[j];
+      // free memory as we go
+      std::vector<float>().swap(val[j]);
+      std::vector<int>().swap(col[j]);
 
-      this->cache_proj_matrix_elems_for_one_bin(lor);
+      if (bin.segment_num() == requested_bin.segment_num() && bin.view_num() == requested_bin.view_num()
+          && bin.axial_pos_num() == requested_bin.axial_pos_num()
+          && bin.tangential_pos_num() == requested_bin.tangential_pos_num())
+        {
+          lor = lor_j;
+          lor.set_bin(requested_bin);
+        }
+
+      this->cache_proj_matrix_elems_for_one_bin(lor_j);
+      if (this->file_cache.is_enabled())
+        lors.push_back(std::move(lor_j));
     }
 
   info(boost::format("Total time after transfering to ProjMatrixElemsForOneBin, CPU %1% s") % timer.value(), 2);
+  if (this->file_cache.is_enabled())
+    this->file_cache.write_view(lors, kOS);
 }
 
 void
 ProjMatrixByBinPinholeSPECTUB::calculate_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const
 {
   const int view_num = lor.get_bin().view_num();
+  // subsets correspond to views
+  const int kOS = view_num;
 
-#ifdef STIR_OPENMP
-#  pragma omp critical(PROJMATRIXBYBINUBONEVIEW)
-#endif
-
-  if (!this->keep_all_views_in_cache)
-    this->clear_cache();
-
-  info(boost::format("Computing matrix elements for view %1%") % view_num, 2);
-  compute_one_subset(view_num);
+  // Different subsets can be computed in parallel. Threads needing a subset that is being computed
+  // by another thread wait until it is done.
+  std::unique_lock<std::mutex> lock(this->subsets_mutex);
+  while (true)
+    {
+      switch (this->subset_states[kOS])
+        {
+        case SubsetState::computing:
+          this->subset_computed_condition.wait(lock);
+          break;
+
+        case SubsetState::computed:
+          // computed by another thread since we looked in the cache
+          // (its position in subsets_in_cache is not changed, see set_maximum_number_of_views_in_cache())
+          lock.unlock();
+          if (this->get_cached_proj_matrix_elems_for_one_bin(lor) == Succeeded::yes)
+            return;
+          lock.lock();
+          // the subset has been removed from the cache in the mean time (or the cache was cleared)
+          if (this->subset_states[kOS] == SubsetState::computed)
+            {
+              this->subsets_in_cache.remove(kOS);
+              this->subset_states[kOS] = SubsetState::not_computed;
+            }
+          break;
 
-  lor.erase();
+        case SubsetState::not_computed:
+          this->subset_states[kOS] = SubsetState::computing;
+          lock.unlock();
+          info(boost::format("Computing matrix elements for view %1%") % view_num, 2);
+          try
+            {
+              compute_one_subset(kOS, lor);
+            }
+          catch (...)
+            {
+              lock.lock();
+              this->subset_states[kOS] = SubsetState::not_computed;
+              this->subset_computed_condition.notify_all();
+              throw;
+            }
+          lock.lock();
+          this->subset_states[kOS] = SubsetState::computed;
+          this->subsets_in_cache.push_front(kOS);
+          if (!this->keep_all_views_in_cache)
+            {
+              // remove the subsets that were computed first from the cache
+              while (static_cast<int>(this->subsets_in_cache.size()) > this->num_subsets_to_keep)
+                {
+                  const int kOS_to_remove = this->subsets_in_cache.back();
+                  this->subsets_in_cache.pop_back();
+                  this->subset_states[kOS_to_remove] = SubsetState::not_computed;
+                  this->clear_cache_for_view(kOS_to_remove);
+                }
+            }
+          this->subset_computed_condition.notify_all();
+          return;
+        }
+    }
 }
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -1,7 +1,7 @@
 /*
     Copyright (C) 2013, Institute for Bioengineering of Catalonia
     Copyright (C) Biomedical Image Group (GIB), Universitat de Barcelona, Barcelona, Spain.
-    Copyright (C) 2013-2014, 2019, 2020, 2023 University College London
+    Copyright (C) 2013-2014, 2019, 2020, 2023, 2026 University College London
     Copyright (C) 2023 National Physical Laboratory
     This file is part of STIR.
 
@@ -34,9 +34,9 @@
 #include "stir/warning.h"
 #include "stir/error.h"
 #include "stir/CPUTimer.h"
-#ifdef STIR_OPENMP
-#  include "stir/num_threads.h"
-#endif
+#include "stir/num_threads.h"
+#include "stir/compute_hash.h"
+#include "stir/spatial_transformation/InvertAxis.h"
 
 //#include "boost/cstdint.hpp"
 //#include "boost/scoped_ptr.hpp"
@@ -47,6 +47,7 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <limits>
 #include <stdio.h>
 #include <iostream>
 #include <string>
@@ -88,6 +89,8 @@ ProjMatrixByBinSPECTUB::initialise_keymap()
   parser.add_key("mask type", &mask_type);
   parser.add_key("mask file", &mask_file);
   parser.add_key("keep_all_views_in_cache", &keep_all_views_in_cache);
+  parser.add_key("maximum number of views in cache", &maximum_number_of_views_in_cache);
+  parser.add_key("matrix cache directory", &matrix_cache_directory);
 
   parser.add_stop_key("End Projection Matrix By Bin SPECT UB Parameters");
 }
@@ -100,6 +103,8 @@ ProjMatrixByBinSPECTUB::set_defaults()
   this->already_setup = false;
 
   this->keep_all_views_in_cache = false;
+  this->maximum_number_of_views_in_cache = 0;
+  this->matrix_cache_directory = "";
   minimum_weight = 0.0;
   maximum_number_of_sigmas = 2.;
   spatial_resolution_PSF = 0.00001;
@@ -145,6 +150,45 @@ ProjMatrixByBinSPECTUB::set_keep_all_views_in_cache(bool value)
     }
 }
 
+int
+ProjMatrixByBinSPECTUB::get_maximum_number_of_views_in_cache() const
+{
+  return this->maximum_number_of_views_in_cache;
+}
+
+void
+ProjMatrixByBinSPECTUB::set_maximum_number_of_views_in_cache(const int value)
+{
+  if (this->maximum_number_of_views_in_cache != value)
+    {
+      this->maximum_number_of_views_in_cache = value;
+      this->already_setup = false;
+    }
+}
+
+int
+ProjMatrixByBinSPECTUB::get_num_views_in_cache() const
+{
+  std::lock_guard<std::mutex> lock(this->subsets_mutex);
+  return static_cast<int>(this->subsets_in_cache.size());
+}
+
+std::string
+ProjMatrixByBinSPECTUB::get_matrix_cache_directory() const
+{
+  return this->matrix_cache_directory;
+}
+
+void
+ProjMatrixByBinSPECTUB::set_matrix_cache_directory(const std::string& value)
+{
+  if (this->matrix_cache_directory != value)
+    {
+      this->matrix_cache_directory = value;
+      this->already_setup = false;
+    }
+}
+
 std::string
 ProjMatrixByBinSPECTUB::get_attenuation_type() const
 {
@@ -221,13 +265,10 @@ ProjMatrixByBinSPECTUB::set_up(const shared_ptr<const ProjDataInfo>& proj_data_i
 
   ProjMatrixByBin::set_up(proj_data_info_ptr_v, density_info_ptr);
 
-#ifdef STIR_OPENMP
-  if (!this->keep_all_views_in_cache)
-    {
-      warning("SPECTUB matrix can currently only use single-threaded code unless all views are kept. Setting num_threads to 1");
-      set_num_threads(1);
-    }
-#endif
+  if (this->maximum_number_of_views_in_cache < 0)
+    error("SPECTUB matrix: maximum number of views in cache has to be non-negative");
+  this->num_subsets_to_keep
+      = this->maximum_number_of_views_in_cache > 0 ? this->maximum_number_of_views_in_cache : get_max_num_threads();
 
   const VoxelsOnCartesianGrid<float>* image_info_ptr = dynamic_cast<const VoxelsOnCartesianGrid<float>*>(density_info_ptr.get());
 
@@ -620,78 +661,64 @@ ProjMatrixByBinSPECTUB::set_up(const shared_ptr<const ProjDataInfo>& proj_data_i
       NITEMS[kOS] = new int[wm.NbOS];
     }
 
-  //... double array wm.val and wm.col .....................................................
-
-  if ((wm.val = new (std::nothrow) float*[wm.NbOS]) == NULL)
-    {
-      // error_wm_SPECT( 200, "wm.val[]" );
-      error("Error allocating space to store values for SPECTUB matrix");
-    }
-  if ((wm.col = new (std::nothrow) int*[wm.NbOS]) == NULL)
-    {
-      // error_wm_SPECT( 200, "wm.col[]" );
-      error("Error allocating space to store column indices for SPECTUB matrix");
-    }
-
-  //... array wm.ne .........................................................................
+  //... wm.val, wm.col, wm.ne and projection indices are allocated in compute_one_subset ..........
 
-  if ((wm.ne = new (std::nothrow) int[wm.NbOS + 1]) == 0)
-    {
-      // error_wm_SPECT(200,"wm.ne[]");
-      error("Error allocating space to store number of elements for SPECTUB matrix");
-    }
+  wm.val = NULL;
+  wm.col = NULL;
+  wm.ne = NULL;
+  wm.na = wm.nb = wm.ns = NULL;
 
-  //... STIR indices .......................................................................
+  //... STIR indices for image elements (the same for all subsets) ...........................
 
   if (wm.do_save_STIR)
     {
-      wm.ns = new int[prj.NbOS];
-      wm.nb = new int[prj.NbOS];
-      wm.na = new int[prj.NbOS];
-
       wm.nx = new short int[vol.Nvox];
       wm.ny = new short int[vol.Nvox];
       wm.nz = new short int[vol.Nvox];
+
+      InvertAxis invert;
+      for (int islc = 0; islc < vol.Nsli; islc++)
+        for (int irow = 0; irow < vol.Nrow; irow++)
+          for (int icol = 0; icol < vol.Ncol; icol++)
+            {
+              const int iv = icol + irow * vol.Ncol + islc * vol.Npix;
+              wm.nx[iv] = (short int)invert.invert_axis_index(
+                  (icol - (int)floor(vol.Ncold2)), vol.Ncold2 * 2, "x"); // centered index for STIR format
+              wm.ny[iv] = (short int)(irow - (int)floor(vol.Nrowd2));   // centered index for STIR format
+              wm.nz[iv] = (short int)islc;                              // non-centered index for STIR format
+            }
     }
 
-  //... memory allocation for wmh .........................................................
+  //... wmh.index and wmh.Rrad are set for every subset (in a local copy of wmh) ..............
+
+  wmh.index = NULL;
+  wmh.Rrad = NULL;
+  wmh.fixed_Rrad = std::all_of(Rrad, Rrad + prj.Nang, [this](const float r) { return r == this->Rrad[0]; });
 
-  wmh.index = new int[wmh.prj.NangOS];
-  wmh.Rrad = new float[wmh.prj.NangOS];
+  //... files with the matrix (if any) ........................................................
+
+  this->file_cache.set_up(this->matrix_cache_directory, "SPECTUB", this->get_matrix_description());
+  if (this->file_cache.is_enabled())
+    info("SPECTUB matrix: using files in " + this->file_cache.get_directory(), 2);
 
   //..........................................................................................
   //... CALCULATION OF MATRICES ..............................................................
   //..........................................................................................
 
-  //... LOOP: Subsets .................................................................
-  subset_already_processed.assign(prj.NOS, false);
+  //... LOOP: Subsets (size estimation is not needed for views which are read from file) ............
+  this->size_estimated.assign(prj.NOS, 0);
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
   for (int kOS = 0; kOS < prj.NOS; kOS++)
     {
-      wmh.subset_ind = kOS;
-
-      for (int i = 0; i < prj.NangOS; i++)
-        {
-
-          wmh.index[i] = prj.order[i + kOS * prj.NangOS];
-          wmh.Rrad[i] = Rrad[wmh.index[i]];
-          if (wmh.Rrad[i] != wmh.Rrad[0])
-            wmh.fixed_Rrad = false;
-        }
-
-      //... NITEMS initialization  ......................
-
-      for (int i = 0; i < prj.NbOS; i++)
-        NITEMS[kOS][i] = 1;
-
-      //... size estimations ........................................................
-
-      wm_size_estimation(kOS, ang, vox, bin, vol, prj, msk_3d, msk_2d, maxszb, &gaussdens, NITEMS[kOS], wmh, Rrad);
-
-      // cout << "\nwm_SPECT. Size estimation done. time (s): " << double( clock()-ini )/CLOCKS_PER_SEC <<std::endl;
-
-      // compute_one_subset(kOS);
+      if (!this->file_cache.has_view(prj.order[kOS]))
+        this->estimate_size_of_subset(kOS);
     } // end of LOOP: Subsets
 
+  this->subset_states.assign(prj.NOS, SubsetState::not_computed);
+  this->subsets_in_cache.clear();
+
   // delete_UB_SPECT_arrays();
   info(boost::format("Done estimating size of matrix. Execution (CPU) time %1% s ") % timer.value(), 2);
   // wm_SPECT ends here ---------------------------------------------------------------------------------------------
@@ -730,10 +757,6 @@ ProjMatrixByBinSPECTUB::delete_UB_SPECT_arrays()
         }
     }
 
-  delete[] wm.val;
-  delete[] wm.col;
-  delete[] wm.ne;
-
   //... freeing memory .............................................
 
   delete[] prj.order;
@@ -741,8 +764,6 @@ ProjMatrixByBinSPECTUB::delete_UB_SPECT_arrays()
   for (int kOS = 0; kOS < prj.NOS; ++kOS)
     delete[] NITEMS[kOS];
   delete[] NITEMS;
-  delete[] wmh.index;
-  delete[] wmh.Rrad;
 
   if (wmh.do_psf)
     {
@@ -760,46 +781,122 @@ ProjMatrixByBinSPECTUB::delete_UB_SPECT_arrays()
 
   if (wm.do_save_STIR)
     {
-      delete[] wm.ns;
-      delete[] wm.nb;
-      delete[] wm.na;
       delete[] wm.nx;
       delete[] wm.ny;
       delete[] wm.nz;
     }
 }
+std::string
+ProjMatrixByBinSPECTUB::get_matrix_description() const
+{
+  // note: needs to be modified if the calculation of the matrix changes
+  std::stringstream s;
+  s.precision(std::numeric_limits<float>::max_digits10);
+  s << "SPECT UB matrix version 1\n";
+  s << "projections: " << prj.Nbin << ' ' << prj.szcm << ' ' << prj.Nsli << ' ' << prj.thcm << ' ' << prj.Nang << ' '
+    << prj.ang0 << ' ' << prj.incr << '\n';
+  s << "image: " << vol.Ncol << ' ' << vol.Nrow << ' ' << vol.Nsli << ' ' << vol.szcm << ' ' << vol.thcm << '\n';
+  s << "radii:";
+  for (int i = 0; i < prj.Nang; ++i)
+    s << ' ' << Rrad[i];
+  s << '\n';
+  s << "psf: " << wmh.do_psf << ' ' << wmh.do_psf_3d << ' ' << wmh.COL.A << ' ' << wmh.COL.B << ' ' << wmh.maxsigm << ' '
+    << wmh.psfres << ' ' << wmh.min_w << '\n';
+  // attenuation is computed with the weights, so we need to include the image
+  s << "attenuation: " << wmh.do_att << ' ' << wmh.do_full_att;
+  if (wmh.do_att)
+    s << " hash " << std::hex << compute_hash(attmap, vol.Nvox * sizeof(*attmap)) << std::dec;
+  s << '\n';
+  s << "mask: " << wmh.do_msk;
+  if (wmh.do_msk)
+    s << " hash " << std::hex
+      << compute_hash(msk_2d, vol.Npix * sizeof(*msk_2d), compute_hash(msk_3d, vol.Nvox * sizeof(*msk_3d)))
+      << std::dec;
+  s << '\n';
+  return s.str();
+}
+
+void
+ProjMatrixByBinSPECTUB::estimate_size_of_subset(const int kOS) const
+{
+  // local copy of wmh, such that subsets can be processed in parallel
+  wmh_type wmh_subset = wmh;
+  std::vector<int> index(prj.NangOS);
+  std::vector<float> Rrad_subset(prj.NangOS);
+  wmh_subset.index = index.data();
+  wmh_subset.Rrad = Rrad_subset.data();
+  wmh_subset.subset_ind = kOS;
+
+  for (int i = 0; i < prj.NangOS; i++)
+    {
+
+      wmh_subset.index[i] = prj.order[i + kOS * prj.NangOS];
+      wmh_subset.Rrad[i] = Rrad[wmh_subset.index[i]];
+    }
+
+  //... NITEMS initialization  ......................
+
+  for (int i = 0; i < prj.NbOS; i++)
+    NITEMS[kOS][i] = 1;
+
+  //... size estimations ........................................................
+
+  wm_size_estimation(kOS, ang, vox, bin, vol, prj, msk_3d, msk_2d, maxszb, &gaussdens, NITEMS[kOS], wmh_subset, Rrad);
+  this->size_estimated[kOS] = 1;
+}
+
 void
-ProjMatrixByBinSPECTUB::compute_one_subset(const int kOS, const float* Rrad) const
+ProjMatrixByBinSPECTUB::compute_one_subset(const int kOS, const float* Rrad, ProjMatrixElemsForOneBin& lor) const
 {
 
   CPUTimer timer;
   timer.start();
-  // cout << "\n\n--- Processing subset: " << kOS+1 << "/" << prj.NOS << " ----------------------------------------\n" << endl;
 
-  //... to fill wmh fields related to the subset ..................................
+  const Bin requested_bin = lor.get_bin();
 
-  this->wmh.subset_ind = kOS;
+  //... read from file if possible .........................................................
 
-  for (int i = 0; i < prj.NangOS; i++)
+  std::vector<ProjMatrixElemsForOneBin> lors;
+  if (this->file_cache.read_view(lors, prj.order[kOS]) == Succeeded::yes)
     {
-
-      this->wmh.index[i] = prj.order[i + kOS * prj.NangOS];
-      this->wmh.Rrad[i] = Rrad[this->wmh.index[i]];
+      for (const auto& lor_j : lors)
+        {
+          const Bin bin = lor_j.get_bin();
+          if (bin.segment_num() == requested_bin.segment_num() && bin.view_num() == requested_bin.view_num()
+              && bin.axial_pos_num() == requested_bin.axial_pos_num()
+              && bin.tangential_pos_num() == requested_bin.tangential_pos_num())
+            {
+              lor = lor_j;
+              lor.set_bin(requested_bin);
+            }
+          this->cache_proj_matrix_elems_for_one_bin(lor_j);
+        }
+      info(boost::format("Matrix elements for view %1% read from file. time %2% (s)") % prj.order[kOS] % timer.value(), 2);
+      return;
     }
 
-  //... NITEMS initialization  ......................
+  if (!this->size_estimated[kOS])
+    this->estimate_size_of_subset(kOS);
 
-  // for ( int i = 0 ; i < prj.NbOS ; i++ ) NITEMS[ i ] = 1;
+  //... local copy of wmh with fields related to the subset ..................................
 
-  //... size esmitations ........................................................
+  wmh_type wmh = this->wmh;
+  std::vector<int> index(prj.NangOS);
+  std::vector<float> Rrad_subset(prj.NangOS);
+  wmh.index = index.data();
+  wmh.Rrad = Rrad_subset.data();
+  wmh.subset_ind = kOS;
 
-  // wm_size_estimation ( kOS,  ang, vox, bin, vol, prj, msk_3d, msk_2d, maxszb, &gaussdens, NITEMS );
+  for (int i = 0; i < prj.NangOS; i++)
+    {
 
-  // cout << "\nwm_SPECT. Size estimation done. time (s): " << double( clock()-ini )/CLOCKS_PER_SEC <<endl;
+      wmh.index[i] = prj.order[i + kOS * prj.NangOS];
+      wmh.Rrad[i] = Rrad[wmh.index[i]];
+    }
 
   int ne = 0;
 
-  for (int i = 0; i < this->wmh.prj.NbOS; i++)
+  for (int i = 0; i < wmh.prj.NbOS; i++)
     ne += NITEMS[kOS][i];
 
   //... size information ....................................................................
@@ -808,83 +905,81 @@ ProjMatrixByBinSPECTUB::compute_one_subset(const int kOS, const float* Rrad) con
            % (this->wm.do_save_STIR ? (ne + 10 * prj.NbOS) / 104857.6 : ne / 131072),
        2);
 
-  //... memory allocation for wm float arrays ...................................
-
-  for (int i = 0; i < this->wmh.prj.NbOS; i++)
-    {
-
-      if ((this->wm.val[i] = new (std::nothrow) float[NITEMS[kOS][i]]) == NULL)
-        {
-          // error_wm_SPECT( 200, "wm.val[][]" );
-          error("Error allocating space to store values for SPECTUB matrix");
-        }
-
-      if ((this->wm.col[i] = new (std::nothrow) int[NITEMS[kOS][i]]) == NULL)
-        {
-          // error_wm_SPECT( 200, "wm.col[]" );
-          error("Error allocating space to store column indices for SPECTUB matrix");
-        }
-    }
-
-  //... to initialize wm to zero ......................
+  //... local copy of wm, with memory allocation for the subset (initialised to zero) ...........
 
-  for (int i = 0; i < this->wm.NbOS; i++)
+  wm_da_type wm = this->wm;
+  std::vector<std::vector<float>> val(wm.NbOS);
+  std::vector<std::vector<int>> col(wm.NbOS);
+  std::vector<float*> val_ptrs(wm.NbOS);
+  std::vector<int*> col_ptrs(wm.NbOS);
+  for (int i = 0; i < wm.NbOS; i++)
     {
-
-      this->wm.ne[i] = 0;
-
-      for (int j = 0; j < NITEMS[kOS][i]; j++)
-        {
-
-          this->wm.val[i][j] = (float)0.;
-          this->wm.col[i][j] = 0;
-        }
+      val[i].resize(NITEMS[kOS][i]);
+      col[i].resize(NITEMS[kOS][i]);
+      val_ptrs[i] = val[i].data();
+      col_ptrs[i] = col[i].data();
     }
-  this->wm.ne[this->wm.NbOS] = 0;
+  std::vector<int> ne_per_row(wm.NbOS + 1, 0);
+  std::vector<int> na(wm.NbOS), nb(wm.NbOS), ns(wm.NbOS);
+  wm.val = val_ptrs.data();
+  wm.col = col_ptrs.data();
+  wm.ne = ne_per_row.data();
+  wm.na = na.data();
+  wm.nb = nb.data();
+  wm.ns = ns.data();
 
   //... wm calculation for this subset ...........................
 
-  wm_calculation(
-      kOS, ang, vox, bin, vol, prj, attmap, msk_3d, msk_2d, maxszb, &gaussdens, NITEMS[kOS], this->wm, this->wmh, Rrad);
+  wm_calculation(kOS, ang, vox, bin, vol, prj, attmap, msk_3d, msk_2d, maxszb, &gaussdens, NITEMS[kOS], wm, wmh, Rrad);
   info(boost::format("Weight matrix calculation done. time %1% (s)") % timer.value(), 2);
 
   //... fill lor .........................
 
-  for (int j = 0; j < this->wm.NbOS; j++)
+  for (int j = 0; j < wm.NbOS; j++)
     {
-      ProjMatrixElemsForOneBin lor;
+      ProjMatrixElemsForOneBin lor_j;
       Bin bin;
       bin.segment_num() = 0;
-      bin.view_num() = this->wm.na[j];
-      bin.axial_pos_num() = this->wm.ns[j];
-      bin.tangential_pos_num() = this->wm.nb[j];
+      bin.view_num() = wm.na[j];
+      bin.axial_pos_num() = wm.ns[j];
+      bin.tangential_pos_num() = wm.nb[j];
       bin.set_bin_value(0);
-      lor.set_bin(bin);
+      lor_j.set_bin(bin);
 
-      lor.reserve(this->wm.ne[j]);
-      for (int i = 0; i < this->wm.ne[j]; i++)
+      lor_j.reserve(wm.ne[j]);
+      for (int i = 0; i < wm.ne[j]; i++)
         {
 
-          const ProjMatrixElemsForOneBin::value_type elem(Coordinate3D<int>(this->wm.nz[this->wm.col[j][i]],
-                                                                            this->wm.ny[this->wm.col[j][i]],
-                                                                            this->wm.nx[this->wm.col[j][i]]),
-                                                          this->wm.val[j][i]);
-          lor.push_back(elem);
+          const ProjMatrixElemsForOneBin::value_type elem(
+              Coordinate3D<int>(wm.nz[wm.col[j][i]], wm.ny[wm.col[j][i]], wm.nx[wm.col[j][i]]), wm.val[j][i]);
+          lor_j.push_back(elem);
         }
 
-      delete[] this->wm.val[j];
-      delete[] this->wm.col[j];
+      // free memory as we go
+      std::vector<float>().swap(val[j]);
+      std::vector<int>().swap(col[j]);
+
+      if (bin.segment_num() == requested_bin.segment_num() && bin.view_num() == requested_bin.view_num()
+          && bin.axial_pos_num() == requested_bin.axial_pos_num()
+          && bin.tangential_pos_num() == requested_bin.tangential_pos_num())
+        {
+          lor = lor_j;
+          lor.set_bin(requested_bin);
+        }
 
-      this->cache_proj_matrix_elems_for_one_bin(lor);
+      this->cache_proj_matrix_elems_for_one_bin(lor_j);
+      if (this->file_cache.is_enabled())
+        lors.push_back(std::move(lor_j));
     }
 
   info(boost::format("Total time after transfering to ProjMatrixElemsForOneBin. time %1% (s)") % timer.value(), 2);
+  if (this->file_cache.is_enabled())
+    this->file_cache.write_view(lors, prj.order[kOS]);
 }
+
 void
 ProjMatrixByBinSPECTUB::calculate_proj_matrix_elems_for_one_bin(ProjMatrixElemsForOneBin& lor) const
 {
-  // error("ProjMatrixByBinSPECTUB element not found in cache (and hence file)");
-
   const int view_num = lor.get_bin().view_num();
   // find which "UB-subset" this view is in
   int kOS = 0;
@@ -894,22 +989,66 @@ ProjMatrixByBinSPECTUB::calculate_proj_matrix_elems_for_one_bin(ProjMatrixElemsF
       if (prj.order[kOS] == view_num)
         break;
     }
-#ifdef STIR_OPENMP
-#  pragma omp critical(PROJMATRIXBYBINUBONEVIEW)
-#endif
-  if (!subset_already_processed[kOS])
+
+  // Different subsets can be computed in parallel. Threads needing a subset that is being computed
+  // by another thread wait until it is done.
+  std::unique_lock<std::mutex> lock(this->subsets_mutex);
+  while (true)
     {
-      if (!this->keep_all_views_in_cache)
+      switch (this->subset_states[kOS])
         {
-          this->clear_cache();
-          subset_already_processed.assign(prj.NOS, false);
+        case SubsetState::computing:
+          this->subset_computed_condition.wait(lock);
+          break;
+
+        case SubsetState::computed:
+          // computed by another thread since we looked in the cache
+          // (its position in subsets_in_cache is not changed, see set_maximum_number_of_views_in_cache())
+          lock.unlock();
+          if (this->get_cached_proj_matrix_elems_for_one_bin(lor) == Succeeded::yes)
+            return;
+          lock.lock();
+          // the subset has been removed from the cache in the mean time (or the cache was cleared)
+          if (this->subset_states[kOS] == SubsetState::computed)
+            {
+              this->subsets_in_cache.remove(kOS);
+              this->subset_states[kOS] = SubsetState::not_computed;
+            }
+          break;
+
+        case SubsetState::not_computed:
+          this->subset_states[kOS] = SubsetState::computing;
+          lock.unlock();
+          info(boost::format("Computing matrix elements for view %1%") % view_num, 2);
+          try
+            {
+              compute_one_subset(kOS, Rrad, lor);
+            }
+          catch (...)
+            {
+              lock.lock();
+              this->subset_states[kOS] = SubsetState::not_computed;
+              this->subset_computed_condition.notify_all();
+              throw;
+            }
+          lock.lock();
+          this->subset_states[kOS] = SubsetState::computed;
+          this->subsets_in_cache.push_front(kOS);
+          if (!this->keep_all_views_in_cache)
+            {
+              // remove the subsets that were computed first from the cache
+              while (static_cast<int>(this->subsets_in_cache.size()) > this->num_subsets_to_keep)
+                {
+                  const int kOS_to_remove = this->subsets_in_cache.back();
+                  this->subsets_in_cache.pop_back();
+                  this->subset_states[kOS_to_remove] = SubsetState::not_computed;
+                  this->clear_cache_for_view(prj.order[kOS_to_remove]);
+                }
+            }
+          this->subset_computed_condition.notify_all();
+          return;
         }
-      info(boost::format("Computing matrix elements for view %1%") % view_num,
-           2); // potentially pass a wm, wmh[threadh] not sure if works then in setup we need an array of wmh
-      compute_one_subset(kOS, Rrad);
-      subset_already_processed[kOS] = true;
     }
-  lor.erase();
 }
 
 END_NAMESPACE_STIR
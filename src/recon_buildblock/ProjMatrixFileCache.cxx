@@ -0,0 +1,279 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup projection
+
+  \brief Implementation of class stir::ProjMatrixFileCache
+
+  \author Kris Thielemans
+*/
+
+#include "stir/recon_buildblock/ProjMatrixFileCache.h"
+#include "stir/Coordinate3D.h"
+#include "stir/Bin.h"
+#include "stir/Succeeded.h"
+#include "stir/compute_hash.h"
+#include "stir/warning.h"
+#include <boost/format.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <cstring>
+
+START_NAMESPACE_STIR
+
+namespace
+{
+const char file_signature[16] = "STIRProjMatrix1";
+const std::uint32_t byte_order_marker = 0x01020304;
+
+struct FileHeader
+{
+  char signature[16];
+  std::uint32_t byte_order;
+  std::uint32_t num_bins;
+  std::uint64_t num_elems;
+};
+
+struct BinRecord
+{
+  std::int32_t segment_num;
+  std::int32_t view_num;
+  std::int32_t axial_pos_num;
+  std::int32_t tangential_pos_num;
+  std::int32_t timing_pos_num;
+  std::uint32_t num_elems;
+};
+
+struct ElemRecord
+{
+  std::int16_t c1, c2, c3, unused;
+  float value;
+};
+
+// write to a temporary file in the same directory, and rename it, such that other processes never see partial files
+Succeeded
+write_file_atomically(const std::string& filename, const std::string& data)
+{
+  std::random_device random;
+  const std::string tmp_filename = filename + ".tmp" + std::to_string(random()) + std::to_string(random());
+  {
+    std::ofstream file(tmp_filename, std::ios::binary);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    file.close();
+    if (!file)
+      {
+        std::error_code ec;
+        std::filesystem::remove(tmp_filename, ec);
+        warning("ProjMatrixFileCache: error writing " + tmp_filename);
+        return Succeeded::no;
+      }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp_filename, filename, ec);
+  if (ec)
+    {
+      std::filesystem::remove(tmp_filename, ec);
+      warning("ProjMatrixFileCache: error renaming file to " + filename);
+      return Succeeded::no;
+    }
+  return Succeeded::yes;
+}
+
+} // namespace
+
+ProjMatrixFileCache::ProjMatrixFileCache()
+{}
+
+void
+ProjMatrixFileCache::set_up(const std::string& cache_directory,
+                            const std::string& matrix_name,
+                            const std::string& matrix_description)
+{
+  this->directory.clear();
+  if (cache_directory.empty())
+    return;
+
+  std::stringstream subdirectory;
+  subdirectory << matrix_name << '_' << std::hex << std::setw(16) << std::setfill('0')
+               << compute_hash(matrix_description.data(), matrix_description.size());
+  const std::filesystem::path path = std::filesystem::path(cache_directory) / subdirectory.str();
+  std::error_code ec;
+  std::filesystem::create_directories(path, ec);
+  if (ec)
+    {
+      warning(boost::format("ProjMatrixFileCache: cannot create directory %1% (%2%). Files will not be used.") % path.string()
+              % ec.message());
+      return;
+    }
+
+  const std::string parameters_filename = (path / "parameters.txt").string();
+  if (std::filesystem::exists(parameters_filename))
+    {
+      std::ifstream file(parameters_filename, std::ios::binary);
+      std::stringstream contents;
+      contents << file.rdbuf();
+      if (contents.str() != matrix_description)
+        {
+          warning(boost::format("ProjMatrixFileCache: %1% does not correspond to the current matrix. Files will not be used.")
+                  % parameters_filename);
+          return;
+        }
+    }
+  else if (write_file_atomically(parameters_filename, matrix_description) == Succeeded::no)
+    return;
+
+  this->directory = path.string();
+}
+
+std::string
+ProjMatrixFileCache::get_filename(const int view_num, const int segment_num) const
+{
+  return (std::filesystem::path(this->directory) / (boost::format("seg%1%_view%2%.bin") % segment_num % view_num).str()).string();
+}
+
+bool
+ProjMatrixFileCache::has_view(const int view_num, const int segment_num) const
+{
+  if (!this->is_enabled())
+    return false;
+  std::error_code ec;
+  return std::filesystem::exists(this->get_filename(view_num, segment_num), ec);
+}
+
+Succeeded
+ProjMatrixFileCache::write_view(const std::vector<ProjMatrixElemsForOneBin>& lors, const int view_num, const int segment_num) const
+{
+  if (!this->is_enabled())
+    return Succeeded::no;
+
+  std::size_t num_elems = 0;
+  for (const auto& lor : lors)
+    num_elems += lor.size();
+
+  std::string data(sizeof(FileHeader) + lors.size() * sizeof(BinRecord) + num_elems * sizeof(ElemRecord), '\0');
+  char* ptr = &data[0];
+  FileHeader header;
+  std::memcpy(header.signature, file_signature, sizeof(header.signature));
+  header.byte_order = byte_order_marker;
+  header.num_bins = static_cast<std::uint32_t>(lors.size());
+  header.num_elems = num_elems;
+  std::memcpy(ptr, &header, sizeof(header));
+  ptr += sizeof(header);
+
+  for (const auto& lor : lors)
+    {
+      const Bin bin = lor.get_bin();
+      BinRecord bin_record;
+      bin_record.segment_num = bin.segment_num();
+      bin_record.view_num = bin.view_num();
+      bin_record.axial_pos_num = bin.axial_pos_num();
+      bin_record.tangential_pos_num = bin.tangential_pos_num();
+      bin_record.timing_pos_num = bin.timing_pos_num();
+      bin_record.num_elems = static_cast<std::uint32_t>(lor.size());
+      std::memcpy(ptr, &bin_record, sizeof(bin_record));
+      ptr += sizeof(bin_record);
+    }
+  for (const auto& lor : lors)
+    for (const auto& elem : lor)
+      {
+        ElemRecord elem_record;
+        elem_record.c1 = static_cast<std::int16_t>(elem.coord1());
+        elem_record.c2 = static_cast<std::int16_t>(elem.coord2());
+        elem_record.c3 = static_cast<std::int16_t>(elem.coord3());
+        elem_record.unused = 0;
+        elem_record.value = elem.get_value();
+        std::memcpy(ptr, &elem_record, sizeof(elem_record));
+        ptr += sizeof(elem_record);
+      }
+
+  return write_file_atomically(this->get_filename(view_num, segment_num), data);
+}
+
+Succeeded
+ProjMatrixFileCache::read_view(std::vector<ProjMatrixElemsForOneBin>& lors, const int view_num, const int segment_num) const
+{
+  if (!this->has_view(view_num, segment_num))
+    return Succeeded::no;
+
+  const std::string filename = this->get_filename(view_num, segment_num);
+  try
+    {
+      using namespace boost::interprocess;
+      const file_mapping mapping(filename.c_str(), read_only);
+      const mapped_region region(mapping, read_only);
+      const char* ptr = static_cast<const char*>(region.get_address());
+      const std::size_t file_size = region.get_size();
+
+      FileHeader header;
+      if (file_size < sizeof(header))
+        {
+          warning("ProjMatrixFileCache: file too short: " + filename);
+          return Succeeded::no;
+        }
+      std::memcpy(&header, ptr, sizeof(header));
+      ptr += sizeof(header);
+      if (std::memcmp(header.signature, file_signature, sizeof(header.signature)) != 0 || header.byte_order != byte_order_marker
+          || file_size != sizeof(FileHeader) + header.num_bins * sizeof(BinRecord) + header.num_elems * sizeof(ElemRecord))
+        {
+          warning("ProjMatrixFileCache: file has wrong format or size: " + filename);
+          return Succeeded::no;
+        }
+
+      std::vector<ProjMatrixElemsForOneBin> lors_from_file(header.num_bins);
+      const char* elems_ptr = ptr + header.num_bins * sizeof(BinRecord);
+      std::uint64_t num_elems_read = 0;
+      for (auto& lor : lors_from_file)
+        {
+          BinRecord bin_record;
+          std::memcpy(&bin_record, ptr, sizeof(bin_record));
+          ptr += sizeof(bin_record);
+          num_elems_read += bin_record.num_elems;
+          if (num_elems_read > header.num_elems)
+            {
+              warning("ProjMatrixFileCache: inconsistent number of elements in file: " + filename);
+              return Succeeded::no;
+            }
+          lor.set_bin(Bin(bin_record.segment_num,
+                          bin_record.view_num,
+                          bin_record.axial_pos_num,
+                          bin_record.tangential_pos_num,
+                          bin_record.timing_pos_num,
+                          0.F));
+          lor.reserve(bin_record.num_elems);
+          for (std::uint32_t i = 0; i < bin_record.num_elems; ++i)
+            {
+              ElemRecord elem_record;
+              std::memcpy(&elem_record, elems_ptr, sizeof(elem_record));
+              elems_ptr += sizeof(elem_record);
+              lor.push_back(ProjMatrixElemsForOneBin::value_type(
+                  Coordinate3D<int>(elem_record.c1, elem_record.c2, elem_record.c3), elem_record.value));
+            }
+        }
+      if (num_elems_read != header.num_elems)
+        {
+          warning("ProjMatrixFileCache: inconsistent number of elements in file: " + filename);
+          return Succeeded::no;
+        }
+      lors.swap(lors_from_file);
+    }
+  catch (const std::exception& e)
+    {
+      warning(boost::format("ProjMatrixFileCache: error reading %1%: %2%") % filename % e.what());
+      return Succeeded::no;
+    }
+  return Succeeded::yes;
+}
+
+END_NAMESPACE_STIR
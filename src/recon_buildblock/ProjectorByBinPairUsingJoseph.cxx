@@ -0,0 +1,43 @@
+//
+//
+/*!
+  \file
+  \ingroup projection
+
+  \brief non-inline implementations for stir::ProjectorByBinPairUsingJoseph
+
+  \author Kris Thielemans
+*/
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+
+#include "stir/recon_buildblock/ProjectorByBinPairUsingJoseph.h"
+#include "stir/recon_buildblock/ForwardProjectorByBinUsingJoseph.h"
+#include "stir/recon_buildblock/BackProjectorByBinUsingJoseph.h"
+
+START_NAMESPACE_STIR
+
+const char* const ProjectorByBinPairUsingJoseph::registered_name = "Joseph";
+
+void
+ProjectorByBinPairUsingJoseph::initialise_keymap()
+{
+  base_type::initialise_keymap();
+  parser.add_start_key("Projector Pair Using Joseph Parameters");
+  parser.add_stop_key("End Projector Pair Using Joseph Parameters");
+}
+
+ProjectorByBinPairUsingJoseph::ProjectorByBinPairUsingJoseph()
+{
+  this->forward_projector_sptr.reset(new ForwardProjectorByBinUsingJoseph);
+  this->back_projector_sptr.reset(new BackProjectorByBinUsingJoseph);
+  set_defaults();
+}
+
+END_NAMESPACE_STIR
@@ -1,6 +1,6 @@
 /*
     Copyright (c) 2013, Biomedical Image Group (GIB), Universitat de Barcelona, Barcelona, Spain.
-    Copyright (c) 2013, University College London
+    Copyright (c) 2013, 2026, University College London
 
     This file is part of STIR.
 
@@ -18,13 +18,13 @@
 #include "stir/error.h"
 #include <boost/format.hpp>
 #include <boost/math/constants/constants.hpp>
-#include "stir/spatial_transformation/InvertAxis.h"
 
 // system libraries
 #include <stdio.h>
 #include <iostream>
 #include <stdlib.h>
 #include <string>
+#include <vector>
 #include <math.h>
 
 namespace SPECTUB
@@ -41,6 +41,18 @@ namespace SPECTUB
 #define REF_DIST 5. // reference distance for fanbeam PSF
 
 using namespace std;
+
+namespace
+{
+//! one weight of the matrix, as stored before copying it into wm_da_type
+struct weight_item_type
+{
+  int jp;       // projection index (row index of the weight matrix)
+  int iv;       // volume index of the voxel (column index of the weight matrix)
+  float weight; // value
+};
+} // namespace
+
 //==========================================================================
 //=== wm_calculation =======================================================
 //==========================================================================
@@ -63,70 +75,12 @@ wm_calculation(const int kOS,
                const float* Rrad)
 {
 
-  float weight;
-  float coeff_att = (float)1.;
-  int jp;
-  float eff;
-
-  //... variables for geometric component ..............................................
-
-  psf1d_type psf1d_h, psf1d_v;
-
-  psf1d_h.maxszb = maxszb;
-  psf1d_h.val = new float[maxszb];
-  psf1d_h.ind = new int[maxszb];
-
-  if (wmh.do_psf_3d)
-    {
-      psf1d_v.maxszb = maxszb;
-      psf1d_v.val = new float[maxszb];
-      psf1d_v.ind = new int[maxszb];
-    }
-
-  psf2da_type psf;
-
-  psf.maxszb_h = maxszb;
-  if (wmh.do_psf_3d)
-    psf.maxszb_v = maxszb;
-  else
-    psf.maxszb_v = 1;
-  psf.maxszb_t = psf.maxszb_h * psf.maxszb_v;
-
-  psf.val = new float[psf.maxszb_t]; // allocation for PSF values
-  psf.ib = new int[psf.maxszb_t];    // allocation for PSF indices
-  psf.jb = new int[psf.maxszb_t];    // allocation for PSF indices
-
-  //... variables for attenuation component .............................................
-
-  attpth_type* attpth = 0; // initialise to avoid compiler warning
-  int sizeattpth = 1;      // initialise to avoid compiler warning
-
-  if (wmh.do_att || wmh.do_msk_att)
-    {
-
-      if (!wmh.do_full_att)
-        sizeattpth = 1;
-      else
-        sizeattpth = psf.maxszb_t;
-
-      attpth = new attpth_type[sizeattpth];
-      attpth[0].maxlng = vol.Ncol + vol.Nrow + vol.Nsli; // maximum length of an attenuation path
-
-      for (int i = 0; i < sizeattpth; i++)
-        {
-
-          attpth[i].dl = new float[attpth[0].maxlng];
-          attpth[i].iv = new int[attpth[0].maxlng];
-          attpth[i].maxlng = attpth[0].maxlng;
-        }
-    }
-
   //... to fill projection indices for STIR format .............................
 
   if (wm.do_save_STIR)
     {
 
-      jp = -1; // projection index (row index of the weight matrix )
+      int jp = -1; // projection index (row index of the weight matrix )
       int j1;
 
       for (int j = 0; j < prj.NangOS; j++)
@@ -149,198 +103,235 @@ wm_calculation(const int kOS,
         }
     }
 
-  //=== LOOP1: IMAGE ROWS =======================================================================
-
-  for (vox.irow = 0; vox.irow < vol.Nrow; vox.irow++)
-    {
-
-      // cout << "weights: " << 100.*(vox.irow+1)/vol.Nrow << "%" << endl;
-
-      vox.y = vol.y0 + vox.irow * vol.szcm; // y coordinate of the voxel (index 0->Nrow-1: irow)
-
-      //=== LOOP2: IMAGE COLUMNS =================================================================
+  //... weights are first stored per image row, such that rows can be computed in parallel ..........
+  //... and the weight matrix can be filled in the same order as a sequential calculation ..........
 
-      for (vox.icol = 0; vox.icol < vol.Ncol; vox.icol++)
-        {
-
-          vox.x = vol.x0 + vox.icol * vol.szcm;    // x coordinate of the voxel (index 0->Ncol-1: icol)
-          vox.ip = vox.irow * vol.Ncol + vox.icol; // in-plane index of the voxel considering the slice as an array
-
-          //... to apply mask .........................................
-
-          if (wmh.do_msk)
-            {
-
-              if (!msk_2d[vox.ip])
-                continue; // to skip voxel if it is outside the 2d_mask
-            }
+  std::vector<std::vector<weight_item_type>> weights_per_row(vol.Nrow);
 
-          //=== LOOP3: ANGLES INTO SUBSETS ========================================================
+  //=== LOOP1: IMAGE ROWS =======================================================================
 
-          for (int k = 0; k < prj.NangOS; k++)
-            {
+#ifdef STIR_OPENMP
+#  pragma omp parallel firstprivate(vox, bin)
+#endif
+  {
+    float weight;
+    float coeff_att = (float)1.;
+    int jp;
+    float eff;
+
+    //... variables for geometric component (one copy per thread) ..............................
+
+    std::vector<float> psf1d_h_val(maxszb), psf1d_v_val(maxszb);
+    std::vector<int> psf1d_h_ind(maxszb), psf1d_v_ind(maxszb);
+
+    psf1d_type psf1d_h, psf1d_v;
+
+    psf1d_h.maxszb = maxszb;
+    psf1d_h.val = psf1d_h_val.data();
+    psf1d_h.ind = psf1d_h_ind.data();
+
+    psf1d_v.maxszb = maxszb;
+    psf1d_v.val = psf1d_v_val.data();
+    psf1d_v.ind = psf1d_v_ind.data();
+
+    psf2da_type psf;
+
+    psf.maxszb_h = maxszb;
+    if (wmh.do_psf_3d)
+      psf.maxszb_v = maxszb;
+    else
+      psf.maxszb_v = 1;
+    psf.maxszb_t = psf.maxszb_h * psf.maxszb_v;
+
+    std::vector<float> psf_val(psf.maxszb_t);
+    std::vector<int> psf_ib(psf.maxszb_t), psf_jb(psf.maxszb_t);
+    psf.val = psf_val.data(); // PSF values
+    psf.ib = psf_ib.data();   // PSF indices
+    psf.jb = psf_jb.data();   // PSF indices
+
+    //... variables for attenuation component (one copy per thread) .............................
+
+    std::vector<attpth_type> attpth;
+    std::vector<std::vector<float>> attpth_dl;
+    std::vector<std::vector<int>> attpth_iv;
+
+    if (wmh.do_att || wmh.do_msk_att)
+      {
+        const int sizeattpth = wmh.do_full_att ? psf.maxszb_t : 1;
+        const int maxlng = vol.Ncol + vol.Nrow + vol.Nsli; // maximum length of an attenuation path
+
+        attpth.resize(sizeattpth);
+        attpth_dl.assign(sizeattpth, std::vector<float>(maxlng));
+        attpth_iv.assign(sizeattpth, std::vector<int>(maxlng));
+
+        for (int i = 0; i < sizeattpth; i++)
+          {
+            attpth[i].dl = attpth_dl[i].data();
+            attpth[i].iv = attpth_iv[i].data();
+            attpth[i].maxlng = maxlng;
+          }
+      }
+
+#ifdef STIR_OPENMP
+#  pragma omp for schedule(dynamic)
+#endif
+    for (int irow = 0; irow < vol.Nrow; irow++)
+      {
+        vox.irow = irow;
+        std::vector<weight_item_type>& weights = weights_per_row[irow];
 
-              int ka = wmh.index[k]; // angle index of the current projection (considering the whole set of projections)
+        vox.y = vol.y0 + vox.irow * vol.szcm; // y coordinate of the voxel (index 0->Nrow-1: irow)
 
-              //... perpendicular distance form voxel to detection plane ...........................
+        //=== LOOP2: IMAGE COLUMNS =================================================================
 
-              vox.dv2dp = vox.x * ang[ka].sin - vox.y * ang[ka].cos + ang[ka].Rrad;
+        for (vox.icol = 0; vox.icol < vol.Ncol; vox.icol++)
+          {
 
-              if (vox.dv2dp <= 0.)
-                continue; // skipping voxel if it is beyond the detection plane (corner voxels)
+            vox.x = vol.x0 + vox.icol * vol.szcm;    // x coordinate of the voxel (index 0->Ncol-1: icol)
+            vox.ip = vox.irow * vol.Ncol + vox.icol; // in-plane index of the voxel considering the slice as an array
 
-              //... x coordinate in the rotated frame ..............................................
+            //... to apply mask .........................................
 
-              vox.x1 = vox.x * ang[ka].cos + vox.y * ang[ka].sin;
+            if (wmh.do_msk)
+              {
 
-              //... to project voxels onto the detection plane and to calculate other distances .....
+                if (!msk_2d[vox.ip])
+                  continue; // to skip voxel if it is outside the 2d_mask
+              }
 
-              voxel_projection(&vox, &eff, prj.lngcmd2, wmh);
+            //=== LOOP3: ANGLES INTO SUBSETS ========================================================
 
-              //... setting PSF to zero	.........................................
+            for (int k = 0; k < prj.NangOS; k++)
+              {
 
-              //		for ( int i = 0 ; i < nel ; i++ ){
-              //
-              //			psf.val[ i ] = (float)0.;
-              //			psf.ib[ i ]  = psf.jb[ i ] = 0;
-              //		}
+                int ka = wmh.index[k]; // angle index of the current projection (considering the whole set of projections)
 
-              //... correction for PSF ..............................
+                //... perpendicular distance form voxel to detection plane ...........................
 
-              if (!wmh.do_psf)
-                fill_psf_no(&psf, &psf1d_h, vox, &ang[ka], bin.szdx, wmh);
+                vox.dv2dp = vox.x * ang[ka].sin - vox.y * ang[ka].cos + ang[ka].Rrad;
 
-              else
-                {
+                if (vox.dv2dp <= 0.)
+                  continue; // skipping voxel if it is beyond the detection plane (corner voxels)
 
-                  if (wmh.do_psf_3d)
-                    fill_psf_3d(&psf, &psf1d_h, &psf1d_v, vox, gaussdens, bin.szdx, bin.thdx, bin.thcmd2, wmh);
+                //... x coordinate in the rotated frame ..............................................
 
-                  else
-                    fill_psf_2d(&psf, &psf1d_h, vox, gaussdens, bin.szdx, wmh);
-                }
+                vox.x1 = vox.x * ang[ka].cos + vox.y * ang[ka].sin;
 
-              //... correction for attenuation .................................................
+                //... to project voxels onto the detection plane and to calculate other distances .....
 
-              if (wmh.do_att)
-                {
+                voxel_projection(&vox, &eff, prj.lngcmd2, wmh);
 
-                  vox.z = (float)0.;
+                //... correction for PSF ..............................
 
-                  if (!wmh.do_full_att)
-                    { // simple correction for attenuation
+                if (!wmh.do_psf)
+                  fill_psf_no(&psf, &psf1d_h, vox, &ang[ka], bin.szdx, wmh);
 
-                      bin.x
-                          = ang[ka].xbin0
-                            + vox.xd0 * ang[ka].cos; // x coord of the projection of the center of the voxel in the detection line
-                      bin.y = ang[ka].ybin0 + vox.xd0 * ang[ka].sin;
-                      bin.z = (float)0.;
+                else
+                  {
 
-                      calc_att_path(bin, vox, vol, &attpth[0]);
-                    }
-                  else
-                    { // full correction for attenuation
+                    if (wmh.do_psf_3d)
+                      fill_psf_3d(&psf, &psf1d_h, &psf1d_v, vox, gaussdens, bin.szdx, bin.thdx, bin.thcmd2, wmh);
 
-                      for (int i = 0; i < psf.Nib; i++)
-                        {
+                    else
+                      fill_psf_2d(&psf, &psf1d_h, vox, gaussdens, bin.szdx, wmh);
+                  }
 
-                          bin.x = ang[ka].xbin0 + ang[ka].incx * ((float)psf.ib[i] + (float)0.5);
-                          bin.y = ang[ka].ybin0 + ang[ka].incy * ((float)psf.ib[i] + (float)0.5);
-                          bin.z = (float)psf.jb[i] * vox.thcm;
+                //... correction for attenuation .................................................
 
-                          calc_att_path(bin, vox, vol, &attpth[i]);
-                        }
-                    }
-                }
+                if (wmh.do_att)
+                  {
 
-              //=== LOOP4: IMAGE SLICES ================================================================
+                    vox.z = (float)0.;
 
-              for (vox.islc = vol.first_sl; vox.islc < vol.last_sl; vox.islc++)
-                {
+                    if (!wmh.do_full_att)
+                      { // simple correction for attenuation
 
-                  vox.iv = vox.ip + vox.islc * vol.Npix; // volume index of the voxel (volume as an array)
+                        bin.x = ang[ka].xbin0
+                                + vox.xd0 * ang[ka].cos; // x coord of the projection of the center of the voxel in the detection line
+                        bin.y = ang[ka].ybin0 + vox.xd0 * ang[ka].sin;
+                        bin.z = (float)0.;
 
-                  if (wmh.do_msk)
-                    {
-                      if (!msk_3d[vox.iv])
-                        continue;
-                    }
+                        calc_att_path(bin, vox, vol, &attpth[0]);
+                      }
+                    else
+                      { // full correction for attenuation
 
-                  if (wmh.do_att && !wmh.do_full_att)
-                    coeff_att = calc_att(&attpth[0], attmap, vox.islc, wmh);
+                        for (int i = 0; i < psf.Nib; i++)
+                          {
 
-                  //... weight matrix values calculation .......................................
+                            bin.x = ang[ka].xbin0 + ang[ka].incx * ((float)psf.ib[i] + (float)0.5);
+                            bin.y = ang[ka].ybin0 + ang[ka].incy * ((float)psf.ib[i] + (float)0.5);
+                            bin.z = (float)psf.jb[i] * vox.thcm;
 
-                  for (int ie = 0; ie < psf.Nib; ie++)
-                    {
+                            calc_att_path(bin, vox, vol, &attpth[i]);
+                          }
+                      }
+                  }
 
-                      if (psf.ib[ie] < 0)
-                        continue;
-                      if (psf.ib[ie] >= prj.Nbin)
-                        continue;
+                //=== LOOP4: IMAGE SLICES ================================================================
 
-                      int ks = (vox.islc + psf.jb[ie]);
+                for (vox.islc = vol.first_sl; vox.islc < vol.last_sl; vox.islc++)
+                  {
 
-                      if (ks < 0)
-                        continue;
-                      if (ks >= vol.Nsli)
-                        continue;
+                    vox.iv = vox.ip + vox.islc * vol.Npix; // volume index of the voxel (volume as an array)
 
-                      jp = k * prj.Nbp + ks * prj.Nbin + psf.ib[ie];
+                    if (wmh.do_msk)
+                      {
+                        if (!msk_3d[vox.iv])
+                          continue;
+                      }
 
-                      if (wmh.do_full_att)
-                        coeff_att = calc_att(&attpth[ie], attmap, vox.islc, wmh);
+                    if (wmh.do_att && !wmh.do_full_att)
+                      coeff_att = calc_att(&attpth[0], attmap, vox.islc, wmh);
 
-                      weight = psf.val[ie] * eff * coeff_att;
+                    //... weight matrix values calculation .......................................
 
-                      //... fill image STIR indices ...........................
+                    for (int ie = 0; ie < psf.Nib; ie++)
+                      {
 
-                      if (wm.do_save_STIR)
-                        {
-                          stir::InvertAxis invert;
-                          wm.nx[vox.iv] = (short int)invert.invert_axis_index(
-                              (vox.icol - (int)floor(vol.Ncold2)), vol.Ncold2 * 2, "x");  // centered index for STIR format
-                          wm.ny[vox.iv] = (short int)(vox.irow - (int)floor(vol.Nrowd2)); // centered index for STIR format
-                          wm.nz[vox.iv] = (short int)vox.islc;                            // non-centered index for STIR format
-                        }
+                        if (psf.ib[ie] < 0)
+                          continue;
+                        if (psf.ib[ie] >= prj.Nbin)
+                          continue;
 
-                      //... fill wm values .....................
+                        int ks = (vox.islc + psf.jb[ie]);
 
-                      wm.col[jp][wm.ne[jp]] = vox.iv;
-                      wm.val[jp][wm.ne[jp]] = weight;
-                      wm.ne[jp]++;
+                        if (ks < 0)
+                          continue;
+                        if (ks >= vol.Nsli)
+                          continue;
 
-                      if (wm.ne[jp] >= NITEMS[jp])
-                        error_weight3d(45, "");
-                    }
-                } // end of LOOP4: image slices
-            }     // end of LOOP3: projection angle into subset
-        }         // end of LOOP2: image rows
-    }             // end of LOOP1: image cols
+                        jp = k * prj.Nbp + ks * prj.Nbin + psf.ib[ie];
 
-  //... detele allocated memory ..............
+                        if (wmh.do_full_att)
+                          coeff_att = calc_att(&attpth[ie], attmap, vox.islc, wmh);
 
-  delete[] psf1d_h.val;
-  delete[] psf1d_h.ind;
+                        weight = psf.val[ie] * eff * coeff_att;
 
-  if (wmh.do_psf_3d)
-    {
-      delete[] psf1d_v.val;
-      delete[] psf1d_v.ind;
-    }
+                        weights.push_back(weight_item_type{ jp, vox.iv, weight });
+                      }
+                  } // end of LOOP4: image slices
+              }     // end of LOOP3: projection angle into subset
+          }         // end of LOOP2: image columns
+      }             // end of LOOP1: image rows
+  }                 // end of parallel region
 
-  delete[] psf.val;
-  delete[] psf.ib;
-  delete[] psf.jb;
+  //... fill wm values (in the order of a sequential calculation) .....................
 
-  if (wmh.do_att)
+  for (int irow = 0; irow < vol.Nrow; irow++)
     {
-      for (int i = 0; i < sizeattpth; i++)
+      for (const weight_item_type& item : weights_per_row[irow])
         {
-          delete[] attpth[i].dl;
-          delete[] attpth[i].iv;
+          const int jp = item.jp;
+          wm.col[jp][wm.ne[jp]] = item.iv;
+          wm.val[jp][wm.ne[jp]] = item.weight;
+          wm.ne[jp]++;
+
+          if (wm.ne[jp] >= NITEMS[jp])
+            error_weight3d(45, "");
         }
-      delete[] attpth;
+      // free memory as we go
+      std::vector<weight_item_type>().swap(weights_per_row[irow]);
     }
 }
 
@@ -33,14 +33,17 @@
 
 #include "stir/recon_buildblock/ForwardProjectorByBinUsingProjMatrixByBin.h"
 #include "stir/recon_buildblock/ForwardProjectorByBinUsingRayTracing.h"
+#include "stir/recon_buildblock/ForwardProjectorByBinUsingJoseph.h"
 
 #include "stir/recon_buildblock/BackProjectorByBinUsingProjMatrixByBin.h"
 #include "stir/recon_buildblock/BackProjectorByBinUsingInterpolation.h"
+#include "stir/recon_buildblock/BackProjectorByBinUsingJoseph.h"
 #include "stir/recon_buildblock/PresmoothingForwardProjectorByBin.h"
 #include "stir/recon_buildblock/PostsmoothingBackProjectorByBin.h"
 
 #include "stir/recon_buildblock/ProjectorByBinPairUsingProjMatrixByBin.h"
 #include "stir/recon_buildblock/ProjectorByBinPairUsingSeparateProjectors.h"
+#include "stir/recon_buildblock/ProjectorByBinPairUsingJoseph.h"
 
 #include "stir/recon_buildblock/TrivialBinNormalisation.h"
 #include "stir/recon_buildblock/ChainedBinNormalisation.h"
@@ -110,14 +113,17 @@ static ProjMatrixByBinPinholeSPECTUB::RegisterIt dummy15;
 
 static ForwardProjectorByBinUsingProjMatrixByBin::RegisterIt dummy31;
 static ForwardProjectorByBinUsingRayTracing::RegisterIt dummy32;
+static ForwardProjectorByBinUsingJoseph::RegisterIt dummy34;
 static PostsmoothingBackProjectorByBin::RegisterIt dummy33;
 
 static BackProjectorByBinUsingProjMatrixByBin::RegisterIt dummy51;
 static BackProjectorByBinUsingInterpolation::RegisterIt dummy52;
+static BackProjectorByBinUsingJoseph::RegisterIt dummy54;
 static PresmoothingForwardProjectorByBin::RegisterIt dummy53;
 
 static ProjectorByBinPairUsingProjMatrixByBin::RegisterIt dummy71;
 static ProjectorByBinPairUsingSeparateProjectors::RegisterIt dummy72;
+static ProjectorByBinPairUsingJoseph::RegisterIt dummy73;
 
 static TrivialBinNormalisation::RegisterIt dummy91;
 static ChainedBinNormalisation::RegisterIt dummy92;
@@ -0,0 +1,303 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recon_test
+
+  \brief Test program for stir::ForwardProjectorByBinUsingJoseph and stir::BackProjectorByBinUsingJoseph
+
+  Checks that the projectors are adjoint (with and without TOF), that the sum over TOF bins is equal
+  to the non-TOF projection, and that the line integral through a uniform cylinder has the expected value.
+  Also checks that limiting the number of thread-local images in the back projector does not change the result.
+  For a scanner with BlocksOnCylindrical geometry, checks adjointness and compares the forward projection of
+  a smooth image with the one of stir::ProjMatrixByBinUsingRayTracing.
+
+  \author Kris Thielemans
+*/
+
+#include "stir/recon_buildblock/ForwardProjectorByBinUsingJoseph.h"
+#include "stir/recon_buildblock/BackProjectorByBinUsingJoseph.h"
+#include "stir/recon_buildblock/ForwardProjectorByBinUsingProjMatrixByBin.h"
+#include "stir/recon_buildblock/ProjMatrixByBinUsingRayTracing.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/ProjDataInfoBlocksOnCylindricalNoArcCorr.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/Bin.h"
+#include "stir/VectorWithOffset.h"
+#include "stir/RunTests.h"
+#include "stir/Verbosity.h"
+#include <random>
+#include <memory>
+#include <numeric>
+#include <cmath>
+#include <iostream>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup recon_test
+  \brief Test class for the Joseph projectors
+*/
+class JosephProjectorsTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  shared_ptr<ExamInfo> exam_info_sptr;
+
+  shared_ptr<VoxelsOnCartesianGrid<float>> construct_image(const ProjDataInfo& proj_data_info) const;
+  void forward_project(ProjData& proj_data, const DiscretisedDensity<3, float>& image);
+  void run_adjoint_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr, const std::string& str);
+  void run_line_integral_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr);
+  void run_TOF_sum_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                        const shared_ptr<const ProjDataInfo>& non_TOF_proj_data_info_sptr);
+  void run_thread_local_images_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr);
+  void run_blocks_on_cylindrical_test();
+};
+
+shared_ptr<VoxelsOnCartesianGrid<float>>
+JosephProjectorsTests::construct_image(const ProjDataInfo& proj_data_info) const
+{
+  auto image_sptr = std::make_shared<VoxelsOnCartesianGrid<float>>(
+      proj_data_info, 1.F, CartesianCoordinate3D<float>(0.F, 0.F, 0.F), CartesianCoordinate3D<int>(-1, 48, 48));
+  image_sptr->set_exam_info(*exam_info_sptr);
+  return image_sptr;
+}
+
+void
+JosephProjectorsTests::forward_project(ProjData& proj_data, const DiscretisedDensity<3, float>& image)
+{
+  shared_ptr<const DiscretisedDensity<3, float>> image_sptr(image.clone());
+  ForwardProjectorByBinUsingJoseph forw_projector;
+  forw_projector.set_up(proj_data.get_proj_data_info_sptr(), image_sptr);
+  forw_projector.forward_project(proj_data, image);
+}
+
+void
+JosephProjectorsTests::run_adjoint_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr, const std::string& str)
+{
+  std::cerr << "Testing adjointness for " << str << "\n";
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> distribution(0.F, 1.F);
+
+  auto image_sptr = construct_image(*proj_data_info_sptr);
+  for (auto iter = image_sptr->begin_all(); iter != image_sptr->end_all(); ++iter)
+    *iter = distribution(generator);
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr, false);
+  for (auto iter = proj_data.begin(); iter != proj_data.end(); ++iter)
+    *iter = distribution(generator);
+
+  ProjDataInMemory fwd_proj_data(exam_info_sptr, proj_data_info_sptr);
+  forward_project(fwd_proj_data, *image_sptr);
+
+  shared_ptr<DiscretisedDensity<3, float>> back_image_sptr(image_sptr->get_empty_copy());
+  BackProjectorByBinUsingJoseph back_projector;
+  back_projector.set_up(proj_data_info_sptr, back_image_sptr);
+  back_projector.back_project(*back_image_sptr, proj_data);
+
+  const double proj_inner_product = std::inner_product(proj_data.begin(), proj_data.end(), fwd_proj_data.begin(), 0.);
+  const double image_inner_product
+      = std::inner_product(image_sptr->begin_all_const(), image_sptr->end_all_const(), back_image_sptr->begin_all_const(), 0.);
+  check(proj_inner_product > 0, "inner product should be positive for " + str);
+  set_tolerance(1.E-4);
+  check_if_equal(proj_inner_product, image_inner_product, "<y, A x> == <A^T y, x> for " + str);
+}
+
+void
+JosephProjectorsTests::run_line_integral_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr)
+{
+  std::cerr << "Testing line integral through uniform cylinder\n";
+  auto image_sptr = construct_image(*proj_data_info_sptr);
+  const float radius = 40.F;
+  for (int z = image_sptr->get_min_z(); z <= image_sptr->get_max_z(); ++z)
+    for (int y = image_sptr->get_min_y(); y <= image_sptr->get_max_y(); ++y)
+      for (int x = image_sptr->get_min_x(); x <= image_sptr->get_max_x(); ++x)
+        {
+          const CartesianCoordinate3D<float> coords
+              = image_sptr->get_physical_coordinates_for_indices(CartesianCoordinate3D<int>(z, y, x));
+          (*image_sptr)[z][y][x] = square(coords.x()) + square(coords.y()) < square(radius) ? 1.F : 0.F;
+        }
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+  forward_project(proj_data, *image_sptr);
+
+  // central LOR, result is in units of the x voxel size
+  Bin bin(0, 0, (proj_data_info_sptr->get_min_axial_pos_num(0) + proj_data_info_sptr->get_max_axial_pos_num(0)) / 2, 0);
+  set_tolerance(.03);
+  check_if_equal(static_cast<double>(proj_data.get_bin_value(bin)),
+                 2. * radius / image_sptr->get_voxel_size().x(),
+                 "line integral through centre of uniform cylinder");
+}
+
+void
+JosephProjectorsTests::run_TOF_sum_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                                        const shared_ptr<const ProjDataInfo>& non_TOF_proj_data_info_sptr)
+{
+  std::cerr << "Testing sum over TOF bins\n";
+  // small object in the centre such that all TOF bins are covered
+  auto image_sptr = construct_image(*proj_data_info_sptr);
+  const int middle_z = (image_sptr->get_min_z() + image_sptr->get_max_z()) / 2;
+  for (int z = middle_z - 2; z <= middle_z + 2; ++z)
+    for (int y = -5; y <= 5; ++y)
+      for (int x = -4; x <= 6; ++x)
+        (*image_sptr)[z][y][x] = 1.F + (x + y) / 10.F;
+
+  ProjDataInMemory TOF_proj_data(exam_info_sptr, proj_data_info_sptr);
+  forward_project(TOF_proj_data, *image_sptr);
+  ProjDataInMemory non_TOF_proj_data(exam_info_sptr, non_TOF_proj_data_info_sptr);
+  forward_project(non_TOF_proj_data, *image_sptr);
+
+  const float max_value = non_TOF_proj_data.find_max();
+  check(max_value > 0, "non-TOF projection should be non-zero");
+  float max_diff = 0.F;
+  for (int segment_num = non_TOF_proj_data.get_min_segment_num(); segment_num <= non_TOF_proj_data.get_max_segment_num();
+       ++segment_num)
+    for (int view_num = non_TOF_proj_data.get_min_view_num(); view_num <= non_TOF_proj_data.get_max_view_num(); ++view_num)
+      {
+        Viewgram<float> sum_viewgram = non_TOF_proj_data.get_empty_viewgram(view_num, segment_num);
+        for (int timing_pos_num = TOF_proj_data.get_min_tof_pos_num(); timing_pos_num <= TOF_proj_data.get_max_tof_pos_num();
+             ++timing_pos_num)
+          sum_viewgram += TOF_proj_data.get_viewgram(view_num, segment_num, false, timing_pos_num);
+        sum_viewgram -= non_TOF_proj_data.get_viewgram(view_num, segment_num);
+        max_diff = std::max(max_diff, std::max(sum_viewgram.find_max(), -sum_viewgram.find_min()));
+      }
+  check(max_diff < max_value * 1.E-3F, "sum over TOF bins should be equal to non-TOF projection");
+}
+
+void
+JosephProjectorsTests::run_thread_local_images_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr)
+{
+  std::cerr << "Testing back projection with a single image shared between threads\n";
+  std::mt19937 generator(43);
+  std::uniform_real_distribution<float> distribution(0.F, 1.F);
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr, false);
+  for (auto iter = proj_data.begin(); iter != proj_data.end(); ++iter)
+    *iter = distribution(generator);
+
+  auto image_sptr = construct_image(*proj_data_info_sptr);
+  shared_ptr<DiscretisedDensity<3, float>> shared_image_sptr(image_sptr->get_empty_copy());
+  BackProjectorByBinUsingJoseph back_projector;
+  back_projector.set_up(proj_data_info_sptr, image_sptr);
+  back_projector.back_project(*image_sptr, proj_data);
+  back_projector.set_max_num_thread_local_images(1);
+  back_projector.set_up(proj_data_info_sptr, shared_image_sptr);
+  back_projector.back_project(*shared_image_sptr, proj_data);
+
+  set_tolerance(1.E-4);
+  check_if_equal(*image_sptr, *shared_image_sptr, "back projection with a single shared image");
+
+  // a clone has its own images and locks
+  std::unique_ptr<BackProjectorByBin> cloned_back_projector_uptr(back_projector.clone());
+  auto cloned_image_sptr = std::unique_ptr<DiscretisedDensity<3, float>>(image_sptr->get_empty_copy());
+  cloned_back_projector_uptr->start_accumulating_in_new_target();
+  back_projector.start_accumulating_in_new_target();
+  cloned_back_projector_uptr->back_project(proj_data);
+  cloned_back_projector_uptr->get_output(*cloned_image_sptr);
+  back_projector.get_output(*shared_image_sptr);
+  check_if_equal(*image_sptr, *cloned_image_sptr, "back projection with a cloned back projector");
+  check_if_zero(*shared_image_sptr, "back projection with a cloned back projector should not change the original");
+}
+
+void
+JosephProjectorsTests::run_blocks_on_cylindrical_test()
+{
+  auto scanner_sptr = std::make_shared<Scanner>(Scanner::SAFIRDualRingPrototype);
+  scanner_sptr->set_scanner_geometry("BlocksOnCylindrical");
+  scanner_sptr->set_up();
+  const int max_ring_diff = 3;
+  VectorWithOffset<int> num_axial_pos_per_segment(-max_ring_diff, max_ring_diff);
+  VectorWithOffset<int> min_ring_diff_v(-max_ring_diff, max_ring_diff);
+  VectorWithOffset<int> max_ring_diff_v(-max_ring_diff, max_ring_diff);
+  for (int i = -max_ring_diff; i <= max_ring_diff; ++i)
+    {
+      min_ring_diff_v[i] = i;
+      max_ring_diff_v[i] = i;
+      num_axial_pos_per_segment[i] = scanner_sptr->get_num_rings() - std::abs(i);
+    }
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr
+      = std::make_shared<ProjDataInfoBlocksOnCylindricalNoArcCorr>(scanner_sptr,
+                                                                   num_axial_pos_per_segment,
+                                                                   min_ring_diff_v,
+                                                                   max_ring_diff_v,
+                                                                   scanner_sptr->get_max_num_views(),
+                                                                   scanner_sptr->get_max_num_non_arccorrected_bins());
+
+  run_adjoint_test(proj_data_info_sptr, "BlocksOnCylindrical data");
+
+  std::cerr << "Comparing with ray tracing matrix for BlocksOnCylindrical data\n";
+  // smooth object, such that differences in interpolation are small
+  auto image_sptr = construct_image(*proj_data_info_sptr);
+  const float radius = 15.F;
+  for (int z = image_sptr->get_min_z(); z <= image_sptr->get_max_z(); ++z)
+    for (int y = image_sptr->get_min_y(); y <= image_sptr->get_max_y(); ++y)
+      for (int x = image_sptr->get_min_x(); x <= image_sptr->get_max_x(); ++x)
+        {
+          const CartesianCoordinate3D<float> coords
+              = image_sptr->get_physical_coordinates_for_indices(CartesianCoordinate3D<int>(z, y, x));
+          const float r2 = (square(coords.x() - 3.F) + square(coords.y() + 2.F)) / square(radius);
+          (*image_sptr)[z][y][x] = r2 < 1.F ? 1.F - r2 : 0.F;
+        }
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+  forward_project(proj_data, *image_sptr);
+
+  shared_ptr<const DiscretisedDensity<3, float>> cloned_image_sptr(image_sptr->clone());
+  auto proj_matrix_sptr = std::make_shared<ProjMatrixByBinUsingRayTracing>();
+  proj_matrix_sptr->set_num_tangential_LORs(5);
+  ForwardProjectorByBinUsingProjMatrixByBin ray_tracing_projector(proj_matrix_sptr);
+  ray_tracing_projector.set_up(proj_data_info_sptr, cloned_image_sptr);
+  ProjDataInMemory ray_tracing_proj_data(exam_info_sptr, proj_data_info_sptr);
+  ray_tracing_projector.forward_project(ray_tracing_proj_data, *image_sptr);
+
+  // compare the sum of absolute differences, as the ray tracing matrix is not very accurate for a few LORs
+  const double sum = std::accumulate(ray_tracing_proj_data.begin(), ray_tracing_proj_data.end(), 0.);
+  check(sum > 0, "ray tracing projection should be non-zero");
+  double sum_abs_diff = 0.;
+  for (auto iter = proj_data.begin(), ray_tracing_iter = ray_tracing_proj_data.begin(); iter != proj_data.end();
+       ++iter, ++ray_tracing_iter)
+    sum_abs_diff += std::abs(*iter - *ray_tracing_iter);
+  std::cerr << "Sum of absolute differences relative to sum: " << sum_abs_diff / sum << "\n";
+  check(sum_abs_diff < sum * .02, "forward projection should be close to the one of the ray tracing matrix");
+}
+
+void
+JosephProjectorsTests::run_tests()
+{
+  exam_info_sptr = std::make_shared<ExamInfo>(ImagingModality::PT);
+
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::PETMR_Signa));
+  const int num_views = scanner_sptr->get_num_detectors_per_ring() / 16;
+  const int num_tangential_poss = 64;
+  shared_ptr<const ProjDataInfo> non_TOF_proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr, 1, 1, num_views, num_tangential_poss, false));
+  shared_ptr<const ProjDataInfo> TOF_proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr, 1, 1, num_views, num_tangential_poss, false, 39));
+
+  run_adjoint_test(non_TOF_proj_data_info_sptr, "non-TOF data");
+  run_adjoint_test(TOF_proj_data_info_sptr, "TOF data");
+  run_line_integral_test(non_TOF_proj_data_info_sptr);
+  run_TOF_sum_test(TOF_proj_data_info_sptr, non_TOF_proj_data_info_sptr);
+  run_thread_local_images_test(non_TOF_proj_data_info_sptr);
+  run_blocks_on_cylindrical_test();
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  Verbosity::set(1);
+  JosephProjectorsTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
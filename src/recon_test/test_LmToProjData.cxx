@@ -0,0 +1,147 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recon_test
+
+  \brief Test program for stir::LmToProjData with a sparse histogram
+
+  \par Usage
+
+  <pre>
+  test_LmToProjData lm_data_filename
+  </pre>
+
+  Histograms the list-mode data in a dense stir::ProjDataInMemory (processing a single segment
+  at a time) and in a stir::ProjDataSparse (see LmToProjData::set_store_sparse_histogram()),
+  and checks that the results are the same. This is done when keeping the sparse data in memory,
+  and when writing it to file.
+
+  \author Kris Thielemans
+*/
+
+#include "stir/listmode/LmToProjData.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataSparse.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/TimeFrameDefinitions.h"
+#include "stir/listmode/ListModeData.h"
+#include "stir/IO/read_from_file.h"
+#include "stir/is_null_ptr.h"
+#include "stir/RunTests.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdio>
+#include <cstdlib>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for LmToProjData
+*/
+class LmToProjDataTests : public RunTests
+{
+public:
+  explicit LmToProjDataTests(const std::string& lm_data_filename)
+      : lm_data_filename(lm_data_filename)
+  {}
+  void run_tests() override;
+
+private:
+  std::string lm_data_filename;
+  //! histogram the data in \a proj_data_sptr, or write it to file if it is null
+  void run_LmToProjData(shared_ptr<ProjData> proj_data_sptr,
+                        const shared_ptr<const ProjDataInfo>& template_proj_data_info_sptr,
+                        const bool store_sparse_histogram,
+                        const std::string& output_filename_prefix);
+};
+
+void
+LmToProjDataTests::run_LmToProjData(shared_ptr<ProjData> proj_data_sptr,
+                                    const shared_ptr<const ProjDataInfo>& template_proj_data_info_sptr,
+                                    const bool store_sparse_histogram,
+                                    const std::string& output_filename_prefix)
+{
+  LmToProjData lm_to_projdata;
+  lm_to_projdata.set_input_data(lm_data_filename);
+  lm_to_projdata.set_template_proj_data_info_sptr(template_proj_data_info_sptr);
+  lm_to_projdata.set_output_filename_prefix(output_filename_prefix);
+  // test data contains only 612 ms of data
+  lm_to_projdata.set_time_frame_definitions(TimeFrameDefinitions(std::vector<std::pair<double, double>>(1, { 0., 1. })));
+  lm_to_projdata.set_store_sparse_histogram(store_sparse_histogram);
+  // make sure the dense histogram needs multiple passes
+  lm_to_projdata.set_num_segments_in_memory(1);
+  if (!is_null_ptr(proj_data_sptr))
+    lm_to_projdata.set_output_projdata_sptr(proj_data_sptr);
+  if (!check(lm_to_projdata.set_up() == Succeeded::yes, "set_up"))
+    return;
+  lm_to_projdata.process_data();
+}
+
+void
+LmToProjDataTests::run_tests()
+{
+  shared_ptr<ListModeData> lm_data_sptr(read_from_file<ListModeData>(lm_data_filename));
+  shared_ptr<Scanner> scanner_sptr(new Scanner(*lm_data_sptr->get_proj_data_info_sptr()->get_scanner_ptr()));
+  // use span and view mashing to keep the size of the dense data down
+  const int span = 11;
+  const int max_delta = (scanner_sptr->get_num_rings() - 1 - span / 2) / span * span + span / 2;
+  shared_ptr<const ProjDataInfo> template_proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr,
+                                             span,
+                                             max_delta,
+                                             scanner_sptr->get_num_detectors_per_ring() / 8,
+                                             scanner_sptr->get_default_num_arccorrected_bins() / 2,
+                                             false));
+  shared_ptr<const ExamInfo> exam_info_sptr(lm_data_sptr->get_exam_info_sptr());
+
+  std::cerr << "Histogramming in dense projection data\n";
+  shared_ptr<ProjDataInMemory> dense_proj_data_sptr(new ProjDataInMemory(exam_info_sptr, template_proj_data_info_sptr));
+  run_LmToProjData(dense_proj_data_sptr, template_proj_data_info_sptr, false, "test_LmToProjData_dense");
+  check(dense_proj_data_sptr->sum() > 0, "dense histogram should not be empty");
+
+  std::cerr << "Histogramming in sparse projection data\n";
+  shared_ptr<ProjData> sparse_proj_data_sptr(new ProjDataSparse(exam_info_sptr, template_proj_data_info_sptr));
+  run_LmToProjData(sparse_proj_data_sptr, template_proj_data_info_sptr, true, "test_LmToProjData_sparse");
+  check_if_equal(*dense_proj_data_sptr, ProjDataInMemory(*sparse_proj_data_sptr), "sparse histogram in memory");
+
+  std::cerr << "Histogramming in sparse projection data on file\n";
+  run_LmToProjData(shared_ptr<ProjData>(), template_proj_data_info_sptr, true, "test_LmToProjData_sparse");
+  {
+    const std::string filename = "test_LmToProjData_sparse_f1g1d0b0.hs";
+    shared_ptr<ProjData> proj_data_from_file_sptr = ProjData::read_from_file(filename);
+    check(!is_null_ptr(dynamic_pointer_cast<ProjDataSparse>(proj_data_from_file_sptr)),
+          "LmToProjData should have written sparse data");
+    check_if_equal(*dense_proj_data_sptr, ProjDataInMemory(*proj_data_from_file_sptr), "sparse histogram on file");
+  }
+  std::remove("test_LmToProjData_sparse_f1g1d0b0.hs");
+  std::remove("test_LmToProjData_sparse_f1g1d0b0.sparse");
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main(int argc, char** argv)
+{
+  if (argc != 2)
+    {
+      std::cerr << "Usage: " << argv[0] << " lm_data_filename\n";
+      return EXIT_FAILURE;
+    }
+  LmToProjDataTests tests(argv[1]);
+  tests.run_tests();
+  return tests.main_return_value();
+}
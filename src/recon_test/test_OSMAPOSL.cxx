@@ -1,5 +1,5 @@
 /*
-    Copyright (C) 2020-2021, University College London
+    Copyright (C) 2020-2021, 2026, University College London
     This file is part of STIR.
     SPDX-License-Identifier: Apache-2.0
     See STIR/LICENSE.txt for details
@@ -14,6 +14,10 @@
 
 #include "stir/recon_buildblock/test/PoissonLLReconstructionTests.h"
 #include "stir/OSMAPOSL/OSMAPOSLReconstruction.h"
+#include "stir/IO/read_from_file.h"
+#include "stir/Succeeded.h"
+#include <cstdio>
+#include <string>
 
 START_NAMESPACE_STIR
 
@@ -91,6 +95,39 @@ TestOSMAPOSL::run_tests()
       catch (...)
         {}
     }
+
+  if (everything_ok)
+    {
+      std::cerr << "\nTesting writing of intermediate images in the background" << std::endl;
+      try
+        {
+          this->construct_reconstructor();
+          this->recon().set_num_subiterations(4);
+          this->recon().set_save_interval(2);
+          this->recon().set_write_intermediate_images_in_background(true);
+          this->recon().set_input_data(this->_proj_data_sptr);
+          this->recon().set_output_filename_prefix("test_OSMAPOSL_background");
+          shared_ptr<target_type> output_sptr(this->_input_density_sptr->get_empty_copy());
+          output_sptr->fill(1.F);
+          if (this->recon().set_up(output_sptr) == Succeeded::no)
+            error("recon::set_up() failed");
+          if (this->recon().reconstruct(output_sptr) == Succeeded::no)
+            error("recon::reconstruct() failed");
+          // intermediate image is written in the background, last one synchronously
+          const unique_ptr<target_type> intermediate_uptr(read_from_file<target_type>("test_OSMAPOSL_background_2.hv"));
+          check(intermediate_uptr->has_same_characteristics(*output_sptr), "intermediate image has wrong characteristics");
+          const unique_ptr<target_type> final_uptr(read_from_file<target_type>("test_OSMAPOSL_background_4.hv"));
+          check_if_equal(*final_uptr, *output_sptr, "final image written to file");
+        }
+      catch (const std::exception& error)
+        {
+          std::cerr << "\nHere's the error:\n\t" << error.what() << "\n\n";
+          everything_ok = false;
+        }
+      for (const std::string subiter_num : { "2", "4" })
+        for (const std::string extension : { ".hv", ".ahv", ".v" })
+          std::remove(("test_OSMAPOSL_background_" + subiter_num + extension).c_str());
+    }
 }
 
 END_NAMESPACE_STIR
@@ -0,0 +1,202 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recon_test
+
+  \brief Test program for stir::ForwardProjectorByBinParallelproj and stir::BackProjectorByBinParallelproj
+
+  Checks that projecting RelatedViewgrams (one TOF bin at a time) gives the same result as projecting
+  all data (all TOF bins of a view at once), and that projecting a subset gives the same result
+  for the views in the subset. The time for projecting a subset is only reported, as timings are too
+  variable to test.
+
+  \author Kris Thielemans
+*/
+
+#include "stir/recon_buildblock/Parallelproj_projector/ForwardProjectorByBinParallelproj.h"
+#include "stir/recon_buildblock/Parallelproj_projector/BackProjectorByBinParallelproj.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/RelatedViewgrams.h"
+#include "stir/DataSymmetriesForViewSegmentNumbers.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/HighResWallClockTimer.h"
+#include "stir/RunTests.h"
+#include "stir/Verbosity.h"
+#include <random>
+#include <memory>
+#include <iostream>
+#include <boost/format.hpp>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup recon_test
+  \brief Test class for the Parallelproj projectors
+*/
+class ParallelprojProjectorsTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  shared_ptr<ExamInfo> exam_info_sptr;
+
+  shared_ptr<VoxelsOnCartesianGrid<float>> construct_image(const ProjDataInfo& proj_data_info) const;
+  void run_related_viewgrams_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr, const std::string& str);
+  void run_subset_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr);
+};
+
+shared_ptr<VoxelsOnCartesianGrid<float>>
+ParallelprojProjectorsTests::construct_image(const ProjDataInfo& proj_data_info) const
+{
+  auto image_sptr = std::make_shared<VoxelsOnCartesianGrid<float>>(
+      proj_data_info, 1.F, CartesianCoordinate3D<float>(0.F, 0.F, 0.F), CartesianCoordinate3D<int>(-1, 48, 48));
+  image_sptr->set_exam_info(*exam_info_sptr);
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> distribution(0.F, 1.F);
+  for (auto iter = image_sptr->begin_all(); iter != image_sptr->end_all(); ++iter)
+    *iter = distribution(generator);
+  return image_sptr;
+}
+
+void
+ParallelprojProjectorsTests::run_related_viewgrams_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                                                        const std::string& str)
+{
+  std::cerr << "Comparing projecting RelatedViewgrams and all data for " << str << "\n";
+  const auto image_sptr = construct_image(*proj_data_info_sptr);
+
+  ForwardProjectorByBinParallelproj forw_projector;
+  forw_projector.set_up(proj_data_info_sptr, image_sptr);
+  BackProjectorByBinParallelproj back_projector;
+  back_projector.set_up(proj_data_info_sptr, image_sptr);
+  shared_ptr<DataSymmetriesForViewSegmentNumbers> symmetries_sptr(forw_projector.get_symmetries_used()->clone());
+
+  // all data, such that all TOF bins of a view are projected at once
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+  forw_projector.set_input(*image_sptr);
+  forw_projector.forward_project(proj_data);
+  shared_ptr<VoxelsOnCartesianGrid<float>> back_projection_sptr(image_sptr->get_empty_copy());
+  back_projector.start_accumulating_in_new_target();
+  back_projector.back_project(proj_data);
+  back_projector.get_output(*back_projection_sptr);
+
+  // one TOF bin at a time
+  ProjDataInMemory proj_data_per_TOF_bin(exam_info_sptr, proj_data_info_sptr);
+  back_projector.start_accumulating_in_new_target();
+  for (int segment_num = proj_data.get_min_segment_num(); segment_num <= proj_data.get_max_segment_num(); ++segment_num)
+    for (int view_num = proj_data.get_min_view_num(); view_num <= proj_data.get_max_view_num(); ++view_num)
+      {
+        const ViewSegmentNumbers vs_num(view_num, segment_num);
+        if (!symmetries_sptr->is_basic(vs_num))
+          continue;
+        for (int timing_pos_num = proj_data.get_min_tof_pos_num(); timing_pos_num <= proj_data.get_max_tof_pos_num();
+             ++timing_pos_num)
+          {
+            RelatedViewgrams<float> viewgrams
+                = proj_data_per_TOF_bin.get_empty_related_viewgrams(vs_num, symmetries_sptr, false, timing_pos_num);
+            forw_projector.forward_project(viewgrams);
+            proj_data_per_TOF_bin.set_related_viewgrams(viewgrams);
+            back_projector.back_project(viewgrams);
+          }
+      }
+  shared_ptr<VoxelsOnCartesianGrid<float>> back_projection_per_TOF_bin_sptr(image_sptr->get_empty_copy());
+  back_projector.get_output(*back_projection_per_TOF_bin_sptr);
+
+  set_tolerance(proj_data.find_max() * 1E-4);
+  check_if_equal(proj_data, proj_data_per_TOF_bin, "forward projection of RelatedViewgrams for " + str);
+  set_tolerance(back_projection_sptr->find_max() * 1E-4);
+  check_if_equal(*back_projection_sptr, *back_projection_per_TOF_bin_sptr, "back projection of RelatedViewgrams for " + str);
+}
+
+void
+ParallelprojProjectorsTests::run_subset_test(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr)
+{
+  std::cerr << "Checking projecting a subset\n";
+  const auto image_sptr = construct_image(*proj_data_info_sptr);
+  ForwardProjectorByBinParallelproj forw_projector;
+  forw_projector.set_up(proj_data_info_sptr, image_sptr);
+  forw_projector.set_input(*image_sptr);
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+
+  HighResWallClockTimer timer;
+  timer.start();
+  forw_projector.forward_project(proj_data);
+  timer.stop();
+  const double time_for_all_data = timer.value();
+
+  const int num_subsets = 4;
+  const int subset_num = 1;
+  ProjDataInMemory subset_proj_data(exam_info_sptr, proj_data_info_sptr);
+  timer.reset();
+  timer.start();
+  forw_projector.forward_project(subset_proj_data, subset_num, num_subsets);
+  timer.stop();
+  const double time_for_subset = timer.value();
+  // timings depend on the load of the machine, so we only report them
+  std::cerr << boost::format("Wall-clock time for all data %1%s, for 1 of %2% subsets %3%s\n") % time_for_all_data % num_subsets
+                   % time_for_subset;
+
+  shared_ptr<DataSymmetriesForViewSegmentNumbers> symmetries_sptr(forw_projector.get_symmetries_used()->clone());
+  set_tolerance(proj_data.find_max() * 1E-4);
+  for (int segment_num = proj_data.get_min_segment_num(); segment_num <= proj_data.get_max_segment_num(); ++segment_num)
+    for (int view_num = proj_data.get_min_view_num() + subset_num; view_num <= proj_data.get_max_view_num();
+         view_num += num_subsets)
+      {
+        const ViewSegmentNumbers vs_num(view_num, segment_num);
+        if (!symmetries_sptr->is_basic(vs_num))
+          continue;
+        for (int timing_pos_num = proj_data.get_min_tof_pos_num(); timing_pos_num <= proj_data.get_max_tof_pos_num();
+             ++timing_pos_num)
+          {
+            const RelatedViewgrams<float> viewgrams = proj_data.get_related_viewgrams(vs_num, symmetries_sptr, false, timing_pos_num);
+            const RelatedViewgrams<float> subset_viewgrams
+                = subset_proj_data.get_related_viewgrams(vs_num, symmetries_sptr, false, timing_pos_num);
+            for (auto iter = viewgrams.begin(), subset_iter = subset_viewgrams.begin(); iter != viewgrams.end();
+                 ++iter, ++subset_iter)
+              if (!check_if_equal(*iter, *subset_iter, "forward projection of a subset"))
+                return;
+          }
+      }
+}
+
+void
+ParallelprojProjectorsTests::run_tests()
+{
+  exam_info_sptr = std::make_shared<ExamInfo>(ImagingModality::PT);
+
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::PETMR_Signa));
+  const int num_views = scanner_sptr->get_num_detectors_per_ring() / 16;
+  const int num_tangential_poss = 64;
+  shared_ptr<const ProjDataInfo> non_TOF_proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr, 1, 1, num_views, num_tangential_poss, false));
+  shared_ptr<const ProjDataInfo> TOF_proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr, 1, 1, num_views, num_tangential_poss, false, 39));
+
+  run_related_viewgrams_test(non_TOF_proj_data_info_sptr, "non-TOF data");
+  run_related_viewgrams_test(TOF_proj_data_info_sptr, "TOF data");
+  run_subset_test(TOF_proj_data_info_sptr);
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  Verbosity::set(1);
+  ParallelprojProjectorsTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
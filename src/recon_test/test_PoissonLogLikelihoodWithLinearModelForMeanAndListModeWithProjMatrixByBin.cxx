@@ -106,6 +106,10 @@ protected:
 
   //! run the test
   void run_tests_for_objective_function(objective_function_type& objective_function, target_type& target);
+  //! check that merging identical events does not change gradient and value
+  void run_tests_for_merging_events(target_type& target);
+  //! check that the sum over subsets of gradient and value is the same for view-based and random event subsets
+  void run_tests_for_event_subsets(shared_ptr<target_type> const& target_sptr);
 };
 
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests::
@@ -129,6 +133,72 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTest
   test_Hessian("PoissonLLListModeData", objective_function, target, 0.5F);
 }
 
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests::run_tests_for_merging_events(
+    target_type& target)
+{
+  std::cerr << "----- testing merging of identical events\n";
+  const int subset_num = 0;
+  shared_ptr<target_type> gradient_sptr(target.get_empty_copy());
+  shared_ptr<target_type> merged_gradient_sptr(target.get_empty_copy());
+
+  objective_function_sptr->set_merge_identical_events(false);
+  objective_function_sptr->compute_sub_gradient_without_penalty_plus_sensitivity(*gradient_sptr, target, subset_num);
+  const double value = objective_function_sptr->compute_objective_function_without_penalty(target, subset_num);
+
+  objective_function_sptr->set_merge_identical_events(true);
+  objective_function_sptr->compute_sub_gradient_without_penalty_plus_sensitivity(*merged_gradient_sptr, target, subset_num);
+  const double merged_value = objective_function_sptr->compute_objective_function_without_penalty(target, subset_num);
+  objective_function_sptr->set_merge_identical_events(false);
+
+  set_tolerance(1.E-4);
+  check_if_equal(value, merged_value, "objective function value with merged events");
+  check_if_equal(*gradient_sptr, *merged_gradient_sptr, "gradient with merged events");
+}
+
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests::run_tests_for_event_subsets(
+    shared_ptr<target_type> const& target_sptr)
+{
+  std::cerr << "----- testing random event subsets\n";
+  const target_type& target = *target_sptr;
+  const int num_subsets = objective_function_sptr->get_num_subsets();
+  if (!check(num_subsets > 1, "test needs more than 1 subset"))
+    return;
+
+  // sum over all subsets. Note that the sum of the subset sensitivities is the same for both subset schemes.
+  auto sum_over_subsets = [&](target_type& gradient_sum, double& value_sum) {
+    shared_ptr<target_type> gradient_sptr(target.get_empty_copy());
+    gradient_sum.fill(0.F);
+    value_sum = 0.;
+    for (int subset_num = 0; subset_num < num_subsets; ++subset_num)
+      {
+        objective_function_sptr->compute_sub_gradient_without_penalty_plus_sensitivity(*gradient_sptr, target, subset_num);
+        gradient_sum += *gradient_sptr;
+        value_sum += objective_function_sptr->compute_objective_function_without_penalty(target, subset_num);
+      }
+  };
+
+  shared_ptr<target_type> gradient_sptr(target.get_empty_copy());
+  shared_ptr<target_type> random_gradient_sptr(target.get_empty_copy());
+  double value, random_value;
+  sum_over_subsets(*gradient_sptr, value);
+
+  objective_function_sptr->set_randomise_event_subsets(true);
+  objective_function_sptr->set_use_subset_sensitivities(false);
+  if (!check(objective_function_sptr->set_up(target_sptr) == Succeeded::yes, "set-up with random event subsets"))
+    return;
+  sum_over_subsets(*random_gradient_sptr, random_value);
+
+  objective_function_sptr->set_randomise_event_subsets(false);
+  objective_function_sptr->set_use_subset_sensitivities(true);
+  check(objective_function_sptr->set_up(target_sptr) == Succeeded::yes, "set-up with view-based subsets");
+
+  set_tolerance(1.E-4);
+  check_if_equal(value, random_value, "sum over subsets of objective function value with random event subsets");
+  check_if_equal(*gradient_sptr, *random_gradient_sptr, "sum over subsets of gradient with random event subsets");
+}
+
 void
 PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTests::construct_input_data(
     shared_ptr<target_type>& density_sptr)
@@ -251,6 +321,8 @@ PoissonLogLikelihoodWithLinearModelForMeanAndListModeDataWithProjMatrixByBinTest
 #if 1
   shared_ptr<target_type> density_sptr;
   construct_input_data(density_sptr);
+  this->run_tests_for_merging_events(*density_sptr);
+  this->run_tests_for_event_subsets(density_sptr);
   this->run_tests_for_objective_function(*this->objective_function_sptr, *density_sptr);
 #else
   // alternative that gets the objective function from an OSMAPOSL .par file
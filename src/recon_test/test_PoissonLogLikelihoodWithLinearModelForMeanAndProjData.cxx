@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2013, 2021, 2024 University College London
+    Copyright (C) 2013, 2021, 2024, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -46,12 +46,15 @@
 #include "stir/info.h"
 #include "stir/Succeeded.h"
 #include "stir/num_threads.h"
+#include "stir/FilePath.h"
 #include <boost/random/uniform_01.hpp>
 #include <boost/random/normal_distribution.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/variate_generator.hpp>
 #include <iostream>
 #include <memory>
+#include <cstdio>
+#include <filesystem>
 
 #include "stir/IO/OutputFileFormat.h"
 #include "stir/recon_buildblock/distributable_main.h"
@@ -111,6 +114,23 @@ protected:
 
   //! Test the approximate Hessian of the objective function by testing the (x^T Hx > 0) condition
   void test_approximate_Hessian_concavity(objective_function_type& objective_function, target_type& target);
+
+  //! Test writing and reading sensitivities to/from the sensitivity cache
+  void test_sensitivity_cache(const objective_function_type& objective_function, const shared_ptr<target_type>& target_sptr);
+};
+
+//! Objective function that counts how often the sensitivity is computed
+class SensitivityCountingObjectiveFunction
+    : public PoissonLogLikelihoodWithLinearModelForMeanAndProjData<DiscretisedDensity<3, float>>
+{
+public:
+  mutable int num_subset_sensitivity_computations = 0;
+  void add_subset_sensitivity(DiscretisedDensity<3, float>& sensitivity, const int subset_num) const override
+  {
+    ++num_subset_sensitivity_computations;
+    PoissonLogLikelihoodWithLinearModelForMeanAndProjData<DiscretisedDensity<3, float>>::add_subset_sensitivity(sensitivity,
+                                                                                                               subset_num);
+  }
 };
 
 PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests::PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests(
@@ -333,6 +353,80 @@ PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests::construct_input_data
     return;
 }
 
+void
+PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests::test_sensitivity_cache(const objective_function_type& objective_function,
+                                                                                   const shared_ptr<target_type>& target_sptr)
+{
+  std::cerr << "Testing sensitivity cache\n";
+  const std::string cache_directory
+      = FilePath(FilePath::get_current_working_directory()).append("test_sensitivity_cache").get_as_string();
+
+  auto set_up_objective_function = [&](SensitivityCountingObjectiveFunction& obj_fun,
+                                       const shared_ptr<BinNormalisation>& normalisation_sptr) {
+    obj_fun.set_proj_data_sptr(this->proj_data_sptr);
+    obj_fun.set_use_subset_sensitivities(true);
+    obj_fun.set_projector_pair_sptr(objective_function.get_projector_pair_sptr());
+    obj_fun.set_normalisation_sptr(normalisation_sptr);
+    obj_fun.set_additive_proj_data_sptr(objective_function.get_additive_proj_data_sptr());
+    obj_fun.set_num_subsets(objective_function.get_num_subsets());
+    obj_fun.set_sensitivity_cache_directory(cache_directory);
+    return obj_fun.set_up(target_sptr);
+  };
+
+  // force computation (the cache might exist from a previous run), which will write to the cache
+  SensitivityCountingObjectiveFunction obj_fun_writing;
+  obj_fun_writing.set_recompute_sensitivity(true);
+  if (!check(set_up_objective_function(obj_fun_writing, objective_function.get_normalisation_sptr()) == Succeeded::yes,
+             "set-up of objective function writing cache"))
+    return;
+  check_if_equal(obj_fun_writing.num_subset_sensitivity_computations,
+                 objective_function.get_num_subsets(),
+                 "number of subset sensitivity computations when writing cache");
+
+  SensitivityCountingObjectiveFunction obj_fun_reading;
+  if (!check(set_up_objective_function(obj_fun_reading, objective_function.get_normalisation_sptr()) == Succeeded::yes,
+             "set-up of objective function reading cache"))
+    return;
+  check_if_equal(obj_fun_reading.num_subset_sensitivity_computations, 0, "sensitivity should be read from cache");
+  check_if_equal(obj_fun_reading.get_sensitivity(), objective_function.get_sensitivity(), "sensitivity read from cache");
+  for (int subset_num = 0; subset_num < objective_function.get_num_subsets(); ++subset_num)
+    check_if_equal(obj_fun_reading.get_subset_sensitivity(subset_num),
+                   objective_function.get_subset_sensitivity(subset_num),
+                   "subset sensitivity read from cache");
+
+  // normalisation read from file. Overwriting the file with different factors should lead to recomputation.
+  const std::string norm_filename = "test_sensitivity_cache_norm.hs";
+  ProjDataInMemory norm_proj_data(*this->mult_proj_data_sptr);
+  norm_proj_data.write_to_file(norm_filename);
+  {
+    SensitivityCountingObjectiveFunction obj_fun;
+    obj_fun.set_recompute_sensitivity(true);
+    check(set_up_objective_function(obj_fun, std::make_shared<BinNormalisationFromProjData>(norm_filename)) == Succeeded::yes,
+          "set-up of objective function with normalisation file writing cache");
+  }
+  {
+    SensitivityCountingObjectiveFunction obj_fun;
+    check(set_up_objective_function(obj_fun, std::make_shared<BinNormalisationFromProjData>(norm_filename)) == Succeeded::yes,
+          "set-up of objective function with normalisation file reading cache");
+    check_if_equal(obj_fun.num_subset_sensitivity_computations, 0, "sensitivity with normalisation file should be read from cache");
+  }
+  for (auto iter = norm_proj_data.begin(); iter != norm_proj_data.end(); ++iter)
+    *iter *= 2;
+  norm_proj_data.write_to_file(norm_filename);
+  {
+    SensitivityCountingObjectiveFunction obj_fun;
+    check(set_up_objective_function(obj_fun, std::make_shared<BinNormalisationFromProjData>(norm_filename)) == Succeeded::yes,
+          "set-up of objective function with modified normalisation file");
+    check_if_equal(obj_fun.num_subset_sensitivity_computations,
+                   objective_function.get_num_subsets(),
+                   "sensitivity should be recomputed after modifying the normalisation file");
+  }
+  std::remove(norm_filename.c_str());
+  std::remove("test_sensitivity_cache_norm.s");
+  std::error_code ec;
+  std::filesystem::remove_all(cache_directory, ec);
+}
+
 void
 PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests::run_tests()
 {
@@ -345,6 +439,7 @@ PoissonLogLikelihoodWithLinearModelForMeanAndProjDataTests::run_tests()
     shared_ptr<target_type> density_sptr;
     construct_input_data(density_sptr, /*TOF_or_not=*/false);
     this->run_tests_for_objective_function(*this->objective_function_sptr, *density_sptr);
+    this->test_sensitivity_cache(*this->objective_function_sptr, density_sptr);
   }
   if (this->proj_data_filename == 0)
     {
@@ -0,0 +1,148 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recon_test
+
+  \brief Test program for stir::ProjMatrixByBinSPECTUB
+
+  \par Usage
+
+  <pre>
+  test_ProjMatrixByBinSPECTUB SPECT_proj_data_filename
+  </pre>
+
+  Uses the projection data info (for a reduced number of views and axial positions) to check that
+  the matrix elements are the same when keeping all views in memory, and when keeping only a few views
+  in memory while accessing bins in parallel (when using OpenMP), and that views are then removed
+  from the cache.
+
+  \author Kris Thielemans
+*/
+
+#include "stir/recon_buildblock/ProjMatrixByBinSPECTUB.h"
+#include "stir/recon_buildblock/ProjMatrixElemsForOneBin.h"
+#include "stir/ProjData.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/IndexRange3D.h"
+#include "stir/Bin.h"
+#include "stir/num_threads.h"
+#include "stir/RunTests.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for ProjMatrixByBinSPECTUB
+*/
+class ProjMatrixByBinSPECTUBTests : public RunTests
+{
+public:
+  explicit ProjMatrixByBinSPECTUBTests(const std::string& proj_data_filename)
+      : proj_data_filename(proj_data_filename)
+  {}
+  void run_tests() override;
+
+private:
+  std::string proj_data_filename;
+};
+
+void
+ProjMatrixByBinSPECTUBTests::run_tests()
+{
+  // reduce sizes to keep computation time down
+  shared_ptr<ProjDataInfo> proj_data_info_sptr(ProjData::read_from_file(proj_data_filename)->get_proj_data_info_sptr()->clone());
+  proj_data_info_sptr->set_num_views(8);
+  proj_data_info_sptr->set_min_axial_pos_num(0, 0);
+  proj_data_info_sptr->set_max_axial_pos_num(3, 0);
+  proj_data_info_sptr->set_min_tangential_pos_num(-16);
+  proj_data_info_sptr->set_max_tangential_pos_num(15);
+  const float voxel_size = proj_data_info_sptr->get_scanner_ptr()->get_default_bin_size();
+  shared_ptr<DiscretisedDensity<3, float>> density_sptr(
+      new VoxelsOnCartesianGrid<float>(IndexRange3D(0, proj_data_info_sptr->get_num_axial_poss(0) - 1, -16, 15, -16, 15),
+                                       CartesianCoordinate3D<float>(0.F, 0.F, 0.F),
+                                       CartesianCoordinate3D<float>(voxel_size, voxel_size, voxel_size)));
+
+  std::vector<Bin> bins;
+  for (int view_num = proj_data_info_sptr->get_min_view_num(); view_num <= proj_data_info_sptr->get_max_view_num(); ++view_num)
+    for (int axial_pos_num = proj_data_info_sptr->get_min_axial_pos_num(0);
+         axial_pos_num <= proj_data_info_sptr->get_max_axial_pos_num(0);
+         ++axial_pos_num)
+      for (int tangential_pos_num = proj_data_info_sptr->get_min_tangential_pos_num();
+           tangential_pos_num <= proj_data_info_sptr->get_max_tangential_pos_num();
+           ++tangential_pos_num)
+        bins.push_back(Bin(0, view_num, axial_pos_num, tangential_pos_num));
+
+  std::cerr << "Computing matrix keeping all views in memory\n";
+  std::vector<ProjMatrixElemsForOneBin> lors(bins.size());
+  {
+    ProjMatrixByBinSPECTUB matrix;
+    matrix.set_keep_all_views_in_cache(true);
+    matrix.set_up(proj_data_info_sptr, density_sptr);
+    for (std::size_t i = 0; i < bins.size(); ++i)
+      matrix.get_proj_matrix_elems_for_one_bin(lors[i], bins[i]);
+    check_if_equal(matrix.get_num_views_in_cache(), proj_data_info_sptr->get_num_views(), "number of views in cache");
+  }
+
+  std::cerr << "Computing matrix keeping only a few views in memory\n";
+  const int max_num_views_in_cache = 2;
+#ifdef STIR_OPENMP
+  set_num_threads(4);
+#endif
+  ProjMatrixByBinSPECTUB matrix;
+  matrix.set_keep_all_views_in_cache(false);
+  matrix.set_maximum_number_of_views_in_cache(max_num_views_in_cache);
+  matrix.set_up(proj_data_info_sptr, density_sptr);
+  // go over all bins twice, such that views that are removed from the cache are computed again
+  const int num_passes = 2;
+  std::vector<ProjMatrixElemsForOneBin> lors_few_views(num_passes * bins.size());
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i = 0; i < static_cast<int>(lors_few_views.size()); ++i)
+    matrix.get_proj_matrix_elems_for_one_bin(lors_few_views[i], bins[i % bins.size()]);
+#ifdef STIR_OPENMP
+  set_default_num_threads();
+#endif
+
+  check(matrix.get_num_views_in_cache() <= max_num_views_in_cache, "views should have been removed from the cache");
+  check(matrix.get_num_views_in_cache() > 0, "cache should not be empty");
+  for (std::size_t i = 0; i < lors_few_views.size(); ++i)
+    {
+      const Bin& bin = bins[i % bins.size()];
+      const std::string str = "elements for view " + std::to_string(bin.view_num()) + ", axial pos "
+                              + std::to_string(bin.axial_pos_num()) + ", tangential pos " + std::to_string(bin.tangential_pos_num())
+                              + " (pass " + std::to_string(i / bins.size()) + ")";
+      check(lors_few_views[i].get_bin() == bin, "bin of " + str);
+      if (!check(lors_few_views[i] == lors[i % bins.size()], str + " when keeping only a few views in memory"))
+        break;
+    }
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main(int argc, char** argv)
+{
+  if (argc != 2)
+    {
+      std::cerr << "Usage: " << argv[0] << " SPECT_proj_data_filename\n";
+      return EXIT_FAILURE;
+    }
+  ProjMatrixByBinSPECTUBTests tests(argv[1]);
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -0,0 +1,208 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup recon_test
+
+  \brief Test program for stir::convert_events_to_bins and stir::ListRecordBatch
+
+  \par Usage
+
+  <pre>
+  test_convert_events_to_bins lm_data_filename
+  </pre>
+
+  Checks that the bins found by convert_events_to_bins() for a batch of events are the same as
+  those found by calling CListEvent::get_bin() for every event. This is done for the uncompressed
+  projection data info of the list-mode data, a template with span and view mashing, and if the scanner
+  supports TOF, a template with TOF mashing.
+
+  Also checks that reading events with stir::ListRecordBatch (which uses ListModeData::get_next_records())
+  gives the same events and times as reading them one by one, when stopping at a number of end times.
+
+  \author Kris Thielemans
+*/
+
+#include "stir/listmode/convert_events_to_bins.h"
+#include "stir/listmode/ListRecordBatch.h"
+#include "stir/listmode/ListModeData.h"
+#include "stir/listmode/ListRecord.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/Scanner.h"
+#include "stir/Succeeded.h"
+#include "stir/IO/read_from_file.h"
+#include "stir/RunTests.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdlib>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for convert_events_to_bins
+*/
+class convert_events_to_binsTests : public RunTests
+{
+public:
+  explicit convert_events_to_binsTests(const std::string& lm_data_filename)
+      : lm_data_filename(lm_data_filename)
+  {}
+  void run_tests() override;
+
+private:
+  std::string lm_data_filename;
+  void run_tests_for_template(const ProjDataInfo& proj_data_info, const std::string& str);
+  void run_tests_for_batch_reading();
+};
+
+void
+convert_events_to_binsTests::run_tests_for_batch_reading()
+{
+  std::cerr << "Testing reading events in batches\n";
+  shared_ptr<ListModeData> lm_data_sptr(read_from_file<ListModeData>(lm_data_filename));
+  const ProjDataInfo& proj_data_info = *lm_data_sptr->get_proj_data_info_sptr();
+  // reference: read events one by one
+  std::vector<std::pair<double, Bin>> events;
+  {
+    shared_ptr<ListRecord> record_sptr = lm_data_sptr->get_empty_record_sptr();
+    double current_time = 0;
+    while (lm_data_sptr->get_next_record(*record_sptr) == Succeeded::yes)
+      {
+        if (record_sptr->is_time())
+          current_time = record_sptr->time().get_time_in_secs();
+        if (record_sptr->is_event())
+          {
+            Bin bin;
+            bin.set_bin_value(1.F);
+            record_sptr->event().get_bin(bin, proj_data_info);
+            events.emplace_back(current_time, bin);
+          }
+      }
+  }
+  check(!events.empty(), "list-mode data should contain events");
+
+  lm_data_sptr->reset();
+  // use a batch size that does not divide the number of events, and stop every 100 ms (test data contains 612 ms)
+  ListRecordBatch batch(*lm_data_sptr, 1000);
+  std::size_t event_num = 0;
+  long num_mismatches = 0;
+  double current_time = 0;
+  bool more_events = true;
+  for (double end_time = .1; more_events; end_time += .1)
+    {
+      do
+        {
+          more_events = batch.read(*lm_data_sptr, current_time, end_time, 777) == Succeeded::yes;
+          for (std::size_t i = 0; i < batch.size(); ++i, ++event_num)
+            {
+              if (event_num >= events.size())
+                {
+                  ++num_mismatches;
+                  continue;
+                }
+              Bin bin;
+              bin.set_bin_value(1.F);
+              batch.get_record(i).event().get_bin(bin, proj_data_info);
+              if (batch.get_time(i) != events[event_num].first || bin != events[event_num].second
+                  || bin.get_bin_value() != events[event_num].second.get_bin_value())
+                ++num_mismatches;
+              if (batch.get_time(i) >= end_time)
+                ++num_mismatches;
+            }
+        }
+      while (more_events && current_time < end_time);
+    }
+  check_if_equal(event_num, events.size(), "number of events read in batches");
+  check_if_equal(num_mismatches, 0L, "number of events where reading in batches differs from reading one by one");
+}
+
+void
+convert_events_to_binsTests::run_tests_for_template(const ProjDataInfo& proj_data_info, const std::string& str)
+{
+  std::cerr << "Testing " << str << "\n";
+  shared_ptr<ListModeData> lm_data_sptr(read_from_file<ListModeData>(lm_data_filename));
+  ListRecordBatch batch(*lm_data_sptr, 100000);
+  std::vector<Bin> bins;
+  double current_time = 0;
+  long num_events = 0;
+  long num_accepted_events = 0;
+  long num_mismatches = 0;
+  bool more_events = true;
+  while (more_events)
+    {
+      more_events = batch.read(*lm_data_sptr, current_time) == Succeeded::yes;
+      convert_events_to_bins(bins, batch, proj_data_info);
+      if (!check_if_equal(bins.size(), batch.size(), "number of bins"))
+        return;
+      for (std::size_t i = 0; i < batch.size(); ++i)
+        {
+          Bin bin;
+          bin.set_bin_value(1.F);
+          batch.get_record(i).event().get_bin(bin, proj_data_info);
+          const bool accepted = bin.get_bin_value() > 0;
+          if (accepted != (bins[i].get_bin_value() > 0) || (accepted && bin != bins[i]))
+            ++num_mismatches;
+          if (accepted)
+            ++num_accepted_events;
+        }
+      num_events += static_cast<long>(batch.size());
+    }
+  std::cerr << "Compared " << num_events << " events (" << num_accepted_events << " accepted)\n";
+  check(num_accepted_events > 0, "some events should be accepted for " + str);
+  check_if_equal(num_mismatches, 0L, "number of events where convert_events_to_bins differs from get_bin for " + str);
+}
+
+void
+convert_events_to_binsTests::run_tests()
+{
+  shared_ptr<ListModeData> lm_data_sptr(read_from_file<ListModeData>(lm_data_filename));
+  const ProjDataInfo& uncompressed_proj_data_info = *lm_data_sptr->get_proj_data_info_sptr();
+  run_tests_for_template(uncompressed_proj_data_info, "uncompressed template");
+
+  shared_ptr<Scanner> scanner_sptr(new Scanner(*uncompressed_proj_data_info.get_scanner_ptr()));
+  const int num_views = scanner_sptr->get_num_detectors_per_ring() / 4;
+  const int num_tangential_poss = scanner_sptr->get_default_num_arccorrected_bins() / 2;
+  const int span = 3;
+  // make sure all segments have the same number of ring differences
+  const int max_delta = (scanner_sptr->get_num_rings() / 2 - 1) / span * span + 1;
+  const auto mashed_proj_data_info_uptr
+      = ProjDataInfo::construct_proj_data_info(scanner_sptr, span, max_delta, num_views, num_tangential_poss, false);
+  run_tests_for_template(*mashed_proj_data_info_uptr, "template with span and view mashing");
+
+  if (scanner_sptr->is_tof_ready())
+    {
+      const auto TOF_proj_data_info_uptr
+          = ProjDataInfo::construct_proj_data_info(scanner_sptr, span, max_delta, num_views, num_tangential_poss, false, 2);
+      run_tests_for_template(*TOF_proj_data_info_uptr, "template with TOF mashing");
+    }
+  else
+    std::cerr << "Scanner does not support TOF. Skipping test with TOF template\n";
+
+  run_tests_for_batch_reading();
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main(int argc, char** argv)
+{
+  if (argc != 2)
+    {
+      std::cerr << "Usage: " << argv[0] << " lm_data_filename\n";
+      return EXIT_FAILURE;
+    }
+  convert_events_to_binsTests tests(argv[1]);
+  tests.run_tests();
+  return tests.main_return_value();
+}
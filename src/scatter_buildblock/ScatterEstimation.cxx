@@ -1,5 +1,5 @@
 /*
-  Copyright (C) 2018,2019,2020 University College London
+  Copyright (C) 2018,2019,2020, 2026 University College London
   Copyright (C) 2018-2019, University of Hull
   Copyright (C) 2022 National Physical Laboratory
   This file is part of STIR.
@@ -74,6 +74,7 @@ ScatterEstimation::set_defaults()
   this->do_average_at_2 = true;
   this->export_scatter_estimates_of_each_iteration = false;
   this->restart_reconstruction_every_scatter_iteration = false;
+  this->scatter_convergence_threshold = 0.F;
   this->run_debug_mode = false;
   this->override_scanner_template = true;
   this->override_density_image = true;
@@ -140,6 +141,7 @@ ScatterEstimation::initialise_keymap()
   this->parser.add_key("output additive estimate name prefix", &this->output_additive_estimate_prefix);
   this->parser.add_key("do average at 2", &this->do_average_at_2);
   this->parser.add_key("restart reconstruction every scatter iteration", &this->restart_reconstruction_every_scatter_iteration);
+  this->parser.add_key("scatter convergence threshold", &this->scatter_convergence_threshold);
   this->parser.add_key("maximum scatter scaling factor", &this->max_scale_value);
   this->parser.add_key("minimum scatter scaling factor", &this->min_scale_value);
   this->parser.add_key("upsampling half filter width", &this->half_filter_width);
@@ -421,6 +423,18 @@ ScatterEstimation::get_restart_reconstruction_every_scatter_iteration() const
   return this->restart_reconstruction_every_scatter_iteration;
 }
 
+void
+ScatterEstimation::set_scatter_convergence_threshold(float threshold)
+{
+  this->scatter_convergence_threshold = threshold;
+}
+
+float
+ScatterEstimation::get_scatter_convergence_threshold() const
+{
+  return this->scatter_convergence_threshold;
+}
+
 void
 ScatterEstimation::set_attenuation_correction_proj_data_sptr(const shared_ptr<ProjData> arg)
 {
@@ -868,6 +882,22 @@ ScatterEstimation::process_data()
       scaled_est_projdata_sptr->fill(0.F);
     }
 
+  // The data to fit and the weights are used in every iteration, so make sure we only read them once
+  shared_ptr<const ProjData> fit_data_sptr = this->data_to_fit_projdata_sptr;
+  shared_ptr<const ProjData> fit_weights_sptr = this->mask_projdata_sptr;
+  if (run_in_2d_projdata)
+    {
+      if (is_null_ptr(dynamic_pointer_cast<const ProjDataInMemory>(fit_data_sptr)))
+        fit_data_sptr.reset(new ProjDataInMemory(*fit_data_sptr));
+      if (is_null_ptr(dynamic_pointer_cast<const ProjDataInMemory>(fit_weights_sptr)))
+        fit_weights_sptr.reset(new ProjDataInMemory(*fit_weights_sptr));
+    }
+
+  // Scatter estimate of the previous iteration, used to check convergence
+  shared_ptr<ProjDataInMemory> previous_scaled_est_projdata_sptr;
+  if (this->scatter_convergence_threshold > 0)
+    previous_scaled_est_projdata_sptr.reset(new ProjDataInMemory(*scaled_est_projdata_sptr));
+
   info("ScatterEstimation: Start processing...");
   shared_ptr<DiscretisedDensity<3, float>> act_image_for_averaging;
 
@@ -952,10 +982,10 @@ ScatterEstimation::process_data()
       scaled_est_projdata_sptr->fill(0.F);
 
       upsample_and_fit_scatter_estimate(*scaled_est_projdata_sptr,
-                                        *data_to_fit_projdata_sptr,
+                                        *fit_data_sptr,
                                         *unscaled_est_projdata_sptr,
                                         *normalisation_factors_sptr,
-                                        *this->mask_projdata_sptr,
+                                        *fit_weights_sptr,
                                         local_min_scale_value,
                                         local_max_scale_value,
                                         this->half_filter_width,
@@ -971,8 +1001,22 @@ ScatterEstimation::process_data()
           scaled_est_projdata_sptr->write_to_file(tmp.get_string());
         }
 
+      bool converged = false;
+      if (!is_null_ptr(previous_scaled_est_projdata_sptr))
+        {
+          // previous = new - previous
+          previous_scaled_est_projdata_sptr->sapyb(-1.F, *scaled_est_projdata_sptr, 1.F);
+          const double norm_of_estimate = scaled_est_projdata_sptr->norm();
+          const double relative_change = norm_of_estimate > 0 ? previous_scaled_est_projdata_sptr->norm() / norm_of_estimate : 0.;
+          info(boost::format("ScatterEstimation: relative change of the scatter estimate in iteration %1%: %2%") % i_scat_iter
+               % relative_change);
+          converged = i_scat_iter > 1 && relative_change < this->scatter_convergence_threshold;
+          previous_scaled_est_projdata_sptr->fill(*scaled_est_projdata_sptr);
+        }
+      const bool last_iteration = converged || i_scat_iter == this->num_scatter_iterations;
+
       // When saving we need to go 3D.
-      if (this->export_scatter_estimates_of_each_iteration || i_scat_iter == this->num_scatter_iterations)
+      if (this->export_scatter_estimates_of_each_iteration || last_iteration)
         {
 
           shared_ptr<ProjData> temp_scatter_projdata;
@@ -1095,6 +1139,12 @@ ScatterEstimation::process_data()
       iterative_method ? reconstruct_iterative(i_scat_iter) : reconstruct_analytic(i_scat_iter);
 
       scatter_simulation_sptr->set_activity_image_sptr(this->current_activity_image_sptr);
+
+      if (converged)
+        {
+          info(boost::format("ScatterEstimation: scatter estimate converged after %1% iterations") % i_scat_iter);
+          break;
+        }
     }
 
   info("ScatterEstimation: Scatter Estimation finished !!!");
@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2004 - 2009 Hammersmith Imanet Ltd
-    Copyright (C) 2013 - 2016, 2019, 2020, 2022  University College London
+    Copyright (C) 2013 - 2016, 2019, 2020, 2022, 2026 University College London
     Copyright (C) 2018-2019, University of Hull
     Copyright (C) 2021, University of Leeds
     Copyright (C) 2022, National Physical Laboratory
@@ -78,6 +78,18 @@ ScatterSimulation::set_use_cache(bool value)
   this->use_cache = value;
 }
 
+void
+ScatterSimulation::set_activity_integrals_tolerance(const float value)
+{
+  this->activity_integrals_tolerance = value;
+}
+
+float
+ScatterSimulation::get_activity_integrals_tolerance() const
+{
+  return this->activity_integrals_tolerance;
+}
+
 Succeeded
 ScatterSimulation::process_data()
 {
@@ -220,6 +232,8 @@ ScatterSimulation::set_defaults()
   this->attenuation_threshold = 0.01f;
   this->randomly_place_scatter_points = true;
   this->use_cache = true;
+  this->activity_integrals_tolerance = 0.F;
+  this->check_cached_activity_integrals = false;
   this->zoom_xy = -1.f;
   this->zoom_z = -1.f;
   this->zoom_size_xy = -1;
@@ -272,6 +286,7 @@ ScatterSimulation::initialise_keymap()
   this->parser.add_key("downsample scanner", &this->downsample_scanner_bool);
   this->parser.add_key("randomly place scatter points", &this->randomly_place_scatter_points);
   this->parser.add_key("use cache", &this->use_cache);
+  this->parser.add_key("tolerance for keeping cached activity integrals", &this->activity_integrals_tolerance);
 }
 
 bool
@@ -399,6 +414,11 @@ ScatterSimulation::set_up()
 #endif
   this->initialise_cache_for_scattpoint_det_integrals_over_attenuation();
   this->initialise_cache_for_scattpoint_det_integrals_over_activity();
+  if (this->check_cached_activity_integrals)
+    {
+      this->update_cache_for_integrals_over_activity();
+      this->check_cached_activity_integrals = false;
+    }
 
   this->_already_set_up = true;
 
@@ -434,7 +454,10 @@ ScatterSimulation::set_activity_image_sptr(const shared_ptr<const DiscretisedDen
     error("ScatterSimulation: Unable to set the activity image");
 
   this->activity_image_sptr = arg;
-  this->remove_cache_for_integrals_over_activity();
+  if (this->use_cache && this->activity_integrals_tolerance > 0)
+    this->check_cached_activity_integrals = true;
+  else
+    this->remove_cache_for_integrals_over_activity();
   this->_already_set_up = false;
 }
 
@@ -1,6 +1,6 @@
 /*
   Copyright (C) 2004-2009, Hammersmith Imanet Ltd
-  Copyright (C) 2013 University College London
+  Copyright (C) 2013, 2026 University College London
   This file is part of STIR.
 
   SPDX-License-Identifier: Apache-2.0
@@ -21,6 +21,10 @@
 #include "stir/scatter/ScatterSimulation.h"
 #include "stir/IndexRange.h"
 #include "stir/Coordinate2D.h"
+#include "stir/info.h"
+#include <boost/format.hpp>
+#include <algorithm>
+#include <cmath>
 
 START_NAMESPACE_STIR
 
@@ -69,6 +73,57 @@ ScatterSimulation::initialise_cache_for_scattpoint_det_integrals_over_activity()
   this->cached_activity_integral_scattpoint_det.fill(cache_init_value);
 }
 
+void
+ScatterSimulation::update_cache_for_integrals_over_activity()
+{
+  if (!this->use_cache)
+    return;
+
+  const int num_scatter_points = static_cast<int>(this->scatt_points_vector.size());
+  const int num_detectors = static_cast<int>(this->detection_points_vector.size());
+  if (num_scatter_points == 0 || num_detectors == 0
+      || this->cached_activity_integral_scattpoint_det.get_index_range()
+             != IndexRange<2>(Coordinate2D<int>(0, 0), Coordinate2D<int>(num_scatter_points - 1, this->total_detectors - 1)))
+    {
+      this->remove_cache_for_integrals_over_activity();
+      this->initialise_cache_for_scattpoint_det_integrals_over_activity();
+      return;
+    }
+
+  // We compare the cached integrals with the ones for the new activity image for a sample of detectors only,
+  // such that checking is much faster than recomputing.
+  const int num_detectors_to_check = 32;
+  const int det_num_step = std::max(num_detectors / num_detectors_to_check, 1);
+  int num_recomputed = 0;
+#ifdef STIR_OPENMP
+#  pragma omp parallel for reduction(+ : num_recomputed) schedule(dynamic)
+#endif
+  for (int scatter_point_num = 0; scatter_point_num < num_scatter_points; ++scatter_point_num)
+    {
+      Array<1, float>& cached_integrals = this->cached_activity_integral_scattpoint_det[scatter_point_num];
+      float max_cached_value = 0.F;
+      float max_difference = 0.F;
+      for (int det_num = 0; det_num < num_detectors; det_num += det_num_step)
+        {
+          const float cached_value = cached_integrals[det_num];
+          if (cached_value == cache_init_value)
+            continue;
+          const float new_value = integral_over_activity_image_between_scattpoint_det(
+              this->scatt_points_vector[scatter_point_num].coord, this->detection_points_vector[det_num]);
+          max_cached_value = std::max(max_cached_value, std::abs(cached_value));
+          max_difference = std::max(max_difference, std::abs(new_value - cached_value));
+        }
+      if (max_difference > this->activity_integrals_tolerance * max_cached_value)
+        {
+          cached_integrals.fill(cache_init_value);
+          ++num_recomputed;
+        }
+    }
+  info(boost::format("ScatterSimulation: activity integrals will be recomputed for %1% of %2% scatter points") % num_recomputed
+           % num_scatter_points,
+       2);
+}
+
 float
 ScatterSimulation::cached_integral_over_activity_image_between_scattpoint_det(const unsigned scatter_point_num,
                                                                               const unsigned det_num)
@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2011-07-01 - 2012, Kris Thielemans
-    Copyright (C) 2013, 2014, 2015, 2018 - 2023 University College London
+    Copyright (C) 2013, 2014, 2015, 2018 - 2023, 2026 University College London
     Copyright (C) 2022 National Physical Laboratory
     Copyright (C) 2022 Positrigo
     This file is part of STIR.
@@ -713,6 +713,98 @@ namespace std {
     return new SwigPyForwardIteratorClosed_T<OutIter>(current, begin, end, seq);
   }
 
+  // create a numpy array that uses the memory at data_ptr (no copy).
+  // base_object is kept alive as long as the numpy array exists (it should own the memory).
+  template <int num_dimensions>
+  PyObject* numpy_array_from_data(float* data_ptr, const stir::BasicCoordinate<num_dimensions, int>& sizes, PyObject* base_object)
+  {
+    npy_intp dims[num_dimensions];
+    for (int d=1; d<=num_dimensions; ++d)
+      dims[d-1] = static_cast<npy_intp>(sizes[d]);
+    PyObject* np = PyArray_SimpleNewFromData(num_dimensions, dims, NPY_FLOAT32, data_ptr);
+    if (np == NULL)
+      throw std::runtime_error("Error creating numpy array");
+    Py_INCREF(base_object);
+    if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(np), base_object) != 0)
+      {
+        Py_DECREF(np);
+        throw std::runtime_error("Error setting base object of numpy array");
+      }
+    return np;
+  }
+
+  // return a numpy array that shares the data with a (contiguous) stir::Array
+  template <int num_dimensions>
+  PyObject* Array_as_numpy(stir::Array<num_dimensions, float>& array, PyObject* base_object)
+  {
+    stir::BasicCoordinate<num_dimensions,int> minind,maxind;
+    if (!array.get_regular_range(minind, maxind))
+      throw std::range_error("as_numpy called on irregular array");
+    if (!array.is_contiguous())
+      throw std::runtime_error("as_numpy called on array whose data are not contiguous. Use stirextra.to_numpy() instead");
+    float* data_ptr = array.get_full_data_ptr();
+    array.release_full_data_ptr();
+    return numpy_array_from_data(data_ptr, maxind - minind + 1, base_object);
+  }
+
+  // get a numpy float32 array from a Python object, checking that it can be used without copying
+  inline PyArrayObject* numpy_array_for_wrapping(PyObject* const arg, const int num_dimensions)
+  {
+    if (!PyArray_Check(arg))
+      throw std::invalid_argument("from_numpy needs a numpy array");
+    PyArrayObject* np = reinterpret_cast<PyArrayObject*>(arg);
+    if (PyArray_TYPE(np) != NPY_FLOAT32 || !PyArray_IS_C_CONTIGUOUS(np) || !PyArray_ISALIGNED(np) || !PyArray_ISWRITEABLE(np)
+        || PyArray_ISBYTESWAPPED(np))
+      throw std::invalid_argument("from_numpy needs a writeable, C-contiguous numpy array of type float32 (use numpy.ascontiguousarray(a, dtype=numpy.float32) if necessary)");
+    if (PyArray_NDIM(np) != num_dimensions)
+      throw std::invalid_argument("from_numpy called with a numpy array of incorrect dimension");
+    return np;
+  }
+
+  // construct a stir::Array that uses the data of a numpy array (no copy).
+  // The numpy array is kept alive as long as the stir::Array (or a stir object which took over its data) exists.
+  template <int num_dimensions>
+  stir::Array<num_dimensions, float> Array_from_numpy(PyObject* const arg, const stir::BasicCoordinate<num_dimensions, int>& min_indices)
+  {
+    PyArrayObject* np = numpy_array_for_wrapping(arg, num_dimensions);
+    stir::BasicCoordinate<num_dimensions, int> max_indices;
+    for (int d=1; d<=num_dimensions; ++d)
+      max_indices[d] = min_indices[d] + static_cast<int>(PyArray_DIM(np, d-1)) - 1;
+    Py_INCREF(arg);
+    shared_ptr<float[]> data_sptr(static_cast<float*>(PyArray_DATA(np)),
+                                  [arg](float*)
+                                  {
+                                    // we might not be called from Python, so need to make sure we have the GIL
+                                    PyGILState_STATE state = PyGILState_Ensure();
+                                    Py_DECREF(arg);
+                                    PyGILState_Release(state);
+                                  });
+    return stir::Array<num_dimensions, float>(stir::IndexRange<num_dimensions>(min_indices, max_indices), data_sptr);
+  }
+
+  // call f(data_ptr) with the data of a numpy array converted to contiguous float32 (copying only if necessary)
+  template <typename FunctionT>
+  void call_with_numpy_data(PyObject* const arg, const std::size_t size_all, FunctionT f)
+  {
+    PyArrayObject* np = reinterpret_cast<PyArrayObject*>(PyArray_FROMANY(arg, NPY_FLOAT32, 0, 0, NPY_ARRAY_IN_ARRAY));
+    if (np == NULL)
+      throw std::invalid_argument("fill() called with a numpy array that cannot be converted to float32");
+    if (static_cast<std::size_t>(PyArray_SIZE(np)) != size_all)
+      {
+        Py_DECREF(np);
+        throw std::runtime_error("fill() called with a numpy array of incorrect size, it needs to have the same number of elements");
+      }
+    try
+      {
+        f(static_cast<const float*>(PyArray_DATA(np)));
+      }
+    catch (...)
+      {
+        Py_DECREF(np);
+        throw;
+      }
+    Py_DECREF(np);
+  }
 
 #endif
   static Array<4,float> create_array_for_proj_data(const ProjData& proj_data)
@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2011-07-01 - 2012, Kris Thielemans
-    Copyright (C) 2013, 2014, 2015, 2018 - 2022 University College London
+    Copyright (C) 2013, 2014, 2015, 2018 - 2022, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -143,10 +143,37 @@ namespace stir
       return swigstir::tuple_from_coord(sizes);
     }
 
-    %feature("autodoc", "fill from a Python iterator, e.g. array.fill(numpyarray.flat)") fill;
+    %feature("autodoc", "return a numpy array that shares the data with this array (no copy), e.g. array.as_numpy().\n"
+             "The array needs to be contiguous. Do not resize the STIR array while the numpy array is in use.") as_numpy;
+    PyObject* as_numpy(PyObject **PYTHON_SELF)
+    {
+      return swigstir::Array_as_numpy(*$self, *PYTHON_SELF);
+    }
+
+    %newobject from_numpy;
+    %feature("autodoc", "construct an array that uses the data of a (writeable, C-contiguous, float32) numpy array (no copy),\n"
+             "e.g. FloatArray3D.from_numpy(numpyarray). Indices start from 0, unless the minimum indices are given.") from_numpy;
+    static stir::Array<num_dimensions, elemT>* from_numpy(PyObject* const arg)
+    {
+      stir::BasicCoordinate<num_dimensions, int> min_indices;
+      min_indices.fill(0);
+      return new stir::Array<num_dimensions, elemT>(swigstir::Array_from_numpy(arg, min_indices));
+    }
+    static stir::Array<num_dimensions, elemT>* from_numpy(PyObject* const arg, const stir::BasicCoordinate<num_dimensions, int>& min_indices)
+    {
+      return new stir::Array<num_dimensions, elemT>(swigstir::Array_from_numpy(arg, min_indices));
+    }
+
+    %feature("autodoc", "fill from a numpy array or a Python iterator, e.g. array.fill(numpyarray) or array.fill(numpyarray.flat)") fill;
     void fill(PyObject* const arg)
     {
-      if (PyIter_Check(arg))
+      if (PyArray_Check(arg))
+      {
+        // fast path, avoiding the Python iterator
+        swigstir::call_with_numpy_data(arg, $self->size_all(),
+                                       [&](const float* data_ptr) { std::copy(data_ptr, data_ptr + $self->size_all(), $self->begin_all()); });
+      }
+      else if (PyIter_Check(arg))
       {
 	swigstir::fill_Array_from_Python_iterator($self, arg);
       }
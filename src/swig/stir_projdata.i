@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2011-07-01 - 2012, Kris Thielemans
-    Copyright (C) 2013, 2014, 2015, 2018 - 2022, 2023 University College London
+    Copyright (C) 2013, 2014, 2015, 2018 - 2022, 2023, 2026 University College London
     Copyright (C) 2022 National Physical Laboratory
     This file is part of STIR.
 
@@ -154,10 +154,15 @@ namespace stir {
       return array;
     }
 
-    %feature("autodoc", "fill from a Python iterator, e.g. proj_data.fill(numpyarray.flat)") fill;
+    %feature("autodoc", "fill from a numpy array or a Python iterator, e.g. proj_data.fill(numpyarray) or proj_data.fill(numpyarray.flat)") fill;
     void fill(PyObject* const arg)
     {
-      if (PyIter_Check(arg))
+      if (PyArray_Check(arg))
+      {
+        // fast path, avoiding the Python iterator and the intermediate Array
+        swigstir::call_with_numpy_data(arg, $self->size_all(), [&](const float* data_ptr) { $self->fill_from(data_ptr); });
+      }
+      else if (PyIter_Check(arg))
       {
         // TODO avoid need for copy to Array
         Array<4,float> array = swigstir::create_array_for_proj_data(*$self);
@@ -195,10 +200,26 @@ namespace stir {
 %extend ProjDataInMemory
   {
 #ifdef SWIGPYTHON
-    %feature("autodoc", "fill from a Python iterator, e.g. proj_data.fill(numpyarray.flat)") fill;
+    %feature("autodoc", "return a 4D numpy array that shares the data with this object (no copy), e.g. proj_data.as_numpy().\n"
+             "The order of the data is the same as for to_array().") as_numpy;
+    PyObject* as_numpy(PyObject **PYTHON_SELF)
+    {
+      float* data_ptr = $self->get_data_ptr();
+      $self->release_data_ptr();
+      const stir::BasicCoordinate<4, int> sizes
+        = stir::make_coordinate($self->get_num_tof_poss(), $self->get_num_non_tof_sinograms(), $self->get_num_views(), $self->get_num_tangential_poss());
+      return swigstir::numpy_array_from_data(data_ptr, sizes, *PYTHON_SELF);
+    }
+
+    %feature("autodoc", "fill from a numpy array or a Python iterator, e.g. proj_data.fill(numpyarray) or proj_data.fill(numpyarray.flat)") fill;
     void fill(PyObject* const arg)
     {
-      if (PyIter_Check(arg))
+      if (PyArray_Check(arg))
+      {
+        // fast path, avoiding the Python iterator and the intermediate Array
+        swigstir::call_with_numpy_data(arg, $self->size_all(), [&](const float* data_ptr) { $self->fill_from(data_ptr); });
+      }
+      else if (PyIter_Check(arg))
       {
         Array<4,float> array = swigstir::create_array_for_proj_data(*$self);
 	swigstir::fill_Array_from_Python_iterator(&array, arg);
@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2011-07-01 - 2012, Kris Thielemans
-    Copyright (C) 2018, 2021-2022 University College London
+    Copyright (C) 2018, 2021-2022, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -43,6 +43,28 @@
       return write_to_file(filename, *$self);
     }
 
+#ifdef SWIGPYTHON
+    %newobject from_numpy;
+    %feature("autodoc", "construct an image that uses the data of a (writeable, C-contiguous, float32) 3D numpy array (no copy),\n"
+             "e.g. FloatVoxelsOnCartesianGrid.from_numpy(numpyarray, origin, grid_spacing).\n"
+             "Indices are as usual in STIR, i.e. z starts from 0, and y and x are centred.") from_numpy;
+    static stir::VoxelsOnCartesianGrid<elemT> * from_numpy(PyObject* const arg,
+                                                           const stir::CartesianCoordinate3D<float>& origin,
+                                                           const stir::CartesianCoordinate3D<float>& grid_spacing)
+    {
+      PyArrayObject* np = swigstir::numpy_array_for_wrapping(arg, 3);
+      const stir::BasicCoordinate<3, int> min_indices
+        = stir::make_coordinate(0, -static_cast<int>(PyArray_DIM(np, 1) / 2), -static_cast<int>(PyArray_DIM(np, 2) / 2));
+      stir::Array<3, float> array = swigstir::Array_from_numpy(arg, min_indices);
+      stir::VoxelsOnCartesianGrid<elemT>* image_ptr = new stir::VoxelsOnCartesianGrid<elemT>();
+      image_ptr->set_origin(origin);
+      image_ptr->set_grid_spacing(grid_spacing);
+      // let the image take over the data of the array
+      swap(static_cast<stir::Array<3, float>&>(*image_ptr), array);
+      return image_ptr;
+    }
+#endif
+
     // add sapyb to VoxelsOnCartesianGrid
     void sapyb(const float a,  const Array<3, float>& y, const float b)
     { 
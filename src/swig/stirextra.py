@@ -1,6 +1,6 @@
 # A simple module with a few python functions to make it easier to work with STIR
 # Copyright (C) 2012 Kris Thielemans
-# Copyright (C) 2013 University College London
+# Copyright (C) 2013, 2026 University College London
 
 # This file is part of STIR.
 #
@@ -58,12 +58,20 @@ def get_physical_coordinates_for_grid(image):
     else:
         raise exceptions.NotImplementedError('need to handle dimensions different from 2 and 3')
 
-def to_numpy(stirdata):
+def to_numpy(stirdata, copy=True):
     """
     return the data in a STIR image or other Array as a numpy array
+
+    If copy is False, the numpy array shares the data with the STIR object where possible
+    (see as_numpy()), such that modifying one modifies the other.
     """
-    # construct a numpy array using the "flat" STIR iterator
     try:
+        npdata=stirdata.as_numpy();
+        return npdata.copy() if copy else npdata
+    except (AttributeError, RuntimeError):
+        pass
+    try:
+        # construct a numpy array using the "flat" STIR iterator (for non-contiguous arrays)
         npstirdata=numpy.fromiter(stirdata.flat(), dtype=numpy.float32);
         # now reshape into ND array
         npdata=npstirdata.reshape(stirdata.shape());
@@ -71,4 +79,23 @@ def to_numpy(stirdata):
     except:
         # hopefully it's projection data
         stirarray=stirdata.to_array();
-        return to_numpy(stirarray);
+        # stirarray is a new object, so no need to copy
+        return stirarray.as_numpy();
+
+def from_numpy(npdata):
+    """
+    return a STIR Array that uses the data of a numpy array (without copying)
+
+    The numpy array needs to be writeable, C-contiguous and of type float32.
+    Use numpy.ascontiguousarray(npdata, dtype=numpy.float32) if necessary.
+    For images, use stir.FloatVoxelsOnCartesianGrid.from_numpy(npdata, origin, grid_spacing).
+    """
+    num_dims = npdata.ndim
+    if num_dims == 2:
+        return stir.FloatArray2D.from_numpy(npdata)
+    elif num_dims == 3:
+        return stir.FloatArray3D.from_numpy(npdata)
+    elif num_dims == 4:
+        return stir.FloatArray4D.from_numpy(npdata)
+    else:
+        raise NotImplementedError('need to handle dimensions different from 2, 3 and 4')
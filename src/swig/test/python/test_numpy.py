@@ -4,7 +4,7 @@
 #     py.test test_numpy.py
 
 
-#    Copyright (C) 2013, 2015 University College London
+#    Copyright (C) 2013, 2015, 2026 University College London
 #    This file is part of STIR.
 #
 #    SPDX-License-Identifier: Apache-2.0
@@ -13,6 +13,7 @@
 
 from stir import *
 import stirextra
+import numpy
 # for Python2 and itertools.zip->zip (as in Python 3) 
 try:
     import itertools.izip as zip
@@ -79,3 +80,60 @@ def test_ProjData():
     seg0=stirextra.to_numpy(projdata.get_segment_by_sinogram(0))
     assert(seg0.max() == 2)
 
+
+def test_Array3D_as_numpy():
+    minind=Int3BasicCoordinate((3,3,5));
+    a=FloatArray3D(IndexRange3D(minind, Int3BasicCoordinate((9,8,7))))
+    a.fill(2);
+    np=a.as_numpy()
+    assert np.shape==a.shape()
+    # shared data
+    np[0,1,2]=5
+    ind=Int3BasicCoordinate((3,4,7))
+    assert a[ind]==5
+    np2=stirextra.to_numpy(a)
+    np2[0,1,2]=6
+    assert a[ind]==5
+    # numpy array keeps the data alive
+    del a
+    assert np[0,1,2]==5
+
+def test_Array3D_from_numpy():
+    np=numpy.arange(24, dtype=numpy.float32).reshape((2,3,4))
+    a=FloatArray3D.from_numpy(np)
+    assert a.shape()==np.shape
+    ind=Int3BasicCoordinate((1,2,3))
+    assert a[ind]==np[1,2,3]
+    np[1,2,3]=100
+    assert a[ind]==100
+    a2=stirextra.from_numpy(np)
+    del np
+    assert a2[ind]==100
+    # fill from numpy array (without iterator)
+    np3=numpy.ones((2,3,4))
+    a2.fill(np3)
+    assert a2[ind]==1
+    assert a[ind]==1
+
+def test_VoxelsOnCartesianGrid_from_numpy():
+    np=numpy.zeros((3,4,5), dtype=numpy.float32)
+    np[1,2,3]=4
+    image=FloatVoxelsOnCartesianGrid.from_numpy(np, FloatCartesianCoordinate3D(1,2,3), FloatCartesianCoordinate3D(2,2,2))
+    assert image[Int3BasicCoordinate((1,0,1))]==4
+    assert image.get_voxel_size()[1]==2
+    assert image.get_origin()[3]==3
+    np2=image.as_numpy()
+    assert np2[1,2,3]==4
+
+def test_ProjDataInMemory_as_numpy():
+    s=Scanner.get_scanner_from_name("ECAT 962")
+    projdatainfo=ProjDataInfo.construct_proj_data_info(s,3,9,8,6)
+    projdata=ProjDataInMemory(ExamInfo(), projdatainfo)
+    np=projdata.as_numpy()
+    assert np.shape==stirextra.to_numpy(projdata.to_array()).shape
+    np+=3
+    seg0=stirextra.to_numpy(projdata.get_segment_by_sinogram(0))
+    assert(seg0.max() == 3)
+    np2=np*2
+    projdata.fill(np2)
+    assert(np.max() == 6)
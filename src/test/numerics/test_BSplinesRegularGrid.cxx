@@ -2,6 +2,7 @@
 //
 /*
   Copyright (C) 2005- 2009-10-27, Hammersmith Imanet Ltd
+  Copyright (C) 2026, University College London
   This file is part of STIR.
 
   SPDX-License-Identifier: Apache-2.0
@@ -11,7 +12,7 @@
 /*!
   \file
   \ingroup numerics_test
-  \brief tests the stir::BSplinesRegularGrid class for the stir::Array 2D case
+  \brief tests the stir::BSplinesRegularGrid class for the stir::Array 2D case (and sampling in 3D)
 
   \author Charalampos Tsoumpas
   \author Kris Thielemans
@@ -21,6 +22,7 @@
 #include "stir/Array.h"
 #include "stir/make_array.h"
 #include "stir/IndexRange2D.h"
+#include "stir/IndexRange3D.h"
 #include "stir/Coordinate2D.h"
 #include "stir/stream.h"
 #include "stir/assign.h"
@@ -525,6 +527,49 @@ BSplinesRegularGrid_Tests::run_tests()
                         "check BSplines implementation for linear_cubic interpolation.\nProblems at half way!");
     }
   }
+  {
+    cerr << "\nTesting BSplinesRegularGrid: sample_on_regular_grid for a 3D array..." << endl;
+    Array<3, elemT> input(IndexRange3D(-2, 5, -3, 6, -4, 8));
+    for (int i1 = input.get_min_index(); i1 <= input.get_max_index(); ++i1)
+      for (int i2 = input[i1].get_min_index(); i2 <= input[i1].get_max_index(); ++i2)
+        for (int i3 = input[i1][i2].get_min_index(); i3 <= input[i1][i2].get_max_index(); ++i3)
+          input[i1][i2][i3] = sin(1.1 * i1 + 2.3 * i2 + .7 * i3 * i3);
+    // include some positions outside the input range
+    BasicCoordinate<3, pos_type> offset, step;
+    offset[1] = -3.3;
+    offset[2] = -4.1;
+    offset[3] = -4.5;
+    step[1] = .7;
+    step[2] = 1.3;
+    step[3] = .55;
+    BasicCoordinate<3, BSplineType> spline_types;
+    spline_types[1] = linear;
+    spline_types[2] = quadratic;
+    spline_types[3] = cubic;
+    for (int rotate = 0; rotate < 3; ++rotate)
+      {
+        const BSplinesRegularGrid<3, elemT, elemT> interpolator(input, spline_types);
+        Array<3, elemT> out(IndexRange3D(0, 12, -1, 7, 2, 27));
+        interpolator.sample_on_regular_grid(out, offset, step);
+        Array<3, elemT> expected(out.get_index_range());
+        BasicCoordinate<3, int> index;
+        for (index[1] = 0; index[1] <= 12; ++index[1])
+          for (index[2] = -1; index[2] <= 7; ++index[2])
+            for (index[3] = 2; index[3] <= 27; ++index[3])
+              {
+                BasicCoordinate<3, pos_type> relative_positions;
+                for (int d = 1; d <= 3; ++d)
+                  relative_positions[d] = index[d] * step[d] + offset[d];
+                expected[index] = interpolator(relative_positions);
+              }
+        check_if_equal(expected, out, "check sample_on_regular_grid against point-wise evaluation");
+        // use another spline type in every dimension for the next test
+        const BSplineType first_type = spline_types[1];
+        spline_types[1] = spline_types[2];
+        spline_types[2] = spline_types[3];
+        spline_types[3] = first_type;
+      }
+  }
   /*  {
       cerr << "\nTesting BSplinesRegularGrid: Linear interpolation values and constructor using a 2D diamond array as input..." <<
      endl; Array<1,elemT> random_1D_1 =  make_1d_array(-14., 8., -1., 13., -1., -2., 11., 1., -8.); Array<1,elemT> random_1D_2 =
@@ -0,0 +1,202 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup test
+
+  \brief Test program for the caching in stir::BinNormalisationFromAttenuationImage
+
+  Checks that apply() and undo() give the same result with and without caching of the attenuation
+  correction factors, including when factors are cached on disk, and when the same view is
+  requested with different ranges of axial and tangential positions.
+
+  \author Kris Thielemans
+*/
+
+#include "stir/recon_buildblock/BinNormalisationFromAttenuationImage.h"
+#include "stir/recon_buildblock/ForwardProjectorByBinUsingRayTracing.h"
+#include "stir/DataSymmetriesForViewSegmentNumbers.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/RelatedViewgrams.h"
+#include "stir/IndexRange2D.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/Succeeded.h"
+#include "stir/RunTests.h"
+#include <random>
+#include <iostream>
+#include <vector>
+#include <boost/format.hpp>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for caching in BinNormalisationFromAttenuationImage
+*/
+class BinNormalisationFromAttenuationImageTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  shared_ptr<ExamInfo> exam_info_sptr;
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr;
+  shared_ptr<const DiscretisedDensity<3, float>> attenuation_image_sptr;
+
+  void run_tests_for_budget(const ProjDataInMemory& proj_data, const float memory_budget_in_MB);
+  //! check applying the cached factors to viewgrams of the same view with a full and a reduced range
+  void run_tests_for_ranges(const ProjDataInMemory& proj_data);
+};
+
+void
+BinNormalisationFromAttenuationImageTests::run_tests_for_budget(const ProjDataInMemory& proj_data, const float memory_budget_in_MB)
+{
+  std::cerr << "Testing caching with memory budget " << memory_budget_in_MB << " MB\n";
+
+  shared_ptr<ForwardProjectorByBin> forward_projector_sptr(new ForwardProjectorByBinUsingRayTracing);
+  BinNormalisationFromAttenuationImage norm(attenuation_image_sptr, forward_projector_sptr);
+  check(norm.set_up(exam_info_sptr, proj_data_info_sptr) == Succeeded::yes, "set_up without cache");
+  BinNormalisationFromAttenuationImage cached_norm(attenuation_image_sptr,
+                                                   shared_ptr<ForwardProjectorByBin>(new ForwardProjectorByBinUsingRayTracing));
+  cached_norm.set_use_cache(true);
+  cached_norm.set_cache_memory_budget_in_MB(memory_budget_in_MB);
+  check(cached_norm.set_up(exam_info_sptr, proj_data_info_sptr) == Succeeded::yes, "set_up with cache");
+  // related viewgrams need to be constructed with the symmetries of the projector
+  const shared_ptr<DataSymmetriesForViewSegmentNumbers> symmetries_sptr(
+      forward_projector_sptr->get_symmetries_used()->clone());
+
+  ProjDataInMemory expected(proj_data);
+  norm.apply(expected, symmetries_sptr);
+  // the first call fills the cache, the second one uses it
+  for (int i = 1; i <= 2; ++i)
+    {
+      ProjDataInMemory result(proj_data);
+      cached_norm.apply(result, symmetries_sptr);
+      check_if_equal(expected, result, str(boost::format("apply with cache (call %1%)") % i));
+    }
+
+  expected.fill(proj_data);
+  norm.undo(expected, symmetries_sptr);
+  ProjDataInMemory result(proj_data);
+  cached_norm.undo(result, symmetries_sptr);
+  check_if_equal(expected, result, "undo with cache");
+}
+
+void
+BinNormalisationFromAttenuationImageTests::run_tests_for_ranges(const ProjDataInMemory& proj_data)
+{
+  std::cerr << "Testing caching with different ranges for the same view\n";
+
+  shared_ptr<ForwardProjectorByBin> forward_projector_sptr(new ForwardProjectorByBinUsingRayTracing);
+  BinNormalisationFromAttenuationImage norm(attenuation_image_sptr, forward_projector_sptr);
+  check(norm.set_up(exam_info_sptr, proj_data_info_sptr) == Succeeded::yes, "set_up without cache");
+  BinNormalisationFromAttenuationImage cached_norm(attenuation_image_sptr,
+                                                   shared_ptr<ForwardProjectorByBin>(new ForwardProjectorByBinUsingRayTracing));
+  cached_norm.set_use_cache(true);
+  check(cached_norm.set_up(exam_info_sptr, proj_data_info_sptr) == Succeeded::yes, "set_up with cache");
+  const shared_ptr<DataSymmetriesForViewSegmentNumbers> symmetries_sptr(
+      forward_projector_sptr->get_symmetries_used()->clone());
+
+  const ViewgramIndices viewgram_indices(/*view_num*/ 1, /*segment_num*/ 0);
+  const RelatedViewgrams<float> full_viewgrams = proj_data.get_related_viewgrams(viewgram_indices, symmetries_sptr);
+  // same views, but with fewer axial and tangential positions
+  std::vector<Viewgram<float>> reduced_viewgrams_vector;
+  for (RelatedViewgrams<float>::const_iterator iter = full_viewgrams.begin(); iter != full_viewgrams.end(); ++iter)
+    {
+      Viewgram<float> viewgram(*iter);
+      viewgram.resize(IndexRange2D(iter->get_min_axial_pos_num() + 2,
+                                   iter->get_max_axial_pos_num() - 3,
+                                   iter->get_min_tangential_pos_num() + 5,
+                                   iter->get_max_tangential_pos_num() - 4));
+      reduced_viewgrams_vector.push_back(viewgram);
+    }
+  const RelatedViewgrams<float> reduced_viewgrams(reduced_viewgrams_vector, symmetries_sptr);
+
+  // fill the cache with the full range first, then ask for the reduced range, and vice versa
+  for (int i = 1; i <= 2; ++i)
+    {
+      RelatedViewgrams<float> expected_full(full_viewgrams);
+      norm.apply(expected_full);
+      RelatedViewgrams<float> expected_reduced(reduced_viewgrams);
+      norm.apply(expected_reduced);
+
+      RelatedViewgrams<float> result_full(full_viewgrams);
+      RelatedViewgrams<float> result_reduced(reduced_viewgrams);
+      if (i == 1)
+        {
+          cached_norm.apply(result_full);
+          cached_norm.apply(result_reduced);
+        }
+      else
+        {
+          cached_norm.apply(result_reduced);
+          cached_norm.apply(result_full);
+        }
+      RelatedViewgrams<float>::const_iterator result_iter = result_full.begin();
+      for (RelatedViewgrams<float>::const_iterator iter = expected_full.begin(); iter != expected_full.end();
+           ++iter, ++result_iter)
+        check_if_equal(*iter, *result_iter, str(boost::format("apply with cache to full range (pass %1%)") % i));
+      result_iter = result_reduced.begin();
+      for (RelatedViewgrams<float>::const_iterator iter = expected_reduced.begin(); iter != expected_reduced.end();
+           ++iter, ++result_iter)
+        check_if_equal(*iter, *result_iter, str(boost::format("apply with cache to reduced range (pass %1%)") % i));
+    }
+}
+
+void
+BinNormalisationFromAttenuationImageTests::run_tests()
+{
+  exam_info_sptr = std::make_shared<ExamInfo>(ImagingModality::PT);
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E962));
+  proj_data_info_sptr = ProjDataInfo::construct_proj_data_info(scanner_sptr,
+                                                                /*span*/ 1,
+                                                                /*max_delta*/ 3,
+                                                                /*num_views*/ scanner_sptr->get_num_detectors_per_ring() / 2,
+                                                                /*num_tang_poss*/ 64,
+                                                                /*arc_corrected*/ false);
+
+  // uniform cylinder with attenuation of water
+  shared_ptr<VoxelsOnCartesianGrid<float>> image_sptr(new VoxelsOnCartesianGrid<float>(*proj_data_info_sptr, 0.5F));
+  image_sptr->fill(0.F);
+  for (int z = image_sptr->get_min_z(); z <= image_sptr->get_max_z(); ++z)
+    for (int y = image_sptr->get_min_y(); y <= image_sptr->get_max_y(); ++y)
+      for (int x = image_sptr->get_min_x(); x <= image_sptr->get_max_x(); ++x)
+        if (x * x + y * y < 100)
+          (*image_sptr)[z][y][x] = .096F;
+  attenuation_image_sptr = image_sptr;
+
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr, false);
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> distribution(1.F, 2.F);
+  for (auto iter = proj_data.begin(); iter != proj_data.end(); ++iter)
+    *iter = distribution(generator);
+
+  // everything in memory
+  run_tests_for_budget(proj_data, 1024.F);
+  // some factors in memory, others on disk (a viewgram is about 0.004 MB)
+  run_tests_for_budget(proj_data, .1F);
+  // everything on disk
+  run_tests_for_budget(proj_data, 0.F);
+  run_tests_for_ranges(proj_data);
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  BinNormalisationFromAttenuationImageTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -0,0 +1,137 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup test
+
+  \brief Test program for stir::InputStreamWithRecords
+
+  Uses records of variable size, and more data than fit in the internal buffer,
+  to check reading, saving/restoring positions and reading multiple records at once.
+
+  \author Kris Thielemans
+*/
+
+#include "stir/IO/InputStreamWithRecords.h"
+#include "stir/RunTests.h"
+#include <sstream>
+#include <vector>
+
+START_NAMESPACE_STIR
+
+namespace detail
+{
+//! simple record where the first byte gives the size, and the next one the (low byte of the) record number
+class TestRecord
+{
+public:
+  std::size_t size_of_record_at_ptr(const char* const data_ptr, const std::size_t, const bool) const
+  {
+    return static_cast<std::size_t>(static_cast<unsigned char>(data_ptr[0]));
+  }
+  Succeeded init_from_data_ptr(const char* const data_ptr, const std::size_t size_of_record, const bool)
+  {
+    size = size_of_record;
+    id = static_cast<unsigned char>(data_ptr[1]);
+    // last byte is equal to the size
+    return static_cast<std::size_t>(static_cast<unsigned char>(data_ptr[size - 1])) == size ? Succeeded::yes : Succeeded::no;
+  }
+  std::size_t size = 0;
+  int id = 0;
+};
+} // namespace detail
+
+/*!
+  \ingroup test
+  \brief Test class for InputStreamWithRecords
+*/
+class InputStreamWithRecordsTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  static std::size_t get_size(const int record_num) { return static_cast<std::size_t>(3 + (record_num * 7) % 10); }
+  static int get_id(const int record_num) { return record_num % 256; }
+  bool check_record(const detail::TestRecord& record, const int record_num, const std::string& str)
+  {
+    return check_if_equal(record.size, get_size(record_num), str + ": size of record " + std::to_string(record_num))
+           && check_if_equal(record.id, get_id(record_num), str + ": id of record " + std::to_string(record_num));
+  }
+};
+
+void
+InputStreamWithRecordsTests::run_tests()
+{
+  // construct data which is larger than the buffer
+  const int num_records = 200000;
+  shared_ptr<std::stringstream> stream_sptr(new std::stringstream);
+  {
+    std::string data;
+    for (int record_num = 0; record_num < num_records; ++record_num)
+      {
+        const std::size_t size = get_size(record_num);
+        std::string record(size, static_cast<char>(size));
+        record[1] = static_cast<char>(get_id(record_num));
+        data += record;
+      }
+    // add some bytes before the start of the data
+    stream_sptr->str("xyz" + data);
+    stream_sptr->seekg(3);
+  }
+  InputStreamWithRecords<detail::TestRecord, bool> input(stream_sptr, 1, 12, false);
+
+  detail::TestRecord record;
+  const int num_records_before_saving = 150001;
+  InputStreamWithRecords<detail::TestRecord, bool>::SavedPosition saved_position = 0;
+  for (int record_num = 0; record_num < num_records; ++record_num)
+    {
+      if (record_num == num_records_before_saving)
+        saved_position = input.save_get_position();
+      if (!check(input.get_next_record(record) == Succeeded::yes, "get_next_record " + std::to_string(record_num))
+          || !check_record(record, record_num, "get_next_record"))
+        return;
+    }
+  check(input.get_next_record(record) == Succeeded::no, "get_next_record at end of data");
+  const auto saved_position_at_end = input.save_get_position();
+
+  check(input.set_get_position(saved_position) == Succeeded::yes, "set_get_position");
+  check(input.get_next_record(record) == Succeeded::yes, "get_next_record after set_get_position");
+  check_record(record, num_records_before_saving, "get_next_record after set_get_position");
+
+  check(input.set_get_position(saved_position_at_end) == Succeeded::yes, "set_get_position at end");
+  check(input.get_next_record(record) == Succeeded::no, "get_next_record after set_get_position at end");
+
+  // read multiple records at once
+  {
+    check(input.reset() == Succeeded::yes, "reset");
+    std::vector<detail::TestRecord> records(7000);
+    int record_num = 0;
+    std::size_t num_read;
+    while ((num_read = input.get_next_records(records.data(), records.size())) > 0)
+      {
+        for (std::size_t i = 0; i < num_read; ++i, ++record_num)
+          if (!check_record(records[i], record_num, "get_next_records"))
+            return;
+      }
+    check_if_equal(record_num, num_records, "get_next_records: total number of records");
+  }
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  InputStreamWithRecordsTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -11,7 +11,7 @@
   \author daniel deidda
 */
 /*
-    Copyright (C) 2021, University College London
+    Copyright (C) 2021, 2026, University College London
     Copyright (C) 2022, National Physical Laboratory
     This file is part of STIR.
 
@@ -26,6 +26,9 @@
 #include "stir/Scanner.h"
 #include "stir/Bin.h"
 #include "stir/ML_norm.h"
+#include "stir/multiply_crystal_factors.h"
+#include "stir/DetectionPositionPair.h"
+#include "stir/Viewgram.h"
 #include "stir/IndexRange2D.h"
 #include "stir/numerics/norm.h"
 #include "stir/num_threads.h"
@@ -48,6 +51,11 @@ public:
 protected:
   template <class TProjDataInfo>
   void test_proj_data_info(shared_ptr<TProjDataInfo> proj_data_info_sptr);
+  //! check if iterate_efficiencies finds the efficiencies used to construct the data
+  void test_iterate_efficiencies(shared_ptr<const ProjDataInfo> proj_data_info_sptr);
+  //! check multiply_crystal_factors against a sum over all detection position pairs of every bin
+  template <class TProjDataInfo>
+  void test_multiply_crystal_factors(shared_ptr<const TProjDataInfo> proj_data_info_sptr);
 };
 
 void
@@ -64,6 +72,31 @@ ML_normTests::run_tests()
                                                /*tang_pos*/ 64,
                                                /*arc_corrected*/ false));
     test_proj_data_info(dynamic_pointer_cast<ProjDataInfoCylindricalNoArcCorr>(proj_data_info_sptr));
+    test_iterate_efficiencies(proj_data_info_sptr);
+    test_multiply_crystal_factors(dynamic_pointer_cast<const ProjDataInfoCylindricalNoArcCorr>(proj_data_info_sptr));
+    // span and view mashing
+    shared_ptr<ProjDataInfo> proj_data_info_span3_sptr(
+        ProjDataInfo::construct_proj_data_info(scanner_sptr,
+                                               /*span*/ 3,
+                                               scanner_sptr->get_num_rings() - 1,
+                                               /*views*/ scanner_sptr->get_num_detectors_per_ring() / 4,
+                                               /*tang_pos*/ 64,
+                                               /*arc_corrected*/ false));
+    test_multiply_crystal_factors(dynamic_pointer_cast<const ProjDataInfoCylindricalNoArcCorr>(proj_data_info_span3_sptr));
+    // TOF (using a modified scanner)
+    shared_ptr<Scanner> tof_scanner_sptr(new Scanner(*scanner_sptr));
+    tof_scanner_sptr->set_max_num_timing_poss(3);
+    tof_scanner_sptr->set_size_of_timing_poss(200.F);
+    tof_scanner_sptr->set_timing_resolution(500.F);
+    shared_ptr<ProjDataInfo> proj_data_info_tof_sptr(
+        ProjDataInfo::construct_proj_data_info(tof_scanner_sptr,
+                                               /*span*/ 3,
+                                               tof_scanner_sptr->get_num_rings() - 1,
+                                               /*views*/ tof_scanner_sptr->get_num_detectors_per_ring() / 4,
+                                               /*tang_pos*/ 64,
+                                               /*arc_corrected*/ false,
+                                               /*tof_mash_factor*/ 1));
+    test_multiply_crystal_factors(dynamic_pointer_cast<const ProjDataInfoCylindricalNoArcCorr>(proj_data_info_tof_sptr));
   }
   {
     std::cerr << "\n-------- Testing ECAT E1080 (with gaps) --------\n";
@@ -90,6 +123,7 @@ ML_normTests::run_tests()
                                                /*tang_pos*/ 64,
                                                /*arc_corrected*/ false));
     test_proj_data_info(dynamic_pointer_cast<ProjDataInfoBlocksOnCylindricalNoArcCorr>(proj_data_info_sptr));
+    test_multiply_crystal_factors(dynamic_pointer_cast<const ProjDataInfoBlocksOnCylindricalNoArcCorr>(proj_data_info_sptr));
   }
 }
 
@@ -183,6 +217,91 @@ ML_normTests::test_proj_data_info(shared_ptr<TProjDataInfo> proj_data_info_sptr)
   }
 }
 
+void
+ML_normTests::test_iterate_efficiencies(shared_ptr<const ProjDataInfo> proj_data_info_sptr)
+{
+  std::cerr << "Testing iterate_efficiencies\n";
+  auto exam_info_sptr = std::make_shared<ExamInfo>();
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+  proj_data.fill(1.F);
+  FanProjData model;
+  make_fan_data_remove_gaps(model, proj_data);
+  const int num_rings = model.get_num_rings();
+  const int num_detectors_per_ring = model.get_num_detectors_per_ring();
+
+  DetectorEfficiencies org_efficiencies(IndexRange2D(num_rings, num_detectors_per_ring));
+  for (int ra = 0; ra < num_rings; ++ra)
+    for (int a = 0; a < num_detectors_per_ring; ++a)
+      org_efficiencies[ra][a] = static_cast<float>(1 + .3 * sin(3.1 * ra + 1.7 * a));
+
+  FanProjData measured = model;
+  apply_efficiencies(measured, org_efficiencies);
+  Array<2, float> data_fan_sums(IndexRange2D(num_rings, num_detectors_per_ring));
+  make_fan_sum_data(data_fan_sums, measured);
+
+  DetectorEfficiencies efficiencies(IndexRange2D(num_rings, num_detectors_per_ring));
+  efficiencies.fill(sqrt(data_fan_sums.sum() / model.sum()));
+  for (int iter_num = 0; iter_num < 20; ++iter_num)
+    iterate_efficiencies(efficiencies, data_fan_sums, model);
+
+  const double old_tolerance = get_tolerance();
+  set_tolerance(.001);
+  check_if_equal(efficiencies, org_efficiencies, "iterate_efficiencies should find the original efficiencies");
+  FanProjData estimated = model;
+  apply_efficiencies(estimated, efficiencies);
+  check_if_zero(KL(measured, estimated, 0.) / measured.sum(), "KL after iterate_efficiencies");
+  set_tolerance(old_tolerance);
+}
+
+template <class TProjDataInfo>
+void
+ML_normTests::test_multiply_crystal_factors(shared_ptr<const TProjDataInfo> proj_data_info_sptr)
+{
+  std::cerr << "Testing multiply_crystal_factors\n";
+  if (!check(proj_data_info_sptr != nullptr, "check type of proj_data_info"))
+    return;
+  const int num_rings = proj_data_info_sptr->get_scanner_sptr()->get_num_rings();
+  const int num_detectors_per_ring = proj_data_info_sptr->get_scanner_sptr()->get_num_detectors_per_ring();
+  Array<2, float> efficiencies(IndexRange2D(num_rings, num_detectors_per_ring));
+  for (int ra = 0; ra < num_rings; ++ra)
+    for (int a = 0; a < num_detectors_per_ring; ++a)
+      efficiencies[ra][a] = static_cast<float>(1 + .3 * sin(3.1 * ra + 1.7 * a));
+  const float global_factor = 1.7F;
+
+  ProjDataInMemory proj_data(std::make_shared<ExamInfo>(), proj_data_info_sptr);
+  multiply_crystal_factors(proj_data, efficiencies, global_factor);
+
+  // TOF bins are all set to the same fraction of the non-TOF value
+  const float factor = global_factor / proj_data.get_num_tof_poss();
+  std::vector<DetectionPositionPair<>> det_pos_pairs;
+  for (int timing_pos_num = proj_data.get_min_tof_pos_num(); timing_pos_num <= proj_data.get_max_tof_pos_num(); ++timing_pos_num)
+    for (int segment_num = proj_data.get_min_segment_num(); segment_num <= proj_data.get_max_segment_num(); ++segment_num)
+      for (int view_num = proj_data.get_min_view_num(); view_num <= proj_data.get_max_view_num(); ++view_num)
+        {
+          const Viewgram<float> viewgram = proj_data.get_viewgram(view_num, segment_num, false, timing_pos_num);
+          Bin bin(segment_num, view_num, 0, 0, timing_pos_num);
+          for (bin.axial_pos_num() = proj_data.get_min_axial_pos_num(segment_num);
+               bin.axial_pos_num() <= proj_data.get_max_axial_pos_num(segment_num);
+               ++bin.axial_pos_num())
+            for (bin.tangential_pos_num() = proj_data.get_min_tangential_pos_num();
+                 bin.tangential_pos_num() <= proj_data.get_max_tangential_pos_num();
+                 ++bin.tangential_pos_num())
+              {
+                proj_data_info_sptr->get_all_det_pos_pairs_for_bin(det_pos_pairs, bin);
+                float expected = 0.F;
+                for (const auto& det_pos_pair : det_pos_pairs)
+                  expected += efficiencies[det_pos_pair.pos1().axial_coord()][det_pos_pair.pos1().tangential_coord()]
+                              * efficiencies[det_pos_pair.pos2().axial_coord()][det_pos_pair.pos2().tangential_coord()];
+                expected *= factor;
+                if (!check_if_equal(viewgram[bin.axial_pos_num()][bin.tangential_pos_num()],
+                                    expected,
+                                    "multiply_crystal_factors for segment " + std::to_string(segment_num) + ", view "
+                                        + std::to_string(view_num) + ", TOF bin " + std::to_string(timing_pos_num)))
+                  return;
+              }
+        }
+}
+
 END_NAMESPACE_STIR
 
 USING_NAMESPACE_STIR
@@ -0,0 +1,268 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup test
+
+  \brief Test program for stir::ProjMatrixFileCache
+
+  \par Usage
+
+  <pre>
+  test_ProjMatrixFileCache SPECT_proj_data_filename
+  </pre>
+
+  Writes and reads elements for a view, checks that truncated or corrupt files are not used, and
+  checks that a different description uses a different directory. Finally, uses the projection data
+  info (for a reduced number of views and axial positions) to check that stir::ProjMatrixByBinSPECTUB
+  elements read from file are the same as freshly computed ones.
+
+  \author Kris Thielemans
+*/
+
+#include "stir/recon_buildblock/ProjMatrixFileCache.h"
+#include "stir/recon_buildblock/ProjMatrixByBinSPECTUB.h"
+#include "stir/ProjData.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/IndexRange3D.h"
+#include "stir/Coordinate3D.h"
+#include "stir/Bin.h"
+#include "stir/Succeeded.h"
+#include "stir/RunTests.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for ProjMatrixFileCache
+*/
+class ProjMatrixFileCacheTests : public RunTests
+{
+public:
+  explicit ProjMatrixFileCacheTests(const std::string& proj_data_filename)
+      : proj_data_filename(proj_data_filename)
+  {}
+  void run_tests() override;
+
+private:
+  std::string proj_data_filename;
+  //! check that truncated or corrupt files for \a view_num are not used
+  void run_tests_for_corrupt_files(const ProjMatrixFileCache& cache, const int view_num);
+  //! check that SPECTUB elements read from file are the same as computed ones
+  void run_tests_for_SPECTUB();
+};
+
+void
+ProjMatrixFileCacheTests::run_tests_for_corrupt_files(const ProjMatrixFileCache& cache, const int view_num)
+{
+  const std::string filename = cache.get_directory() + "/seg0_view" + std::to_string(view_num) + ".bin";
+  if (!check(std::filesystem::exists(filename), "file for view should exist"))
+    return;
+  std::string contents;
+  {
+    std::ifstream file(filename, std::ios::binary);
+    std::stringstream s;
+    s << file.rdbuf();
+    contents = s.str();
+  }
+  const auto restore_file = [&]() {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), contents.size());
+  };
+  const auto check_read_fails = [&](const std::string& str) {
+    std::vector<ProjMatrixElemsForOneBin> lors_read;
+    check(cache.read_view(lors_read, view_num) == Succeeded::no, "read_view for " + str);
+    check(lors_read.empty(), "read_view should not modify elements for " + str);
+  };
+
+  std::filesystem::resize_file(filename, contents.size() - 4);
+  check_read_fails("file with truncated elements");
+  std::filesystem::resize_file(filename, 10);
+  check_read_fails("file with truncated header");
+  std::filesystem::resize_file(filename, 0);
+  check_read_fails("empty file");
+
+  restore_file();
+  {
+    std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(0);
+    file.put('X');
+  }
+  check_read_fails("file with wrong signature");
+
+  restore_file();
+  {
+    // append some data
+    std::ofstream file(filename, std::ios::binary | std::ios::app);
+    file.write(contents.data(), 4);
+  }
+  check_read_fails("file with too much data");
+
+  restore_file();
+  std::vector<ProjMatrixElemsForOneBin> lors_read;
+  check(cache.read_view(lors_read, view_num) == Succeeded::yes, "read_view after restoring file");
+}
+
+void
+ProjMatrixFileCacheTests::run_tests_for_SPECTUB()
+{
+  std::cerr << "Testing SPECTUB matrix read from file\n";
+  const std::string cache_directory = "test_ProjMatrixFileCache_SPECTUB_dir";
+  std::filesystem::remove_all(cache_directory);
+
+  // reduce sizes to keep computation time down
+  shared_ptr<ProjDataInfo> proj_data_info_sptr(ProjData::read_from_file(proj_data_filename)->get_proj_data_info_sptr()->clone());
+  proj_data_info_sptr->set_num_views(6);
+  proj_data_info_sptr->set_min_axial_pos_num(0, 0);
+  proj_data_info_sptr->set_max_axial_pos_num(3, 0);
+  proj_data_info_sptr->set_min_tangential_pos_num(-16);
+  proj_data_info_sptr->set_max_tangential_pos_num(15);
+  const float voxel_size = proj_data_info_sptr->get_scanner_ptr()->get_default_bin_size();
+  shared_ptr<DiscretisedDensity<3, float>> density_sptr(
+      new VoxelsOnCartesianGrid<float>(IndexRange3D(0, proj_data_info_sptr->get_num_axial_poss(0) - 1, -16, 15, -16, 15),
+                                       CartesianCoordinate3D<float>(0.F, 0.F, 0.F),
+                                       CartesianCoordinate3D<float>(voxel_size, voxel_size, voxel_size)));
+
+  ProjMatrixByBinSPECTUB computed_matrix;
+  computed_matrix.set_up(proj_data_info_sptr, density_sptr);
+
+  {
+    // compute all views, writing them to file
+    ProjMatrixByBinSPECTUB matrix;
+    matrix.set_matrix_cache_directory(cache_directory);
+    matrix.set_up(proj_data_info_sptr, density_sptr);
+    ProjMatrixElemsForOneBin lor;
+    for (int view_num = proj_data_info_sptr->get_min_view_num(); view_num <= proj_data_info_sptr->get_max_view_num(); ++view_num)
+      matrix.get_proj_matrix_elems_for_one_bin(lor, Bin(0, view_num, 0, 0));
+  }
+
+  // find the directory used by the matrix, and use its description to read the files
+  std::string description;
+  std::string matrix_directory;
+  for (const auto& entry : std::filesystem::directory_iterator(cache_directory))
+    {
+      matrix_directory = entry.path().string();
+      std::ifstream file(entry.path() / "parameters.txt", std::ios::binary);
+      std::stringstream s;
+      s << file.rdbuf();
+      description = s.str();
+    }
+  ProjMatrixFileCache cache;
+  cache.set_up(cache_directory, "SPECTUB", description);
+  if (!check_if_equal(cache.get_directory(), matrix_directory, "directory for SPECTUB matrix"))
+    return;
+
+  ProjMatrixByBinSPECTUB matrix_from_file;
+  matrix_from_file.set_matrix_cache_directory(cache_directory);
+  matrix_from_file.set_up(proj_data_info_sptr, density_sptr);
+
+  for (int view_num = proj_data_info_sptr->get_min_view_num(); view_num <= proj_data_info_sptr->get_max_view_num(); ++view_num)
+    {
+      std::vector<ProjMatrixElemsForOneBin> lors;
+      if (!check(cache.read_view(lors, view_num) == Succeeded::yes, "read_view for SPECTUB view " + std::to_string(view_num)))
+        continue;
+      const int num_bins_in_view = proj_data_info_sptr->get_num_axial_poss(0) * proj_data_info_sptr->get_num_tangential_poss();
+      check_if_equal(lors.size(), static_cast<std::size_t>(num_bins_in_view), "number of bins in SPECTUB view");
+      for (const auto& lor : lors)
+        {
+          const Bin bin = lor.get_bin();
+          const std::string str = "SPECTUB elements for view " + std::to_string(view_num) + ", axial pos "
+                                  + std::to_string(bin.axial_pos_num()) + ", tangential pos "
+                                  + std::to_string(bin.tangential_pos_num());
+          ProjMatrixElemsForOneBin computed_lor;
+          computed_matrix.get_proj_matrix_elems_for_one_bin(computed_lor, bin);
+          check(computed_lor.size() > 0, str + " should not be empty");
+          check(lor == computed_lor, str + " read from file");
+          ProjMatrixElemsForOneBin lor_from_file;
+          matrix_from_file.get_proj_matrix_elems_for_one_bin(lor_from_file, bin);
+          check(lor_from_file == computed_lor, str + " via matrix using the cache");
+        }
+    }
+
+  std::filesystem::remove_all(cache_directory);
+}
+
+void
+ProjMatrixFileCacheTests::run_tests()
+{
+  const std::string cache_directory = "test_ProjMatrixFileCache_dir";
+  std::filesystem::remove_all(cache_directory);
+
+  ProjMatrixFileCache cache;
+  check(!cache.is_enabled(), "default constructor should disable the cache");
+  std::vector<ProjMatrixElemsForOneBin> lors;
+  check(cache.read_view(lors, 0) == Succeeded::no, "read_view when disabled");
+
+  cache.set_up(cache_directory, "test", "some parameters\n");
+  check(cache.is_enabled(), "set_up should enable the cache");
+  check(std::filesystem::exists(cache.get_directory() + "/parameters.txt"), "set_up should write parameters.txt");
+  check(!cache.has_view(3), "has_view before writing");
+
+  // construct some elements (including an empty bin)
+  for (int tang_pos_num = -2; tang_pos_num <= 2; ++tang_pos_num)
+    {
+      ProjMatrixElemsForOneBin lor(Bin(0, 3, 1, tang_pos_num));
+      for (int i = 0; i < (tang_pos_num + 2) * 3; ++i)
+        lor.push_back(ProjMatrixElemsForOneBin::value_type(Coordinate3D<int>(i, -tang_pos_num, i - 5), i * 1.5F + tang_pos_num));
+      lors.push_back(lor);
+    }
+  check(cache.write_view(lors, 3) == Succeeded::yes, "write_view");
+  check(cache.has_view(3), "has_view after writing");
+
+  {
+    // read in another object, as if in another process
+    ProjMatrixFileCache cache2;
+    cache2.set_up(cache_directory, "test", "some parameters\n");
+    check_if_equal(cache2.get_directory(), cache.get_directory(), "same description should give same directory");
+    std::vector<ProjMatrixElemsForOneBin> lors_read;
+    check(cache2.read_view(lors_read, 3) == Succeeded::yes, "read_view");
+    if (check_if_equal(lors_read.size(), lors.size(), "number of bins read"))
+      for (std::size_t b = 0; b < lors.size(); ++b)
+        {
+          check(lors_read[b].get_bin() == lors[b].get_bin(), "bin read");
+          check(lors_read[b] == lors[b], "elements read for bin " + std::to_string(b));
+        }
+    check(cache2.read_view(lors_read, 4) == Succeeded::no, "read_view for a view that was not written");
+  }
+  run_tests_for_corrupt_files(cache, 3);
+  {
+    ProjMatrixFileCache cache2;
+    cache2.set_up(cache_directory, "test", "other parameters\n");
+    check(cache2.is_enabled(), "set_up with other description");
+    check(cache2.get_directory() != cache.get_directory(), "other description should give other directory");
+    check(!cache2.has_view(3), "has_view for other description");
+  }
+
+  std::filesystem::remove_all(cache_directory);
+
+  run_tests_for_SPECTUB();
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main(int argc, char** argv)
+{
+  if (argc != 2)
+    {
+      std::cerr << "Usage: " << argv[0] << " SPECT_proj_data_filename\n";
+      return EXIT_FAILURE;
+    }
+  ProjMatrixFileCacheTests tests(argv[1]);
+  tests.run_tests();
+  return tests.main_return_value();
+}
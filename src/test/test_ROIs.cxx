@@ -37,6 +37,7 @@
 #include "stir/Shape/DiscretisedShape3D.h"
 #include "stir/evaluation/ROIValues.h"
 #include "stir/evaluation/compute_ROI_values.h"
+#include "stir/evaluation/SparseROIMask.h"
 #include "stir/IndexRange.h"
 #include "stir/RunTests.h"
 #include "stir/is_null_ptr.h"
@@ -47,6 +48,7 @@
 #  include "stir/display.h"
 #endif
 #include <iostream>
+#include <vector>
 
 START_NAMESPACE_STIR
 
@@ -80,6 +82,9 @@ private:
                            VoxelsOnCartesianGrid<float>& image,
                            const bool do_rotated_ROI_test = true,
                            const bool do_separate_translate_test = true);
+
+  //! Test computing ROI values for multiple masks (constructed from a label image) in one pass
+  void run_tests_multiple_masks(const VoxelsOnCartesianGrid<float>& label_image);
 };
 
 void
@@ -248,6 +253,69 @@ ROITests::run_tests_one_shape(Shape3D& shape,
       display(image2, image2.find_max(), "(image corresponding to rotated and scaled (x,y) shape)*2 - (original shape) + 1");
 #endif
     }
+
+  // test sub-sampling, bounding box and SparseROIMask
+  if (dynamic_cast<DiscretisedShape3D const*>(&shape) == 0)
+    {
+      const CartesianCoordinate3D<int> num_samples(2, 3, 4);
+      VoxelsOnCartesianGrid<float> discretised_shape(image.get_index_range(), image.get_origin(), voxel_size);
+      shape.construct_volume(discretised_shape, num_samples);
+
+      CartesianCoordinate3D<float> min_coord, max_coord;
+      if (shape.get_bounding_box(min_coord, max_coord) == Succeeded::yes)
+        {
+          bool all_inside_box = true;
+          for (int z = discretised_shape.get_min_z(); z <= discretised_shape.get_max_z(); ++z)
+            for (int y = discretised_shape.get_min_y(); y <= discretised_shape.get_max_y(); ++y)
+              for (int x = discretised_shape.get_min_x(); x <= discretised_shape.get_max_x(); ++x)
+                {
+                  if (discretised_shape[z][y][x] == 0)
+                    continue;
+                  const CartesianCoordinate3D<float> coord
+                      = CartesianCoordinate3D<float>(static_cast<float>(z), static_cast<float>(y), static_cast<float>(x))
+                            * voxel_size
+                        + image.get_origin();
+                  for (int d = 1; d <= 3; ++d)
+                    if (coord[d] < min_coord[d] - voxel_size[d] / 2 || coord[d] > max_coord[d] + voxel_size[d] / 2)
+                      all_inside_box = false;
+                }
+          check(all_inside_box, "all voxels of the discretised shape should be inside the bounding box");
+        }
+
+      // compare voxel weights with the generic (sampling) implementation
+      {
+        // allow for 1 sample (out of 2*3*4) to differ due to floating point rounding
+        const double old_tolerance = get_tolerance();
+        set_tolerance(1.5 / 24);
+        for (int z = discretised_shape.get_min_z(); z <= discretised_shape.get_max_z(); ++z)
+          for (int y = discretised_shape.get_min_y(); y <= discretised_shape.get_max_y(); ++y)
+            for (int x = discretised_shape.get_min_x(); x <= discretised_shape.get_max_x(); ++x)
+              {
+                const float weight = discretised_shape[z][y][x];
+                if (weight == 0 || weight == 1)
+                  continue;
+                const CartesianCoordinate3D<float> centre
+                    = CartesianCoordinate3D<float>(static_cast<float>(z), static_cast<float>(y), static_cast<float>(x))
+                          * voxel_size
+                      + image.get_origin();
+                check_if_equal(shape.Shape3D::get_voxel_weight(centre, voxel_size, num_samples),
+                               weight,
+                               "voxel weight compared to generic Shape3D implementation");
+              }
+        set_tolerance(old_tolerance);
+      }
+
+      const SparseROIMask mask(shape, image, num_samples);
+      check(mask.is_compatible_with(image), "SparseROIMask should be compatible with its template");
+      const ROIValues ROI_values_dense = compute_total_ROI_values(image, discretised_shape);
+      const ROIValues ROI_values_mask = compute_total_ROI_values(image, mask);
+      check_if_equal(ROI_values_mask.get_mean(), ROI_values_dense.get_mean(), "ROI mean with SparseROIMask");
+      check_if_equal(ROI_values_mask.get_stddev(), ROI_values_dense.get_stddev(), "ROI stddev with SparseROIMask");
+      check_if_equal(ROI_values_mask.get_roi_volume(), ROI_values_dense.get_roi_volume(), "ROI volume with SparseROIMask");
+      check_if_equal(ROI_values_mask.get_max(), ROI_values_dense.get_max(), "ROI max with SparseROIMask");
+      check_if_equal(ROI_values_mask.get_min(), ROI_values_dense.get_min(), "ROI min with SparseROIMask");
+    }
+
   // test on parsing
   if (dynamic_cast<DiscretisedShape3D const*>(&shape) == 0)
     {
@@ -271,6 +339,45 @@ ROITests::run_tests_one_shape(Shape3D& shape,
     }
 }
 
+void
+ROITests::run_tests_multiple_masks(const VoxelsOnCartesianGrid<float>& label_image)
+{
+  const std::vector<int> labels{ 2, 1, 7 };
+  const std::vector<SparseROIMask> masks = SparseROIMask::construct_from_label_image(label_image, labels);
+  if (!check_if_equal(masks.size(), labels.size(), "number of masks constructed from label image"))
+    return;
+  check_if_equal(masks[2].get_num_voxels(), std::size_t(0), "mask for a label that does not occur in the label image");
+
+  // an image with varying values
+  VoxelsOnCartesianGrid<float> image(label_image);
+  for (int z = image.get_min_z(); z <= image.get_max_z(); ++z)
+    for (int y = image.get_min_y(); y <= image.get_max_y(); ++y)
+      for (int x = image.get_min_x(); x <= image.get_max_x(); ++x)
+        image[z][y][x] = 1.F + z + .1F * y - .05F * x;
+
+  std::vector<ROIValues> values;
+  compute_total_ROI_values(values, image, masks);
+  if (!check_if_equal(values.size(), labels.size(), "number of ROI values"))
+    return;
+  for (std::size_t mask_num = 0; mask_num < masks.size(); ++mask_num)
+    {
+      // compare with a dense 0/1 image for this label
+      VoxelsOnCartesianGrid<float> discretised_shape(label_image);
+      for (int z = image.get_min_z(); z <= image.get_max_z(); ++z)
+        for (int y = image.get_min_y(); y <= image.get_max_y(); ++y)
+          for (int x = image.get_min_x(); x <= image.get_max_x(); ++x)
+            discretised_shape[z][y][x] = label_image[z][y][x] == labels[mask_num] ? 1.F : 0.F;
+      const ROIValues dense_values = compute_total_ROI_values(image, discretised_shape);
+      const ROIValues single_mask_values = compute_total_ROI_values(image, masks[mask_num]);
+      check_if_equal(values[mask_num].get_roi_volume(), dense_values.get_roi_volume(), "ROI volume for multiple masks");
+      check_if_equal(values[mask_num].get_mean(), dense_values.get_mean(), "ROI mean for multiple masks");
+      check_if_equal(values[mask_num].get_stddev(), dense_values.get_stddev(), "ROI stddev for multiple masks");
+      check_if_equal(values[mask_num].get_mean(), single_mask_values.get_mean(), "ROI mean for multiple vs single mask");
+      check_if_equal(values[mask_num].get_min(), single_mask_values.get_min(), "ROI min for multiple vs single mask");
+      check_if_equal(values[mask_num].get_max(), single_mask_values.get_max(), "ROI max for multiple vs single mask");
+    }
+}
+
 void
 ROITests::run_tests()
 
@@ -372,6 +479,15 @@ ROITests::run_tests()
       discretised_shape.set_label_index(2);
       this->run_tests_one_shape(discretised_shape, image, false, false);
     }
+    // need to fill in image again, as the tests change it
+    ellipsoid.construct_volume(image, make_coordinate(1, 1, 1));
+    {
+      std::cerr << "\t\tmultiple masks from label image\n";
+      VoxelsOnCartesianGrid<float> label_image(image);
+      // label 1 for the ellipsoid, label 2 for the first plane (outside the ellipsoid)
+      label_image[label_image.get_min_z()].fill(2.F);
+      this->run_tests_multiple_masks(label_image);
+    }
   }
 }
 
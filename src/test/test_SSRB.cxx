@@ -0,0 +1,305 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup test
+
+  \brief Test program for stir::SSRB and stir::inverse_SSRB
+
+  Compares the results with straightforward implementations that handle one output sinogram
+  at a time. This is done for span, view mashing, tangential trimming and TOF mashing.
+
+  \author Kris Thielemans
+*/
+
+#include "stir/SSRB.h"
+#include "stir/inverse_SSRB.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataInfoCylindrical.h"
+#include "stir/ExamInfo.h"
+#include "stir/Scanner.h"
+#include "stir/Sinogram.h"
+#include "stir/Bin.h"
+#include "stir/Succeeded.h"
+#include "stir/RunTests.h"
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <boost/format.hpp>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for SSRB and inverse_SSRB
+*/
+class SSRBTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  shared_ptr<ExamInfo> exam_info_sptr;
+
+  //! fill with random values
+  static void fill_random(ProjData& proj_data);
+  //! straightforward SSRB, finding the contributing input sinograms for every output sinogram
+  static void reference_SSRB(ProjData& out_proj_data, const ProjData& in_proj_data, const bool do_norm);
+  //! straightforward inverse_SSRB, interpolating the direct sinograms for every output sinogram
+  static void reference_inverse_SSRB(ProjData& proj_data_4D, const ProjData& proj_data_3D);
+
+  void run_SSRB_test(const ProjDataInMemory& in_proj_data,
+                     const int num_segments_to_combine,
+                     const int num_views_to_combine,
+                     const int num_tangential_poss_to_trim,
+                     const int num_tof_bins_to_combine);
+  void run_inverse_SSRB_test(const ProjDataInMemory& proj_data_3D, const shared_ptr<const ProjDataInfo>& proj_data_info_4D_sptr);
+};
+
+void
+SSRBTests::fill_random(ProjData& proj_data)
+{
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> distribution(0.F, 1.F);
+  for (int timing_pos_num = proj_data.get_min_tof_pos_num(); timing_pos_num <= proj_data.get_max_tof_pos_num(); ++timing_pos_num)
+    for (int segment_num = proj_data.get_min_segment_num(); segment_num <= proj_data.get_max_segment_num(); ++segment_num)
+      for (int ax_pos_num = proj_data.get_min_axial_pos_num(segment_num); ax_pos_num <= proj_data.get_max_axial_pos_num(segment_num);
+           ++ax_pos_num)
+        {
+          Sinogram<float> sinogram = proj_data.get_empty_sinogram(ax_pos_num, segment_num, false, timing_pos_num);
+          for (auto iter = sinogram.begin_all(); iter != sinogram.end_all(); ++iter)
+            *iter = distribution(generator);
+          proj_data.set_sinogram(sinogram);
+        }
+}
+
+void
+SSRBTests::reference_SSRB(ProjData& out_proj_data, const ProjData& in_proj_data, const bool do_norm)
+{
+  const auto& in_proj_data_info = dynamic_cast<const ProjDataInfoCylindrical&>(*in_proj_data.get_proj_data_info_sptr());
+  const auto& out_proj_data_info = dynamic_cast<const ProjDataInfoCylindrical&>(*out_proj_data.get_proj_data_info_sptr());
+  const int num_views_to_combine = in_proj_data.get_num_views() / out_proj_data.get_num_views();
+  const int min_tangential_pos_num
+      = std::max(in_proj_data.get_min_tangential_pos_num(), out_proj_data.get_min_tangential_pos_num());
+  const int max_tangential_pos_num
+      = std::min(in_proj_data.get_max_tangential_pos_num(), out_proj_data.get_max_tangential_pos_num());
+
+  for (int out_segment_num = out_proj_data.get_min_segment_num(); out_segment_num <= out_proj_data.get_max_segment_num();
+       ++out_segment_num)
+    for (int out_timing_pos_num = out_proj_data.get_min_tof_pos_num(); out_timing_pos_num <= out_proj_data.get_max_tof_pos_num();
+         ++out_timing_pos_num)
+      for (int out_ax_pos_num = out_proj_data.get_min_axial_pos_num(out_segment_num);
+           out_ax_pos_num <= out_proj_data.get_max_axial_pos_num(out_segment_num);
+           ++out_ax_pos_num)
+        {
+          const Bin out_bin(out_segment_num, 0, out_ax_pos_num, 0, out_timing_pos_num);
+          Sinogram<float> out_sino = out_proj_data.get_empty_sinogram(out_bin);
+          const float out_m = out_proj_data_info.get_m(out_bin);
+          const float out_lower_k = out_proj_data_info.is_tof_data()
+                                        ? out_proj_data_info.get_k(out_bin) - out_proj_data_info.get_sampling_in_k(out_bin) / 2
+                                        : -std::numeric_limits<float>::max();
+          const float out_higher_k = out_proj_data_info.is_tof_data()
+                                         ? out_proj_data_info.get_k(out_bin) + out_proj_data_info.get_sampling_in_k(out_bin) / 2
+                                         : std::numeric_limits<float>::max();
+          int num_in_ax_pos = 0;
+          for (int in_segment_num = in_proj_data.get_min_segment_num(); in_segment_num <= in_proj_data.get_max_segment_num();
+               ++in_segment_num)
+            {
+              if (in_proj_data_info.get_min_ring_difference(in_segment_num)
+                      < out_proj_data_info.get_min_ring_difference(out_segment_num)
+                  || in_proj_data_info.get_max_ring_difference(in_segment_num)
+                         > out_proj_data_info.get_max_ring_difference(out_segment_num))
+                continue;
+              for (int in_ax_pos_num = in_proj_data.get_min_axial_pos_num(in_segment_num);
+                   in_ax_pos_num <= in_proj_data.get_max_axial_pos_num(in_segment_num);
+                   ++in_ax_pos_num)
+                {
+                  if (std::fabs(in_proj_data_info.get_m(Bin(in_segment_num, 0, in_ax_pos_num, 0)) - out_m) >= 1E-4)
+                    continue;
+                  ++num_in_ax_pos;
+                  for (int in_timing_pos_num = in_proj_data.get_min_tof_pos_num();
+                       in_timing_pos_num <= in_proj_data.get_max_tof_pos_num();
+                       ++in_timing_pos_num)
+                    {
+                      const Bin in_bin(in_segment_num, 0, in_ax_pos_num, 0, in_timing_pos_num);
+                      const float in_k = in_proj_data_info.get_k(in_bin);
+                      if (in_k < out_lower_k || in_k >= out_higher_k)
+                        continue;
+                      const Sinogram<float> in_sino = in_proj_data.get_sinogram(in_bin);
+                      for (int view_num = in_proj_data.get_min_view_num(); view_num <= in_proj_data.get_max_view_num(); ++view_num)
+                        for (int tangential_pos_num = min_tangential_pos_num; tangential_pos_num <= max_tangential_pos_num;
+                             ++tangential_pos_num)
+                          out_sino[view_num / num_views_to_combine][tangential_pos_num] += in_sino[view_num][tangential_pos_num];
+                    }
+                }
+            }
+          if (do_norm && num_in_ax_pos != 0)
+            out_sino /= static_cast<float>(num_in_ax_pos * num_views_to_combine);
+          out_proj_data.set_sinogram(out_sino);
+        }
+}
+
+void
+SSRBTests::reference_inverse_SSRB(ProjData& proj_data_4D, const ProjData& proj_data_3D)
+{
+  const ProjDataInfo& proj_data_info_3D = *proj_data_3D.get_proj_data_info_sptr();
+  const ProjDataInfo& proj_data_info_4D = *proj_data_4D.get_proj_data_info_sptr();
+  const int min_in_ax_pos_num = proj_data_3D.get_min_axial_pos_num(0);
+  const int max_in_ax_pos_num = proj_data_3D.get_max_axial_pos_num(0);
+
+  for (int segment_num = proj_data_4D.get_min_segment_num(); segment_num <= proj_data_4D.get_max_segment_num(); ++segment_num)
+    for (int ax_pos_num = proj_data_4D.get_min_axial_pos_num(segment_num); ax_pos_num <= proj_data_4D.get_max_axial_pos_num(segment_num);
+         ++ax_pos_num)
+      for (int timing_pos_num = proj_data_4D.get_min_tof_pos_num(); timing_pos_num <= proj_data_4D.get_max_tof_pos_num();
+           ++timing_pos_num)
+        {
+          const float out_m = proj_data_info_4D.get_m(Bin(segment_num, 0, ax_pos_num, 0));
+          // find the closest direct sinogram, and its closest neighbour
+          int closest_ax_pos_num = min_in_ax_pos_num;
+          for (int in_ax_pos_num = min_in_ax_pos_num + 1; in_ax_pos_num <= max_in_ax_pos_num; ++in_ax_pos_num)
+            if (std::abs(out_m - proj_data_info_3D.get_m(Bin(0, 0, in_ax_pos_num, 0)))
+                < std::abs(out_m - proj_data_info_3D.get_m(Bin(0, 0, closest_ax_pos_num, 0))))
+              closest_ax_pos_num = in_ax_pos_num;
+          const float distance_to_closest = std::abs(out_m - proj_data_info_3D.get_m(Bin(0, 0, closest_ax_pos_num, 0)));
+          Sinogram<float> sino_4D = proj_data_4D.get_empty_sinogram(ax_pos_num, segment_num, false, timing_pos_num);
+          Sinogram<float> sino_3D = proj_data_3D.get_sinogram(closest_ax_pos_num, 0, false, timing_pos_num);
+          if (distance_to_closest <= 1E-4)
+            sino_4D += sino_3D;
+          else
+            {
+              const float distance_to_previous
+                  = closest_ax_pos_num == min_in_ax_pos_num
+                        ? std::numeric_limits<float>::max()
+                        : std::abs(out_m - proj_data_info_3D.get_m(Bin(0, 0, closest_ax_pos_num - 1, 0)));
+              const float distance_to_next
+                  = closest_ax_pos_num == max_in_ax_pos_num
+                        ? std::numeric_limits<float>::max()
+                        : std::abs(out_m - proj_data_info_3D.get_m(Bin(0, 0, closest_ax_pos_num + 1, 0)));
+              const int other_ax_pos_num = distance_to_previous < distance_to_next ? closest_ax_pos_num - 1 : closest_ax_pos_num + 1;
+              const float distance_to_other = std::min(distance_to_previous, distance_to_next);
+              const float distance_sum = distance_to_closest + distance_to_other;
+              Sinogram<float> other_sino_3D = proj_data_3D.get_sinogram(other_ax_pos_num, 0, false, timing_pos_num);
+              // linear interpolation: the weight of a sinogram is the distance to the other one
+              other_sino_3D.sapyb(distance_to_closest / distance_sum, sino_3D, distance_to_other / distance_sum);
+              sino_4D += other_sino_3D;
+            }
+          proj_data_4D.set_sinogram(sino_4D);
+        }
+}
+
+void
+SSRBTests::run_SSRB_test(const ProjDataInMemory& in_proj_data,
+                         const int num_segments_to_combine,
+                         const int num_views_to_combine,
+                         const int num_tangential_poss_to_trim,
+                         const int num_tof_bins_to_combine)
+{
+  const std::string str = boost::str(boost::format("segments %1%, views %2%, trim %3%, TOF bins %4%") % num_segments_to_combine
+                                     % num_views_to_combine % num_tangential_poss_to_trim % num_tof_bins_to_combine);
+  std::cerr << "Testing SSRB combining " << str << "\n";
+  shared_ptr<const ProjDataInfo> out_proj_data_info_sptr(SSRB(*in_proj_data.get_proj_data_info_sptr(),
+                                                               num_segments_to_combine,
+                                                               num_views_to_combine,
+                                                               num_tangential_poss_to_trim,
+                                                               /*max_in_segment_num_to_process*/ -1,
+                                                               num_tof_bins_to_combine));
+  for (int do_norm = 0; do_norm <= 1; ++do_norm)
+    {
+      ProjDataInMemory out_proj_data(exam_info_sptr, out_proj_data_info_sptr);
+      SSRB(out_proj_data, in_proj_data, do_norm != 0);
+      ProjDataInMemory reference_out_proj_data(exam_info_sptr, out_proj_data_info_sptr);
+      reference_SSRB(reference_out_proj_data, in_proj_data, do_norm != 0);
+      check(reference_out_proj_data.find_max() > 0, "reference SSRB should not be zero for " + str);
+      check_if_equal(reference_out_proj_data, out_proj_data, (do_norm ? "SSRB with normalisation for " : "SSRB for ") + str);
+    }
+}
+
+void
+SSRBTests::run_inverse_SSRB_test(const ProjDataInMemory& proj_data_3D,
+                                 const shared_ptr<const ProjDataInfo>& proj_data_info_4D_sptr)
+{
+  std::cerr << "Testing inverse_SSRB " << (proj_data_3D.get_proj_data_info_sptr()->is_tof_data() ? "with TOF" : "without TOF")
+            << "\n";
+  ProjDataInMemory proj_data_4D(exam_info_sptr, proj_data_info_4D_sptr);
+  check(inverse_SSRB(proj_data_4D, proj_data_3D) == Succeeded::yes, "inverse_SSRB should succeed");
+  ProjDataInMemory reference_proj_data_4D(exam_info_sptr, proj_data_info_4D_sptr);
+  reference_inverse_SSRB(reference_proj_data_4D, proj_data_3D);
+  check_if_equal(reference_proj_data_4D, proj_data_4D, "inverse_SSRB");
+}
+
+void
+SSRBTests::run_tests()
+{
+  exam_info_sptr = std::make_shared<ExamInfo>(ImagingModality::PT);
+
+  // TOF version of a small scanner
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E953));
+  scanner_sptr->set_max_num_timing_poss(15);
+  scanner_sptr->set_size_of_timing_poss(100.F);
+  scanner_sptr->set_timing_resolution(500.F);
+  const int num_views = scanner_sptr->get_num_detectors_per_ring() / 4;
+  const int num_tangential_poss = 64;
+  const int max_delta = scanner_sptr->get_num_rings() - 1;
+
+  {
+    shared_ptr<const ProjDataInfo> proj_data_info_sptr(
+        ProjDataInfo::construct_proj_data_info(scanner_sptr, /*span*/ 1, max_delta, num_views, num_tangential_poss, false));
+    ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+    fill_random(proj_data);
+    // span
+    run_SSRB_test(proj_data, 3, 1, 0, 1);
+    // view mashing and tangential trimming
+    run_SSRB_test(proj_data, 1, 2, 10, 1);
+    // all of them, and adding tangential positions
+    run_SSRB_test(proj_data, 5, 4, -4, 1);
+
+    // direct sinograms after SSRB sample the axial direction at half the ring spacing, so no interpolation is needed
+    shared_ptr<const ProjDataInfo> proj_data_info_3D_sptr(SSRB(*proj_data_info_sptr, 2 * max_delta + 1));
+    ProjDataInMemory proj_data_3D(exam_info_sptr, proj_data_info_3D_sptr);
+    SSRB(proj_data_3D, proj_data);
+    run_inverse_SSRB_test(proj_data_3D, proj_data_info_sptr);
+    // direct sinograms of span 1 data only, such that oblique sinograms of odd ring difference are interpolated
+    shared_ptr<const ProjDataInfo> proj_data_info_direct_sptr(
+        ProjDataInfo::construct_proj_data_info(scanner_sptr, /*span*/ 1, /*max_delta*/ 0, num_views, num_tangential_poss, false));
+    ProjDataInMemory proj_data_direct(exam_info_sptr, proj_data_info_direct_sptr);
+    fill_random(proj_data_direct);
+    run_inverse_SSRB_test(proj_data_direct, proj_data_info_sptr);
+  }
+  {
+    shared_ptr<const ProjDataInfo> proj_data_info_sptr(ProjDataInfo::construct_proj_data_info(
+        scanner_sptr, /*span*/ 1, max_delta, num_views, num_tangential_poss, false, /*tof_mash_factor*/ 1));
+    ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+    fill_random(proj_data);
+    // TOF mashing
+    run_SSRB_test(proj_data, 1, 1, 0, 3);
+    run_SSRB_test(proj_data, 3, 2, 6, 5);
+    // keeping TOF bins
+    run_SSRB_test(proj_data, 3, 1, 0, 1);
+
+    shared_ptr<const ProjDataInfo> proj_data_info_direct_sptr(ProjDataInfo::construct_proj_data_info(
+        scanner_sptr, /*span*/ 1, /*max_delta*/ 0, num_views, num_tangential_poss, false, /*tof_mash_factor*/ 1));
+    ProjDataInMemory proj_data_direct(exam_info_sptr, proj_data_info_direct_sptr);
+    fill_random(proj_data_direct);
+    run_inverse_SSRB_test(proj_data_direct, proj_data_info_sptr);
+  }
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  SSRBTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
@@ -2,7 +2,7 @@
 //
 /*
     Copyright (C) 2019, University of Hull
-    Copyright (C) 2020, University College London
+    Copyright (C) 2020, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -72,6 +72,8 @@ private:
   void test_scatter_simulation();
 
   void test_symmetric(ScatterSimulation& sss, const std::string& name);
+  //! Check that cached activity integrals are only kept when the activity image changed a little
+  void test_activity_integrals_tolerance(ScatterSimulation& sss, const shared_ptr<VoxelsOnCartesianGrid<float>>& act_density_sptr);
   void test_output_is_symmetric(const ProjData& proj_data, const std::string& name);
 };
 
@@ -285,6 +287,42 @@ ScatterSimulationTests::test_symmetric(ScatterSimulation& ss, const std::string&
     sss_output->write_to_file("my_single_scatter_sim_" + name + ".hs");
 }
 
+void
+ScatterSimulationTests::test_activity_integrals_tolerance(ScatterSimulation& ss,
+                                                          const shared_ptr<VoxelsOnCartesianGrid<float>>& act_density_sptr)
+{
+  ss.set_activity_image_sptr(act_density_sptr);
+  shared_ptr<ProjDataInMemory> sss_output(new ProjDataInMemory(ss.get_exam_info_sptr(), ss.get_template_proj_data_info_sptr()));
+  ss.set_output_proj_data_sptr(sss_output);
+  ss.set_activity_integrals_tolerance(.01F);
+
+  check(ss.set_up() == Succeeded::yes, "activity integrals tolerance: set_up");
+  check(ss.process_data() == Succeeded::yes, "activity integrals tolerance: process_data");
+  const SegmentBySinogram<float> org_seg = sss_output->get_segment_by_sinogram(0);
+
+  // small change: cached integrals should be used, so the output should not change at all
+  *act_density_sptr *= 1.001F;
+  ss.set_activity_image_sptr(act_density_sptr);
+  check(ss.set_up() == Succeeded::yes, "activity integrals tolerance: set_up after small change");
+  check(ss.process_data() == Succeeded::yes, "activity integrals tolerance: process_data after small change");
+  check(sss_output->get_segment_by_sinogram(0) == org_seg, "activity integrals tolerance: output after small change");
+
+  // large change: integrals should be recomputed
+  SegmentBySinogram<float> scaled_org_seg = org_seg;
+  scaled_org_seg *= 2.F * 1000;
+  *act_density_sptr *= 2.F;
+  ss.set_activity_image_sptr(act_density_sptr);
+  check(ss.set_up() == Succeeded::yes, "activity integrals tolerance: set_up after large change");
+  check(ss.process_data() == Succeeded::yes, "activity integrals tolerance: process_data after large change");
+  SegmentBySinogram<float> new_seg = sss_output->get_segment_by_sinogram(0);
+  new_seg *= 1000; // see test_output_is_symmetric
+  check_if_equal(new_seg, scaled_org_seg, "activity integrals tolerance: output after large change");
+
+  *act_density_sptr /= 2.002F;
+  ss.set_activity_integrals_tolerance(0.F);
+  ss.set_activity_image_sptr(act_density_sptr);
+}
+
 void
 ScatterSimulationTests::test_output_is_symmetric(const ProjData& proj_data, const std::string& name)
 {
@@ -469,6 +507,8 @@ ScatterSimulationTests::test_scatter_simulation()
   }
 #endif
 
+  test_activity_integrals_tolerance(*sss, act_density);
+
   //    shared_ptr<ProjDataInMemory> atten_sino(new ProjDataInMemory(exam, output_projdata_info));
   //    atten_sino->fill(1.F);
   //    shared_ptr<ProjDataInMemory> act_sino(new ProjDataInMemory(exam, output_projdata_info));
@@ -2,7 +2,7 @@
 //
 /*
   Copyright 2023, Positrigo AG, Zurich
-  Copyright 2024, University College London
+  Copyright 2024, 2026, University College London
   This file is part of STIR.
 
   SPDX-License-Identifier: Apache-2.0
@@ -29,6 +29,8 @@
 #include "stir/ProjDataInfo.h"
 #include "stir/ExamInfo.h"
 #include "stir/ProjDataInMemory.h"
+#include "stir/SegmentBySinogram.h"
+#include "stir/Scanner.h"
 #include "stir/Succeeded.h"
 #include "stir/IO/write_data.h"
 #include "stir/IO/read_data.h"
@@ -44,6 +46,8 @@
 #include "stir/scatter/SingleScatterSimulation.h"
 
 #include "stir/RunTests.h"
+#include <cmath>
+#include <string>
 
 START_NAMESPACE_STIR
 
@@ -59,6 +63,7 @@ private:
   void scatter_interpolation_test_cyl_asymmetric();
   void scatter_interpolation_test_blocks_downsampled();
   void transaxial_upsampling_interpolation_test_blocks();
+  void interpolation_test_TOF();
 
   void check_symmetry(const SegmentBySinogram<float>& segment);
   void compare_segment(const SegmentBySinogram<float>& segment1, const SegmentBySinogram<float>& segment2, float maxDiff);
@@ -952,6 +957,53 @@ InterpolationTests::transaxial_upsampling_interpolation_test_blocks()
   info(boost::format("A total of %1% LORs were compared between the downsampled and the interpolated sinogram.") % tested_LORs);
 }
 
+void
+InterpolationTests::interpolation_test_TOF()
+{
+  info("Performing interpolation test for TOF data");
+  // interpolating TOF data (where TOF bins are processed in parallel) should give the same result as
+  // interpolating every TOF bin on its own
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::PETMR_Signa));
+  const int tof_mash_factor = 39;
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr, 1, 0, 112, 128, false, tof_mash_factor));
+  shared_ptr<const ProjDataInfo> downsampled_proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr, 1, 0, 28, 32, false, tof_mash_factor));
+  shared_ptr<const ProjDataInfo> non_TOF_proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr, 1, 0, 112, 128, false));
+  shared_ptr<const ProjDataInfo> non_TOF_downsampled_proj_data_info_sptr(
+      ProjDataInfo::construct_proj_data_info(scanner_sptr, 1, 0, 28, 32, false));
+  auto exam_info_sptr = std::make_shared<ExamInfo>(ImagingModality::PT);
+
+  ProjDataInMemory downsampled_proj_data(exam_info_sptr, downsampled_proj_data_info_sptr);
+  for (int k = downsampled_proj_data.get_min_tof_pos_num(); k <= downsampled_proj_data.get_max_tof_pos_num(); ++k)
+    {
+      auto segment = downsampled_proj_data.get_empty_segment_by_sinogram(0, false, k);
+      for (int ax = segment.get_min_axial_pos_num(); ax <= segment.get_max_axial_pos_num(); ++ax)
+        for (int view = segment.get_min_view_num(); view <= segment.get_max_view_num(); ++view)
+          for (int tang = segment.get_min_tangential_pos_num(); tang <= segment.get_max_tangential_pos_num(); ++tang)
+            segment[ax][view][tang] = (k + 10) * (1 + 0.01F * ax + 0.1F * std::sin(view * 0.2F) + 0.001F * tang * tang);
+      downsampled_proj_data.set_segment(segment);
+    }
+
+  ProjDataInMemory proj_data(exam_info_sptr, proj_data_info_sptr);
+  check(interpolate_projdata(proj_data, downsampled_proj_data, BSpline::cubic, false) == Succeeded::yes,
+        "interpolate_projdata for TOF data");
+
+  for (int k = proj_data.get_min_tof_pos_num(); k <= proj_data.get_max_tof_pos_num(); ++k)
+    {
+      ProjDataInMemory non_TOF_downsampled_proj_data(exam_info_sptr, non_TOF_downsampled_proj_data_info_sptr);
+      const Array<3, float> downsampled_segment = downsampled_proj_data.get_segment_by_sinogram(0, k);
+      non_TOF_downsampled_proj_data.set_segment(
+          SegmentBySinogram<float>(downsampled_segment, non_TOF_downsampled_proj_data_info_sptr, 0));
+      ProjDataInMemory non_TOF_proj_data(exam_info_sptr, non_TOF_proj_data_info_sptr);
+      interpolate_projdata(non_TOF_proj_data, non_TOF_downsampled_proj_data, BSpline::cubic, false);
+      const Array<3, float> expected = non_TOF_proj_data.get_segment_by_sinogram(0);
+      const Array<3, float> result = proj_data.get_segment_by_sinogram(0, k);
+      check_if_equal(result, expected, "TOF bin " + std::to_string(k) + " should be interpolated as non-TOF data");
+    }
+}
+
 void
 InterpolationTests::run_tests()
 {
@@ -961,6 +1013,7 @@ InterpolationTests::run_tests()
   scatter_interpolation_test_cyl_asymmetric();
   scatter_interpolation_test_blocks_downsampled();
   transaxial_upsampling_interpolation_test_blocks();
+  interpolation_test_TOF();
 }
 
 END_NAMESPACE_STIR
@@ -17,7 +17,7 @@
 /*
     Copyright (C) 2000 PARAPET partners
     Copyright (C) 2000- 2011, Hammersmith Imanet Ltd
-    Copyright (C) 2018, 2021, 2022, University College London
+    Copyright (C) 2018, 2021, 2022, 2026, University College London
     Copyright (C) 2018, University of Leeds
     Copyright (C) 2021, National Physical Laboratory
     This file is part of STIR.
@@ -29,6 +29,7 @@
 
 #include "stir/ProjDataInfoCylindricalArcCorr.h"
 #include "stir/ProjDataInfoCylindricalNoArcCorr.h"
+#include "stir/DetPairViewTangPosLookupTable.h"
 #include "stir/LORCoordinates.h"
 #include "stir/ProjDataInfo.h"
 #include "stir/ProjDataInfoBlocksOnCylindricalNoArcCorr.h"
@@ -1192,12 +1193,44 @@ public:
 
 private:
   void test_proj_data_info(ProjDataInfoCylindricalNoArcCorr& proj_data_info);
+  void test_det_pair_lookup_table();
 };
 
+void
+ProjDataInfoCylindricalNoArcCorrTests::test_det_pair_lookup_table()
+{
+  cerr << "\n\tTest sharing of detector-pair look-up tables.";
+
+  const int num_detectors = 24;
+  shared_ptr<const DetPairViewTangPosLookupTable> table_sptr = DetPairViewTangPosLookupTable::get_shared(num_detectors);
+  check(table_sptr == DetPairViewTangPosLookupTable::get_shared(num_detectors), "tables should be shared");
+  check(table_sptr != DetPairViewTangPosLookupTable::get_shared(num_detectors + 2), "tables should differ for different scanners");
+  check_if_equal(table_sptr->get_num_detectors(), num_detectors, "number of detectors of table");
+
+  // (det1,det2) and (det2,det1) use the same entry, so check that swapping works
+  for (int det1 = 0; det1 < num_detectors; ++det1)
+    for (int det2 = 0; det2 < num_detectors; ++det2)
+      {
+        if (det1 == det2)
+          continue;
+        int view12, tang_pos12, view21, tang_pos21;
+        const bool swap12 = table_sptr->get_view_tangential_pos_num_for_det_num_pair(view12, tang_pos12, det1, det2);
+        const bool swap21 = table_sptr->get_view_tangential_pos_num_for_det_num_pair(view21, tang_pos21, det2, det1);
+        check_if_equal(view12, view21, "view for swapped detectors");
+        check_if_equal(tang_pos12, tang_pos21, "tang_pos for swapped detectors");
+        check(swap12 != swap21, "swap_detectors for swapped detectors");
+        int new_det1, new_det2;
+        table_sptr->get_det_num_pair_for_view_tangential_pos_num(new_det1, new_det2, view12, tang_pos12);
+        check_if_equal(swap12 ? new_det1 : new_det2, det1, "dets -> sino -> dets (det1)");
+        check_if_equal(swap12 ? new_det2 : new_det1, det2, "dets -> sino -> dets (det2)");
+      }
+}
+
 void
 ProjDataInfoCylindricalNoArcCorrTests::run_tests()
 {
   cerr << "\n-------- Testing ProjDataInfoCylindricalNoArcCorr --------\n";
+  test_det_pair_lookup_table();
   shared_ptr<Scanner> scanner_ptr(new Scanner(Scanner::E953));
   cerr << "Tests with proj_data_info without mashing and axial compression\n\n";
   // Note: test without axial compression requires that all ring differences
@@ -0,0 +1,237 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup test
+
+  \brief Test program for stir::ProjDataSparse
+
+  Compares with stir::ProjDataInMemory after setting random bins, and checks writing to and reading from file.
+  Also checks that the indices in the sparse file correspond to the layout described by its header, and that
+  stir::read_interfile_PDFS() rejects sparse data.
+
+  \author Kris Thielemans
+*/
+
+#include "stir/ProjDataSparse.h"
+#include "stir/ProjDataInMemory.h"
+#include "stir/ProjDataFromStream.h"
+#include "stir/ExamInfo.h"
+#include "stir/ProjDataInfo.h"
+#include "stir/Sinogram.h"
+#include "stir/Viewgram.h"
+#include "stir/Bin.h"
+#include "stir/Succeeded.h"
+#include "stir/RunTests.h"
+#include "stir/Scanner.h"
+#include "stir/is_null_ptr.h"
+#include "stir/IO/interfile.h"
+#include <random>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+START_NAMESPACE_STIR
+
+/*!
+  \ingroup test
+  \brief Test class for ProjDataSparse
+*/
+class ProjDataSparseTests : public RunTests
+{
+public:
+  void run_tests() override;
+
+private:
+  void run_tests_for_proj_data_info(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr, const std::string& str);
+  void check_if_equal_proj_data(const ProjData& proj_data, const ProjData& proj_data2, const std::string& str);
+};
+
+void
+ProjDataSparseTests::check_if_equal_proj_data(const ProjData& proj_data, const ProjData& proj_data2, const std::string& str)
+{
+  for (int timing_pos_num = proj_data.get_min_tof_pos_num(); timing_pos_num <= proj_data.get_max_tof_pos_num(); ++timing_pos_num)
+    for (int segment_num = proj_data.get_min_segment_num(); segment_num <= proj_data.get_max_segment_num(); ++segment_num)
+      {
+        for (int view_num = proj_data.get_min_view_num(); view_num <= proj_data.get_max_view_num(); ++view_num)
+          if (!check_if_equal(proj_data.get_viewgram(view_num, segment_num, false, timing_pos_num),
+                              proj_data2.get_viewgram(view_num, segment_num, false, timing_pos_num),
+                              str + ": viewgrams"))
+            return;
+        for (int ax_pos_num = proj_data.get_min_axial_pos_num(segment_num);
+             ax_pos_num <= proj_data.get_max_axial_pos_num(segment_num);
+             ++ax_pos_num)
+          if (!check_if_equal(proj_data.get_sinogram(ax_pos_num, segment_num, false, timing_pos_num),
+                              proj_data2.get_sinogram(ax_pos_num, segment_num, false, timing_pos_num),
+                              str + ": sinograms"))
+            return;
+      }
+}
+
+void
+ProjDataSparseTests::run_tests_for_proj_data_info(const shared_ptr<const ProjDataInfo>& proj_data_info_sptr,
+                                                  const std::string& str)
+{
+  std::cerr << "-------- Testing ProjDataSparse " << str << " --------\n";
+  shared_ptr<ExamInfo> exam_info_sptr(new ExamInfo(ImagingModality::PT));
+
+  ProjDataSparse proj_data(exam_info_sptr, proj_data_info_sptr);
+  ProjDataInMemory dense_proj_data(exam_info_sptr, proj_data_info_sptr);
+  check_if_equal(proj_data.get_num_stored_bins(), std::size_t(0), "constructor should give empty data");
+  check_if_equal(proj_data.find_max(), 0.F, "find_max of empty data");
+
+  // histogram some random "events"
+  std::mt19937 generator(42);
+  const int num_events = 2000;
+  for (int i = 0; i < num_events; ++i)
+    {
+      Bin bin;
+      bin.timing_pos_num() = std::uniform_int_distribution<int>(proj_data.get_min_tof_pos_num(),
+                                                                proj_data.get_max_tof_pos_num())(generator);
+      bin.segment_num()
+          = std::uniform_int_distribution<int>(proj_data.get_min_segment_num(), proj_data.get_max_segment_num())(generator);
+      bin.view_num() = std::uniform_int_distribution<int>(proj_data.get_min_view_num(), proj_data.get_max_view_num())(generator);
+      bin.axial_pos_num() = std::uniform_int_distribution<int>(proj_data.get_min_axial_pos_num(bin.segment_num()),
+                                                               proj_data.get_max_axial_pos_num(bin.segment_num()))(generator);
+      bin.tangential_pos_num() = std::uniform_int_distribution<int>(proj_data.get_min_tangential_pos_num(),
+                                                                    proj_data.get_max_tangential_pos_num())(generator);
+      proj_data.increment_bin_value(bin, 1.F);
+      bin.set_bin_value(dense_proj_data.get_bin_value(bin) + 1.F);
+      dense_proj_data.set_bin_value(bin);
+    }
+  check(proj_data.get_num_stored_bins() <= static_cast<std::size_t>(num_events), "number of stored bins");
+  check_if_equal(proj_data.sum(), static_cast<float>(num_events), "sum");
+  check_if_equal(proj_data.find_max(), dense_proj_data.find_max(), "find_max");
+  check_if_equal(proj_data.find_min(), 0.F, "find_min");
+  check_if_equal_proj_data(proj_data, dense_proj_data, "after increment_bin_value");
+
+  // test set_viewgram, setting some bins to zero
+  {
+    Viewgram<float> viewgram = dense_proj_data.get_viewgram(1, 0, false, proj_data.get_max_tof_pos_num());
+    viewgram.fill(0.F);
+    viewgram[viewgram.get_min_axial_pos_num()][0] = 3.F;
+    check(proj_data.set_viewgram(viewgram) == Succeeded::yes, "set_viewgram succeeded");
+    dense_proj_data.set_viewgram(viewgram);
+    check_if_equal(proj_data.get_num_stored_bins(),
+                   static_cast<std::size_t>(std::count_if(dense_proj_data.begin(),
+                                                          dense_proj_data.end(),
+                                                          [](const float value) { return value != 0; })),
+                   "set_viewgram should not store zeroes");
+  }
+  // test set_sinogram
+  {
+    Sinogram<float> sinogram = dense_proj_data.get_sinogram(0, 0, false, proj_data.get_min_tof_pos_num());
+    sinogram.fill(2.F);
+    check(proj_data.set_sinogram(sinogram) == Succeeded::yes, "set_sinogram succeeded");
+    dense_proj_data.set_sinogram(sinogram);
+  }
+  check_if_equal_proj_data(proj_data, dense_proj_data, "after set_viewgram/set_sinogram");
+
+  // test I/O
+  {
+    const std::string filename = "test_proj_data_sparse.hs";
+    check(proj_data.write_to_sparse_file(filename) == Succeeded::yes, "write_to_sparse_file succeeded");
+    check(ProjDataSparse::is_sparse_interfile_header(filename), "is_sparse_interfile_header");
+    shared_ptr<ProjData> proj_data_from_file_sptr = ProjData::read_from_file(filename);
+    check(!is_null_ptr(dynamic_pointer_cast<ProjDataSparse>(proj_data_from_file_sptr)),
+          "ProjData::read_from_file should return ProjDataSparse");
+    check(*proj_data_from_file_sptr->get_proj_data_info_sptr() == *proj_data_info_sptr, "ProjDataInfo read from file");
+    check_if_equal_proj_data(*proj_data_from_file_sptr, dense_proj_data, "read from file");
+    proj_data_from_file_sptr.reset();
+
+    // the indices in the sparse file are offsets in the dense data described by the header
+    {
+      std::ifstream input("test_proj_data_sparse.sparse", std::ios::in | std::ios::binary);
+      std::string line;
+      std::getline(input, line); // signature
+      std::getline(input, line); // byte order
+      std::getline(input, line);
+      const std::size_t num_bins = std::stoull(line.substr(line.find(":=") + 2));
+      std::vector<std::uint64_t> indices(num_bins);
+      std::vector<float> values(num_bins);
+      input.read(reinterpret_cast<char*>(indices.data()), num_bins * sizeof(std::uint64_t));
+      input.read(reinterpret_cast<char*>(values.data()), num_bins * sizeof(float));
+      check(input.good(), "reading sparse data file");
+      std::vector<float> dense_values(proj_data.size_all(), 0.F);
+      for (std::size_t i = 0; i < num_bins; ++i)
+        dense_values.at(indices[i]) = values[i];
+      std::ofstream("test_proj_data_sparse_expanded.s", std::ios::out | std::ios::binary)
+          .write(reinterpret_cast<const char*>(dense_values.data()), dense_values.size() * sizeof(float));
+      // copy the header, replacing the name of the data file
+      std::ifstream header_input(filename.c_str());
+      std::ofstream header_output("test_proj_data_sparse_expanded.hs");
+      while (std::getline(header_input, line))
+        {
+          if (line.find("name of data file") != std::string::npos)
+            line = "name of data file := test_proj_data_sparse_expanded.s";
+          header_output << line << '\n';
+        }
+    }
+    check_if_equal_proj_data(
+        *ProjData::read_from_file("test_proj_data_sparse_expanded.hs"), dense_proj_data, "sparse data expanded using the header");
+
+    // sparse data cannot be read as ProjDataFromStream
+    try
+      {
+        std::cerr << "\nThe next test should throw an error\n";
+        shared_ptr<ProjData> pdfs_sptr(read_interfile_PDFS(filename, std::ios::in));
+        check(false, "read_interfile_PDFS should reject sparse data");
+      }
+    catch (...)
+      {
+        std::cerr << "Test was ok\n";
+      }
+
+    // dense files should still be read as usual
+    dense_proj_data.write_to_file("test_proj_data_sparse_dense.hs");
+    check(!ProjDataSparse::is_sparse_interfile_header("test_proj_data_sparse_dense.hs"),
+          "is_sparse_interfile_header for dense data");
+    check_if_equal_proj_data(*ProjData::read_from_file("test_proj_data_sparse_dense.hs"), proj_data, "dense data read from file");
+
+    std::remove(filename.c_str());
+    std::remove("test_proj_data_sparse.sparse");
+    std::remove("test_proj_data_sparse_dense.hs");
+    std::remove("test_proj_data_sparse_dense.s");
+    std::remove("test_proj_data_sparse_expanded.hs");
+    std::remove("test_proj_data_sparse_expanded.s");
+  }
+
+  proj_data.fill(0.F);
+  check_if_equal(proj_data.get_num_stored_bins(), std::size_t(0), "fill(0)");
+}
+
+void
+ProjDataSparseTests::run_tests()
+{
+  shared_ptr<Scanner> scanner_sptr(new Scanner(Scanner::E953));
+  shared_ptr<const ProjDataInfo> proj_data_info_sptr(
+      ProjDataInfo::ProjDataInfoCTI(scanner_sptr, /*span*/ 1, 3, /*views*/ 48, /*tang_pos*/ 64, /*arc_corrected*/ false));
+  run_tests_for_proj_data_info(proj_data_info_sptr, "without TOF");
+
+  shared_ptr<Scanner> TOF_scanner_sptr(new Scanner(Scanner::PETMR_Signa));
+  shared_ptr<const ProjDataInfo> TOF_proj_data_info_sptr(ProjDataInfo::ProjDataInfoCTI(
+      TOF_scanner_sptr, /*span*/ 1, 2, /*views*/ 28, /*tang_pos*/ 32, /*arc_corrected*/ false, /*tof_mashing*/ 117));
+  run_tests_for_proj_data_info(TOF_proj_data_info_sptr, "with TOF");
+}
+
+END_NAMESPACE_STIR
+
+USING_NAMESPACE_STIR
+
+int
+main()
+{
+  ProjDataSparseTests tests;
+  tests.run_tests();
+  return tests.main_return_value();
+}
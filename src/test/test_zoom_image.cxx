@@ -2,6 +2,7 @@
 //
 /*
     Copyright (C) 2006- 2007,  Hammersmith Imanet Ltd
+    Copyright (C) 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -19,8 +20,12 @@
 */
 
 #include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/PixelsOnCartesianGrid.h"
 #include "stir/IndexRange.h"
+#include "stir/IndexRange2D.h"
+#include "stir/IndexRange3D.h"
 #include "stir/zoom.h"
+#include "stir/interpolate.h"
 #include "stir/centre_of_gravity.h"
 
 #include <iostream>
@@ -36,13 +41,88 @@ START_NAMESPACE_STIR
   The tests check if a point source remains in the same physical location
   after zooming. This is done by checking the centre of gravity of the
   zoomed image.
+
+  In addition, the result of zoom_image is compared with applying overlap_interpolate
+  along every dimension.
 */
 class zoom_imageTests : public RunTests
 {
 public:
   void run_tests() override;
+
+private:
+  void run_tests_for_overlap_interpolate();
 };
 
+void
+zoom_imageTests::run_tests_for_overlap_interpolate()
+{
+  std::cerr << "Comparing zoom_image with overlap_interpolate\n";
+
+  const IndexRange<3> range(CartesianCoordinate3D<int>(-2, -12, -11), CartesianCoordinate3D<int>(6, 13, 12));
+  VoxelsOnCartesianGrid<float> image(range, CartesianCoordinate3D<float>(1.F, 2.F, 3.F), CartesianCoordinate3D<float>(3, 4, 5));
+  for (int z = image.get_min_z(); z <= image.get_max_z(); ++z)
+    for (int y = image.get_min_y(); y <= image.get_max_y(); ++y)
+      for (int x = image.get_min_x(); x <= image.get_max_x(); ++x)
+        image[z][y][x] = 1.F + static_cast<float>(sin(z * 1.1 + y * .7 + x * .3));
+
+  // zooms larger and smaller than 1
+  for (int test_num = 0; test_num < 2; ++test_num)
+    {
+      const CartesianCoordinate3D<float> new_grid_spacing
+          = test_num == 0 ? CartesianCoordinate3D<float>(2.2F, 3.1F, 4.3F) : CartesianCoordinate3D<float>(4.1F, 5.3F, 6.7F);
+      VoxelsOnCartesianGrid<float> new_image(IndexRange<3>(CartesianCoordinate3D<int>(-1, -16, -17),
+                                                           CartesianCoordinate3D<int>(7, 15, 20)),
+                                             CartesianCoordinate3D<float>(4.F, 5.F, 6.F),
+                                             new_grid_spacing);
+      zoom_image(new_image, image);
+
+      // zoom and offsets as documented in zoom_image
+      const CartesianCoordinate3D<float> zooms = image.get_voxel_size() / new_image.get_voxel_size();
+      const CartesianCoordinate3D<float> offsets = (new_image.get_origin() - image.get_origin()) / image.get_voxel_size();
+      Array<3, float> temp(IndexRange3D(image.get_min_z(),
+                                        image.get_max_z(),
+                                        image.get_min_y(),
+                                        image.get_max_y(),
+                                        new_image.get_min_x(),
+                                        new_image.get_max_x()));
+      for (int z = image.get_min_z(); z <= image.get_max_z(); ++z)
+        for (int y = image.get_min_y(); y <= image.get_max_y(); ++y)
+          overlap_interpolate(temp[z][y], image[z][y], zooms.x(), offsets.x());
+      Array<3, float> temp2(IndexRange3D(image.get_min_z(),
+                                         image.get_max_z(),
+                                         new_image.get_min_y(),
+                                         new_image.get_max_y(),
+                                         new_image.get_min_x(),
+                                         new_image.get_max_x()));
+      for (int z = image.get_min_z(); z <= image.get_max_z(); ++z)
+        overlap_interpolate(temp2[z], temp[z], zooms.y(), offsets.y());
+      Array<3, float> expected(new_image.get_index_range());
+      overlap_interpolate(expected, temp2, zooms.z(), offsets.z());
+
+      check_if_equal(expected, new_image, "test on zoom_image vs overlap_interpolate");
+
+      // check scaling
+      VoxelsOnCartesianGrid<float> new_image_preserve_values(
+          new_image.get_index_range(), new_image.get_origin(), new_grid_spacing);
+      zoom_image(new_image_preserve_values, image, ZoomOptions::preserve_values);
+      expected *= zooms.x() * zooms.y() * zooms.z();
+      check_if_equal(expected, new_image_preserve_values, "test on zoom_image with preserve_values vs overlap_interpolate");
+
+      // 2D version
+      const int z = 2;
+      PixelsOnCartesianGrid<float> plane = image.get_plane(z);
+      PixelsOnCartesianGrid<float> new_plane(
+          IndexRange2D(new_image.get_min_y(), new_image.get_max_y(), new_image.get_min_x(), new_image.get_max_x()),
+          new_image.get_origin(),
+          Coordinate2D<float>(new_grid_spacing.y(), new_grid_spacing.x()));
+      zoom_image(new_plane, plane);
+      Array<2, float> expected_plane(new_plane.get_index_range());
+      overlap_interpolate(expected_plane, temp[z], zooms.y(), offsets.y());
+      check_if_equal(expected_plane, new_plane, "test on 2D zoom_image vs overlap_interpolate");
+    }
+}
+
 void
 zoom_imageTests::run_tests()
 
@@ -131,6 +211,8 @@ zoom_imageTests::run_tests()
           new_image.get_voxel_size(), image.get_voxel_size() / zooms, "test on multiple argument (2d) zoom_image: voxel size");
     }
   }
+
+  run_tests_for_overlap_interpolate();
 }
 
 END_NAMESPACE_STIR
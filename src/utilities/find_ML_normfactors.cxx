@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2001- 2008, Hammersmith Imanet Ltd
-    Copyright (C) 2019-2020, University College London
+    Copyright (C) 2019-2020, 2026, University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -101,9 +101,10 @@ END_NAMESPACE_STIR
 static void
 print_usage_and_exit(const std::string& program_name)
 {
-  std::cerr << "Usage: " << program_name << " [--display | --print-KL | --include-block-timing-model] \\\n"
+  std::cerr << "Usage: " << program_name << " [--display | --print-KL | --KL-interval n | --include-block-timing-model] \\\n"
             << " out_filename_prefix measured_data model num_iterations num_eff_iterations\n"
-            << " set num_iterations to 0 to do only efficiencies\n";
+            << " set num_iterations to 0 to do only efficiencies\n"
+            << " with --print-KL, the KL divergence is computed every n (sub)iterations (default 1), and at the end\n";
   exit(EXIT_FAILURE);
 }
 
@@ -120,6 +121,7 @@ main(int argc, char** argv)
   // check_geo_data();
   bool do_display = false;
   bool do_KL = false;
+  int KL_interval = 1;
   bool do_block = false;
 
   // first process command line options
@@ -137,6 +139,14 @@ main(int argc, char** argv)
           --argc;
           ++argv;
         }
+      else if (strcmp(argv[0], "--KL-interval") == 0 && argc > 1)
+        {
+          KL_interval = atoi(argv[1]);
+          if (KL_interval < 1)
+            print_usage_and_exit(program_name);
+          argc -= 2;
+          argv += 2;
+        }
       else if (strcmp(argv[0], "--include-block-timing-model") == 0)
         {
           do_block = true;
@@ -171,28 +181,38 @@ main(int argc, char** argv)
   timer.start();
 
   const int segment_num = 0;
-  DetPairData det_pair_data;
-  DetPairData model_det_pair_data;
-  Array<1, float> data_fan_sums(num_detectors);
-  Array<1, float> efficiencies(num_detectors);
   assert(num_crystals_per_block % 2 == 0);
-  GeoData measured_geo_data(IndexRange2D(num_crystals_per_block / 2, num_detectors));
-  GeoData norm_geo_data(IndexRange2D(num_crystals_per_block / 2, num_detectors));
-  BlockData measured_block_data(IndexRange2D(num_blocks, num_blocks));
-  BlockData norm_block_data(IndexRange2D(num_blocks, num_blocks));
 
+  // sinograms are processed independently, so we can do this in parallel (but not when displaying)
+#ifdef STIR_OPENMP
+#  pragma omp parallel for schedule(dynamic) if (!do_display)
+#endif
   for (int ax_pos_num = measured_data->get_min_axial_pos_num(segment_num);
        ax_pos_num <= measured_data->get_max_axial_pos_num(segment_num);
        ++ax_pos_num)
     {
+      DetPairData det_pair_data;
+      DetPairData model_det_pair_data;
+      Array<1, float> data_fan_sums(num_detectors);
+      Array<1, float> efficiencies(num_detectors);
+      GeoData measured_geo_data(IndexRange2D(num_crystals_per_block / 2, num_detectors));
+      GeoData norm_geo_data(IndexRange2D(num_crystals_per_block / 2, num_detectors));
+      BlockData measured_block_data(IndexRange2D(num_blocks, num_blocks));
+      BlockData norm_block_data(IndexRange2D(num_blocks, num_blocks));
       // next could be local if KL is not computed below
       DetPairData measured_det_pair_data;
       float threshold_for_KL;
       // compute factors dependent on the data
       {
-        make_det_pair_data(measured_det_pair_data, *measured_data, segment_num, ax_pos_num);
+#ifdef STIR_OPENMP
+#  pragma omp critical(FIND_ML_NORMFACTORS_READ)
+#endif
+        {
+          make_det_pair_data(measured_det_pair_data, *measured_data, segment_num, ax_pos_num);
+          make_det_pair_data(model_det_pair_data, *model_data, segment_num, ax_pos_num);
+        }
         threshold_for_KL = measured_det_pair_data.find_max() / 100000.F;
-        std::cerr << "ax_pos " << ax_pos_num << std::endl;
+        info(boost::format("ax_pos %1%") % ax_pos_num);
         // display(measured_det_pair_data, "measured data");
 
         make_fan_sum_data(data_fan_sums, measured_det_pair_data);
@@ -211,11 +231,13 @@ main(int argc, char** argv)
         */
       }
 
-      make_det_pair_data(model_det_pair_data, *model_data, segment_num, ax_pos_num);
       // display(model_det_pair_data, "model");
 
-      for (int iter_num = 1; iter_num <= std::max(num_iterations, 1); ++iter_num)
+      const int last_iter_num = std::max(num_iterations, 1);
+      for (int iter_num = 1; iter_num <= last_iter_num; ++iter_num)
         {
+          // only compute the KL every KL_interval iterations (and at the end)
+          const bool do_KL_this_iter = do_KL && (iter_num % KL_interval == 0 || iter_num == last_iter_num);
           if (iter_num == 1)
             {
               efficiencies.fill(sqrt(data_fan_sums.sum() / model_det_pair_data.sum()));
@@ -240,7 +262,7 @@ main(int argc, char** argv)
                   out << efficiencies;
                   delete[] out_filename;
                 }
-                if (do_KL)
+                if (do_KL_this_iter && (eff_iter_num % KL_interval == 0 || eff_iter_num == num_eff_iterations))
                   {
                     DetPairData model_times_norm = det_pair_data;
                     apply_efficiencies(model_times_norm, efficiencies);
@@ -249,7 +271,8 @@ main(int argc, char** argv)
                     // std::cerr << "model_times_norm min max: " << model_times_norm.find_min() << ',' <<
                     // model_times_norm.find_max() << std::endl;
 
-                    std::cerr << "KL " << KL(measured_det_pair_data, model_times_norm, threshold_for_KL) << std::endl;
+                    info(boost::format("ax_pos %1%: KL %2%") % ax_pos_num
+                         % KL(measured_det_pair_data, model_times_norm, threshold_for_KL));
                   }
                 if (do_display)
                   {
@@ -281,14 +304,15 @@ main(int argc, char** argv)
               out << norm_geo_data;
               delete[] out_filename;
             }
-            if (do_KL)
+            if (do_KL_this_iter)
               {
                 apply_geo_norm(det_pair_data, norm_geo_data);
                 for (int a = det_pair_data.get_min_index(); a <= det_pair_data.get_max_index(); ++a)
                   for (int b = det_pair_data.get_min_index(a); b <= det_pair_data.get_max_index(a); ++b)
                     if (det_pair_data(a, b) == 0 && measured_det_pair_data(a, b) != 0)
                       warning("geo 0 at a=%d b=%d measured value=%g\n", a, b, measured_det_pair_data(a, b));
-                std::cerr << "KL " << KL(measured_det_pair_data, det_pair_data, threshold_for_KL) << std::endl;
+                info(boost::format("ax_pos %1%: KL %2%") % ax_pos_num
+                     % KL(measured_det_pair_data, det_pair_data, threshold_for_KL));
               }
             if (do_display)
               {
@@ -320,10 +344,11 @@ main(int argc, char** argv)
               out << norm_block_data;
               delete[] out_filename;
             }
-            if (do_block && do_KL)
+            if (do_block && do_KL_this_iter)
               {
                 apply_block_norm(det_pair_data, norm_block_data);
-                std::cerr << "KL " << KL(measured_det_pair_data, det_pair_data, threshold_for_KL) << std::endl;
+                info(boost::format("ax_pos %1%: KL %2%") % ax_pos_num
+                     % KL(measured_det_pair_data, det_pair_data, threshold_for_KL));
               }
             if (do_block && do_display)
               {
@@ -1,6 +1,6 @@
 /*
     Copyright (C) 2002, Hammersmith Imanet Ltd
-    Copyright (C) 2020, 2022 University College London
+    Copyright (C) 2020, 2022, 2026 University College London
     This file is part of STIR.
 
     SPDX-License-Identifier: Apache-2.0
@@ -29,9 +29,10 @@ static void
 print_usage_and_exit(const std::string& program_name)
 {
   std::cerr << "Usage: " << program_name
-            << " [--display | --print-KL | --include-block-timing-model | --for-symmetry-per-block] \\\n"
+            << " [--display | --print-KL | --KL-interval n | --include-block-timing-model | --for-symmetry-per-block] \\\n"
             << " out_filename_prefix measured_data model num_iterations num_eff_iterations\n"
-            << " set num_iterations to 0 to do only efficiencies\n";
+            << " set num_iterations to 0 to do only efficiencies\n"
+            << " with --print-KL, the KL divergence is computed every n (sub)iterations (default 1), and at the end\n";
   exit(EXIT_FAILURE);
 }
 
@@ -47,6 +48,7 @@ main(int argc, char** argv)
 
   bool do_display = false;
   bool do_KL = false;
+  int KL_interval = 1;
   bool do_geo = true;
   bool do_block = false;
   bool do_symmetry_per_block = false;
@@ -66,6 +68,14 @@ main(int argc, char** argv)
           --argc;
           ++argv;
         }
+      else if (strcmp(argv[0], "--KL-interval") == 0 && argc > 1)
+        {
+          KL_interval = atoi(argv[1]);
+          if (KL_interval < 1)
+            print_usage_and_exit(program_name);
+          argc -= 2;
+          argv += 2;
+        }
       else if (strcmp(argv[0], "--include-geometric-model") == 0)
         {
           do_geo = true;
@@ -114,7 +124,8 @@ main(int argc, char** argv)
                                             do_block,
                                             do_symmetry_per_block,
                                             do_KL,
-                                            do_display);
+                                            do_display,
+                                            KL_interval);
 
   timer.stop();
   info(boost::format("CPU time %1% secs") % timer.value());
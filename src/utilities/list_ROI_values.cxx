@@ -12,40 +12,16 @@
 
   \brief Utility program for getting ROI values
 
-  The .par file has the following format
-  \verbatim
-  ROIValues Parameters :=
-
-  ; give the ROI an (optional) name. Defaults to the empty string.
-  ROI name := some name
-  ; see Shape3D hierarchy for possible values
-  ROI Shape type:=ellipsoid
-  ;; ellipsoid parameters here
-
-  ; if more than 1 ROI is desired, you can do this
-  next shape :=
-  ROI name := some other name
-  ROI Shape type:=ellipsoidal cylinder
-  ;; parameters here
-
-  number of samples to take for ROI template-z:=1
-  number of samples to take for ROI template-y:=1
-  number of samples to take for ROI template-x:=1
-
-  ; specify (optional) filter to apply before computing ROI values
-  ; see ImageProcessor hierarchy for possible values
-  Image Filter type:=None
-  End:=
-  \endverbatim
+  See stir::ROIValuesParameters for the format of the .par file.
 
   \author Kris Thielemans
 */
 #include "stir/utilities.h"
 #include "stir/evaluation/compute_ROI_values.h"
+#include "stir/evaluation/ROIValuesParameters.h"
 #include "stir/Shape/DiscretisedShape3D.h"
 #include "stir/VoxelsOnCartesianGrid.h"
 #include "stir/DataProcessor.h"
-#include "stir/KeyParser.h"
 #include "stir/is_null_ptr.h"
 #include "stir/IO/read_from_file.h"
 #include "stir/warning.h"
@@ -59,99 +35,6 @@ using std::cerr;
 using std::endl;
 using std::ofstream;
 
-START_NAMESPACE_STIR
-// TODO repetition of postfilter.cxx to be able to use its .par file
-class ROIValuesParameters : public KeyParser
-{
-public:
-  ROIValuesParameters();
-  virtual void set_defaults();
-  virtual void initialise_keymap();
-  bool post_processing() override;
-  std::vector<shared_ptr<Shape3D>> shape_ptrs;
-  std::vector<std::string> shape_names;
-  CartesianCoordinate3D<int> num_samples;
-  shared_ptr<DataProcessor<DiscretisedDensity<3, float>>> filter_ptr;
-
-private:
-  shared_ptr<Shape3D> current_shape_sptr;
-  std::string current_shape_name;
-  void increment_current_shape_num();
-};
-
-ROIValuesParameters::ROIValuesParameters()
-{
-  set_defaults();
-  initialise_keymap();
-}
-
-void
-ROIValuesParameters::increment_current_shape_num()
-{
-  if (!is_null_ptr(current_shape_sptr))
-    {
-      shape_ptrs.push_back(current_shape_sptr);
-      shape_names.push_back(current_shape_name);
-      current_shape_sptr.reset();
-      current_shape_name = "";
-    }
-}
-
-void
-ROIValuesParameters::set_defaults()
-{
-  shape_ptrs.resize(0);
-  shape_names.resize(0);
-
-  filter_ptr.reset();
-  current_shape_sptr.reset();
-  current_shape_name = "";
-  num_samples = CartesianCoordinate3D<int>(1, 1, 1);
-}
-
-void
-ROIValuesParameters::initialise_keymap()
-{
-  add_start_key("ROIValues Parameters");
-  add_key("ROI name", &current_shape_name);
-  add_parsing_key("ROI Shape type", &current_shape_sptr);
-  add_key("next shape", KeyArgument::NONE, (KeywordProcessor)&ROIValuesParameters::increment_current_shape_num);
-  add_key("number of samples to take for ROI template-z", &num_samples.z());
-  add_key("number of samples to take for ROI template-y", &num_samples.y());
-  add_key("number of samples to take for ROI template-x", &num_samples.x());
-  add_parsing_key("Image Filter type", &filter_ptr);
-  add_stop_key("END");
-}
-
-bool
-ROIValuesParameters::post_processing()
-{
-  assert(shape_names.size() == shape_ptrs.size());
-
-  if (!is_null_ptr(current_shape_sptr))
-    {
-      increment_current_shape_num();
-    }
-  if (num_samples.z() <= 0)
-    {
-      warning("number of samples to take in z-direction should be strictly positive\n");
-      return true;
-    }
-  if (num_samples.y() <= 0)
-    {
-      warning("number of samples to take in y-direction should be strictly positive\n");
-      return true;
-    }
-  if (num_samples.x() <= 0)
-    {
-      warning("number of samples to take in x-direction should be strictly positive\n");
-      return true;
-    }
-  return false;
-}
-
-END_NAMESPACE_STIR
-
 USING_NAMESPACE_STIR
 
 int
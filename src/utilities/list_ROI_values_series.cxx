@@ -0,0 +1,230 @@
+/*
+    Copyright (C) 2026, University College London
+    This file is part of STIR.
+
+    SPDX-License-Identifier: Apache-2.0
+
+    See STIR/LICENSE.txt for details
+*/
+/*!
+  \file
+  \ingroup utilities
+
+  \brief Utility program for getting ROI values for all frames of a dynamic or gated image
+
+  \par Usage
+  \verbatim
+  list_ROI_values_series [--gated] [--json] output_filename image_series ROI_filename.par
+  list_ROI_values_series [--gated] [--json] [--filter filter_filename.par] \
+       output_filename image_series --labels label_image label1 [label2 ...]
+  \endverbatim
+  \a image_series is read as a stir::DynamicDiscretisedDensity, or as a stir::GatedDiscretisedDensity
+  when \c --gated is given (see stir::GatedDiscretisedDensity::read_from_files()).
+
+  ROIs are either specified as shapes in a .par file (see stir::ROIValuesParameters), or as
+  a number of labels in a label image (on the same grid as the images).
+  The .par file can specify a filter that is applied to every frame before computing the values.
+  When using labels, this can be done with \c --filter, whose file has the same format as the
+  ROI .par file, but only its filter is used (it cannot specify any shapes).
+  All ROIs are discretised only once. For every frame (or gate), values for all ROIs are then computed
+  in a single (multi-threaded) pass, see stir::compute_total_ROI_values(). The values for a frame
+  are written (and flushed) as soon as they are computed.
+
+  The output is in CSV format, with one line per (frame, ROI) combination, listing
+  mean, stddev, min, max and volume (in mm^3). With \c --json, a JSON array of objects
+  with the same information is written instead.
+
+  \author Kris Thielemans
+*/
+#include "stir/evaluation/compute_ROI_values.h"
+#include "stir/evaluation/ROIValuesParameters.h"
+#include "stir/evaluation/SparseROIMask.h"
+#include "stir/DynamicDiscretisedDensity.h"
+#include "stir/GatedDiscretisedDensity.h"
+#include "stir/VoxelsOnCartesianGrid.h"
+#include "stir/IO/read_from_file.h"
+#include "stir/is_null_ptr.h"
+#include "stir/error.h"
+#include <boost/format.hpp>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+USING_NAMESPACE_STIR
+
+static std::string
+json_quote(const std::string& s)
+{
+  std::string result = "\"";
+  for (const char c : s)
+    {
+      if (c == '"' || c == '\\')
+        result += '\\';
+      result += c;
+    }
+  return result + '"';
+}
+
+static void
+print_usage_and_exit(const char* const progname)
+{
+  std::cerr << "\nUsage:\n"
+            << progname << " [--gated] [--json] output_filename image_series ROI_filename.par\n"
+            << progname << " [--gated] [--json] [--filter filter_filename.par] \\\n"
+            << "     output_filename image_series --labels label_image label1 [label2 ...]\n"
+            << "The image series is read as a dynamic image, unless --gated is given.\n"
+            << "--filter can only be used with --labels (otherwise, specify the filter in ROI_filename.par).\n"
+            << "Output is in CSV format, unless --json is given.\n";
+  exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char* argv[])
+{
+  const char* const progname = argv[0];
+  bool gated = false;
+  bool json = false;
+  std::string filter_filename;
+
+  while (argc > 1 && strncmp(argv[1], "--", 2) == 0)
+    {
+      if (strcmp(argv[1], "--gated") == 0)
+        gated = true;
+      else if (strcmp(argv[1], "--json") == 0)
+        json = true;
+      else if (strcmp(argv[1], "--filter") == 0)
+        {
+          if (argc < 3)
+            print_usage_and_exit(progname);
+          filter_filename = argv[2];
+          --argc;
+          ++argv;
+        }
+      else
+        error(boost::format("Unknown option %s") % argv[1]);
+      --argc;
+      ++argv;
+    }
+
+  const bool use_labels = argc > 3 && strcmp(argv[3], "--labels") == 0;
+  if ((use_labels && argc < 6) || (!use_labels && argc != 4))
+    print_usage_and_exit(progname);
+  if (!use_labels && !filter_filename.empty())
+    error("list_ROI_values_series: --filter can only be used with --labels. Specify the filter in the ROI .par file instead.");
+
+  const std::string output_filename = argv[1];
+  const std::string input_filename = argv[2];
+
+  // read images
+  shared_ptr<DynamicDiscretisedDensity> dyn_sptr;
+  shared_ptr<GatedDiscretisedDensity> gated_sptr;
+  std::function<DiscretisedDensity<3, float>&(unsigned int)> get_density;
+  unsigned int num_frames;
+  if (gated)
+    {
+      gated_sptr.reset(GatedDiscretisedDensity::read_from_files(input_filename));
+      num_frames = gated_sptr->get_num_gates();
+      get_density = [&gated_sptr](unsigned int gate_num) -> DiscretisedDensity<3, float>& {
+        return gated_sptr->get_density(gate_num);
+      };
+    }
+  else
+    {
+      dyn_sptr = read_from_file<DynamicDiscretisedDensity>(input_filename);
+      num_frames = dyn_sptr->get_num_time_frames();
+      get_density = [&dyn_sptr](unsigned int frame_num) -> DiscretisedDensity<3, float>& {
+        return dyn_sptr->get_density(frame_num);
+      };
+    }
+  if (num_frames == 0)
+    error("list_ROI_values_series: no images found in " + input_filename);
+
+  // construct masks
+  std::vector<SparseROIMask> masks;
+  std::vector<std::string> names;
+  shared_ptr<DataProcessor<DiscretisedDensity<3, float>>> filter_sptr;
+  if (use_labels)
+    {
+      shared_ptr<DiscretisedDensity<3, float>> label_image_sptr(read_from_file<DiscretisedDensity<3, float>>(argv[4]));
+      std::vector<int> labels;
+      for (int arg_num = 5; arg_num < argc; ++arg_num)
+        {
+          labels.push_back(atoi(argv[arg_num]));
+          names.push_back(argv[arg_num]);
+        }
+      masks = SparseROIMask::construct_from_label_image(*label_image_sptr, labels);
+      if (!filter_filename.empty())
+        {
+          ROIValuesParameters parameters;
+          if (parameters.parse(filter_filename.c_str()) == false)
+            exit(EXIT_FAILURE);
+          if (!parameters.shape_ptrs.empty())
+            error("list_ROI_values_series: " + filter_filename + " specifies ROI shapes, which cannot be used with --labels");
+          filter_sptr = parameters.filter_ptr;
+        }
+    }
+  else
+    {
+      ROIValuesParameters parameters;
+      if (parameters.parse(argv[3]) == false)
+        exit(EXIT_FAILURE);
+      const VoxelsOnCartesianGrid<float>* template_ptr = dynamic_cast<const VoxelsOnCartesianGrid<float>*>(&get_density(1));
+      if (!template_ptr)
+        error("list_ROI_values_series: can only handle images of type VoxelsOnCartesianGrid");
+      for (std::size_t shape_num = 0; shape_num < parameters.shape_ptrs.size(); ++shape_num)
+        masks.emplace_back(*parameters.shape_ptrs[shape_num], *template_ptr, parameters.num_samples);
+      names = parameters.shape_names;
+      filter_sptr = parameters.filter_ptr;
+    }
+
+  std::ofstream out(output_filename.c_str());
+  if (!out)
+    error("list_ROI_values_series: cannot open output file " + output_filename);
+  out << std::setprecision(8);
+
+  const std::string frame_key = gated ? "gate" : "frame";
+  if (json)
+    out << "[";
+  else
+    out << frame_key << ",ROI,mean,stddev,min,max,volume\n";
+
+  bool first_entry = true;
+  std::vector<ROIValues> values;
+  for (unsigned int frame_num = 1; frame_num <= num_frames; ++frame_num)
+    {
+      DiscretisedDensity<3, float>& density = get_density(frame_num);
+      if (!is_null_ptr(filter_sptr))
+        filter_sptr->apply(density);
+      // multi-threaded over all (mask, plane) combinations
+      compute_total_ROI_values(values, density, masks);
+
+      for (std::size_t mask_num = 0; mask_num < masks.size(); ++mask_num)
+        {
+          const ROIValues& v = values[mask_num];
+          if (json)
+            {
+              out << (first_entry ? "\n" : ",\n") << "  {\"" << frame_key << "\": " << frame_num
+                  << ", \"ROI\": " << json_quote(names[mask_num]) << ", \"mean\": " << v.get_mean()
+                  << ", \"stddev\": " << v.get_stddev() << ", \"min\": " << v.get_min() << ", \"max\": " << v.get_max()
+                  << ", \"volume\": " << v.get_roi_volume() << "}";
+            }
+          else
+            {
+              out << frame_num << ',' << names[mask_num] << ',' << v.get_mean() << ',' << v.get_stddev() << ',' << v.get_min()
+                  << ',' << v.get_max() << ',' << v.get_roi_volume() << '\n';
+            }
+          first_entry = false;
+        }
+      // make results available while the next frame is processed
+      out.flush();
+    }
+  if (json)
+    out << "\n]\n";
+
+  return out ? EXIT_SUCCESS : EXIT_FAILURE;
+}